@@ -809,55 +809,133 @@ void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
                                    double fuzzy_amount_difference,
                                    gint match_date_hardlimit)
 {
-    GList * list_element;
-    Query *query = qof_query_create_for(GNC_ID_SPLIT);
+    GList trans_infos = { trans_info, NULL, NULL };
     g_assert (trans_info);
 
-    /* Get list of splits of the originating account. */
+    gnc_import_find_split_matches_list (&trans_infos, process_threshold,
+                                        fuzzy_amount_difference,
+                                        match_date_hardlimit);
+}
+
+/** Index of the first split in the date ordered array splits that was posted
+    on or after date. */
+static guint
+first_split_posted_from (GPtrArray *splits, time64 date)
+{
+    guint low = 0, high = splits->len;
+
+    while (low < high)
     {
-        /* We used to traverse *all* splits of the account by using
-           xaccAccountGetSplitList, which is a bad idea because 90% of these
-           splits are outside the date range that is interesting. We should
-           rather use a query according to the date region, which is
-           implemented here.
-        */
+        guint mid = low + (high - low) / 2;
+        Split *split = g_ptr_array_index (splits, mid);
+
+        if (xaccTransGetDate (xaccSplitGetParent (split)) < date)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/** /brief Find the matching splits for all the given transactions at once.
+
+   We used to create and run one query for each imported transaction. Instead
+   there is now one single query matching the full date range and all
+   accounts in question. Its splits are grouped by account, and every
+   transaction is only compared with the splits of its account that lie
+   within match_date_hardlimit days of it. */
+void gnc_import_find_split_matches_list (GList *trans_infos,
+                                         gint process_threshold,
+                                         double fuzzy_amount_difference,
+                                         gint match_date_hardlimit)
+{
+    GHashTable *candidates;
+    GList *accounts = NULL, *node;
+    time64 range = (time64) match_date_hardlimit * 86400;
+    time64 min_time = G_MAXINT64, max_time = G_MININT64;
+
+    if (trans_infos == NULL)
+        return;
+
+    /* One array of candidate splits per originating account. */
+    candidates = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                        (GDestroyNotify) g_ptr_array_unref);
+    for (node = trans_infos; node; node = g_list_next (node))
+    {
+        GNCImportTransInfo *trans_info = node->data;
         Account *importaccount =
             xaccSplitGetAccount (gnc_import_TransInfo_get_fsplit (trans_info));
-        time64 download_time = xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+        time64 download_time =
+            xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+
+        if (importaccount == NULL)
+            continue;
+        if (!g_hash_table_contains (candidates, importaccount))
+        {
+            g_hash_table_insert (candidates, importaccount, g_ptr_array_new ());
+            accounts = g_list_prepend (accounts, importaccount);
+        }
+        min_time = MIN (min_time, download_time);
+        max_time = MAX (max_time, download_time);
+    }
+
+    if (accounts != NULL)
+    {
+        Query *query = qof_query_create_for (GNC_ID_SPLIT);
+        GList *splits;
 
-        qof_query_set_book (query, gnc_get_current_book());
-        xaccQueryAddSingleAccountMatch (query, importaccount,
-                                        QOF_QUERY_AND);
+        qof_query_set_book (query, gnc_get_current_book ());
+        xaccQueryAddAccountMatch (query, accounts, QOF_GUID_MATCH_ANY,
+                                  QOF_QUERY_AND);
         xaccQueryAddDateMatchTT (query,
-                                 TRUE, download_time - match_date_hardlimit * 86400,
-                                 TRUE, download_time + match_date_hardlimit * 86400,
+                                 TRUE, min_time - range,
+                                 TRUE, max_time + range,
                                  QOF_QUERY_AND);
-        list_element = qof_query_run (query);
-        /* Sigh. Doesn't help too much. We still create and run one query
-           for each imported transaction. Maybe it would improve
-           performance further if there is one single (master-)query at
-           the beginning, matching the full date range and all accounts in
-           question. However, this doesn't quite work because this function
-           here is called from each gnc_gen_trans_list_add_trans(), which
-           is called one at a time. Therefore the whole importer would
-           have to change its behaviour: Accept the imported txns via
-           gnc_gen_trans_list_add_trans(), and only when
-           gnc_gen_trans_list_run() is called, then calculate all the
-           different match candidates. That's too much work for now.
-        */
+
+        /* The query returns the splits in the default split order, which
+           sorts by date posted first, so every account's array ends up
+           sorted by date as well. */
+        for (splits = qof_query_run (query); splits; splits = g_list_next (splits))
+        {
+            Split *split = splits->data;
+            GPtrArray *account_splits =
+                g_hash_table_lookup (candidates, xaccSplitGetAccount (split));
+
+            if (account_splits)
+                g_ptr_array_add (account_splits, split);
+        }
+        qof_query_destroy (query);
+        g_list_free (accounts);
     }
 
-    /* Traverse that list, calling split_find_match on each one. Note
-       that xaccAccountForEachSplit is declared in Account.h but
-       implemented nowhere :-( */
-    while (list_element != NULL)
+    for (node = trans_infos; node; node = g_list_next (node))
     {
-        split_find_match (trans_info, list_element->data,
-                          process_threshold, fuzzy_amount_difference);
-        list_element = g_list_next (list_element);
+        GNCImportTransInfo *trans_info = node->data;
+        Account *importaccount =
+            xaccSplitGetAccount (gnc_import_TransInfo_get_fsplit (trans_info));
+        time64 download_time =
+            xaccTransGetDate (gnc_import_TransInfo_get_trans (trans_info));
+        GPtrArray *account_splits;
+        guint i;
+
+        if (importaccount == NULL)
+            continue;
+        account_splits = g_hash_table_lookup (candidates, importaccount);
+
+        for (i = first_split_posted_from (account_splits, download_time - range);
+                i < account_splits->len; i++)
+        {
+            Split *split = g_ptr_array_index (account_splits, i);
+
+            if (xaccTransGetDate (xaccSplitGetParent (split)) >
+                    download_time + range)
+                break;
+            split_find_match (trans_info, split,
+                              process_threshold, fuzzy_amount_difference);
+        }
     }
 
-    qof_query_destroy (query);
+    g_hash_table_destroy (candidates);
 }
 
 
@@ -1191,23 +1269,14 @@ static gint compare_probability (gconstpointer a,
            ((GNCImportMatchInfo *)a)->probability);
 }
 
-/** Iterates through all splits of the originating account of
- * trans_info. Sorts the resulting list and sets the selected_match
- * and action fields in the trans_info.
+/** Sorts the match list of trans_info and sets the selected_match and
+ * action fields from its best match.
  */
-void
-gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
-                                   GNCImportSettings *settings)
+static void
+select_best_match (GNCImportTransInfo *trans_info,
+                   GNCImportSettings *settings)
 {
     GNCImportMatchInfo * best_match = NULL;
-    g_assert (trans_info);
-
-
-    /* Find all split matches in originating account. */
-    gnc_import_find_split_matches(trans_info,
-                                  gnc_import_Settings_get_display_threshold (settings),
-                                  gnc_import_Settings_get_fuzzy_amount (settings),
-                                  gnc_import_Settings_get_match_date_hardlimit (settings));
 
     if (trans_info->match_list != NULL)
     {
@@ -1257,6 +1326,40 @@ gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
     trans_info->previous_action = trans_info->action;
 }
 
+/** Iterates through all splits of the originating account of
+ * trans_info. Sorts the resulting list and sets the selected_match
+ * and action fields in the trans_info.
+ */
+void
+gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
+                                   GNCImportSettings *settings)
+{
+    GList trans_infos = { trans_info, NULL, NULL };
+    g_assert (trans_info);
+
+    gnc_import_TransInfo_init_matches_list (&trans_infos, settings);
+}
+
+/** Finds the matches of all the GNCImportTransInfo in trans_infos with a
+ * single query, then sorts each resulting list and sets the
+ * selected_match and action fields of each trans_info.
+ */
+void
+gnc_import_TransInfo_init_matches_list (GList *trans_infos,
+                                        GNCImportSettings *settings)
+{
+    GList *node;
+
+    /* Find all split matches in the originating accounts. */
+    gnc_import_find_split_matches_list (trans_infos,
+                                        gnc_import_Settings_get_display_threshold (settings),
+                                        gnc_import_Settings_get_fuzzy_amount (settings),
+                                        gnc_import_Settings_get_match_date_hardlimit (settings));
+
+    for (node = trans_infos; node; node = g_list_next (node))
+        select_best_match (node->data, settings);
+}
+
 
 /* Try to automatch a transaction to a destination account if the */
 /* transaction hasn't already been manually assigned to another account */
@@ -95,6 +95,21 @@ void gnc_import_find_split_matches(GNCImportTransInfo *trans_info,
                                    double fuzzy_amount_difference,
                                    gint match_date_hardlimit);
 
+/** Like gnc_import_find_split_matches(), but for all the
+ * GNCImportTransInfo in trans_infos at once. The candidate splits of
+ * all their originating accounts are loaded by one single query over
+ * the combined date range, so prefer this whenever several imported
+ * transactions are matched together.
+ *
+ * @param trans_infos A GList of GNCImportTransInfo.
+ *
+ * See gnc_import_find_split_matches() for the other parameters.
+ */
+void gnc_import_find_split_matches_list (GList *trans_infos,
+                                         gint process_threshold,
+                                         double fuzzy_amount_difference,
+                                         gint match_date_hardlimit);
+
 /** Iterates through all splits of the originating account of
  * trans_info. Sorts the resulting list and sets the selected_match
  * and action fields in the trans_info.
@@ -108,6 +123,18 @@ void
 gnc_import_TransInfo_init_matches (GNCImportTransInfo *trans_info,
                                    GNCImportSettings *settings);
 
+/** Like gnc_import_TransInfo_init_matches(), but for all the
+ * GNCImportTransInfo in trans_infos at once, using
+ * gnc_import_find_split_matches_list().
+ *
+ * @param trans_infos A GList of GNCImportTransInfo.
+ *
+ * @param settings The structure that holds all the user preferences.
+ */
+void
+gnc_import_TransInfo_init_matches_list (GList *trans_infos,
+                                        GNCImportSettings *settings);
+
 /** This function is intended to be called when the importer dialog is
  * finished. It should be called once for each imported transaction
  * and processes each ImportTransInfo according to its selected action:
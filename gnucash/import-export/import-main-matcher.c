@@ -65,6 +65,8 @@ struct _main_matcher_info
     gpointer user_data;
     GNCImportPendingMatches *pending_matches;
     GtkTreeViewColumn *account_column;
+    GList *temp_trans_list;  /* GNCImportTransInfo still to be matched */
+    guint match_idle_id;
 };
 
 enum downloaded_cols
@@ -119,6 +121,7 @@ static gboolean gnc_gen_trans_onPopupMenu_cb (GtkTreeView *treeview,
                                               GNCImportMainMatcher *info);
 static void refresh_model_row(GNCImportMainMatcher *gui, GtkTreeModel *model,
                   GtkTreeIter *iter, GNCImportTransInfo *info);
+static void gnc_gen_trans_list_match_pending (GNCImportMainMatcher *gui);
 /* end local prototypes */
 
 void gnc_gen_trans_list_delete (GNCImportMainMatcher *info)
@@ -126,10 +129,26 @@ void gnc_gen_trans_list_delete (GNCImportMainMatcher *info)
     GtkTreeModel *model;
     GtkTreeIter iter;
     GNCImportTransInfo *trans_info;
+    GList *node;
 
     if (info == NULL)
         return;
 
+    if (info->match_idle_id)
+        g_source_remove (info->match_idle_id);
+    for (node = info->temp_trans_list; node; node = g_list_next (node))
+    {
+        trans_info = node->data;
+        if (info->transaction_processed_cb)
+        {
+            info->transaction_processed_cb(trans_info,
+                                           FALSE,
+                                           info->user_data);
+        }
+        gnc_import_TransInfo_delete(trans_info);
+    }
+    g_list_free (info->temp_trans_list);
+
     model = gtk_tree_view_get_model(info->view);
     if (gtk_tree_model_get_iter_first(model, &iter))
     {
@@ -174,6 +193,8 @@ on_matcher_ok_clicked (GtkButton *button,
 
     /*   DEBUG ("Begin") */
 
+    gnc_gen_trans_list_match_pending (info);
+
     model = gtk_tree_view_get_model(info->view);
     if (!gtk_tree_model_get_iter_first(model, &iter))
         return;
@@ -181,6 +202,7 @@ on_matcher_ok_clicked (GtkButton *button,
     /* Don't run any queries and/or split sorts while processing the matcher
     results. */
     gnc_suspend_gui_refresh();
+    qof_event_begin_batch();
 
     do
     {
@@ -201,6 +223,7 @@ on_matcher_ok_clicked (GtkButton *button,
     while (gtk_tree_model_iter_next (model, &iter));
 
     /* Allow GUI refresh again. */
+    qof_event_end_batch();
     gnc_resume_gui_refresh();
 
     gnc_gen_trans_list_delete (info);
@@ -913,6 +936,7 @@ gboolean gnc_gen_trans_list_run (GNCImportMainMatcher *info)
     gboolean result;
 
     /* DEBUG("Begin"); */
+    gnc_gen_trans_list_match_pending (info);
     result = gtk_dialog_run (GTK_DIALOG (info->main_widget));
     /* DEBUG("Result was %d", result); */
 
@@ -1168,30 +1192,35 @@ void gnc_gen_trans_list_add_trans(GNCImportMainMatcher *gui, Transaction *trans)
     return;
 }/* end gnc_import_add_trans() */
 
-void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transaction *trans, guint32 ref_id)
+/* Match all the transactions added since the last call in one go and
+ * show them in the list. */
+static void
+gnc_gen_trans_list_match_pending (GNCImportMainMatcher *gui)
 {
-    GNCImportTransInfo * transaction_info = NULL;
     GtkTreeModel *model;
     GtkTreeIter iter;
-    GNCImportMatchInfo *selected_match;
-    gboolean match_selected_manually;
-    g_assert (gui);
-    g_assert (trans);
+    GList *trans_list, *node;
 
-
-    if (gnc_import_exists_online_id (trans))
-        return;
-    else
+    if (gui->match_idle_id)
     {
-        transaction_info = gnc_import_TransInfo_new(trans, NULL);
-        gnc_import_TransInfo_set_ref_id(transaction_info, ref_id);
+        g_source_remove (gui->match_idle_id);
+        gui->match_idle_id = 0;
+    }
+    if (gui->temp_trans_list == NULL)
+        return;
+
+    trans_list = g_list_reverse (gui->temp_trans_list);
+    gui->temp_trans_list = NULL;
 
-        gnc_import_TransInfo_init_matches(transaction_info,
-                                          gui->user_settings);
+    gnc_import_TransInfo_init_matches_list (trans_list, gui->user_settings);
 
-        selected_match =
+    model = gtk_tree_view_get_model(gui->view);
+    for (node = trans_list; node; node = g_list_next (node))
+    {
+        GNCImportTransInfo *transaction_info = node->data;
+        GNCImportMatchInfo *selected_match =
             gnc_import_TransInfo_get_selected_match(transaction_info);
-        match_selected_manually =
+        gboolean match_selected_manually =
             gnc_import_TransInfo_get_match_selected_manually(transaction_info);
 
         if (selected_match)
@@ -1199,10 +1228,44 @@ void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transac
                                                 selected_match,
                                                 match_selected_manually);
 
-        model = gtk_tree_view_get_model(gui->view);
         gtk_list_store_append(GTK_LIST_STORE(model), &iter);
         refresh_model_row (gui, model, &iter, transaction_info);
     }
+    g_list_free (trans_list);
+}
+
+static gboolean
+match_pending_idle_cb (gpointer user_data)
+{
+    GNCImportMainMatcher *gui = user_data;
+
+    gui->match_idle_id = 0;
+    gnc_gen_trans_list_match_pending (gui);
+    return G_SOURCE_REMOVE;
+}
+
+/* The importers add their transactions one at a time, so only queue them
+ * here; they are matched all together once the importer is done, that is
+ * when the list is run or processed, or else when the main loop goes idle. */
+void gnc_gen_trans_list_add_trans_with_ref_id(GNCImportMainMatcher *gui, Transaction *trans, guint32 ref_id)
+{
+    GNCImportTransInfo * transaction_info = NULL;
+    g_assert (gui);
+    g_assert (trans);
+
+
+    if (gnc_import_exists_online_id (trans))
+        return;
+    else
+    {
+        transaction_info = gnc_import_TransInfo_new(trans, NULL);
+        gnc_import_TransInfo_set_ref_id(transaction_info, ref_id);
+
+        gui->temp_trans_list = g_list_prepend (gui->temp_trans_list,
+                                               transaction_info);
+        if (!gui->match_idle_id)
+            gui->match_idle_id = g_idle_add (match_pending_idle_cb, gui);
+    }
     return;
 }/* end gnc_import_add_trans_with_ref_id() */
 
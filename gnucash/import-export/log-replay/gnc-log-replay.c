@@ -602,8 +602,26 @@ void gnc_file_log_replay (GtkWindow *parent)
         }
         else
         {
+            gchar *text_filename = NULL;
+
+            /* Binary logs are replayed from their text version. */
+            if (xaccLogFileIsBinary(selected_filename))
+            {
+                gint fd = g_file_open_tmp("gnucash-log-XXXXXX", &text_filename, NULL);
+                if (fd >= 0)
+                    g_close(fd, NULL);
+                if (fd < 0 || !xaccLogConvertToText(selected_filename, text_filename))
+                {
+                    PERR("Cannot convert binary log file %s", selected_filename);
+                    if (text_filename)
+                        g_unlink(text_filename);
+                    g_free(text_filename);
+                    text_filename = NULL;
+                }
+            }
+
             DEBUG("Opening selected file");
-            log_file = g_fopen(selected_filename, "r");
+            log_file = g_fopen(text_filename ? text_filename : selected_filename, "r");
             if (!log_file || ferror(log_file) != 0)
             {
                 int err = errno;
@@ -651,6 +669,11 @@ void gnc_file_log_replay (GtkWindow *parent)
                 }
                 fclose(log_file);
             }
+            if (text_filename)
+            {
+                g_unlink(text_filename);
+                g_free(text_filename);
+            }
         }
         g_free(selected_filename);
     }
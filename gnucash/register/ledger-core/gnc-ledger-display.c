@@ -572,10 +572,10 @@ refresh_handler (GHashTable *changes, gpointer user_data)
         }
     }
 
-    /* Its not clear if we should re-run the query, or if we should
-     * just use qof_query_last_run().  Its possible that the dates
-     * changed, requiring a full new query.  Similar considerations
-     * needed for multi-user mode.
+    /* The query is live, so this only searches the book again if the
+     * query was changed, e.g. its dates, or if the query couldn't follow
+     * the changes to its results.  Otherwise it returns the results kept
+     * up to date as the splits changed.
      */
     splits = qof_query_run (ld->query);
 
@@ -771,6 +771,7 @@ gnc_ledger_display_internal (Account *lead_account, Query *q,
         ld->query = qof_query_copy (q);
     else
         gnc_ledger_display_make_query (ld, limit, reg_type);
+    qof_query_set_live (ld->query, NULL, NULL);
 
     ld->component_id = gnc_register_gui_component (klass,
                        refresh_handler,
@@ -805,6 +806,7 @@ gnc_ledger_display_set_query (GNCLedgerDisplay *ledger_display, Query *q)
 
     qof_query_destroy (ledger_display->query);
     ledger_display->query = qof_query_copy (q);
+    qof_query_set_live (ledger_display->query, NULL, NULL);
 }
 
 GNCLedgerDisplay *
@@ -20,6 +20,7 @@
 #include <config.h>
 
 #include <stdio.h>
+#include <string.h>
 
 #include "gnc-component-manager.h"
 #include "qof.h"
@@ -40,8 +41,6 @@ typedef struct
 {
     GHashTable * event_masks;
     GHashTable * entity_events;
-
-    gboolean match;
 } ComponentEventInfo;
 
 typedef struct
@@ -63,9 +62,21 @@ static guint  suspend_counter = 0;
 /* Some code foolishly uses 0 instead of NO_COMPONENT, so we start with 1. */
 static gint   next_component_id = 1;
 static GList *components = NULL;
+/* component id --> ComponentInfo */
+static GHashTable *components_by_id = NULL;
+
+/* The components watching each entity and entity type, so that a refresh
+ * only has to look at the components watching what changed.
+ *   entity_watchers: GncGUID --> set of ComponentInfo
+ *   type_watchers:   entity type --> set of ComponentInfo
+ * The keys are g_malloced and in the engine string cache respectively. */
+static GHashTable *entity_watchers = NULL;
+static GHashTable *type_watchers = NULL;
 
-static ComponentEventInfo changes = { NULL, NULL, FALSE };
-static ComponentEventInfo changes_backup = { NULL, NULL, FALSE };
+static GNCComponentRefreshStats refresh_stats = { 0, 0, 0, 0 };
+
+static ComponentEventInfo changes = { NULL, NULL };
+static ComponentEventInfo changes_backup = { NULL, NULL };
 
 
 /* This static indicates the debugging module that this .o belongs to.  */
@@ -253,29 +264,115 @@ add_event_type (ComponentEventInfo *cei, QofIdTypeConst entity_type,
 }
 
 static void
-gnc_cm_event_handler (QofInstance *entity,
-                      QofEventId event_type,
-                      gpointer user_data,
-                      gpointer event_data)
+destroy_guid_key (gpointer key)
+{
+    guid_free (key);
+}
+
+static void
+destroy_type_key (gpointer key)
+{
+    qof_string_cache_remove (key);
+}
+
+static void
+add_watcher (GHashTable **index, gconstpointer key, ComponentInfo *ci,
+             gboolean by_type)
+{
+    GHashTable *watchers;
+
+    if (*index == NULL)
+    {
+        if (by_type)
+            *index = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            destroy_type_key,
+                                            (GDestroyNotify) g_hash_table_destroy);
+        else
+            *index = g_hash_table_new_full (guid_hash_to_guint,
+                                            guid_g_hash_table_equal,
+                                            destroy_guid_key,
+                                            (GDestroyNotify) g_hash_table_destroy);
+    }
+
+    watchers = g_hash_table_lookup (*index, key);
+    if (!watchers)
+    {
+        gpointer index_key;
+
+        if (by_type)
+        {
+            index_key = qof_string_cache_insert (key);
+        }
+        else
+        {
+            index_key = guid_malloc ();
+            *(GncGUID *) index_key = *(const GncGUID *) key;
+        }
+
+        watchers = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (*index, index_key, watchers);
+    }
+
+    g_hash_table_add (watchers, ci);
+}
+
+static void
+remove_watcher (GHashTable *index, gconstpointer key, ComponentInfo *ci)
+{
+    GHashTable *watchers;
+
+    if (!index)
+        return;
+
+    watchers = g_hash_table_lookup (index, key);
+    if (!watchers)
+        return;
+
+    g_hash_table_remove (watchers, ci);
+    if (g_hash_table_size (watchers) == 0)
+        g_hash_table_remove (index, key);
+}
+
+static void
+remove_entity_watcher_helper (gpointer key, gpointer value, gpointer user_data)
+{
+    remove_watcher (entity_watchers, key, user_data);
+}
+
+static void
+remove_type_watcher_helper (gpointer key, gpointer value, gpointer user_data)
 {
-    const GncGUID *guid = qof_entity_get_guid(entity);
+    remove_watcher (type_watchers, key, user_data);
+}
+
+static void
+gnc_cm_event_handler (const QofEventBatchItem *items,
+                      guint n_items,
+                      gpointer user_data)
+{
+    guint i;
+
+    for (i = 0; i < n_items; i++)
+    {
+        const QofEventBatchItem *item = &items[i];
 #if CM_DEBUG
-    gchar guidstr[GUID_ENCODING_LENGTH+1];
-    guid_to_string_buff (guid, guidstr);
-    fprintf (stderr, "event_handler: event %d, entity %p, guid %s\n", event_type,
-             entity, guidstr);
+        gchar guidstr[GUID_ENCODING_LENGTH+1];
+        guid_to_string_buff (&item->guid, guidstr);
+        fprintf (stderr, "event_handler: event %d, entity %p, guid %s\n",
+                 item->event_mask, item->entity, guidstr);
 #endif
-    add_event (&changes, guid, event_type, TRUE);
+        add_event (&changes, &item->guid, item->event_mask, TRUE);
 
-    if (QOF_CHECK_TYPE(entity, GNC_ID_SPLIT))
-    {
-        /* split events are never generated by the engine, but might
-         * be generated by a backend (viz. the postgres backend.)
-         * Handle them like a transaction modify event. */
-        add_event_type (&changes, GNC_ID_TRANS, QOF_EVENT_MODIFY, TRUE);
+        if (g_strcmp0 (item->type, GNC_ID_SPLIT) == 0)
+        {
+            /* split events are never generated by the engine, but might
+             * be generated by a backend (viz. the postgres backend.)
+             * Handle them like a transaction modify event. */
+            add_event_type (&changes, GNC_ID_TRANS, QOF_EVENT_MODIFY, TRUE);
+        }
+        else
+            add_event_type (&changes, item->type, item->event_mask, TRUE);
     }
-    else
-        add_event_type (&changes, entity->e_type, event_type, TRUE);
 
     got_events = TRUE;
 
@@ -300,7 +397,8 @@ gnc_component_manager_init (void)
     changes_backup.event_masks = g_hash_table_new (g_str_hash, g_str_equal);
     changes_backup.entity_events = guid_hash_table_new ();
 
-    handler_id = qof_event_register_handler (gnc_cm_event_handler, NULL);
+    handler_id = qof_event_register_batch_handler (gnc_cm_event_handler, NULL,
+                                                   NULL);
 }
 
 void
@@ -324,23 +422,29 @@ gnc_component_manager_shutdown (void)
     destroy_event_hash (changes_backup.entity_events);
     changes_backup.entity_events = NULL;
 
+    if (entity_watchers)
+        g_hash_table_destroy (entity_watchers);
+    entity_watchers = NULL;
+
+    if (type_watchers)
+        g_hash_table_destroy (type_watchers);
+    type_watchers = NULL;
+
+    if (components_by_id)
+        g_hash_table_destroy (components_by_id);
+    components_by_id = NULL;
+
     qof_event_unregister_handler (handler_id);
 }
 
 static ComponentInfo *
 find_component (gint component_id)
 {
-    GList *node;
-
-    for (node = components; node; node = node->next)
-    {
-        ComponentInfo *ci = node->data;
-
-        if (ci->component_id == component_id)
-            return ci;
-    }
+    if (!components_by_id)
+        return NULL;
 
-    return NULL;
+    return g_hash_table_lookup (components_by_id,
+                                GINT_TO_POINTER (component_id));
 }
 
 static GList *
@@ -411,6 +515,10 @@ gnc_register_gui_component_internal (const char * component_class)
 
     components = g_list_prepend (components, ci);
 
+    if (!components_by_id)
+        components_by_id = g_hash_table_new (g_direct_hash, g_direct_equal);
+    g_hash_table_insert (components_by_id, GINT_TO_POINTER (component_id), ci);
+
     /* update id for next registration */
     next_component_id = component_id + 1;
 
@@ -466,6 +574,11 @@ gnc_gui_component_watch_entity (gint component_id,
     }
 
     add_event (&ci->watch_info, entity, event_mask, FALSE);
+
+    if (event_mask)
+        add_watcher (&entity_watchers, entity, ci, FALSE);
+    else
+        remove_watcher (entity_watchers, entity, ci);
 }
 
 void
@@ -483,6 +596,14 @@ gnc_gui_component_watch_entity_type (gint component_id,
     }
 
     add_event_type (&ci->watch_info, entity_type, event_mask, FALSE);
+
+    if (!entity_type)
+        return;
+
+    if (event_mask)
+        add_watcher (&type_watchers, entity_type, ci, TRUE);
+    else
+        remove_watcher (type_watchers, entity_type, ci);
 }
 
 const EventInfo *
@@ -506,6 +627,11 @@ gnc_gui_component_clear_watches (gint component_id)
         return;
     }
 
+    g_hash_table_foreach (ci->watch_info.entity_events,
+                          remove_entity_watcher_helper, ci);
+    g_hash_table_foreach (ci->watch_info.event_masks,
+                          remove_type_watcher_helper, ci);
+
     clear_event_info (&ci->watch_info);
 }
 
@@ -530,6 +656,7 @@ gnc_unregister_gui_component (gint component_id)
     gnc_gui_component_clear_watches (component_id);
 
     components = g_list_remove (components, ci);
+    g_hash_table_remove (components_by_id, GINT_TO_POINTER (component_id));
 
     destroy_mask_hash (ci->watch_info.event_masks);
     ci->watch_info.event_masks = NULL;
@@ -596,70 +723,77 @@ gnc_resume_gui_refresh (void)
         gnc_gui_refresh_internal (FALSE);
 }
 
+/* Add the ids of the components watching the changed entity type in key
+ * for any of the events it got to the set in user_data. */
 static void
 match_type_helper (gpointer key, gpointer value, gpointer user_data)
 {
-    ComponentEventInfo *cei = user_data;
+    GHashTable *matches = user_data;
     QofIdType id_type = key;
     QofEventId * et = value;
-    QofEventId * et_2;
+    GHashTable *watchers;
+    GHashTableIter iter;
+    gpointer ci_ptr;
+
+    if (*et == 0 || !type_watchers)
+        return;
 
-    et_2 = g_hash_table_lookup (cei->event_masks, id_type);
-    if (!et_2)
+    watchers = g_hash_table_lookup (type_watchers, id_type);
+    if (!watchers)
         return;
 
-    if (*et & *et_2)
-        cei->match = TRUE;
+    g_hash_table_iter_init (&iter, watchers);
+    while (g_hash_table_iter_next (&iter, &ci_ptr, NULL))
+    {
+        ComponentInfo *ci = ci_ptr;
+        QofEventId * et_2 = g_hash_table_lookup (ci->watch_info.event_masks,
+                                                 id_type);
+
+        if (et_2 && (*et & *et_2))
+            g_hash_table_add (matches, GINT_TO_POINTER (ci->component_id));
+    }
 }
 
+/* Like match_type_helper for the changed entity in key. */
 static void
 match_helper (gpointer key, gpointer value, gpointer user_data)
 {
+    GHashTable *matches = user_data;
     GncGUID *guid = key;
     EventInfo *ei_1 = value;
-    EventInfo *ei_2;
-    ComponentEventInfo *cei = user_data;
+    GHashTable *watchers;
+    GHashTableIter iter;
+    gpointer ci_ptr;
 
-    ei_2 = g_hash_table_lookup (cei->entity_events, guid);
-    if (!ei_2)
+    if (!entity_watchers)
         return;
 
-    if (ei_1->event_mask & ei_2->event_mask)
-        cei->match = TRUE;
-}
-
-static gboolean
-changes_match (ComponentEventInfo *cei, ComponentEventInfo *changes)
-{
-    ComponentEventInfo *big_cei;
-    GHashTable *smalltable;
-
-    if (cei == NULL)
-        return FALSE;
-
-    /* check types first, for efficiency */
-    cei->match = FALSE;
-    g_hash_table_foreach (changes->event_masks, match_type_helper, cei);
-    if (cei->match)
-        return TRUE;
+    watchers = g_hash_table_lookup (entity_watchers, guid);
+    if (!watchers)
+        return;
 
-    if (g_hash_table_size (cei->entity_events) <=
-            g_hash_table_size (changes->entity_events))
+    g_hash_table_iter_init (&iter, watchers);
+    while (g_hash_table_iter_next (&iter, &ci_ptr, NULL))
     {
-        smalltable = cei->entity_events;
-        big_cei = changes;
-    }
-    else
-    {
-        smalltable = changes->entity_events;
-        big_cei = cei;
+        ComponentInfo *ci = ci_ptr;
+        EventInfo *ei_2 = g_hash_table_lookup (ci->watch_info.entity_events,
+                                               guid);
+
+        if (ei_2 && (ei_1->event_mask & ei_2->event_mask))
+            g_hash_table_add (matches, GINT_TO_POINTER (ci->component_id));
     }
+}
 
-    big_cei->match = FALSE;
+/* The ids of the components watching any of the changes. */
+static GHashTable *
+changes_matches (ComponentEventInfo *changes)
+{
+    GHashTable *matches = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-    g_hash_table_foreach (smalltable, match_helper, big_cei);
+    g_hash_table_foreach (changes->event_masks, match_type_helper, matches);
+    g_hash_table_foreach (changes->entity_events, match_helper, matches);
 
-    return big_cei->match;
+    return matches;
 }
 
 static void
@@ -667,10 +801,15 @@ gnc_gui_refresh_internal (gboolean force)
 {
     GList *list;
     GList *node;
+    GHashTable *matches = NULL;
+    guint refreshed = 0;
+    gint64 start, elapsed;
 
     if (!got_events && !force)
         return;
 
+    start = g_get_monotonic_time ();
+
     gnc_suspend_gui_refresh ();
 
     {
@@ -689,14 +828,23 @@ gnc_gui_refresh_internal (gboolean force)
     fprintf (stderr, "%srefresh!\n", force ? "forced " : "");
 #endif
 
+    /* Look the components to refresh up before refreshing any of them, as
+     * that may change what they watch. */
+    if (!force)
+        matches = changes_matches (&changes_backup);
+
     list = find_component_ids_by_class (NULL);
     // reverse the list so class GncPluginPageRegister is before register-single
     list = g_list_reverse (list);
 
     for (node = list; node; node = node->next)
     {
-        ComponentInfo *ci = find_component (GPOINTER_TO_INT (node->data));
+        ComponentInfo *ci;
+
+        if (matches && !g_hash_table_contains (matches, node->data))
+            continue;
 
+        ci = find_component (GPOINTER_TO_INT (node->data));
         if (!ci)
             continue;
 
@@ -718,32 +866,55 @@ gnc_gui_refresh_internal (gboolean force)
                 ci->refresh_handler (NULL, ci->user_data);
             }
         }
-        else if (changes_match (&ci->watch_info, &changes_backup))
-        {
-            if (ci->refresh_handler)
-            {
-#if CM_DEBUG
-                fprintf (stderr, "calling %s:%d C handler\n", ci->component_class, ci->component_id);
-#endif
-                ci->refresh_handler (changes_backup.entity_events, ci->user_data);
-            }
-        }
         else
         {
 #if CM_DEBUG
-            fprintf (stderr, "no match for %s:%d\n", ci->component_class, ci->component_id);
+            fprintf (stderr, "calling %s:%d C handler\n", ci->component_class, ci->component_id);
 #endif
+            ci->refresh_handler (changes_backup.entity_events, ci->user_data);
         }
+        refreshed++;
     }
 
+    PINFO ("%srefresh of %u entities and %u entity types: %u of %u components",
+           force ? "forced " : "",
+           g_hash_table_size (changes_backup.entity_events),
+           g_hash_table_size (changes_backup.event_masks),
+           refreshed, g_list_length (list));
+
     clear_event_info (&changes_backup);
     got_events = FALSE;
 
     g_list_free (list);
+    if (matches)
+        g_hash_table_destroy (matches);
+
+    /* Before resuming, which may start another refresh. */
+    elapsed = g_get_monotonic_time () - start;
+    refresh_stats.refreshes++;
+    refresh_stats.components_refreshed += refreshed;
+    refresh_stats.total_usecs += elapsed;
+    if (elapsed > refresh_stats.max_usecs)
+        refresh_stats.max_usecs = elapsed;
+    PINFO ("refresh took %" G_GINT64_FORMAT " us", elapsed);
 
     gnc_resume_gui_refresh ();
 }
 
+void
+gnc_gui_refresh_get_stats (GNCComponentRefreshStats *stats)
+{
+    g_return_if_fail (stats);
+
+    *stats = refresh_stats;
+}
+
+void
+gnc_gui_refresh_reset_stats (void)
+{
+    memset (&refresh_stats, 0, sizeof (refresh_stats));
+}
+
 void
 gnc_gui_refresh_all (void)
 {
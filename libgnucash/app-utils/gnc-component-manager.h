@@ -253,6 +253,28 @@ void gnc_gui_refresh_all (void);
  */
 gboolean gnc_gui_refresh_suspended (void);
 
+/* GNCComponentRefreshStats
+ *   How long the refreshes since the stats were last reset took.
+ *   Forced refreshes count too.
+ */
+typedef struct
+{
+    guint refreshes;             /* refresh passes run */
+    guint components_refreshed;  /* refresh handlers called */
+    gint64 total_usecs;          /* time spent in refresh passes */
+    gint64 max_usecs;            /* the longest refresh pass */
+} GNCComponentRefreshStats;
+
+/* gnc_gui_refresh_get_stats
+ *   Copy the refresh stats into stats.
+ */
+void gnc_gui_refresh_get_stats (GNCComponentRefreshStats *stats);
+
+/* gnc_gui_refresh_reset_stats
+ *   Start counting the refresh stats over.
+ */
+void gnc_gui_refresh_reset_stats (void);
+
 /* gnc_close_gui_component
  *   Invoke the close handler for the indicated component.
  *
@@ -28,6 +28,7 @@
 
 extern void test_suite_option_util (void);
 extern void test_suite_gnc_ui_util (void);
+extern void test_suite_component_manager (void);
 
 static void
 guile_main (void *closure, int argc, char **argv)
@@ -39,6 +40,7 @@ guile_main (void *closure, int argc, char **argv)
 
     test_suite_option_util ();
     test_suite_gnc_ui_util ();
+    test_suite_component_manager ();
     retval = g_test_run ();
 
     exit (retval);
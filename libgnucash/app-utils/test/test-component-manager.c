@@ -0,0 +1,223 @@
+/********************************************************************
+ * test-component-manager.c: GLib g_test test suite for             *
+ * gnc-component-manager.c.                                         *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, you can retrieve it from        *
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html            *
+ * or contact:                                                      *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ ********************************************************************/
+
+#include <config.h>
+#include <glib.h>
+#include <string.h>
+#include <unittest-support.h>
+#include <qof.h>
+#include <Account.h>
+#include <Transaction.h>
+
+#include "../gnc-component-manager.h"
+
+static const gchar *suitename = "/app-utils/gnc-component-manager";
+void test_suite_component_manager (void);
+
+#define N_COMPONENTS 7
+
+/* What a test component watches, so that the components to refresh can be
+ * found by testing every component against the changes, the way the
+ * component manager did before it indexed the watches. */
+typedef struct
+{
+    const GncGUID *entity;
+    QofEventId entity_mask;
+    QofIdTypeConst type;
+    QofEventId type_mask;
+    gint id;
+    guint refreshes;
+} TestComponent;
+
+typedef struct
+{
+    QofBook *book;
+    Account *acct1;
+    Account *acct2;
+    Transaction *trans;
+    TestComponent components[N_COMPONENTS];
+} Fixture;
+
+static void
+setup (Fixture *fixture, gconstpointer pData)
+{
+    fixture->book = qof_book_new ();
+    fixture->acct1 = xaccMallocAccount (fixture->book);
+    fixture->acct2 = xaccMallocAccount (fixture->book);
+    fixture->trans = xaccMallocTransaction (fixture->book);
+    memset (fixture->components, 0, sizeof (fixture->components));
+    gnc_component_manager_init ();
+}
+
+static void
+teardown (Fixture *fixture, gconstpointer pData)
+{
+    int i;
+
+    for (i = 0; i < N_COMPONENTS; i++)
+        if (fixture->components[i].id != NO_COMPONENT)
+            gnc_unregister_gui_component (fixture->components[i].id);
+
+    gnc_component_manager_shutdown ();
+    qof_book_destroy (fixture->book);
+}
+
+static void
+refresh_handler (GHashTable *changes, gpointer user_data)
+{
+    TestComponent *tc = user_data;
+
+    tc->refreshes++;
+}
+
+static void
+register_component (TestComponent *tc, const GncGUID *entity,
+                    QofEventId entity_mask, QofIdTypeConst type,
+                    QofEventId type_mask)
+{
+    tc->entity = entity;
+    tc->entity_mask = entity_mask;
+    tc->type = type;
+    tc->type_mask = type_mask;
+    tc->id = gnc_register_gui_component ("test-component", refresh_handler,
+                                         NULL, tc);
+    if (entity)
+        gnc_gui_component_watch_entity (tc->id, entity, entity_mask);
+    if (type)
+        gnc_gui_component_watch_entity_type (tc->id, type, type_mask);
+}
+
+/* The old scan for one event. */
+static gboolean
+scan_matches (const TestComponent *tc, QofInstance *inst, QofEventId event)
+{
+    if (tc->type && g_strcmp0 (tc->type, inst->e_type) == 0 &&
+            (tc->type_mask & event))
+        return TRUE;
+
+    return tc->entity && guid_equal (tc->entity, qof_instance_get_guid (inst)) &&
+           (tc->entity_mask & event);
+}
+
+static void
+check_refreshes (Fixture *fixture, QofInstance *inst, QofEventId event)
+{
+    int i;
+
+    for (i = 0; i < N_COMPONENTS; i++)
+        fixture->components[i].refreshes = 0;
+
+    qof_event_gen (inst, event, NULL);
+
+    for (i = 0; i < N_COMPONENTS; i++)
+    {
+        TestComponent *tc = &fixture->components[i];
+
+        g_assert_cmpuint (tc->refreshes, ==,
+                          scan_matches (tc, inst, event) ? 1 : 0);
+    }
+}
+
+static void
+test_refresh_matches_scan (Fixture *fixture, gconstpointer pData)
+{
+    TestComponent *tc = fixture->components;
+    const GncGUID *guid1 = qof_instance_get_guid (fixture->acct1);
+    const GncGUID *guid2 = qof_instance_get_guid (fixture->acct2);
+    QofInstance *acct1 = QOF_INSTANCE (fixture->acct1);
+    QofInstance *acct2 = QOF_INSTANCE (fixture->acct2);
+    QofInstance *trans = QOF_INSTANCE (fixture->trans);
+
+    register_component (&tc[0], guid1, QOF_EVENT_MODIFY, NULL, 0);
+    register_component (&tc[1], guid1, QOF_EVENT_DESTROY, NULL, 0);
+    register_component (&tc[2], NULL, 0, GNC_ID_ACCOUNT, QOF_EVENT_MODIFY);
+    register_component (&tc[3], NULL, 0, GNC_ID_TRANS, QOF_EVENT_MODIFY);
+    register_component (&tc[4], guid2, QOF_EVENT_MODIFY | QOF_EVENT_DESTROY,
+                        GNC_ID_ACCOUNT, QOF_EVENT_ADD);
+    /* Watches that were dropped again mustn't match. */
+    register_component (&tc[5], guid1, QOF_EVENT_MODIFY, GNC_ID_ACCOUNT,
+                        QOF_EVENT_MODIFY);
+    gnc_gui_component_clear_watches (tc[5].id);
+    tc[5].entity = NULL;
+    tc[5].type = NULL;
+    register_component (&tc[6], guid1, QOF_EVENT_MODIFY, NULL, 0);
+    gnc_gui_component_watch_entity (tc[6].id, guid1, 0);
+    tc[6].entity = NULL;
+
+    check_refreshes (fixture, acct1, QOF_EVENT_MODIFY);
+    g_assert_cmpuint (tc[0].refreshes, ==, 1);
+    g_assert_cmpuint (tc[2].refreshes, ==, 1);
+    check_refreshes (fixture, acct1, QOF_EVENT_DESTROY);
+    g_assert_cmpuint (tc[1].refreshes, ==, 1);
+    check_refreshes (fixture, acct2, QOF_EVENT_MODIFY);
+    g_assert_cmpuint (tc[4].refreshes, ==, 1);
+    check_refreshes (fixture, acct2, QOF_EVENT_ADD);
+    g_assert_cmpuint (tc[4].refreshes, ==, 1);
+    check_refreshes (fixture, acct2, QOF_EVENT_REMOVE);
+    g_assert_cmpuint (tc[4].refreshes, ==, 0);
+    check_refreshes (fixture, trans, QOF_EVENT_MODIFY);
+    g_assert_cmpuint (tc[3].refreshes, ==, 1);
+
+    /* An unregistered component is no longer in the indexes. */
+    gnc_unregister_gui_component (tc[0].id);
+    tc[0].id = NO_COMPONENT;
+    tc[0].entity = NULL;
+    check_refreshes (fixture, acct1, QOF_EVENT_MODIFY);
+}
+
+/* Changes made while the refresh is suspended refresh each matching
+ * component once, whichever of its watches they match. */
+static void
+test_suspended_refresh_matches_scan (Fixture *fixture, gconstpointer pData)
+{
+    TestComponent *tc = fixture->components;
+    const GncGUID *guid1 = qof_instance_get_guid (fixture->acct1);
+    int i;
+
+    register_component (&tc[0], guid1, QOF_EVENT_MODIFY, GNC_ID_TRANS,
+                        QOF_EVENT_MODIFY);
+    register_component (&tc[1], NULL, 0, GNC_ID_TRANS, QOF_EVENT_DESTROY);
+    register_component (&tc[2], guid1, QOF_EVENT_DESTROY, NULL, 0);
+    for (i = 3; i < N_COMPONENTS; i++)
+        tc[i].id = NO_COMPONENT;
+
+    gnc_suspend_gui_refresh ();
+    qof_event_gen (QOF_INSTANCE (fixture->acct1), QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (QOF_INSTANCE (fixture->trans), QOF_EVENT_MODIFY, NULL);
+    g_assert_cmpuint (tc[0].refreshes, ==, 0);
+    gnc_resume_gui_refresh ();
+
+    g_assert_cmpuint (tc[0].refreshes, ==, 1);
+    g_assert_cmpuint (tc[1].refreshes, ==, 0);
+    g_assert_cmpuint (tc[2].refreshes, ==, 0);
+}
+
+void
+test_suite_component_manager (void)
+{
+    GNC_TEST_ADD (suitename, "refresh matches scan", Fixture, NULL, setup,
+                  test_refresh_matches_scan, teardown);
+    GNC_TEST_ADD (suitename, "suspended refresh matches scan", Fixture, NULL,
+                  setup, test_suspended_refresh_matches_scan, teardown);
+}
@@ -855,6 +855,14 @@ GncDbiBackend<Type>::~GncDbiBackend()
 
 /* ================================================================= */
 
+/* Whether the database was written with an older schema or data semantics
+ * than GNUCASH_RESAVE_VERSION, see load(). */
+template <DbType Type> bool
+GncDbiBackend<Type>::needs_resave () const noexcept
+{
+    return GNUCASH_RESAVE_VERSION > get_table_version("Gnucash");
+}
+
 /* GNUCASH_RESAVE_VERSION indicates the earliest database version
  * compatible with this version of Gnucash; the stored value is the
  * earliest version of Gnucash conpatible with the database. If the
@@ -885,7 +893,7 @@ GncDbiBackend<Type>::load (QofBook* book, QofBackendLoadType loadType)
     if (Type == DbType::DBI_SQLITE)
         gnc_features_set_used(book, GNC_FEATURE_SQLITE3_ISO_DATES);
 
-    if (GNUCASH_RESAVE_VERSION > get_table_version("Gnucash"))
+    if (needs_resave())
     {
         /* The database was loaded with an older database schema or
          * data semantics. In order to ensure consistency, the whole
@@ -940,11 +948,25 @@ save_may_clobber_data <DbType::DBI_PGSQL>(dbi_conn conn,
 }
 
 
+/* A database that no longer holds the book, because a save or the deletion
+ * of an object failed, may have rows the book doesn't. It has to be written
+ * anew, which only safe_sync() can do to tables that are there already. */
+template <DbType Type> void
+GncDbiBackend<Type>::sync (QofBook* book)
+{
+    if (book == m_book && !holds_book())
+        safe_sync (book);
+    else
+        GncSqlBackend::sync (book);
+}
+
 /**
  * Safely resave a database by renaming all of its tables, recreating
  * everything, and then dropping the backup tables only if there were
  * no errors. If there are errors, drop the new tables and restore the
- * originals.
+ * originals. A database that holds the book, having loaded it or saved all
+ * of it, and needs no resave only gets what changed, in a transaction of
+ * its own.
  *
  * @param book: QofBook to be saved in the database.
  */
@@ -957,6 +979,17 @@ GncDbiBackend<Type>::safe_sync (QofBook* book)
     g_return_if_fail (book != nullptr);
 
     ENTER ("book=%p, primary=%p", book, m_book);
+    /* A database that's up to date only needs what changed, which is
+     * written in a single transaction anyway. */
+    if (book == m_book && holds_book() && !needs_resave())
+    {
+        sync_changes (m_book);
+        LEAVE ("book=%p", m_book);
+        return;
+    }
+    /* The tables are written again from the book, which must hold all of
+     * the history for that. */
+    load_history (m_book, nullptr, INT64_MIN);
     if (!conn->begin_transaction())
     {
         LEAVE("Failed to obtain a transaction.");
@@ -975,7 +1008,7 @@ GncDbiBackend<Type>::safe_sync (QofBook* book)
         return;
     }
 
-    sync(m_book);
+    sync_all(m_book);
     if (check_error())
     {
         conn->rollback_transaction();
@@ -1000,6 +1033,13 @@ GncDbiBackend<DbType::DBI_MYSQL>::safe_sync (QofBook* book)
     g_return_if_fail (book != nullptr);
 
     ENTER ("book=%p, primary=%p", book, m_book);
+    if (book == m_book && holds_book() && !needs_resave())
+    {
+        sync_changes (m_book);
+        LEAVE ("book=%p", m_book);
+        return;
+    }
+    load_history (m_book, nullptr, INT64_MIN);
     if (!conn->table_operation (TableOpType::backup))
     {
         set_error(ERR_BACKEND_SERVER_ERR);
@@ -1016,7 +1056,7 @@ GncDbiBackend<DbType::DBI_MYSQL>::safe_sync (QofBook* book)
         return;
     }
 
-    sync(m_book);
+    sync_all(m_book);
     if (check_error())
     {
         conn->table_operation (TableOpType::rollback);
@@ -95,6 +95,7 @@ public:
     void session_begin(QofSession*, const char*, bool, bool, bool) override;
     void session_end() override;
     void load(QofBook*, QofBackendLoadType) override;
+    void sync(QofBook*) override;
     void safe_sync(QofBook*) override;
     bool connected() const noexcept { return m_conn != nullptr; }
     /** FIXME: Just a pass-through to m_conn: */
@@ -115,6 +116,7 @@ private:
     bool conn_test_dbi_library(dbi_conn conn);
     bool set_standard_connection_options(dbi_conn conn, const UriStrings& uri);
     bool create_database(dbi_conn conn, const char* db);
+    bool needs_resave() const noexcept;
     bool m_exists;         // Does the database exist?
 };
 
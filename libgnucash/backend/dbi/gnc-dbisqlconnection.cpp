@@ -29,6 +29,7 @@ extern "C"
 #include <gnc-locale-utils.h>
 }
 
+#include <algorithm>
 #include <string>
 #include <regex>
 #include <sstream>
@@ -729,6 +730,21 @@ GncDbiSqlConnection::table_operation(TableOpType op) noexcept
    return true;
 }
 
+bool
+GncDbiSqlConnection::does_index_exist (const std::string& index_name)
+    const noexcept
+{
+    /* MySQL lists its indexes as "index_name table_name". */
+    auto index_list = m_provider->get_index_list (m_conn);
+    return std::any_of (index_list.begin(), index_list.end(),
+                        [&index_name](const std::string& index)
+                        {
+                            return index == index_name ||
+                                index.compare (0, index_name.size() + 1,
+                                               index_name + " ") == 0;
+                        });
+}
+
 bool
 GncDbiSqlConnection::drop_indexes() noexcept
 {
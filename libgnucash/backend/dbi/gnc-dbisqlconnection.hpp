@@ -57,6 +57,7 @@ public:
     bool create_table (const std::string&, const ColVec&) const noexcept override;
     bool create_index (const std::string&, const std::string&, const EntryVec&)
         const noexcept override;
+    bool does_index_exist (const std::string&) const noexcept override;
     bool add_columns_to_table (const std::string&, const ColVec&)
         const noexcept override;
     std::string quote_string (const std::string&) const noexcept override;
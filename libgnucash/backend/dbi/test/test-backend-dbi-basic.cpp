@@ -44,6 +44,7 @@ extern "C"
 #include <TransLog.h>
 #include "Transaction.h"
 #include "Split.h"
+#include "Query.h"
 #include "gnc-commodity.h"
 #include "gncAddress.h"
 #include "gncCustomer.h"
@@ -425,6 +426,185 @@ test_dbi_store_and_reload (Fixture* fixture, gconstpointer pData)
     qof_session_destroy (session_3);
 }
 
+/* Save a book, load it back with only the last month of its history and
+ * check that the account balances are the same anyway and that running a
+ * query loads the rest. */
+static void
+test_dbi_partial_load (Fixture* fixture, gconstpointer pData)
+{
+    const gchar* url = (const gchar*)pData;
+    QofSession* session_2;
+    QofSession* session_3;
+    QofBook* book_2, *book_3;
+    QofCollection* coll_2, *coll_3;
+    GList* accounts, *node;
+    QofQuery* query;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_2);
+    qof_book_mark_session_dirty (qof_session_get_book (session_2));
+    qof_session_save (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    book_2 = qof_session_get_book (session_2);
+
+    gnc_prefs_set_sql_history_days (30);
+    session_3 = qof_session_new ();
+    qof_session_begin (session_3, url, TRUE, FALSE, FALSE);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_3, NULL);
+    g_assert_cmpint (qof_session_get_error (session_3), == , ERR_BACKEND_NO_ERR);
+    gnc_prefs_set_sql_history_days (0);
+    book_3 = qof_session_get_book (session_3);
+
+    coll_2 = qof_book_get_collection (book_2, GNC_ID_TRANS);
+    coll_3 = qof_book_get_collection (book_3, GNC_ID_TRANS);
+    g_assert_cmpuint (qof_collection_count (coll_3), <=,
+                      qof_collection_count (coll_2));
+
+    accounts = gnc_account_get_descendants (gnc_book_get_root_account (book_2));
+    for (node = accounts; node != NULL; node = node->next)
+    {
+        auto acc_2 = GNC_ACCOUNT (node->data);
+        auto acc_3 = xaccAccountLookup (qof_instance_get_guid (acc_2), book_3);
+        g_assert (acc_3 != NULL);
+        g_assert (gnc_numeric_equal (xaccAccountGetBalance (acc_2),
+                                     xaccAccountGetBalance (acc_3)));
+        g_assert (gnc_numeric_equal (xaccAccountGetClearedBalance (acc_2),
+                                     xaccAccountGetClearedBalance (acc_3)));
+        g_assert (gnc_numeric_equal (xaccAccountGetReconciledBalance (acc_2),
+                                     xaccAccountGetReconciledBalance (acc_3)));
+    }
+
+    /* A query for the splits of an account loads the history it needs */
+    for (node = accounts; node != NULL; node = node->next)
+    {
+        auto acc_2 = GNC_ACCOUNT (node->data);
+        auto acc_3 = xaccAccountLookup (qof_instance_get_guid (acc_2), book_3);
+        query = qof_query_create_for (GNC_ID_SPLIT);
+        qof_query_set_book (query, book_3);
+        xaccQueryAddSingleAccountMatch (query, acc_3, QOF_QUERY_AND);
+        g_assert_cmpuint (g_list_length (qof_query_run (query)), ==,
+                          g_list_length (xaccAccountGetSplitList (acc_2)));
+        qof_query_destroy (query);
+        g_assert (gnc_numeric_equal (xaccAccountGetBalance (acc_2),
+                                     xaccAccountGetBalance (acc_3)));
+    }
+    g_list_free (accounts);
+
+    /* A query for all splits needs all of the history.  The results are
+     * the query's and go with it. */
+    query = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (query, book_3);
+    g_assert_cmpuint (g_list_length (qof_query_run (query)), ==,
+                      qof_collection_count (qof_book_get_collection (
+                                                book_2, GNC_ID_SPLIT)));
+    qof_query_destroy (query);
+    g_assert_cmpuint (qof_collection_count (coll_3), ==,
+                      qof_collection_count (coll_2));
+    compare_books (book_2, book_3);
+
+    /* fixture->session belongs to the fixture and teardown() will clean it up */
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_end (session_3);
+    qof_session_destroy (session_3);
+}
+
+/* Change the slots of an account that's in the database already, so that
+ * only the slots that changed are written, and check that loading it back,
+ * nested frames and lists along, gives the same slots. */
+static void
+test_dbi_slots_save_and_load (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (const gchar*)pData;
+    QofSession* session_1, *session_2;
+    GList* accounts;
+    Account* acc_1, *acc_2;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (fixture->filename)
+        url = fixture->filename;
+
+    session_1 = qof_session_new ();
+    qof_session_begin (session_1, url, FALSE, TRUE, TRUE);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+
+    accounts = gnc_account_get_descendants (gnc_book_get_root_account (
+                                                qof_session_get_book (session_1)));
+    g_assert (accounts != NULL);
+    acc_1 = GNC_ACCOUNT (accounts->data);
+    g_list_free (accounts);
+
+    /* Nested frames and a list holding a frame */
+    xaccAccountBeginEdit (acc_1);
+    auto frame = qof_instance_get_slots (QOF_INSTANCE (acc_1));
+    frame->set_path ({"nested", "inner", "int64-val"},
+                     new KvpValue (INT64_C (1)));
+    frame->set_path ({"nested", "inner", "string-val"},
+                     new KvpValue (g_strdup ("inner")));
+    frame->set_path ({"nested", "double-val"}, new KvpValue (2.5));
+    auto list_frame = new KvpFrame;
+    list_frame->set ({"string-val"}, new KvpValue (g_strdup ("in a list")));
+    auto list = g_list_append (nullptr, new KvpValue (INT64_C (2)));
+    list = g_list_append (list, new KvpValue (list_frame));
+    frame->set ({"list-val"}, new KvpValue (list));
+    qof_instance_set_dirty (QOF_INSTANCE (acc_1));
+    xaccAccountCommitEdit (acc_1);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+
+    /* Change a top level slot, drop another and change a nested one */
+    xaccAccountBeginEdit (acc_1);
+    delete frame->set ({"int64-val"}, new KvpValue (INT64_C (200)));
+    delete frame->set ({"string-val"}, nullptr);
+    delete frame->set_path ({"nested", "inner", "int64-val"},
+                            new KvpValue (INT64_C (3)));
+    qof_instance_set_dirty (QOF_INSTANCE (acc_1));
+    xaccAccountCommitEdit (acc_1);
+    g_assert_cmpint (qof_session_get_error (session_1), == , ERR_BACKEND_NO_ERR);
+
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    qof_session_load (session_2, NULL);
+    g_assert_cmpint (qof_session_get_error (session_2), == , ERR_BACKEND_NO_ERR);
+    acc_2 = xaccAccountLookup (qof_instance_get_guid (acc_1),
+                               qof_session_get_book (session_2));
+    g_assert (acc_2 != NULL);
+    auto frame_2 = qof_instance_get_slots (QOF_INSTANCE (acc_2));
+    g_assert_cmpint (compare (frame, frame_2), ==, 0);
+    g_assert (frame_2->get_slot ({"string-val"}) == nullptr);
+    g_assert_cmpint (frame_2->get_slot ({"nested", "inner", "int64-val"})->get<int64_t> (),
+                     ==, 3);
+
+    /* fixture->session belongs to the fixture and teardown() will clean it up */
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    qof_session_end (session_1);
+    qof_session_destroy (session_1);
+}
+
 /** Test the safe_save mechanism.  Beware that this test used on its
  * own doesn't ensure that the resave is done safely, only that the
  * database is intact and unchanged after the save. To observe the
@@ -437,6 +617,7 @@ test_dbi_safe_save (Fixture* fixture, gconstpointer pData)
 {
     auto url = (gchar*)pData;
     QofSession* session_1 = NULL, *session_2 = NULL;
+    GncSqlBackend* sql_be = nullptr;
 
     auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
     auto log_domain = nullptr;
@@ -462,6 +643,10 @@ test_dbi_safe_save (Fixture* fixture, gconstpointer pData)
     qof_session_swap_data (fixture->session, session_1);
     qof_book_mark_session_dirty (qof_session_get_book (session_1));
     qof_session_save (session_1, NULL);
+    /* A database that holds the book only gets what changed, so have it
+     * need a resave for the safe save to write it all anew */
+    sql_be = reinterpret_cast<decltype(sql_be)>(qof_session_get_backend (session_1));
+    sql_be->set_table_version ("Gnucash", GNUCASH_RESAVE_VERSION - 1);
     /* Do a safe save */
     qof_session_safe_save (session_1, NULL);
     if (session_1 && qof_session_get_error (session_1) != ERR_BACKEND_NO_ERR)
@@ -491,6 +676,103 @@ test_dbi_safe_save (Fixture* fixture, gconstpointer pData)
 //    auto qof_be = qof_book_get_backend (qof_session_get_book (session_2));
 //    test_conn_index_functions (qof_be);
 
+cleanup:
+    fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
+                                                 (GLogFunc)test_checked_handler);
+    if (session_2 != NULL)
+    {
+        qof_session_end (session_2);
+        qof_session_destroy (session_2);
+    }
+    if (session_1 != NULL)
+    {
+        qof_session_end (session_1);
+        qof_session_destroy (session_1);
+    }
+    return;
+}
+/* A safe save of a database that holds the book writes only what changed,
+ * which an edit that isn't committed yet isn't. */
+static void
+test_dbi_safe_save_edit (Fixture* fixture, gconstpointer pData)
+{
+    auto url = (gchar*)pData;
+    QofSession* session_1 = NULL, *session_2 = NULL;
+    GList* accounts;
+    Account* acc;
+
+    auto msg = "[GncDbiSqlConnection::unlock_database()] There was no lock entry in the Lock table";
+    auto log_domain = nullptr;
+    auto loglevel = static_cast<GLogLevelFlags> (G_LOG_LEVEL_WARNING |
+                                                 G_LOG_FLAG_FATAL);
+    TestErrorStruct* check = test_error_struct_new (log_domain, loglevel, msg);
+
+    if (fixture->filename)
+        url = fixture->filename;
+
+    // Load the session data
+    session_1 = qof_session_new ();
+    qof_session_begin (session_1, url, FALSE, TRUE, TRUE);
+    if (session_1 &&
+        qof_session_get_error (session_1) != ERR_BACKEND_NO_ERR)
+    {
+        g_warning ("Session Error: %d, %s", qof_session_get_error (session_1),
+                   qof_session_get_error_message (session_1));
+        g_test_message ("DB Session Creation Failed");
+        g_assert (FALSE);
+        goto cleanup;
+    }
+    qof_session_swap_data (fixture->session, session_1);
+    qof_book_mark_session_dirty (qof_session_get_book (session_1));
+    qof_session_save (session_1, NULL);
+    /* Change an account without committing it: the safe save mustn't write
+     * the change, as the edit could still be rolled back */
+    accounts = gnc_account_get_descendants (gnc_book_get_root_account (
+                                                qof_session_get_book (session_1)));
+    g_assert (accounts != NULL);
+    acc = GNC_ACCOUNT (accounts->data);
+    g_list_free (accounts);
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetDescription (acc, "Changed during the safe save");
+    qof_session_safe_save (session_1, NULL);
+    if (session_1 && qof_session_get_error (session_1) != ERR_BACKEND_NO_ERR)
+    {
+        g_warning ("Session Error: %s",
+                   qof_session_get_error_message (session_1));
+        g_test_message ("DB Session Safe Save Failed");
+        g_assert (FALSE);
+        goto cleanup;
+    }
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    qof_session_load (session_2, NULL);
+    g_assert_cmpstr (xaccAccountGetDescription (
+                         xaccAccountLookup (qof_instance_get_guid (acc),
+                                            qof_session_get_book (session_2))),
+                     !=, "Changed during the safe save");
+    qof_session_end (session_2);
+    qof_session_destroy (session_2);
+    /* Committing the edit writes it */
+    xaccAccountCommitEdit (acc);
+    /* Destroy the session and reload it */
+
+    session_2 = qof_session_new ();
+    qof_session_begin (session_2, url, TRUE, FALSE, FALSE);
+    if (session_2 &&
+        qof_session_get_error (session_2) != ERR_BACKEND_NO_ERR)
+    {
+        g_warning ("Session Error: %d, %s", qof_session_get_error (session_2),
+                   qof_session_get_error_message (session_2));
+        g_test_message ("DB Session re-creation Failed");
+        g_assert (FALSE);
+        goto cleanup;
+    }
+    qof_session_load (session_2, NULL);
+    compare_books (qof_session_get_book (session_1),
+                   qof_session_get_book (session_2));
+//    auto qof_be = qof_book_get_backend (qof_session_get_book (session_2));
+//    test_conn_index_functions (qof_be);
+
 cleanup:
     fixture->hdlrs = test_log_set_fatal_handler (fixture->hdlrs, check,
                                                  (GLogFunc)test_checked_handler);
@@ -649,8 +931,14 @@ create_dbi_test_suite (const char* dbm_name, const char* url)
     auto subsuite = g_strdup_printf ("%s/%s", suitename, dbm_name);
     GNC_TEST_ADD (subsuite, "store_and_reload", Fixture, url, setup,
                   test_dbi_store_and_reload, teardown);
+    GNC_TEST_ADD (subsuite, "partial_load", Fixture, url, setup,
+                  test_dbi_partial_load, teardown);
+    GNC_TEST_ADD (subsuite, "slots_save_and_load", Fixture, url, setup_memory,
+                  test_dbi_slots_save_and_load, teardown);
     GNC_TEST_ADD (subsuite, "safe_save", Fixture, url, setup_memory,
                   test_dbi_safe_save, teardown);
+    GNC_TEST_ADD (subsuite, "safe_save_edit", Fixture, url, setup_memory,
+                  test_dbi_safe_save_edit, teardown);
     GNC_TEST_ADD (subsuite, "version_control", Fixture, url, setup_memory,
                   test_dbi_version_control, teardown);
     GNC_TEST_ADD (subsuite, "business_store_and_reload", Fixture, url,
@@ -42,6 +42,7 @@ extern "C"
 
 #include <string>
 #include <sstream>
+#include <unordered_map>
 
 #include "gnc-sql-connection.hpp"
 #include "gnc-sql-backend.hpp"
@@ -63,6 +64,11 @@ typedef enum
     LIST
 } context_t;
 
+struct slot_info_t;
+/* The frames and lists whose slots are still to be loaded, by the GUID
+ * their slots are stored under */
+using PendingSlots = std::unordered_map<std::string, slot_info_t*>;
+
 struct slot_info_t
 {
     GncSqlBackend* be;
@@ -75,6 +81,9 @@ struct slot_info_t
     KvpValue* pKvpValue;
     std::string path;
     std::string parent_path;
+    /* Where to leave nested frames and lists for loading along with the
+     * others, nullptr to load each of them right away. */
+    PendingSlots* pending = nullptr;
 };
 
 
@@ -100,6 +109,7 @@ static GDate* get_gdate_val (gpointer pObject);
 static void set_gdate_val (gpointer pObject, GDate* value);
 static slot_info_t* slot_info_copy (slot_info_t* pInfo, GncGUID* guid);
 static void slots_load_info (slot_info_t* pInfo);
+static void defer_slots_load (slot_info_t* pInfo);
 
 #define SLOT_MAX_PATHNAME_LEN 4096
 #define SLOT_MAX_STRINGVAL_LEN 4096
@@ -456,6 +466,14 @@ set_guid_val (gpointer pObject,  gpointer pValue)
 
         newInfo->context = LIST;
 
+        if (pInfo->pending)
+        {
+            /* The items are set in finish_pending_slots() */
+            newInfo->pKvpValue = new KvpValue {static_cast<GList*>(nullptr)};
+            pInfo->pKvpFrame->set ({key.c_str()}, newInfo->pKvpValue);
+            defer_slots_load (newInfo);
+            break;
+        }
         slots_load_info (newInfo);
         pValue = new KvpValue {newInfo->pList};
         pInfo->pKvpFrame->set ({key.c_str()}, pValue);
@@ -487,6 +505,11 @@ set_guid_val (gpointer pObject,  gpointer pValue)
         }
 
         newInfo->context = FRAME;
+        if (pInfo->pending)
+        {
+            defer_slots_load (newInfo);
+            break;
+        }
         slots_load_info (newInfo);
         delete newInfo;
         break;
@@ -570,6 +593,7 @@ slot_info_copy (slot_info_t* pInfo, GncGUID* guid)
     newSlot->pList = pInfo->pList;
     newSlot->context = pInfo->context;
     newSlot->pKvpValue = pInfo->pKvpValue;
+    newSlot->pending = pInfo->pending;
     if (!pInfo->path.empty())
         newSlot->parent_path = pInfo->path + "/";
     else
@@ -646,6 +670,91 @@ save_slot (const char* key, KvpValue* value, slot_info_t & slot_info)
     }
 }
 
+/* The slots of the frames and lists held by the slots the WHERE clause
+ * selects are deleted. */
+static void
+delete_nested_slots (GncSqlBackend* sql_be, const std::string& where)
+{
+    std::string sql("SELECT * FROM " TABLE_NAME " WHERE ");
+    sql += where + " and slot_type in ('" +
+        std::to_string (static_cast<int>(KvpValue::Type::FRAME)) + "', '" +
+        std::to_string (static_cast<int>(KvpValue::Type::GLIST)) +
+        "') and not guid_val is null";
+    auto stmt = sql_be->create_statement_from_sql(sql);
+    if (stmt == nullptr)
+        return;
+
+    auto result = sql_be->execute_select_statement(stmt);
+    for (auto row : *result)
+    {
+        try
+        {
+            const GncSqlColumnTableEntryPtr table_row =
+                col_table[guid_val_col];
+            GncGUID child_guid;
+            auto val = row.get_string_at_col (table_row->name());
+            if (string_to_guid (val.c_str(), &child_guid))
+                gnc_sql_slots_delete (sql_be, &child_guid);
+        }
+        catch (std::invalid_argument&)
+        {
+            continue;
+        }
+    }
+    delete result;
+}
+
+/* Delete the object's top level slot key with everything below it. */
+static gboolean
+delete_slot (GncSqlBackend* sql_be, const GncGUID* guid, const std::string& key)
+{
+    gnc::GUID obj_guid(*guid);
+    std::string where("obj_guid='");
+    where += obj_guid.to_string() + "' and name=" + sql_be->quote_string(key);
+
+    delete_nested_slots (sql_be, where);
+    auto stmt = sql_be->create_statement_from_sql("DELETE FROM " TABLE_NAME
+                                                  " WHERE " + where);
+    return stmt != nullptr && sql_be->execute_nonselect_statement(stmt) != -1;
+}
+
+/* Write the top level slots of pFrame that differ from the object's stored
+ * ones and delete the stored ones it no longer has.  A changed frame or
+ * list is written again as a whole. */
+static void
+save_changed_slots (KvpFrame* pFrame, slot_info_t& slot_info)
+{
+    KvpFrame stored;
+    slot_info_t stored_info = { NULL, NULL, TRUE, NULL, KvpValue::Type::INVALID,
+                                NULL, NONE, NULL, "" };
+
+    stored_info.be = slot_info.be;
+    stored_info.guid = slot_info.guid;
+    stored_info.pKvpFrame = &stored;
+    slots_load_info (&stored_info);
+
+    for (const auto& key : stored.get_keys())
+    {
+        if (slot_info.is_ok && pFrame->get_slot({key}) == nullptr)
+            slot_info.is_ok = delete_slot (slot_info.be, slot_info.guid, key);
+    }
+
+    pFrame->for_each_slot_temp ([&stored, &slot_info](const char* key,
+                                                      KvpValue* value)
+    {
+        if (!slot_info.is_ok)
+            return;
+        auto old_value = stored.get_slot({key});
+        if (old_value != nullptr)
+        {
+            if (compare (old_value, value) == 0)
+                return;
+            slot_info.is_ok = delete_slot (slot_info.be, slot_info.guid, key);
+        }
+        save_slot (key, value, slot_info);
+    });
+}
+
 gboolean
 gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infant,
                     QofInstance* inst)
@@ -658,15 +767,18 @@ gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infa
     g_return_val_if_fail (guid != NULL, FALSE);
     g_return_val_if_fail (pFrame != NULL, FALSE);
 
-    // If this is not saving into a new db, clear out the old saved slots first
-    if (!sql_be->pristine() && !is_infant)
-    {
-        (void)gnc_sql_slots_delete (sql_be, guid);
-    }
-
     slot_info.be = sql_be;
     slot_info.guid = guid;
-    pFrame->for_each_slot_temp (save_slot, slot_info);
+
+    /* The object's new rows that fill the same columns go in one statement. */
+    sql_be->begin_insert_batch();
+    // If this is not saving into a new db, only write what changed
+    if (!sql_be->pristine() && !is_infant)
+        save_changed_slots (pFrame, slot_info);
+    else
+        pFrame->for_each_slot_temp (save_slot, slot_info);
+    if (!sql_be->end_insert_batch())
+        slot_info.is_ok = FALSE;
 
     return slot_info.is_ok;
 }
@@ -674,7 +786,6 @@ gnc_sql_slots_save (GncSqlBackend* sql_be, const GncGUID* guid, gboolean is_infa
 gboolean
 gnc_sql_slots_delete (GncSqlBackend* sql_be, const GncGUID* guid)
 {
-    gchar* buf;
     gchar guid_buf[GUID_ENCODING_LENGTH + 1];
     slot_info_t slot_info = { NULL, NULL, TRUE, NULL, KvpValue::Type::INVALID,
                               NULL, FRAME, NULL, "" };
@@ -683,31 +794,7 @@ gnc_sql_slots_delete (GncSqlBackend* sql_be, const GncGUID* guid)
     g_return_val_if_fail (guid != NULL, FALSE);
 
     (void)guid_to_string_buff (guid, guid_buf);
-
-    buf = g_strdup_printf ("SELECT * FROM %s WHERE obj_guid='%s' and slot_type in ('%d', '%d') and not guid_val is null",
-                           TABLE_NAME, guid_buf, KvpValue::Type::FRAME, KvpValue::Type::GLIST);
-    auto stmt = sql_be->create_statement_from_sql(buf);
-    g_free (buf);
-    if (stmt != nullptr)
-    {
-        auto result = sql_be->execute_select_statement(stmt);
-        for (auto row : *result)
-        {
-            try
-            {
-                const GncSqlColumnTableEntryPtr table_row =
-                    col_table[guid_val_col];
-                GncGUID child_guid;
-                auto val = row.get_string_at_col (table_row->name());
-                if (string_to_guid (val.c_str(), &child_guid))
-                    gnc_sql_slots_delete (sql_be, &child_guid);
-            }
-            catch (std::invalid_argument&)
-            {
-                continue;
-            }
-        }
-    }
+    delete_nested_slots (sql_be, std::string{"obj_guid='"} + guid_buf + "'");
 
     slot_info.be = sql_be;
     slot_info.guid = guid;
@@ -820,26 +907,87 @@ load_slot_for_list_item (GncSqlBackend* sql_be, GncSqlRow& row,
 
 }
 
+/* Leave the nested frame or list pInfo is for to be loaded with the others
+ * the rows being loaded have.  pInfo is deleted once it's loaded. */
+static void
+defer_slots_load (slot_info_t* pInfo)
+{
+    gnc::GUID guid(*pInfo->guid);
+    pInfo->guid = nullptr;
+    auto result = pInfo->pending->emplace (guid.to_string(), pInfo);
+    if (!result.second)
+    {
+        PWARN ("Slots %s are held by more than one slot", guid.to_string().c_str());
+        delete pInfo;
+    }
+}
+
+/* Put the items of a pending list into its value. */
+static void
+finish_pending_slots (slot_info_t* pInfo)
+{
+    if (pInfo->context == LIST)
+        pInfo->pKvpValue->set (pInfo->pList);
+    delete pInfo;
+}
+
+/* Load the slots of the pending frames and lists, with a query for each
+ * level of nesting rather than one for each frame or list. */
+static void
+load_pending_slots (GncSqlBackend* sql_be, PendingSlots& pending)
+{
+    /* Keep the statements from getting too long */
+    constexpr std::size_t max_guids = 500;
+
+    while (!pending.empty())
+    {
+        PendingSlots loading, next;
+        loading.swap (pending);
+        for (auto& entry : loading)
+            entry.second->pending = &next;
+
+        auto it = loading.begin();
+        while (it != loading.end())
+        {
+            std::string sql("SELECT * FROM " TABLE_NAME " WHERE obj_guid IN (");
+            for (std::size_t n = 0; it != loading.end() && n < max_guids; ++it, ++n)
+                sql += (n ? ",'" : "'") + it->first + "'";
+            sql += ")";
+
+            auto stmt = sql_be->create_statement_from_sql(sql);
+            if (stmt == nullptr)
+                continue;
+            auto result = sql_be->execute_select_statement(stmt);
+            for (auto row : *result)
+            {
+                auto guid = load_obj_guid (sql_be, row);
+                auto info = loading.find (gnc::GUID(*guid).to_string());
+                if (info != loading.end())
+                    load_slot (info->second, row);
+            }
+            delete result;
+        }
+
+        for (auto& entry : loading)
+            finish_pending_slots (entry.second);
+        pending.swap (next);
+    }
+}
+
 static void
 load_slot_for_book_object (GncSqlBackend* sql_be, GncSqlRow& row,
-                           BookLookupFn lookup_fn)
+                           QofInstance* inst, PendingSlots& pending)
 {
     slot_info_t slot_info = { NULL, NULL, TRUE, NULL, KvpValue::Type::INVALID,
                               NULL, FRAME, NULL, "" };
-    const GncGUID* guid;
-    QofInstance* inst;
 
     g_return_if_fail (sql_be != NULL);
-    g_return_if_fail (lookup_fn != NULL);
-
-    guid = load_obj_guid (sql_be, row);
-    g_return_if_fail (guid != NULL);
-    inst = lookup_fn (guid, sql_be->book());
-    if (inst == NULL) return; /* Silently bail if the guid isn't loaded yet. */
+    g_return_if_fail (inst != NULL);
 
     slot_info.be = sql_be;
     slot_info.pKvpFrame = qof_instance_get_slots (inst);
     slot_info.path.clear();
+    slot_info.pending = &pending;
 
     gnc_sql_load_object (sql_be, row, TABLE_NAME, &slot_info, col_table);
 }
@@ -858,6 +1006,7 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* sql_be,
                                           BookLookupFn lookup_fn)
 {
     g_return_if_fail (sql_be != NULL);
+    g_return_if_fail (lookup_fn != NULL);
 
     // Ignore empty subquery
     if (subquery.empty()) return;
@@ -873,10 +1022,33 @@ void gnc_sql_slots_load_for_sql_subquery (GncSqlBackend* sql_be,
         PERR ("stmt == NULL, SQL = '%s'\n", sql.c_str());
         return;
     }
+
+    /* An object's rows usually come one after the other, so it's only
+     * looked up again when the object changes. */
+    GncGUID last_guid = *guid_null();
+    QofInstance* inst = nullptr;
+    PendingSlots pending;
     auto result = sql_be->execute_select_statement(stmt);
     for (auto row : *result)
-        load_slot_for_book_object (sql_be, row, lookup_fn);
+    {
+        auto guid = load_obj_guid (sql_be, row);
+        if (guid == nullptr)
+        {
+            PWARN ("Skipping a slot without an object GUID");
+            continue;
+        }
+        if (!guid_equal (guid, &last_guid))
+        {
+            last_guid = *guid;
+            inst = lookup_fn (guid, sql_be->book());
+        }
+        /* Silently bail if the guid isn't loaded yet. */
+        if (inst != nullptr)
+            load_slot_for_book_object (sql_be, row, inst, pending);
+    }
     delete result;
+
+    load_pending_slots (sql_be, pending);
 }
 
 /* ================================================================= */
@@ -111,6 +111,7 @@ GncSqlBackend::create_statement_from_sql(const std::string& str) const noexcept
 GncSqlResultPtr
 GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
+    flush_inserts();
     auto result = m_conn->execute_select_statement(stmt);
     if (result == nullptr)
     {
@@ -123,6 +124,7 @@ GncSqlBackend::execute_select_statement(const GncSqlStatementPtr& stmt) const no
 int
 GncSqlBackend::execute_nonselect_statement(const GncSqlStatementPtr& stmt) const noexcept
 {
+    flush_inserts();
     auto result = m_conn->execute_nonselect_statement(stmt);
     if (result == -1)
     {
@@ -170,6 +172,12 @@ GncSqlBackend::create_index(const std::string& index_name,
     return m_conn->create_index(index_name, table_name, col_table);
 }
 
+bool
+GncSqlBackend::does_index_exist(const std::string& index_name) const noexcept
+{
+    return m_conn->does_index_exist(index_name);
+}
+
 bool
 GncSqlBackend::add_columns_to_table(const std::string& table_name,
                                     const EntryVec& col_table) const noexcept
@@ -278,6 +286,17 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
         assert (m_book == nullptr);
         m_book = book;
 
+        /* Only the recent transactions are loaded if so asked, the others
+         * when queries need them. */
+        auto days = gnc_prefs_get_sql_history_days ();
+        if (days > 0)
+            m_history_start = gnc_time64_get_day_start (gnc_time (nullptr) -
+                static_cast<time64>(days) * 24 * 60 * 60);
+        else
+            m_history_start = INT64_MIN;
+        m_account_history.clear();
+        m_loaded_queries.clear();
+
         auto num_types = m_backend_registry.size();
         auto num_done = 0;
 
@@ -308,15 +327,25 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
                                        nullptr);
 
         m_backend_registry.load_remaining(this);
+        if (m_history_start != INT64_MIN)
+            gnc_sql_transaction_set_start_balances (this);
 
         gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
                                        nullptr);
+        m_holds_book = true;
     }
     else if (loadType == LOAD_TYPE_LOAD_ALL)
     {
         // Load all transactions
-        auto obe = m_backend_registry.get_object_backend (GNC_ID_TRANS);
-        obe->load_all (this);
+        if (m_history_start != INT64_MIN)
+        {
+            load_history (book, nullptr, INT64_MIN);
+        }
+        else
+        {
+            auto obe = m_backend_registry.get_object_backend (GNC_ID_TRANS);
+            obe->load_all (this);
+        }
     }
 
     m_loading = FALSE;
@@ -336,6 +365,127 @@ GncSqlBackend::load (QofBook* book, QofBackendLoadType loadType)
     LEAVE ("");
 }
 
+void
+GncSqlBackend::load_history (QofBook* book, const GList* account_guids,
+                             time64 since)
+{
+    std::vector<Account*> accounts;
+
+    if (book != m_book || m_history_start == INT64_MIN ||
+        since >= m_history_start)
+        return;
+
+    /* Leave out the accounts whose history is already loaded that far */
+    for (auto node = account_guids; node != nullptr; node = node->next)
+    {
+        auto acc = xaccAccountLookup (static_cast<GncGUID*>(node->data), m_book);
+        if (acc == nullptr)
+            continue;
+        auto loaded = m_account_history.find (acc);
+        if (loaded == m_account_history.end() || loaded->second > since)
+            accounts.push_back (acc);
+    }
+    if (account_guids != nullptr && accounts.empty())
+        return;
+
+    ENTER ("sql_be=%p, since=%" G_GINT64_FORMAT, this, since);
+
+    auto loading = begin_history_load ();
+    gnc_sql_transaction_load_history (this, accounts, since, m_history_start);
+    end_history_load (loading);
+
+    if (account_guids == nullptr)
+    {
+        m_history_start = since;
+        m_loaded_queries.clear();
+        for (auto it = m_account_history.begin(); it != m_account_history.end();)
+        {
+            if (it->second >= since)
+                it = m_account_history.erase (it);
+            else
+                ++it;
+        }
+    }
+    else
+    {
+        for (auto acc : accounts)
+            m_account_history[acc] = since;
+    }
+
+    LEAVE ("");
+}
+
+/* Reports and registers build queries with new dates all the time. */
+static constexpr std::size_t MAX_LOADED_QUERIES = 1000;
+
+bool
+GncSqlBackend::load_query (QofBook* book, QofQuery* query)
+{
+    if (book != m_book || m_history_start == INT64_MIN)
+        return true;
+
+    /* Only transactions and their splits are left in the database */
+    auto search_for = qof_query_get_search_for (query);
+    if (g_strcmp0 (search_for, GNC_ID_SPLIT) != 0 &&
+        g_strcmp0 (search_for, GNC_ID_TRANS) != 0)
+        return true;
+
+    auto selector = gnc_sql_transaction_query_selector (this, query,
+                                                        m_history_start);
+    if (selector.empty())
+    {
+        /* The loader of split queries narrows them down some more, but
+         * nothing is registered for transaction queries. */
+        if (g_strcmp0 (search_for, GNC_ID_SPLIT) == 0)
+            return false;
+        load_history (book, nullptr, INT64_MIN);
+        return true;
+    }
+    /* The transactions that a query keeping only its last results selects
+     * change as those after them are deleted, so those are run each time. */
+    if (qof_query_get_max_results (query) <= 0)
+    {
+        if (m_loaded_queries.count (selector))
+            return true;
+        if (m_loaded_queries.size() >= MAX_LOADED_QUERIES)
+            m_loaded_queries.clear();
+        m_loaded_queries.insert (selector);
+    }
+
+    ENTER ("sql_be=%p, query=%p", this, query);
+
+    auto loading = begin_history_load ();
+    gnc_sql_transaction_load_selected (this, selector);
+    end_history_load (loading);
+
+    LEAVE ("");
+    return true;
+}
+
+/* The query that wanted them loaded finds the transactions; the events
+ * would only have other queries run and come back here meanwhile. */
+bool
+GncSqlBackend::begin_history_load () noexcept
+{
+    qof_event_suspend ();
+    auto loading = m_loading;
+    m_loading = true;
+    auto root = gnc_book_get_root_account (m_book);
+    gnc_account_foreach_descendant(root, (AccountCb)xaccAccountBeginEdit,
+                                   nullptr);
+    return loading;
+}
+
+void
+GncSqlBackend::end_history_load (bool loading) noexcept
+{
+    auto root = gnc_book_get_root_account (m_book);
+    gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
+                                   nullptr);
+    m_loading = loading;
+    qof_event_resume ();
+}
+
 /* ================================================================= */
 
 bool
@@ -452,10 +602,24 @@ GncSqlBackend::sync(QofBook* book)
 {
     g_return_if_fail (book != NULL);
 
+    if (book == m_book && m_holds_book)
+        sync_changes (book);
+    else
+        sync_all (book);
+}
+
+void
+GncSqlBackend::sync_all(QofBook* book)
+{
+    g_return_if_fail (book != NULL);
+
     reset_version_info();
     ENTER ("book=%p, sql_be->book=%p", book, m_book);
     update_progress(101.0);
 
+    /* Until all of it is written, the next save has to write all again. */
+    m_holds_book = false;
+
     /* Create new tables */
     m_is_pristine_db = true;
     create_tables();
@@ -463,6 +627,7 @@ GncSqlBackend::sync(QofBook* book)
     /* Save all contents */
     m_book = book;
     auto is_ok = m_conn->begin_transaction();
+    begin_insert_batch();
 
     // FIXME: should write the set of commodities that are used
     // write_commodities(sql_be, book);
@@ -492,6 +657,8 @@ GncSqlBackend::sync(QofBook* book)
         for (auto entry : m_backend_registry)
             std::get<1>(entry)->write (this);
     }
+    if (!end_insert_batch())
+        is_ok = false;
     if (is_ok)
     {
         is_ok = m_conn->commit_transaction();
@@ -499,6 +666,8 @@ GncSqlBackend::sync(QofBook* book)
     if (is_ok)
     {
         m_is_pristine_db = false;
+        m_holds_book = true;
+        m_unsaved.clear();
 
         /* Mark the session as clean -- though it shouldn't ever get
          * marked dirty with this backend
@@ -514,6 +683,81 @@ GncSqlBackend::sync(QofBook* book)
     LEAVE ("book=%p", book);
 }
 
+/* An instance that's still being edited is written when it's committed,
+ * or not at all if the edit is rolled back. */
+static void
+collect_changed_instance (QofInstance* inst, gpointer data)
+{
+    if (qof_instance_get_editlevel (inst) > 0)
+        return;
+    if (qof_instance_get_dirty_flag (inst) || qof_instance_get_destroying (inst))
+        static_cast<InstanceVec*>(data)->push_back (inst);
+}
+
+/* Editing marks an instance dirty but not its collection, so all of them
+ * have to be looked at. */
+static void
+collect_changed_instances (QofCollection* col, gpointer data)
+{
+    qof_collection_foreach (col, collect_changed_instance, data);
+}
+
+void
+GncSqlBackend::sync_changes(QofBook* book)
+{
+    g_return_if_fail (book != NULL);
+
+    ENTER ("book=%p", book);
+    update_progress(101.0);
+
+    InstanceVec changed;
+    qof_book_foreach_collection (book, collect_changed_instances, &changed);
+    for (auto& unsaved : m_unsaved)
+    {
+        auto coll = qof_book_get_collection (book, unsaved.first);
+        auto inst = qof_collection_lookup_entity (coll, &unsaved.second);
+        if (inst != nullptr && qof_instance_get_editlevel (inst) == 0 &&
+            std::find (changed.begin(), changed.end(), inst) == changed.end())
+            changed.push_back (inst);
+    }
+
+    auto is_ok = m_conn->begin_transaction();
+    begin_insert_batch();
+    for (auto inst : changed)
+    {
+        if (!is_ok)
+            break;
+        // The PriceDB, for one, isn't in the database
+        auto obe = m_backend_registry.get_object_backend(std::string{inst->e_type});
+        if (obe != nullptr)
+            is_ok = obe->commit (this, inst);
+    }
+    if (!end_insert_batch())
+        is_ok = false;
+    if (is_ok)
+    {
+        is_ok = m_conn->commit_transaction();
+    }
+    if (is_ok)
+    {
+        for (auto inst : changed)
+        {
+            forget_unsaved (inst);
+            qof_instance_mark_clean (inst);
+        }
+        /* Those still being edited are written when they're committed. */
+        if (m_unsaved.empty())
+            qof_book_mark_session_saved(book);
+    }
+    else
+    {
+        set_error (ERR_BACKEND_SERVER_ERR);
+        m_conn->rollback_transaction ();
+    }
+    finish_progress();
+    LEAVE ("book=%p", book);
+}
+
 /* ================================================================= */
 /* Routines to deal with the creation of multiple books. */
 
@@ -602,6 +846,10 @@ GncSqlBackend::commit (QofInstance* inst)
     if (!m_conn->begin_transaction ())
     {
         PERR ("begin_transaction failed\n");
+        if (is_destroying)
+            forget_undeleted (inst);
+        else
+            remember_unsaved (inst);
         LEAVE ("Rolled back - database transaction begin error");
         return;
     }
@@ -627,19 +875,56 @@ GncSqlBackend::commit (QofInstance* inst)
         // Error - roll it back
         (void)m_conn->rollback_transaction();
 
-        // This *should* leave things marked dirty
+        /* The engine marks inst clean regardless, so the next save has to
+         * be told to write it. A destroyed one is freed, though. */
+        if (is_destroying)
+            forget_undeleted (inst);
+        else
+            remember_unsaved (inst);
         LEAVE ("Rolled back - database error");
         return;
     }
 
     (void)m_conn->commit_transaction ();
 
-    qof_book_mark_session_saved(m_book);
+    forget_unsaved (inst);
+    if (m_unsaved.empty() && m_holds_book)
+        qof_book_mark_session_saved(m_book);
     qof_instance_mark_clean (inst);
 
     LEAVE ("");
 }
 
+/* Which of the rows go with a destroyed instance depends on its type, and
+ * the instance is freed, so its rows can only go with a full save. */
+void
+GncSqlBackend::forget_undeleted (QofInstance* inst) noexcept
+{
+    forget_unsaved (inst);
+    m_holds_book = false;
+}
+
+
+void
+GncSqlBackend::remember_unsaved (QofInstance* inst) noexcept
+{
+    forget_unsaved (inst);
+    m_unsaved.emplace_back (inst->e_type, *qof_instance_get_guid (inst));
+}
+
+void
+GncSqlBackend::forget_unsaved (QofInstance* inst) noexcept
+{
+    if (m_unsaved.empty())
+        return;
+    auto guid = qof_instance_get_guid (inst);
+    m_unsaved.erase (std::remove_if (m_unsaved.begin(), m_unsaved.end(),
+                                     [guid](const std::pair<QofIdTypeConst,
+                                            GncGUID>& unsaved) {
+                                         return guid_equal (&unsaved.second,
+                                                            guid); }),
+                     m_unsaved.end());
+}
 
 /**
  * Sees if the version table exists, and if it does, loads the info into
@@ -842,6 +1127,8 @@ GncSqlBackend::do_db_operation (E_DB_OPERATION op, const char* table_name,
     switch(op)
     {
         case  OP_DB_INSERT:
+        if (m_batch_depth > 0)
+            return queue_insert (table_name, obj_name, pObject, table);
         stmt = build_insert_statement (table_name, obj_name, pObject, table);
         break;
         case OP_DB_UPDATE:
@@ -860,13 +1147,120 @@ bool
 GncSqlBackend::save_commodity(gnc_commodity* comm) noexcept
 {
     if (comm == nullptr) return false;
+    if (m_batch_depth > 0 && m_saved_commodities.count(comm))
+        return true;
     QofInstance* inst = QOF_INSTANCE(comm);
     auto obe = m_backend_registry.get_object_backend(std::string(inst->e_type));
+    auto is_ok = true;
     if (obe && !obe->instance_in_db(this, inst))
-        return obe->commit(this, inst);
+        is_ok = obe->commit(this, inst);
+    if (m_batch_depth > 0 && is_ok)
+        m_saved_commodities.insert(comm);
+    return is_ok;
+}
+
+/* SQLite before 3.8.8 takes at most 500 rows in a VALUES clause and
+ * MySQL's max_allowed_packet may be as small as 1MB. */
+static constexpr unsigned int MAX_BATCH_ROWS = 250;
+static constexpr std::string::size_type MAX_BATCH_SIZE = 256 * 1024;
+
+void
+GncSqlBackend::begin_insert_batch() noexcept
+{
+    if (m_batch_depth++ == 0)
+        m_batch_ok = true;
+}
+
+bool
+GncSqlBackend::end_insert_batch() noexcept
+{
+    g_return_val_if_fail (m_batch_depth > 0, false);
+    if (--m_batch_depth > 0)
+        return m_batch_ok;
+
+    flush_inserts();
+    m_insert_batches.clear();
+    m_saved_commodities.clear();
+    return m_batch_ok;
+}
+
+bool
+GncSqlBackend::queue_insert (const char* table_name, QofIdTypeConst obj_name,
+                             gpointer pObject, const EntryVec& table) const noexcept
+{
+    PairVec values{get_object_values(obj_name, pObject, table)};
+    std::string columns{"("};
+    std::string row{"("};
+
+    for (auto const& col_value : values)
+    {
+        if (row.size() > 1)
+        {
+            columns += ",";
+            row += ",";
+        }
+        columns += col_value.first;
+        row += col_value.second;
+    }
+    columns += ")";
+    row += ")";
+
+    /* Columns whose value is NULL are left out, so rows of the same table,
+     * slots holding different types for one, may fill different columns.
+     * Each set of them has a batch of its own. */
+    auto& batch = m_insert_batches[std::string{table_name} + columns];
+    if (batch.count == 0)
+    {
+        batch.table = table_name;
+        batch.columns = std::move(columns);
+        batch.rows = std::move(row);
+    }
+    else
+    {
+        batch.rows += ",";
+        batch.rows += row;
+    }
+    if (++batch.count >= MAX_BATCH_ROWS || batch.rows.size() >= MAX_BATCH_SIZE)
+        return send_insert_batch(batch);
+    return true;
+}
+
+bool
+GncSqlBackend::send_insert_batch (InsertBatch& batch) const noexcept
+{
+    if (batch.count == 0)
+        return true;
+
+    auto stmt = create_statement_from_sql("INSERT INTO " + batch.table +
+                                          batch.columns + " VALUES" +
+                                          batch.rows);
+    batch.count = 0;
+    batch.rows.clear();
+    if (stmt == nullptr)
+    {
+        m_batch_ok = false;
+        return false;
+    }
+    if (m_conn->execute_nonselect_statement(stmt) == -1)
+    {
+        PERR ("SQL error: %s\n", stmt->to_sql());
+        qof_backend_set_error ((QofBackend*)this, ERR_BACKEND_SERVER_ERR);
+        m_batch_ok = false;
+        return false;
+    }
     return true;
 }
 
+bool
+GncSqlBackend::flush_inserts () const noexcept
+{
+    auto is_ok = true;
+    for (auto& entry : m_insert_batches)
+        if (!send_insert_batch(entry.second))
+            is_ok = false;
+    return is_ok;
+}
+
 GncSqlStatementPtr
 GncSqlBackend::build_insert_statement (const char* table_name,
                                        QofIdTypeConst obj_name,
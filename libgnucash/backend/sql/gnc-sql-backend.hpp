@@ -32,6 +32,9 @@ extern "C"
 #include <memory>
 #include <exception>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <qof-backend.hpp>
 
@@ -74,11 +77,50 @@ public:
      */
     void load(QofBook*, QofBackendLoadType) override;
     /**
-     * Save the contents of a book to an SQL database.
+     * Load the transactions posted on or after since with splits in the
+     * accounts with the GUIDs in account_guids, or in any account if it's
+     * NULL, that the initial load left in the database.
+     *
+     * @param book Book being loaded
+     * @param account_guids GUIDs of the accounts, or NULL for all
+     * @param since Earliest posted date to load
+     */
+    void load_history(QofBook*, const GList*, time64) override;
+    /**
+     * Load the transactions that the initial load left in the database and
+     * that a query for splits or transactions may need, as selected by the
+     * SQL the query compiles to.
+     *
+     * @param book Book being loaded
+     * @param query Query about to run
+     * @return false if the terms of a query for splits don't narrow the
+     * transactions down; the whole history is loaded for such a query for
+     * transactions
+     */
+    bool load_query(QofBook*, QofQuery*) override;
+    /**
+     * Save a book to an SQL database: only what changed if the database
+     * holds it already, having loaded it or saved all of it before, all of
+     * it otherwise.
      *
      * @param book Book to be saved
      */
     void sync(QofBook*) override;
+    /**
+     * Create the tables and write all of the contents of a book to them.
+     *
+     * @param book Book to be saved
+     */
+    void sync_all(QofBook*);
+    /**
+     * Write the objects of a book that the database doesn't have as they
+     * are: the dirty ones, those being destroyed and those whose commit
+     * failed. They're written in one database transaction, leaving the
+     * tables and their indexes in place.
+     *
+     * @param book Book loaded from or saved to the database before
+     */
+    void sync_changes(QofBook*);
     /**
      * An object is about to be edited.
      *
@@ -157,6 +199,13 @@ public:
     bool create_index(const std::string& index_name,
                       const std::string& table_name,
                       const EntryVec& col_table) const noexcept;
+    /**
+     * Checks whether the database has an index
+     *
+     * @param index_name Index name
+     * @return TRUE if the index exists, FALSE if it doesn't
+     */
+    bool does_index_exist(const std::string& index_name) const noexcept;
     /**
      * Adds one or more columns to an existing table.
      *
@@ -226,6 +275,22 @@ public:
     bool do_db_operation (E_DB_OPERATION op, const char* table_name,
                           QofIdTypeConst obj_name, gpointer pObject,
                           const EntryVec& table) const noexcept;
+    /**
+     * Collect the rows of OP_DB_INSERT operations into multi-row INSERT
+     * statements, one for each table and set of columns the rows fill,
+     * until end_insert_batch(). The rows waiting are sent before any other
+     * statement, so the database looks the same to everything else as it
+     * would without batching. Batches nest; the rows are sent when the
+     * outermost one ends, if not before.
+     */
+    void begin_insert_batch() noexcept;
+    /**
+     * End a batch, sending the rows still waiting and stopping batching if
+     * it's the outermost one.
+     *
+     * @return false if any of the batched INSERTs failed so far.
+     */
+    bool end_insert_batch() noexcept;
     /**
      * Ensure that a commodity referenced in another object is in fact saved
      * in the database.
@@ -237,6 +302,12 @@ public:
     QofBook* book() const noexcept { return m_book; }
     void set_loading(bool loading) noexcept { m_loading = loading; }
     bool pristine() const noexcept { return m_is_pristine_db; }
+    /** Whether the database holds the book as it was last loaded or saved,
+     * so that saving it need only write what changed since. */
+    bool holds_book() const noexcept { return m_holds_book; }
+    /** Transactions posted before this were left in the database by the
+     * initial load, unless it's INT64_MIN. */
+    time64 history_start() const noexcept { return m_history_start; }
     void update_progress(double pct) const noexcept;
     void finish_progress() const noexcept;
 
@@ -266,6 +337,43 @@ private:
                                                QofIdTypeConst obj_name,
                                                gpointer pObject,
                                                const EntryVec& table) const noexcept;
+    bool queue_insert (const char* table_name, QofIdTypeConst obj_name,
+                       gpointer pObject, const EntryVec& table) const noexcept;
+    bool flush_inserts () const noexcept;
+
+    /** The rows of a table waiting to be inserted. They all have values
+     * for the same columns, as a multi-row INSERT needs. */
+    struct InsertBatch
+    {
+        std::string table;
+        std::string columns;    /**< "(col,...)" */
+        std::string rows;       /**< "(value,...),(value,...)" */
+        unsigned int count = 0;
+    };
+    bool send_insert_batch (InsertBatch& batch) const noexcept;
+    unsigned int m_batch_depth = 0;
+    mutable bool m_batch_ok = true;
+    /** The batches by table name and columns. */
+    mutable std::unordered_map<std::string, InsertBatch> m_insert_batches;
+    /** Commodities known to be in the database while batching, so that
+     * save_commodity() needn't look and send the rows waiting each time. */
+    std::unordered_set<gnc_commodity*> m_saved_commodities;
+    time64 m_history_start = INT64_MIN;
+    /** How far back the history of accounts was loaded beyond
+     * m_history_start. */
+    std::unordered_map<Account*, time64> m_account_history;
+    bool m_holds_book = false;
+    /** The types and GUIDs of the objects whose commit failed, for
+     * sync_changes() to write. */
+    std::vector<std::pair<QofIdTypeConst, GncGUID>> m_unsaved;
+    void remember_unsaved (QofInstance* inst) noexcept;
+    void forget_unsaved (QofInstance* inst) noexcept;
+    void forget_undeleted (QofInstance* inst) noexcept;
+    /** The selectors of the queries whose transactions were loaded, but for
+     * those keeping only their last results. */
+    std::unordered_set<std::string> m_loaded_queries;
+    bool begin_history_load () noexcept;
+    void end_history_load (bool loading) noexcept;
 
     class ObjectBackendRegistry
     {
@@ -84,6 +84,8 @@ public:
     /** Returns TRUE if successful, FALSE if error */
     virtual bool create_index (const std::string&, const std::string&,
                                const EntryVec&) const noexcept = 0;
+    /** Returns true if the database has an index with that name */
+    virtual bool does_index_exist (const std::string&) const noexcept = 0;
     /** Returns TRUE if successful, FALSE if error */
     virtual bool add_columns_to_table (const std::string&, const ColVec&)
         const noexcept = 0;
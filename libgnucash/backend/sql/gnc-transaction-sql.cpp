@@ -49,10 +49,12 @@ extern "C"
 #endif
 }
 
+#include <cmath>
+#include <locale>
 #include <string>
 #include <sstream>
-
-#include "escape.h"
+#include <unordered_map>
+#include <vector>
 
 #include <gnc-datetime.hpp>
 #include "gnc-sql-connection.hpp"
@@ -63,14 +65,12 @@ extern "C"
 #include "gnc-commodity-sql.h"
 #include "gnc-slots-sql.h"
 
-#define SIMPLE_QUERY_COMPILATION 1
-
 static QofLogModule log_module = G_LOG_DOMAIN;
 
 #define TRANSACTION_TABLE "transactions"
-#define TX_TABLE_VERSION 4
+#define TX_TABLE_VERSION 5
 #define SPLIT_TABLE "splits"
-#define SPLIT_TABLE_VERSION 4
+#define SPLIT_TABLE_VERSION 5
 
 struct split_info_t : public write_objects_t
 {
@@ -141,6 +141,11 @@ static const EntryVec tx_guid_col_table
     gnc_sql_make_table_entry<CT_GUID>("tx_guid", 0, 0, "guid"),
 };
 
+static const EntryVec lot_guid_col_table
+{
+    gnc_sql_make_table_entry<CT_GUID>("lot_guid", 0, 0, "guid"),
+};
+
 GncSqlTransBackend::GncSqlTransBackend() :
     GncSqlObjectBackend(TX_TABLE_VERSION, GNC_ID_TRANS,
                         TRANSACTION_TABLE, tx_col_table) {}
@@ -241,6 +246,22 @@ load_single_split (GncSqlBackend* sql_be, GncSqlRow& row)
     }
     return pSplit;
 }
+
+/* Make room in the book's collection of type for count more entities. */
+static void
+reserve_entities (GncSqlBackend* sql_be, QofIdTypeConst type, uint64_t count)
+{
+    auto coll = qof_book_get_collection (sql_be->book(), type);
+    qof_collection_reserve (coll, qof_collection_count (coll) + count);
+}
+
+/* t as the literal to compare post_date with. */
+static std::string
+time_literal (time64 t)
+{
+    return "'" + GncDateTime(t).format_iso8601() + "'";
+}
+
 static void
 load_splits_for_transactions (GncSqlBackend* sql_be, std::string selector)
 {
@@ -264,6 +285,7 @@ load_splits_for_transactions (GncSqlBackend* sql_be, std::string selector)
     // Execute the query and load the splits
     auto stmt = sql_be->create_statement_from_sql(sql);
     auto result = sql_be->execute_select_statement (stmt);
+    reserve_entities (sql_be, GNC_ID_SPLIT, result->size());
 
     for (auto row : *result)
         load_single_split (sql_be, row);
@@ -329,11 +351,12 @@ typedef struct
  *
  * @param sql_be SQL backend
  * @param stmt SQL statement
+ * @return The transactions that weren't loaded before
  */
-static void
+static InstanceVec
 query_transactions (GncSqlBackend* sql_be, std::string selector)
 {
-    g_return_if_fail (sql_be != NULL);
+    g_return_val_if_fail (sql_be != NULL, InstanceVec{});
 
     const std::string tpkey(tx_col_table[0]->name());
     std::string sql("SELECT * FROM " TRANSACTION_TABLE);
@@ -347,7 +370,7 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
     if (result->begin() == result->end())
     {
         PINFO("Query %s returned no results", sql.c_str());
-        return;
+        return InstanceVec{};
     }
 
     Transaction* tx;
@@ -355,6 +378,7 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
     // Load the transactions
     InstanceVec instances;
     instances.reserve(result->size());
+    reserve_entities (sql_be, GNC_ID_TRANS, result->size());
     for (auto row : *result)
     {
         tx = load_single_tx (sql_be, row);
@@ -391,6 +415,7 @@ query_transactions (GncSqlBackend* sql_be, std::string selector)
     for (auto instance : instances)
          xaccTransCommitEdit(GNC_TRANSACTION(instance));
 
+    return instances;
 }
 
 
@@ -426,8 +451,16 @@ GncSqlTransBackend::create_tables (GncSqlBackend* sql_be)
             1->2: 64 bit int handling
             2->3: allow dates to be NULL
             3->4: Use DATETIME instead of TIMESTAMP in MySQL
+            4->5: Index the posted dates, which the table copy of the
+                  earlier upgrades dropped and queries select on
         */
-        sql_be->upgrade_table(m_table_name.c_str(), tx_col_table);
+        if (version < 4)
+            sql_be->upgrade_table(m_table_name.c_str(), tx_col_table);
+        /* Only tables created at version 4 still have the index. */
+        if (!sql_be->does_index_exist ("tx_post_date_index") &&
+            !sql_be->create_index ("tx_post_date_index", TRANSACTION_TABLE,
+                                   post_date_col_table))
+            PERR ("Unable to create index\n");
         sql_be->set_table_version (m_table_name.c_str(), m_version);
         PINFO ("Transactions table upgraded from version %d to version %d\n",
                version, m_version);
@@ -450,21 +483,31 @@ GncSqlSplitBackend::create_tables (GncSqlBackend* sql_be)
                                    m_table_name.c_str(),
                                    account_guid_col_table))
             PERR ("Unable to create index\n");
+        if (!sql_be->create_index("splits_lot_guid_index",
+                                   m_table_name.c_str(), lot_guid_col_table))
+            PERR ("Unable to create index\n");
     }
     else if (version < SPLIT_TABLE_VERSION)
     {
 
         /* Upgrade:
            1->2: 64 bit int handling
-           3->4: Split reconcile date can be NULL */
-        sql_be->upgrade_table(m_table_name.c_str(), split_col_table);
-        if (!sql_be->create_index("splits_tx_guid_index",
-                                   m_table_name.c_str(),
-                                   tx_guid_col_table))
-            PERR ("Unable to create index\n");
-        if (!sql_be->create_index("splits_account_guid_index",
-                                   m_table_name.c_str(),
-                                   account_guid_col_table))
+           3->4: Split reconcile date can be NULL
+           4->5: Index the lots, which queries and partial loads look for */
+        if (version < 4)
+        {
+            sql_be->upgrade_table(m_table_name.c_str(), split_col_table);
+            if (!sql_be->create_index("splits_tx_guid_index",
+                                       m_table_name.c_str(),
+                                       tx_guid_col_table))
+                PERR ("Unable to create index\n");
+            if (!sql_be->create_index("splits_account_guid_index",
+                                       m_table_name.c_str(),
+                                       account_guid_col_table))
+                PERR ("Unable to create index\n");
+        }
+        if (!sql_be->create_index("splits_lot_guid_index",
+                                   m_table_name.c_str(), lot_guid_col_table))
             PERR ("Unable to create index\n");
         sql_be->set_table_version (m_table_name.c_str(), m_version);
         PINFO ("Splits table upgraded from version %d to version %d\n", version,
@@ -707,6 +750,10 @@ void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* sql_be,
  * Loads all transactions.  This might be used during a save-as operation to ensure that
  * all data is in memory and ready to be saved.
  *
+ * If the backend keeps the transactions posted before its history_start() in
+ * the database, only the later ones are loaded, along with those without a
+ * posted date and those with splits in lots, which lot balances need.
+ *
  * @param sql_be SQL backend
  */
 void
@@ -714,234 +761,733 @@ GncSqlTransBackend::load_all (GncSqlBackend* sql_be)
 {
     g_return_if_fail (sql_be != NULL);
 
+    std::string selector;
+    auto since = sql_be->history_start();
+    if (since != INT64_MIN)
+    {
+        const std::string pdkey(tx_col_table[3]->name());   //post_date
+        const std::string tpkey(tx_col_table[0]->name());   //guid
+        const std::string stkey(split_col_table[1]->name()); //tx_guid
+        const std::string slkey(split_col_table[9]->name()); //lot_guid
+        selector = pdkey + " >= " + time_literal (since) + " OR " + pdkey +
+            " IS NULL OR " + tpkey + " IN (SELECT " + stkey + " FROM "
+            SPLIT_TABLE " WHERE " + slkey + " IS NOT NULL)";
+    }
+
     auto root = gnc_book_get_root_account (sql_be->book());
     gnc_account_foreach_descendant(root, (AccountCb)xaccAccountBeginEdit,
                                    nullptr);
-    query_transactions (sql_be, "");
+    query_transactions (sql_be, selector);
     gnc_account_foreach_descendant(root, (AccountCb)xaccAccountCommitEdit,
                                    nullptr);
 }
 
+typedef struct
+{
+    const GncSqlBackend* sql_be;
+    Account* acct;
+    char reconcile_state;
+    gnc_numeric balance;
+} single_acct_balance_t;
+
 static void
-convert_query_comparison_to_sql (QofQueryPredData* pPredData,
-                                 gboolean isInverted, std::stringstream& sql)
-{
-    if (pPredData->how == QOF_COMPARE_LT
-        || (isInverted && pPredData->how == QOF_COMPARE_GTE))
-        sql << "<";
-    else if (pPredData->how == QOF_COMPARE_LTE
-             || (isInverted && pPredData->how == QOF_COMPARE_GT))
-        sql << "<=";
-    else if (pPredData->how == QOF_COMPARE_EQUAL
-             || (isInverted && pPredData->how == QOF_COMPARE_NEQ))
-        sql << "=";
-    else if (pPredData->how == QOF_COMPARE_GT
-             || (isInverted && pPredData->how == QOF_COMPARE_LTE))
-        sql << ">";
-    else if (pPredData->how == QOF_COMPARE_GTE
-             || (isInverted && pPredData->how == QOF_COMPARE_LT))
-        sql << ">=";
-    else if (pPredData->how == QOF_COMPARE_NEQ
-             || (isInverted && pPredData->how == QOF_COMPARE_EQUAL))
-        sql <<  "~=";
-    else
-    {
-        PERR ("Unknown comparison type\n");
-        sql << "??";
-    }
+set_acct_bal_account_from_guid (gpointer pObject, gpointer pValue)
+{
+    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
+    const GncGUID* guid = (const GncGUID*)pValue;
+
+    g_return_if_fail (pObject != NULL);
+    g_return_if_fail (pValue != NULL);
+
+    bal->acct = xaccAccountLookup (guid, bal->sql_be->book());
 }
 
 static void
-convert_query_term_to_sql (const GncSqlBackend* sql_be, const gchar* fieldName,
-                           QofQueryTerm* pTerm, std::stringstream& sql)
+set_acct_bal_reconcile_state (gpointer pObject, gpointer pValue)
 {
-    QofQueryPredData* pPredData;
-    gboolean isInverted;
+    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
+    const gchar* s = (const gchar*)pValue;
 
-    g_return_if_fail (pTerm != NULL);
+    g_return_if_fail (pObject != NULL);
+    g_return_if_fail (pValue != NULL);
 
-    pPredData = qof_query_term_get_pred_data (pTerm);
-    isInverted = qof_query_term_is_inverted (pTerm);
+    bal->reconcile_state = s[0];
+}
 
-    if (g_strcmp0 (pPredData->type_name, QOF_TYPE_GUID) == 0)
-    {
-        query_guid_t guid_data = (query_guid_t)pPredData;
-        GList* guid_entry;
-        sql << "(" << fieldName;
+static void
+set_acct_bal_balance (gpointer pObject, gnc_numeric value)
+{
+    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
 
-        switch (guid_data->options)
-        {
-        case QOF_GUID_MATCH_ANY:
-            sql << (isInverted ? " NOT IN (" : " IN (");
-            break;
+    g_return_if_fail (pObject != NULL);
 
-        case QOF_GUID_MATCH_NONE:
-            sql << (isInverted ? " IN (" : " NOT IN (");
-            break;
+    bal->balance = value;
+}
 
-        default:
-            PERR ("Unexpected GncGUID match type: %d\n", guid_data->options);
-        }
+static const EntryVec acct_balances_col_table
+{
+    gnc_sql_make_table_entry<CT_GUID>("account_guid", 0, 0, nullptr,
+                                (QofSetterFunc)set_acct_bal_account_from_guid),
+    gnc_sql_make_table_entry<CT_STRING>("reconcile_state", 1, 0, nullptr,
+                                (QofSetterFunc)set_acct_bal_reconcile_state),
+    gnc_sql_make_table_entry<CT_NUMERIC>("quantity", 0, 0, nullptr,
+                                         (QofSetterFunc)set_acct_bal_balance),
+};
 
-        for (guid_entry = guid_data->guids; guid_entry != NULL;
-             guid_entry = guid_entry->next)
-        {
-            gchar guid_buf[GUID_ENCODING_LENGTH + 1];
+/* Add split to the balances of its account */
+static void
+add_split_to_balances (acct_balances_t& bal, char reconcile_state,
+                       gnc_numeric amount)
+{
+    bal.balance = gnc_numeric_add_fixed (bal.balance, amount);
+    if (reconcile_state != NREC)
+        bal.cleared_balance = gnc_numeric_add_fixed (bal.cleared_balance,
+                                                     amount);
+    if (reconcile_state == YREC || reconcile_state == FREC)
+        bal.reconciled_balance = gnc_numeric_add_fixed (bal.reconciled_balance,
+                                                        amount);
+}
 
-            if (guid_entry != guid_data->guids) sql << ",";
-            (void)guid_to_string_buff (static_cast<GncGUID*> (guid_entry->data),
-                                       guid_buf);
-            sql << guid_buf;
-        }
-        sql << "))";
+using AcctBalancesMap = std::unordered_map<Account*, acct_balances_t>;
 
-    }
-    else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_CHAR) == 0)
+/* The balances of the splits of transactions, by account */
+static AcctBalancesMap
+get_split_balances (const InstanceVec& transactions)
+{
+    AcctBalancesMap balances;
+    for (auto inst : transactions)
     {
-        query_char_t char_data = (query_char_t)pPredData;
-        int i;
-
-        if (isInverted) sql <<  "NOT(";
-        if (char_data->options == QOF_CHAR_MATCH_NONE) sql << "NOT ";
-        sql << "(";
-        for (i = 0; char_data->char_list[i] != '\0'; i++)
+        for (auto node = xaccTransGetSplitList (GNC_TRANSACTION (inst));
+             node != nullptr; node = node->next)
         {
-            if (i != 0) sql << " OR ";
-            sql << fieldName << " = '" << char_data->char_list[i] << "'";
+            auto split = GNC_SPLIT (node->data);
+            auto acc = xaccSplitGetAccount (split);
+            if (acc == nullptr)
+                continue;
+            auto it = balances.emplace (acc, acct_balances_t{acc,
+                        gnc_numeric_zero(), gnc_numeric_zero(),
+                        gnc_numeric_zero()}).first;
+            add_split_to_balances (it->second, xaccSplitGetReconcile (split),
+                                   xaccSplitGetAmount (split));
         }
-        sql << ") ";
-        if (isInverted) sql << ") ";
     }
-    else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_STRING) == 0)
+    return balances;
+}
+
+/**
+ * Sets the start balances of the accounts to the balances of the splits
+ * still in the database only: the balances of all of their splits in the
+ * database less those of the splits that were loaded.
+ *
+ * @param sql_be SQL backend
+ */
+void
+gnc_sql_transaction_set_start_balances (GncSqlBackend* sql_be)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    const std::string sakey(split_col_table[2]->name()); //account_guid
+    const std::string srkey(split_col_table[5]->name()); //reconcile_state
+    const std::string sqkey(split_col_table[8]->name()); //quantity
+    std::string sql("SELECT " + sakey + ", " + srkey + ", SUM(" + sqkey +
+                    "_num) AS " + sqkey + "_num, " + sqkey + "_denom FROM "
+                    SPLIT_TABLE " GROUP BY " + sakey + ", " + srkey + ", " +
+                    sqkey + "_denom");
+    auto stmt = sql_be->create_statement_from_sql (sql);
+    if (stmt == nullptr)
+        return;
+
+    AcctBalancesMap balances;
+    auto result = sql_be->execute_select_statement (stmt);
+    for (auto row : *result)
     {
-        query_string_t string_data = (query_string_t)pPredData;
-        sqlEscape* escape = sqlEscape_new ();
+        single_acct_balance_t bal{sql_be, nullptr, NREC, gnc_numeric_zero()};
+        gnc_sql_load_object (sql_be, row, nullptr, &bal,
+                             acct_balances_col_table);
+        if (bal.acct == nullptr)
+            continue;
+        auto it = balances.emplace (bal.acct, acct_balances_t{bal.acct,
+                    gnc_numeric_zero(), gnc_numeric_zero(),
+                    gnc_numeric_zero()}).first;
+        add_split_to_balances (it->second, bal.reconcile_state, bal.balance);
+    }
+    delete result;
 
-        if (isInverted ||  pPredData->how == QOF_COMPARE_NEQ)
-            sql << "NOT(";
-        sql << fieldName;
-        if (string_data->is_regex ||
-            string_data->options == QOF_STRING_MATCH_CASEINSENSITIVE)
+    for (auto& entry : balances)
+    {
+        auto acc = entry.first;
+        acct_balances_t loaded{acc, gnc_numeric_zero(), gnc_numeric_zero(),
+                               gnc_numeric_zero()};
+        for (auto node = xaccAccountGetSplitList (acc); node != nullptr;
+             node = node->next)
         {
-            PWARN ("String is_regex || option = QOF_STRING_MATCH_INSENSITIVE\n");
+            auto split = GNC_SPLIT (node->data);
+            add_split_to_balances (loaded, xaccSplitGetReconcile (split),
+                                   xaccSplitGetAmount (split));
         }
-//          sql << " ~" ;
-//      } else {
-        sql << " =";
-//      }
-//      if( string_data->options == QOF_STRING_MATCH_CASEINSENSITIVE ) {
-//          sql+= "*";
-//      }
-        sql << "'" << sqlEscapeString (escape, string_data->matchstring) << "'";
-        if (pPredData->how == QOF_COMPARE_NEQ) sql << ")";
-        if (isInverted) sql << ")";
-        sqlEscape_destroy (escape);
+        gnc_account_set_start_balance (acc,
+            gnc_numeric_sub_fixed (entry.second.balance, loaded.balance));
+        gnc_account_set_start_cleared_balance (acc,
+            gnc_numeric_sub_fixed (entry.second.cleared_balance,
+                                   loaded.cleared_balance));
+        gnc_account_set_start_reconciled_balance (acc,
+            gnc_numeric_sub_fixed (entry.second.reconciled_balance,
+                                   loaded.reconciled_balance));
+    }
+}
+
+/* Take the splits of the transactions just loaded out of the start balances
+ * of their accounts, which counted them while they were in the database
+ * only. */
+static void
+remove_from_start_balances (const InstanceVec& transactions)
+{
+    for (auto& entry : get_split_balances (transactions))
+    {
+        auto acc = entry.first;
+        gnc_numeric *start, *cleared, *reconciled;
+        g_object_get (acc, "start-balance", &start,
+                      "start-cleared-balance", &cleared,
+                      "start-reconciled-balance", &reconciled, nullptr);
+        gnc_account_set_start_balance (acc,
+            gnc_numeric_sub_fixed (*start, entry.second.balance));
+        gnc_account_set_start_cleared_balance (acc,
+            gnc_numeric_sub_fixed (*cleared, entry.second.cleared_balance));
+        gnc_account_set_start_reconciled_balance (acc,
+            gnc_numeric_sub_fixed (*reconciled,
+                                   entry.second.reconciled_balance));
+        g_boxed_free (GNC_TYPE_NUMERIC, start);
+        g_boxed_free (GNC_TYPE_NUMERIC, cleared);
+        g_boxed_free (GNC_TYPE_NUMERIC, reconciled);
+    }
+}
+
+/**
+ * Loads the transactions posted on or after since and before until with
+ * splits in accounts, or in any account if it's empty.
+ *
+ * @param sql_be SQL backend
+ * @param accounts Accounts
+ * @param since Earliest posted date
+ * @param until Posted date the transactions were loaded from already
+ */
+void
+gnc_sql_transaction_load_history (GncSqlBackend* sql_be,
+                                  const std::vector<Account*>& accounts,
+                                  time64 since, time64 until)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    const std::string tpkey(tx_col_table[0]->name());    //guid
+    const std::string pdkey(tx_col_table[3]->name());    //post_date
+    const std::string stkey(split_col_table[1]->name()); //tx_guid
+    const std::string sakey(split_col_table[2]->name()); //account_guid
 
+    std::string sql("(SELECT DISTINCT ");
+    if (accounts.empty())
+    {
+        sql += tpkey + " FROM " TRANSACTION_TABLE " WHERE ";
     }
     else
     {
-        sql << "(" << fieldName;
-        convert_query_comparison_to_sql (pPredData, isInverted, sql);
-
-        if (strcmp (pPredData->type_name, QOF_TYPE_NUMERIC) == 0)
+        sql += SPLIT_TABLE "." + stkey + " FROM " SPLIT_TABLE " INNER JOIN "
+            TRANSACTION_TABLE " ON " SPLIT_TABLE "." + stkey + " = "
+            TRANSACTION_TABLE "." + tpkey + " WHERE " SPLIT_TABLE "." + sakey +
+            " IN (";
+        for (auto acc : accounts)
         {
-            query_numeric_t pData = (query_numeric_t)pPredData;
-            sql << gnc_numeric_to_double (pData->amount);
+            if (acc != accounts.front())
+                sql += ",";
+            sql += "'" + gnc::GUID(*qof_instance_get_guid (acc)).to_string() +
+                "'";
         }
-        else if (g_strcmp0 (pPredData->type_name, QOF_TYPE_DATE) == 0)
-        {
-            query_date_t date_data = (query_date_t)pPredData;
+        sql += ") AND ";
+    }
+    sql += pdkey + " < " + time_literal (until);
+    if (since > MINTIME)
+        sql += " AND " + pdkey + " >= " + time_literal (since);
+    sql += ")";
 
-            GncDateTime time(date_data->date);
-            sql << time.format_iso8601();
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_INT32) == 0)
-        {
-            query_int32_t pData = (query_int32_t)pPredData;
-            sql << pData->val;
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_INT64) == 0)
-        {
-            query_int64_t pData = (query_int64_t)pPredData;
-            sql << pData->val;
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_DOUBLE) == 0)
-        {
-            query_double_t pData = (query_double_t)pPredData;
-            sql << pData->val;
-        }
-        else if (strcmp (pPredData->type_name, QOF_TYPE_BOOLEAN) == 0)
-        {
-            query_boolean_t pData = (query_boolean_t)pPredData;
-            sql << pData->val;
-        }
-        else
-        {
-            PERR ("Unknown query predicate type: %s\n", pPredData->type_name);
-        }
+    remove_from_start_balances (query_transactions (sql_be, sql));
+}
+
+/* ----------------------------------------------------------------- */
+/* Query compilation.  The transactions that a query may need and that the
+ * initial load left in the database are selected with an SQL translation
+ * of its terms.  Terms that can't be translated are left out and the others
+ * may be widened a little, so the SQL may select transactions the query
+ * turns down, but never misses one it wants: the query still checks every
+ * object in memory. */
+
+/* How far a QOF_DATE_MATCH_DAY comparison may move a time in rounding it,
+ * and the leeway given to amounts compared as floating point numbers. */
+#define DAY_MATCH_SLACK (2 * 24 * 60 * 60)
+#define AMOUNT_SLACK 0.001
+
+/* The column of a query parameter, or of its sub_param if that's set */
+typedef struct
+{
+    const char* param;
+    const char* sub_param;
+    const char* column;
+} query_param_column_t;
+
+static const query_param_column_t split_param_columns[]
+{
+    { QOF_PARAM_GUID, nullptr, SPLIT_TABLE ".guid" },
+    { SPLIT_ACCOUNT, QOF_PARAM_GUID, SPLIT_TABLE ".account_guid" },
+    { SPLIT_ACCOUNT_GUID, nullptr, SPLIT_TABLE ".account_guid" },
+    { SPLIT_LOT, QOF_PARAM_GUID, SPLIT_TABLE ".lot_guid" },
+    { SPLIT_MEMO, nullptr, SPLIT_TABLE ".memo" },
+    { SPLIT_ACTION, nullptr, SPLIT_TABLE ".action" },
+    { SPLIT_RECONCILE, nullptr, SPLIT_TABLE ".reconcile_state" },
+    { SPLIT_DATE_RECONCILED, nullptr, SPLIT_TABLE ".reconcile_date" },
+    { SPLIT_AMOUNT, nullptr, SPLIT_TABLE ".quantity" },
+    { SPLIT_VALUE, nullptr, SPLIT_TABLE ".value" },
+};
+
+static const query_param_column_t tx_param_columns[]
+{
+    { QOF_PARAM_GUID, nullptr, TRANSACTION_TABLE ".guid" },
+    { TRANS_NUM, nullptr, TRANSACTION_TABLE ".num" },
+    { TRANS_DATE_POSTED, nullptr, TRANSACTION_TABLE ".post_date" },
+    { TRANS_DATE_ENTERED, nullptr, TRANSACTION_TABLE ".enter_date" },
+    { TRANS_DESCRIPTION, nullptr, TRANSACTION_TABLE ".description" },
+};
 
-        sql << ")";
+template <std::size_t N> static const char*
+query_param_column (const query_param_column_t (&columns)[N],
+                    const QofQueryParamList* path)
+{
+    auto param = static_cast<const char*>(path->data);
+    auto sub_param = path->next ?
+        static_cast<const char*>(path->next->data) : nullptr;
+
+    for (auto& entry : columns)
+    {
+        if (g_strcmp0 (param, entry.param) != 0)
+            continue;
+        if (entry.sub_param == nullptr && sub_param == nullptr)
+            return entry.column;
+        if (entry.sub_param != nullptr && path->next->next == nullptr &&
+            g_strcmp0 (sub_param, entry.sub_param) == 0)
+            return entry.column;
     }
+    return nullptr;
 }
 
-typedef struct
+static std::string
+guid_list_literal (const GList* guids)
 {
-    GncSqlStatementPtr stmt;
-    gboolean has_been_run;
-} split_query_info_t;
+    std::string sql("(");
+    for (auto node = guids; node != nullptr; node = node->next)
+    {
+        if (node != guids)
+            sql += ",";
+        sql += "'" +
+            gnc::GUID(*static_cast<GncGUID*>(node->data)).to_string() + "'";
+    }
+    return sql + ")";
+}
 
-/* ----------------------------------------------------------------- */
-typedef struct
+static std::string
+guid_term_sql (const std::string& column, query_guid_t pdata)
 {
-    const GncSqlBackend* sql_be;
-    Account* acct;
-    char reconcile_state;
-    gnc_numeric balance;
-} single_acct_balance_t;
+    switch (pdata->options)
+    {
+    case QOF_GUID_MATCH_ANY:
+        if (pdata->guids == nullptr)
+            return "1=0";
+        return column + " IN " + guid_list_literal (pdata->guids);
+
+    case QOF_GUID_MATCH_NONE:
+        if (pdata->guids == nullptr)
+            return "";
+        return "(" + column + " IS NULL OR " + column + " NOT IN " +
+            guid_list_literal (pdata->guids) + ")";
+
+    default:
+        return "";
+    }
+}
 
-static void
-set_acct_bal_account_from_guid (gpointer pObject, gpointer pValue)
+/* A NULL time reads as 0 into the engine, so it matches if 0 does. */
+static std::string
+date_term_sql (const std::string& column, query_date_t pdata, bool& exact)
 {
-    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
-    const GncGUID* guid = (const GncGUID*)pValue;
+    time64 slack = 0;
+    if (pdata->options == QOF_DATE_MATCH_DAY)
+    {
+        slack = DAY_MATCH_SLACK;
+        exact = false;
+    }
+    if (pdata->date - slack < MINTIME || pdata->date + slack > MAXTIME)
+        return "";
+
+    auto before = time_literal (pdata->date + slack);
+    auto after = time_literal (pdata->date - slack);
+    std::string cond;
+    bool null_matches;
+    switch (pdata->pd.how)
+    {
+    case QOF_COMPARE_LT:
+        cond = column + " < " + before;
+        null_matches = 0 < pdata->date;
+        break;
+    case QOF_COMPARE_LTE:
+        cond = column + " <= " + before;
+        null_matches = 0 <= pdata->date;
+        break;
+    case QOF_COMPARE_GT:
+        cond = column + " > " + after;
+        null_matches = 0 > pdata->date;
+        break;
+    case QOF_COMPARE_GTE:
+        cond = column + " >= " + after;
+        null_matches = 0 >= pdata->date;
+        break;
+    case QOF_COMPARE_EQUAL:
+        cond = column + " BETWEEN " + after + " AND " + before;
+        null_matches = 0 == pdata->date;
+        break;
+    case QOF_COMPARE_NEQ:
+        if (slack)
+            return "";
+        cond = column + " <> " + before;
+        null_matches = 0 != pdata->date;
+        break;
+    default:
+        return "";
+    }
+    if (null_matches || slack)
+        return "(" + cond + " OR " + column + " IS NULL)";
+    return cond;
+}
 
-    g_return_if_fail (pObject != NULL);
-    g_return_if_fail (pValue != NULL);
+static std::string
+amount_literal (double amount)
+{
+    std::ostringstream literal;
+    literal.imbue (std::locale::classic());
+    literal.precision (17);
+    literal << amount;
+    return literal.str();
+}
 
-    bal->acct = xaccAccountLookup (guid, bal->sql_be->book());
+/* The query compares the absolute value of the column's amount, see
+ * numeric_match_predicate(). */
+static std::string
+numeric_term_sql (const std::string& column, query_numeric_t pdata)
+{
+    auto num = column + "_num";
+    auto value = "ABS(" + num + "*1.0/NULLIF(" + column + "_denom,0))";
+    auto amount = gnc_numeric_to_double (pdata->amount);
+    std::string cond;
+
+    if (pdata->options == QOF_NUMERIC_MATCH_DEBIT)
+        cond = num + " >= 0";
+    else if (pdata->options == QOF_NUMERIC_MATCH_CREDIT)
+        cond = num + " <= 0";
+
+    std::string compare;
+    switch (pdata->pd.how)
+    {
+    case QOF_COMPARE_LT:
+    case QOF_COMPARE_LTE:
+        compare = value + " <= " + amount_literal (amount + AMOUNT_SLACK);
+        break;
+    case QOF_COMPARE_GT:
+    case QOF_COMPARE_GTE:
+        compare = value + " >= " + amount_literal (amount - AMOUNT_SLACK);
+        break;
+    case QOF_COMPARE_EQUAL:
+        amount = fabs (amount);
+        compare = value + " BETWEEN " +
+            amount_literal (amount - AMOUNT_SLACK) + " AND " +
+            amount_literal (amount + AMOUNT_SLACK);
+        break;
+    default:
+        break;
+    }
+    if (cond.empty() || compare.empty())
+        return cond + compare;
+    return "(" + cond + " AND " + compare + ")";
 }
 
-static void
-set_acct_bal_reconcile_state (gpointer pObject, gpointer pValue)
+/* Only matches the database can do without regular expressions, and only
+ * caseless ones of ASCII text, which SQL's LOWER() surely folds like the
+ * engine does. */
+static std::string
+string_term_sql (const GncSqlBackend* sql_be, const std::string& column,
+                 query_string_t pdata)
 {
-    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
-    const gchar* s = (const gchar*)pValue;
+    auto how = pdata->pd.how;
+    if (pdata->is_regex || pdata->matchstring == nullptr ||
+        *pdata->matchstring == '\0' ||
+        (how != QOF_COMPARE_EQUAL && how != QOF_COMPARE_CONTAINS))
+        return "";
+
+    std::string pattern;
+    for (auto c = pdata->matchstring; *c != '\0'; ++c)
+    {
+        if (*c == '!' || *c == '%' || *c == '_')
+            pattern += '!';
+        pattern += *c;
+    }
+    if (how == QOF_COMPARE_CONTAINS)
+        pattern = "%" + pattern + "%";
 
-    g_return_if_fail (pObject != NULL);
-    g_return_if_fail (pValue != NULL);
+    if (pdata->options == QOF_STRING_MATCH_CASEINSENSITIVE)
+    {
+        if (!g_str_is_ascii (pdata->matchstring))
+            return "";
+        return "LOWER(" + column + ") LIKE LOWER(" +
+            sql_be->quote_string (pattern) + ") ESCAPE '!'";
+    }
+    /* LIKE ignores the case in some databases, which only selects more */
+    return column + " LIKE " + sql_be->quote_string (pattern) + " ESCAPE '!'";
+}
 
-    bal->reconcile_state = s[0];
+static std::string
+char_term_sql (const std::string& column, query_char_t pdata)
+{
+    std::string chars;
+    for (auto c = pdata->char_list; c != nullptr && *c != '\0'; ++c)
+    {
+        if (!g_ascii_isalpha (*c))
+            return "";
+        if (!chars.empty())
+            chars += ",";
+        chars += std::string("'") + *c + "'";
+    }
+    if (pdata->options == QOF_CHAR_MATCH_NONE)
+        return chars.empty() ? "" : column + " NOT IN (" + chars + ")";
+    return chars.empty() ? "1=0" : column + " IN (" + chars + ")";
 }
 
-static void
-set_acct_bal_balance (gpointer pObject, gnc_numeric value)
+/* The condition on column for a query term, or "" if there's none. exact is
+ * cleared if it may hold for more than the term does. */
+static std::string
+column_term_sql (const GncSqlBackend* sql_be, const std::string& column,
+                 QofQueryPredData* pd, bool& exact)
 {
-    single_acct_balance_t* bal = (single_acct_balance_t*)pObject;
+    std::string cond;
+    if (g_strcmp0 (pd->type_name, QOF_TYPE_GUID) == 0)
+        cond = guid_term_sql (column, (query_guid_t)pd);
+    else if (g_strcmp0 (pd->type_name, QOF_TYPE_DATE) == 0)
+        cond = date_term_sql (column, (query_date_t)pd, exact);
+    else if (g_strcmp0 (pd->type_name, QOF_TYPE_CHAR) == 0)
+        cond = char_term_sql (column, (query_char_t)pd);
+    else if (g_strcmp0 (pd->type_name, QOF_TYPE_NUMERIC) == 0)
+    {
+        cond = numeric_term_sql (column, (query_numeric_t)pd);
+        exact = false;
+    }
+    else if (g_strcmp0 (pd->type_name, QOF_TYPE_STRING) == 0)
+    {
+        cond = string_term_sql (sql_be, column, (query_string_t)pd);
+        exact = false;
+    }
+    if (cond.empty())
+        exact = false;
+    return cond;
+}
 
-    g_return_if_fail (pObject != NULL);
+static std::string
+tx_term_sql (const GncSqlBackend* sql_be, const QofQueryParamList* path,
+             QofQueryPredData* pd, bool& exact)
+{
+    auto column = query_param_column (tx_param_columns, path);
+    if (column != nullptr)
+        return column_term_sql (sql_be, column, pd, exact);
 
-    bal->balance = value;
+    /* The splits' accounts, as xaccQueryAddAccountGUIDMatch() asks for
+     * transactions with splits in all of a list of accounts */
+    const std::string tpkey(tx_col_table[0]->name());    //guid
+    const std::string stkey(split_col_table[1]->name()); //tx_guid
+    const std::string sakey(split_col_table[2]->name()); //account_guid
+    auto pdata = (query_guid_t)pd;
+    std::string cond;
+    if (g_strcmp0 (static_cast<const char*>(path->data), TRANS_SPLITLIST) == 0 &&
+        path->next != nullptr && path->next->next == nullptr &&
+        g_strcmp0 (static_cast<const char*>(path->next->data),
+                   SPLIT_ACCOUNT_GUID) == 0 &&
+        g_strcmp0 (pd->type_name, QOF_TYPE_GUID) == 0 &&
+        pdata->options == QOF_GUID_MATCH_ALL)
+    {
+        for (auto node = pdata->guids; node != nullptr; node = node->next)
+        {
+            if (!cond.empty())
+                cond += " AND ";
+            cond += TRANSACTION_TABLE "." + tpkey + " IN (SELECT " + stkey +
+                " FROM " SPLIT_TABLE " WHERE " + sakey + " = '" +
+                gnc::GUID(*static_cast<GncGUID*>(node->data)).to_string() +
+                "')";
+        }
+    }
+    if (cond.empty())
+        exact = false;
+    return cond;
 }
 
-static const EntryVec acct_balances_col_table
+static std::string
+split_term_sql (const GncSqlBackend* sql_be, const QofQueryParamList* path,
+                QofQueryPredData* pd, bool& exact)
 {
-    gnc_sql_make_table_entry<CT_GUID>("account_guid", 0, 0, nullptr,
-                                (QofSetterFunc)set_acct_bal_account_from_guid),
-    gnc_sql_make_table_entry<CT_STRING>("reconcile_state", 1, 0, nullptr,
-                                (QofSetterFunc)set_acct_bal_reconcile_state),
-    gnc_sql_make_table_entry<CT_NUMERIC>("quantity", 0, 0, nullptr,
-                                         (QofSetterFunc)set_acct_bal_balance),
-};
+    if (g_strcmp0 (static_cast<const char*>(path->data), SPLIT_TRANS) == 0 &&
+        path->next != nullptr)
+        return tx_term_sql (sql_be, path->next, pd, exact);
+
+    auto column = query_param_column (split_param_columns, path);
+    if (column != nullptr)
+        return column_term_sql (sql_be, column, pd, exact);
+    exact = false;
+    return "";
+}
+
+/* The date column a query sorts on first, or nullptr. Splits and
+ * transactions sort by their posted date by default. */
+static const char*
+sort_date_column (QofQuery* query, bool splits)
+{
+    QofQuerySort* primary;
+    qof_query_get_sorts (query, &primary, nullptr, nullptr);
+    auto path = qof_query_sort_get_param_path (primary);
+    if (path == nullptr)
+        return nullptr;
+
+    auto param = static_cast<const char*>(path->data);
+    if (g_strcmp0 (param, QUERY_DEFAULT_SORT) == 0)
+        return TRANSACTION_TABLE ".post_date";
+
+    const char* column;
+    if (splits && g_strcmp0 (param, SPLIT_TRANS) == 0)
+        column = path->next ?
+            query_param_column (tx_param_columns, path->next) : nullptr;
+    else if (splits)
+        column = query_param_column (split_param_columns, path);
+    else
+        column = query_param_column (tx_param_columns, path);
+    if (g_strcmp0 (column, TRANSACTION_TABLE ".post_date") == 0 ||
+        g_strcmp0 (column, TRANSACTION_TABLE ".enter_date") == 0 ||
+        g_strcmp0 (column, SPLIT_TABLE ".reconcile_date") == 0)
+        return column;
+    return nullptr;
+}
+
+/**
+ * Compiles a query for splits or transactions into the SQL selecting the
+ * transactions posted before until that it may need.
+ *
+ * @param sql_be SQL backend
+ * @param query Query
+ * @param until Posted date the transactions were loaded from already
+ * @return A selector of transaction GUIDs, or "" if the query may need all
+ * of the transactions
+ */
+std::string
+gnc_sql_transaction_query_selector (GncSqlBackend* sql_be, QofQuery* query,
+                                    time64 until)
+{
+    g_return_val_if_fail (sql_be != NULL, "");
+    g_return_val_if_fail (query != NULL, "");
+
+    auto search_for = qof_query_get_search_for (query);
+    bool splits = g_strcmp0 (search_for, GNC_ID_SPLIT) == 0;
+    if (!splits && g_strcmp0 (search_for, GNC_ID_TRANS) != 0)
+        return "";
+
+    const std::string tpkey(tx_col_table[0]->name());    //guid
+    const std::string stkey(split_col_table[1]->name()); //tx_guid
+    std::string from(TRANSACTION_TABLE);
+    if (splits)
+        from = SPLIT_TABLE " INNER JOIN " TRANSACTION_TABLE " ON "
+            SPLIT_TABLE "." + stkey + " = " TRANSACTION_TABLE "." + tpkey;
+
+    /* The query's terms are ORed lists of ANDed terms */
+    bool exact = true;
+    std::string where;
+    for (auto or_ptr = qof_query_get_terms (query); or_ptr != nullptr;
+         or_ptr = or_ptr->next)
+    {
+        std::string and_terms;
+        for (auto and_ptr = static_cast<GList*>(or_ptr->data);
+             and_ptr != nullptr; and_ptr = and_ptr->next)
+        {
+            auto term = static_cast<QofQueryTerm*>(and_ptr->data);
+            auto path = qof_query_term_get_param_path (term);
+            std::string cond;
+            if (path != nullptr && !qof_query_term_is_inverted (term))
+                cond = splits ?
+                    split_term_sql (sql_be, path,
+                                    qof_query_term_get_pred_data (term), exact) :
+                    tx_term_sql (sql_be, path,
+                                 qof_query_term_get_pred_data (term), exact);
+            else
+                exact = false;
+            if (cond.empty())
+                continue;
+            if (!and_terms.empty())
+                and_terms += " AND ";
+            and_terms += cond;
+        }
+        if (and_terms.empty())
+            return ""; // Anything may match.
+        where += (where.empty() ? "(" : " OR (") + and_terms + ")";
+    }
+
+    /* A query that keeps only its last results in date order needs nothing
+     * beyond the latest that the database has. Its terms must all be
+     * exact, or it could pick a date after that of a result the query
+     * keeps. */
+    auto max_results = qof_query_get_max_results (query);
+    auto date_column = sort_date_column (query, splits);
+    if (exact && max_results > 0 && date_column != nullptr)
+    {
+        QofQuerySort* primary;
+        qof_query_get_sorts (query, &primary, nullptr, nullptr);
+        auto increasing = qof_query_sort_get_increasing (primary);
+        std::string column(date_column);
+        std::string top("SELECT " + column + " AS top_date FROM " + from +
+                        " WHERE ");
+        if (!where.empty())
+            top += "(" + where + ") AND ";
+        top += column + " IS NOT NULL ORDER BY " + column +
+            (increasing ? " DESC" : " ASC") + " LIMIT " +
+            std::to_string (max_results);
+        auto cond = "(" + column + (increasing ? " >= (SELECT MIN" :
+                                    " <= (SELECT MAX") +
+            "(top_date) FROM (" + top + ") top_dates) OR " + column +
+            " IS NULL)";
+        where = where.empty() ? cond : "(" + where + ") AND " + cond;
+    }
+    if (where.empty())
+        return "";
+
+    std::string sql("(SELECT DISTINCT ");
+    sql += (splits ? SPLIT_TABLE "." + stkey : TRANSACTION_TABLE "." + tpkey) +
+        " FROM " + from + " WHERE (" + where + ")";
+    if (until > MINTIME)
+        sql += " AND " TRANSACTION_TABLE "." +
+            std::string(tx_col_table[3]->name()) + " < " + time_literal (until);
+    return sql + ")";
+}
+
+/**
+ * Loads the transactions that selector selects and takes their splits out
+ * of the start balances of their accounts.
+ *
+ * @param sql_be SQL backend
+ * @param selector Selector of transaction GUIDs, "(SELECT ...)"
+ */
+void
+gnc_sql_transaction_load_selected (GncSqlBackend* sql_be,
+                                   const std::string& selector)
+{
+    g_return_if_fail (sql_be != NULL);
+
+    remove_from_start_balances (query_transactions (sql_be, selector));
+}
 
 /* ----------------------------------------------------------------- */
 template<> void
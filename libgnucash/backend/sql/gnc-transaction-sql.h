@@ -35,6 +35,9 @@ extern "C"
 #include "qof.h"
 #include "Account.h"
 }
+#include <string>
+#include <vector>
+
 class GncSqlTransBackend : public GncSqlObjectBackend
 {
 public:
@@ -61,6 +64,49 @@ public:
  */
 void gnc_sql_transaction_load_tx_for_account (GncSqlBackend* sql_be,
                                               Account* account);
+/**
+ * Loads the transactions posted on or after since and before until with
+ * splits in accounts, or in any account if it's empty, and takes their splits
+ * out of the start balances of the accounts.
+ *
+ * @param sql_be SQL backend
+ * @param accounts Accounts
+ * @param since Earliest posted date
+ * @param until Posted date the transactions were loaded from already
+ */
+void gnc_sql_transaction_load_history (GncSqlBackend* sql_be,
+                                       const std::vector<Account*>& accounts,
+                                       time64 since, time64 until);
+/**
+ * Compiles a query for splits or transactions into the SQL selecting the
+ * transactions posted before until that it may need. Terms the database
+ * can't evaluate are left out, so it may select more.
+ *
+ * @param sql_be SQL backend
+ * @param query Query
+ * @param until Posted date the transactions were loaded from already
+ * @return A selector of transaction GUIDs, or "" if the query may need all
+ * of the transactions
+ */
+std::string gnc_sql_transaction_query_selector (GncSqlBackend* sql_be,
+                                                QofQuery* query, time64 until);
+/**
+ * Loads the transactions that selector selects and takes their splits out
+ * of the start balances of their accounts.
+ *
+ * @param sql_be SQL backend
+ * @param selector Selector of transaction GUIDs, as from
+ * gnc_sql_transaction_query_selector()
+ */
+void gnc_sql_transaction_load_selected (GncSqlBackend* sql_be,
+                                        const std::string& selector);
+/**
+ * Sets the start balances of the accounts to the balances of their splits
+ * that weren't loaded.
+ *
+ * @param sql_be SQL backend
+ */
+void gnc_sql_transaction_set_start_balances (GncSqlBackend* sql_be);
 typedef struct
 {
     Account* acct;
@@ -37,6 +37,11 @@ extern "C"
 #include "sixtp-dom-generators.h"
 #include "io-gncxml-gen.h"
 #include "io-gncxml-v2.h"
+#include "gnc-xml-stream.hpp"
+#include "gnc-xml-writer.hpp"
+
+#include <string>
+#include <vector>
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = GNC_MOD_IO;
@@ -78,7 +83,8 @@ static QofLogModule log_module = GNC_MOD_IO;
 /****************************************************************************/
 /* <price>
 
-  restores a price.  Does so via a walk of the XML tree in memory.
+  restores a price.  Does so straight from the SAX events, the way
+  price_parse_xml_sub_node() would from the price's DOM tree.
   Returns a GNCPrice * in result.
 
   Right now, a price is legitimate even if all of it's fields are not
@@ -86,59 +92,181 @@ static QofLogModule log_module = GNC_MOD_IO;
 
 */
 
-static gboolean
-price_parse_xml_sub_node (GNCPrice* p, xmlNodePtr sub_node, QofBook* book)
-{
-    if (!p || !sub_node) return FALSE;
+enum class PriceField { id, commodity, currency, time, source, type, value };
 
-    gnc_price_begin_edit (p);
-    if (g_strcmp0 ("price:id", (char*)sub_node->name) == 0)
-    {
-        GncGUID* c = dom_tree_to_guid (sub_node);
-        if (!c) return FALSE;
-        gnc_price_set_guid (p, c);
-        g_free (c);
-    }
-    else if (g_strcmp0 ("price:commodity", (char*)sub_node->name) == 0)
+static const struct
+{
+    const char* tag;
+    GncFieldType type;
+} price_fields[] =
+{
+    { "price:id", GncFieldType::guid },
+    { "price:commodity", GncFieldType::commodity },
+    { "price:currency", GncFieldType::commodity },
+    { "price:time", GncFieldType::time },
+    { "price:source", GncFieldType::text },
+    { "price:type", GncFieldType::text },
+    { "price:value", GncFieldType::numeric },
+};
+
+class GncPriceStream : public SixtpStream
+{
+public:
+    GncPriceStream () : m_field_stream{m_texts} {}
+
+    void start_element (const gchar* tag, const gchar** attrs) override;
+    void characters (const gchar* text, int len) override;
+    void end_element (const gchar* tag) override;
+
+    /* The price, or NULL if it can't be loaded. */
+    GNCPrice* make_price (QofBook* book, GncCommodityRefCache& commodities);
+
+private:
+    std::string m_texts;
+    GncFieldStream m_field_stream;
+    std::vector<GncStreamField> m_fields;
+    int m_depth = 0;
+    int m_ignored = 0;          // the depth of the element being ignored
+    bool m_empty = true;        // no content at all, i.e. <price/>
+    bool m_ok = true;
+};
+
+void
+GncPriceStream::start_element (const gchar* tag, const gchar** attrs)
+{
+    ++m_depth;
+    m_empty = false;
+    if (m_ignored)
+        return;
+    if (m_field_stream.active ())
     {
-        gnc_commodity* c = dom_tree_to_commodity_ref (sub_node, book);
-        if (!c) return FALSE;
-        gnc_price_set_commodity (p, c);
+        m_field_stream.start_element (tag, attrs);
+        return;
     }
-    else if (g_strcmp0 ("price:currency", (char*)sub_node->name) == 0)
+
+    for (std::size_t i = 0; i < G_N_ELEMENTS (price_fields); ++i)
     {
-        gnc_commodity* c = dom_tree_to_commodity_ref (sub_node, book);
-        if (!c) return FALSE;
-        gnc_price_set_currency (p, c);
+        if (strcmp (price_fields[i].tag, tag) == 0)
+        {
+            m_fields.push_back (GncStreamField{static_cast<int> (i),
+                                               price_fields[i].type, true, 0, 0,
+                                               nullptr, gnc_numeric_zero (), 0,
+                                               {}});
+            m_field_stream.start (m_fields.back (), attrs);
+            return;
+        }
     }
-    else if (g_strcmp0 ("price:time", (char*)sub_node->name) == 0)
+    /* price_parse_xml_sub_node() ignores the elements it doesn't know. */
+    m_ignored = m_depth;
+}
+
+void
+GncPriceStream::characters (const gchar* text, int len)
+{
+    m_empty = false;
+    if (!m_ignored && m_field_stream.active ())
+        m_field_stream.characters (text, len);
+}
+
+void
+GncPriceStream::end_element (const gchar* tag)
+{
+    if (m_ignored)
     {
-        time64 time = dom_tree_to_time64 (sub_node);
-        if (!dom_tree_valid_time64 (time, sub_node->name)) time = 0;
-        gnc_price_set_time64 (p, time);
+        if (m_depth == m_ignored)
+            m_ignored = 0;
     }
-    else if (g_strcmp0 ("price:source", (char*)sub_node->name) == 0)
+    else if (m_field_stream.active ())
     {
-        char* text = dom_tree_to_text (sub_node);
-        if (!text) return FALSE;
-        gnc_price_set_source_string (p, text);
-        g_free (text);
+        m_field_stream.end_element (tag);
+        if (!m_field_stream.active () && !m_field_stream.ok ())
+        {
+            m_ok = false;
+            m_field_stream.reset_ok ();
+        }
     }
-    else if (g_strcmp0 ("price:type", (char*)sub_node->name) == 0)
+    --m_depth;
+}
+
+GNCPrice*
+GncPriceStream::make_price (QofBook* book, GncCommodityRefCache& commodities)
+{
+    if (m_empty || !m_ok)
+        return NULL;
+
+    GNCPrice* p = gnc_price_create (book);
+    if (!p)
+        return NULL;
+
+    gboolean ok = TRUE;
+    gnc_price_begin_edit (p);
+    for (auto& field : m_fields)
     {
-        char* text = dom_tree_to_text (sub_node);
-        if (!text) return FALSE;
-        gnc_price_set_typestr (p, text);
-        g_free (text);
+        field.convert (m_texts);
+        auto text = field.text == std::string::npos ? NULL : &m_texts[field.text];
+        gnc_commodity* c = NULL;
+
+        switch (static_cast<PriceField> (field.handler))
+        {
+        case PriceField::id:
+            ok = field.valid;
+            if (ok)
+                gnc_price_set_guid (p, &field.guid);
+            break;
+        case PriceField::commodity:
+        case PriceField::currency:
+            if (field.valid)
+                c = commodities.lookup (text, field.text2 == std::string::npos ?
+                                        NULL : &m_texts[field.text2], book);
+            ok = c != NULL;
+            if (!ok)
+                break;
+            if (static_cast<PriceField> (field.handler) == PriceField::commodity)
+                gnc_price_set_commodity (p, c);
+            else
+                gnc_price_set_currency (p, c);
+            break;
+        case PriceField::time:
+        {
+            time64 time = field.time;
+            if (!dom_tree_valid_time64 (time, BAD_CAST price_fields[field.handler].tag))
+                time = 0;
+            gnc_price_set_time64 (p, time);
+            break;
+        }
+        case PriceField::source:
+            gnc_price_set_source_string (p, text);
+            break;
+        case PriceField::type:
+            gnc_price_set_typestr (p, text);
+            break;
+        case PriceField::value:
+            gnc_price_set_value (p, field.num);
+            break;
+        }
+        if (!ok)
+            break;
     }
-    else if (g_strcmp0 ("price:value", (char*)sub_node->name) == 0)
+    gnc_price_commit_edit (p);
+
+    if (!ok)
     {
-        gnc_numeric* value = dom_tree_to_gnc_numeric (sub_node);
-        if (!value) return FALSE;
-        gnc_price_set_value (p, *value);
-        g_free (value);
+        gnc_price_unref (p);
+        return NULL;
     }
-    gnc_price_commit_edit (p);
+    return p;
+}
+
+static gboolean
+price_parse_xml_start_handler (GSList* sibling_data,
+                               gpointer parent_data,
+                               gpointer global_data,
+                               gpointer* data_for_children,
+                               gpointer* result,
+                               const gchar* tag,
+                               gchar** attrs)
+{
+    *data_for_children = new GncPriceStream;
     return TRUE;
 }
 
@@ -151,77 +279,30 @@ price_parse_xml_end_handler (gpointer data_for_children,
                              gpointer* result,
                              const gchar* tag)
 {
-    gboolean ok = TRUE;
-    xmlNodePtr price_xml = (xmlNodePtr) data_for_children;
-    xmlNodePtr child;
-    GNCPrice* p = NULL;
+    auto stream = static_cast<GncPriceStream*> (data_for_children);
+    auto commodities = static_cast<GncCommodityRefCache*> (parent_data);
     gxpf_data* gdata = static_cast<decltype (gdata)> (global_data);
     QofBook* book = static_cast<decltype (book)> (gdata->bookdata);
 
-    /* we haven't been handed the *top* level node yet... */
-    if (parent_data) return TRUE;
-
     *result = NULL;
 
-    if (!price_xml) return FALSE;
-    if (price_xml->next)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
-    if (price_xml->prev)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
-    if (!price_xml->xmlChildrenNode)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
-
-    p = gnc_price_create (book);
-    if (!p)
-    {
-        ok = FALSE;
-        goto cleanup_and_exit;
-    }
+    g_return_val_if_fail (stream && commodities, FALSE);
 
-    for (child = price_xml->xmlChildrenNode; child; child = child->next)
-    {
-        switch (child->type)
-        {
-        case XML_COMMENT_NODE:
-        case XML_TEXT_NODE:
-            break;
-        case XML_ELEMENT_NODE:
-            if (!price_parse_xml_sub_node (p, child, book))
-            {
-                ok = FALSE;
-                goto cleanup_and_exit;
-            }
-            break;
-        default:
-            PERR ("Unknown node type (%d) while parsing gnc-price xml.", child->type);
-            child = NULL;
-            ok = FALSE;
-            goto cleanup_and_exit;
-            break;
-        }
-    }
+    *result = stream->make_price (book, *commodities);
+    delete stream;
+    return *result != NULL;
+}
 
-cleanup_and_exit:
-    if (ok)
-    {
-        *result = p;
-    }
-    else
-    {
-        *result = NULL;
-        gnc_price_unref (p);
-    }
-    xmlFreeNode (price_xml);
-    return ok;
+static void
+price_parse_xml_fail_handler (gpointer data_for_children,
+                              GSList* data_from_children,
+                              GSList* sibling_data,
+                              gpointer parent_data,
+                              gpointer global_data,
+                              gpointer* result,
+                              const gchar* tag)
+{
+    delete static_cast<GncPriceStream*> (data_for_children);
 }
 
 static void
@@ -233,9 +314,19 @@ cleanup_gnc_price (sixtp_child_result* result)
 static sixtp*
 gnc_price_parser_new (void)
 {
-    return sixtp_dom_parser_new (price_parse_xml_end_handler,
-                                 cleanup_gnc_price,
-                                 cleanup_gnc_price);
+    sixtp* parser = sixtp_set_any (sixtp_new (), FALSE,
+                                   SIXTP_START_HANDLER_ID,
+                                   price_parse_xml_start_handler,
+                                   SIXTP_END_HANDLER_ID,
+                                   price_parse_xml_end_handler,
+                                   SIXTP_FAIL_HANDLER_ID,
+                                   price_parse_xml_fail_handler,
+                                   SIXTP_RESULT_FAIL_ID, cleanup_gnc_price,
+                                   SIXTP_CLEANUP_RESULT_ID, cleanup_gnc_price,
+                                   SIXTP_NO_MORE_HANDLERS);
+    if (parser)
+        sixtp_set_stream (parser, TRUE);
+    return parser;
 }
 
 
@@ -249,7 +340,10 @@ gnc_price_parser_new (void)
 
    result: GNCPriceDB*
 
-   start: create new GNCPriceDB*, and leave in *data_for_children.
+   start: create new GNCPriceDB*, and leave in *result.  Leave a
+     GncCommodityRefCache for the prices in *data_for_children.
+   end: destroy the GncCommodityRefCache.
+   fail: destroy the GncCommodityRefCache.
    cleanup-result: destroy GNCPriceDB*
    result-fail: destroy GNCPriceDB*
 
@@ -270,6 +364,7 @@ pricedb_start_handler (GSList* sibling_data,
     g_return_val_if_fail (db, FALSE);
     gnc_pricedb_set_bulk_update (db, TRUE);
     *result = db;
+    *data_for_children = new GncCommodityRefCache;
     return (TRUE);
 }
 
@@ -332,6 +427,8 @@ pricedb_v2_end_handler (
     GNCPriceDB* db = static_cast<decltype (db)> (*result);
     gxpf_data* gdata = (gxpf_data*)global_data;
 
+    delete static_cast<GncCommodityRefCache*> (data_for_children);
+
     if (parent_data)
     {
         return TRUE;
@@ -350,6 +447,18 @@ pricedb_v2_end_handler (
     return TRUE;
 }
 
+static void
+pricedb_fail_handler (gpointer data_for_children,
+                      GSList* data_from_children,
+                      GSList* sibling_data,
+                      gpointer parent_data,
+                      gpointer global_data,
+                      gpointer* result,
+                      const gchar* tag)
+{
+    delete static_cast<GncCommodityRefCache*> (data_for_children);
+}
+
 static sixtp*
 gnc_pricedb_parser_new (void)
 {
@@ -362,6 +471,7 @@ gnc_pricedb_parser_new (void)
                        SIXTP_AFTER_CHILD_HANDLER_ID, pricedb_after_child_handler,
                        SIXTP_CHARACTERS_HANDLER_ID,
                        allow_and_ignore_only_whitespace,
+                       SIXTP_FAIL_HANDLER_ID, pricedb_fail_handler,
                        SIXTP_RESULT_FAIL_ID, pricedb_cleanup_result_handler,
                        SIXTP_CLEANUP_RESULT_ID, pricedb_cleanup_result_handler,
                        SIXTP_NO_MORE_HANDLERS);
@@ -513,3 +623,72 @@ gnc_pricedb_dom_tree_create (GNCPriceDB* db)
 {
     return gnc_pricedb_to_dom_tree (BAD_CAST "gnc:pricedb", db);
 }
+
+/* gnc_price_to_dom_tree() fails on these, and with it the whole database. */
+static gboolean
+price_is_writable (GNCPrice* p, gpointer data)
+{
+    if (!p)
+        return TRUE;
+
+    auto commodity = gnc_price_get_commodity (p);
+    auto currency = gnc_price_get_currency (p);
+    return commodity && currency
+           && gnc_commodity_get_namespace (commodity)
+           && gnc_commodity_get_mnemonic (commodity)
+           && gnc_commodity_get_namespace (currency)
+           && gnc_commodity_get_mnemonic (currency)
+           && gnc_price_get_time64 (p) != INT64_MAX;
+}
+
+struct price_write_data
+{
+    GncXmlWriter* writer;
+    sixtp_gdv2* gd;
+};
+
+static gboolean
+price_xml_write (GNCPrice* p, gpointer data)
+{
+    auto pdata = static_cast<price_write_data*> (data);
+    auto writer = pdata->writer;
+
+    if (!p)
+        return TRUE;
+
+    writer->start_element ("price");
+    writer->add_guid ("price:id", gnc_price_get_guid (p));
+    writer->add_commodity_ref ("price:commodity", gnc_price_get_commodity (p));
+    writer->add_commodity_ref ("price:currency", gnc_price_get_currency (p));
+    writer->add_time64 ("price:time", gnc_price_get_time64 (p));
+
+    auto source = gnc_price_get_source_string (p);
+    if (source && *source)
+        writer->add_text ("price:source", source);
+
+    auto type = gnc_price_get_typestr (p);
+    if (type && *type)
+        writer->add_text ("price:type", type);
+
+    writer->add_numeric ("price:value", gnc_price_get_value (p));
+    writer->end_element ();
+
+    pdata->gd->counter.prices_loaded += 1;
+    sixtp_run_callback (pdata->gd, "prices");
+    return writer->ok ();
+}
+
+void
+gnc_pricedb_xml_write (GncXmlWriter& writer, GNCPriceDB* db, sixtp_gdv2* gd)
+{
+    price_write_data pdata {&writer, gd};
+
+    if (gnc_pricedb_get_num_prices (db) == 0
+        || !gnc_pricedb_foreach_price (db, price_is_writable, NULL, TRUE))
+        return;
+
+    writer.start_element ("gnc:pricedb");
+    writer.add_attribute ("version", "1");
+    gnc_pricedb_foreach_price (db, price_xml_write, &pdata, TRUE);
+    writer.end_element ();
+}
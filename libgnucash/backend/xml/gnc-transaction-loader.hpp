@@ -0,0 +1,94 @@
+/********************************************************************\
+ * gnc-transaction-loader.hpp -- Pipelined loading of transactions  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @file gnc-transaction-loader.hpp
+ *
+ * GncTransactionLoader takes the transactions of a book being loaded, as
+ * GncTransactionStream reduced them to their fields' texts, off the SAX
+ * parser and converts them on a pool of worker threads. The workers only do
+ * the part that doesn't touch the engine: they turn the texts into GUIDs,
+ * numbers and times. The engine isn't thread safe, so creating the
+ * transactions and their splits from those values, looking up their
+ * accounts, lots and commodities and handing them to the book is left to the
+ * main thread, which does so in document order.
+ *
+ * Objects parsed later may refer to the transactions, so the loader must be
+ * flushed before the parser moves on to anything other than a transaction.
+ */
+
+#ifndef GNC_TRANSACTION_LOADER_HPP
+#define GNC_TRANSACTION_LOADER_HPP
+
+extern "C"
+{
+#include <glib.h>
+#include "qof.h"
+}
+
+#include "gnc-xml-helper.h"
+#include "io-gncxml-gen.h"
+#include "gnc-xml-stream.hpp"
+
+#include <deque>
+#include <vector>
+
+struct GncTransactionJob;
+
+class GncTransactionLoader
+{
+public:
+    /** cb is called with parsedata and each loaded transaction, like the
+     *  callback passed to gnc_xml_parse_fd(). */
+    GncTransactionLoader (QofBook* book, gxpf_callback cb, gpointer parsedata);
+    /** Waits for the workers; transactions not applied yet are dropped. */
+    ~GncTransactionLoader ();
+    GncTransactionLoader (const GncTransactionLoader&) = delete;
+    GncTransactionLoader& operator= (const GncTransactionLoader&) = delete;
+
+    /** A job to parse a transaction into, from the ones already applied if
+     *  possible. It belongs to the caller until it's pushed. */
+    GncTransactionJob* new_job ();
+    /** Queue job for conversion. The loader takes ownership of it. Some of
+     *  the transactions queued earlier may get loaded. */
+    void push (GncTransactionJob* job);
+    /** Load all queued transactions.
+     *  @return FALSE if any of them failed to load since the last flush. */
+    gboolean flush ();
+
+private:
+    static void convert (gpointer job, gpointer loader);
+    void apply_jobs (std::size_t min_count);
+    void apply_job (GncTransactionJob* job);
+
+    QofBook* m_book;
+    gxpf_callback m_cb;
+    gpointer m_parsedata;
+    GThreadPool* m_pool = nullptr;
+    GMutex m_mutex;
+    GCond m_cond;
+    std::deque<GncTransactionJob*> m_jobs;
+    std::vector<GncTransactionJob*> m_free_jobs;
+    GncCommodityRefCache m_commodities;
+    std::size_t m_max_pending;
+    gboolean m_ok = TRUE;
+};
+
+#endif /* GNC_TRANSACTION_LOADER_HPP */
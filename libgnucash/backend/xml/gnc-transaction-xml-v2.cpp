@@ -47,6 +47,12 @@ extern "C"
 #include "io-gncxml-gen.h"
 
 #include "sixtp-dom-parsers.h"
+#include "gnc-transaction-loader.hpp"
+#include "gnc-xml-stream.hpp"
+#include "gnc-xml-writer.hpp"
+
+#include <string>
+#include <vector>
 
 const gchar* transaction_version_string = "2.0.0";
 
@@ -192,6 +198,75 @@ gnc_transaction_dom_tree_create (Transaction* trn)
     return ret;
 }
 
+/* The streaming counterparts of split_to_dom_tree() and
+ * gnc_transaction_dom_tree_create(); they must write the same. */
+static void
+split_xml_write (GncXmlWriter& writer, const gchar* tag, Split* spl)
+{
+    writer.start_element (tag);
+
+    writer.add_guid ("split:id", xaccSplitGetGUID (spl));
+
+    auto memo = xaccSplitGetMemo (spl);
+    if (memo && *memo)
+        writer.add_text ("split:memo", memo);
+
+    auto action = xaccSplitGetAction (spl);
+    if (action && *action)
+        writer.add_text ("split:action", action);
+
+    char tmp[2] = { xaccSplitGetReconcile (spl), '\0' };
+    writer.add_text ("split:reconciled-state", tmp);
+
+    auto reconciled = xaccSplitGetDateReconciled (spl);
+    if (reconciled)
+        writer.add_time64 ("split:reconcile-date", reconciled);
+
+    writer.add_numeric ("split:value", xaccSplitGetValue (spl));
+    writer.add_numeric ("split:quantity", xaccSplitGetAmount (spl));
+
+    writer.add_guid ("split:account",
+                     xaccAccountGetGUID (xaccSplitGetAccount (spl)));
+
+    GNCLot* lot = xaccSplitGetLot (spl);
+    if (lot)
+        writer.add_guid ("split:lot", gnc_lot_get_guid (lot));
+
+    writer.add_slots ("split:slots", QOF_INSTANCE (spl));
+
+    writer.end_element ();
+}
+
+void
+gnc_transaction_xml_write (GncXmlWriter& writer, Transaction* trn)
+{
+    writer.start_element ("gnc:transaction");
+    writer.add_attribute ("version", transaction_version_string);
+
+    writer.add_guid ("trn:id", xaccTransGetGUID (trn));
+    writer.add_commodity_ref ("trn:currency", xaccTransGetCurrency (trn));
+
+    auto num = xaccTransGetNum (trn);
+    if (num && *num)
+        writer.add_text ("trn:num", num);
+
+    writer.add_time64 ("trn:date-posted", xaccTransRetDatePosted (trn));
+    writer.add_time64 ("trn:date-entered", xaccTransRetDateEntered (trn));
+
+    auto description = xaccTransGetDescription (trn);
+    if (description)
+        writer.add_text ("trn:description", description);
+
+    writer.add_slots ("trn:slots", QOF_INSTANCE (trn));
+
+    writer.start_element ("trn:splits");
+    for (auto n = xaccTransGetSplitList (trn); n; n = n->next)
+        split_xml_write (writer, "trn:split", static_cast<Split*> (n->data));
+    writer.end_element ();
+
+    writer.end_element ();
+}
+
 /***********************************************************************/
 
 struct split_pdata
@@ -295,26 +370,45 @@ spl_quantity_handler (xmlNodePtr node, gpointer data)
 
 gboolean gnc_transaction_xml_v2_testing = FALSE;
 
-static gboolean
-spl_account_handler (xmlNodePtr node, gpointer data)
+static void
+split_set_account (Split* split, const GncGUID* id, QofBook* book)
 {
-    struct split_pdata* pdata = static_cast<decltype (pdata)> (data);
-    GncGUID* id = dom_tree_to_guid (node);
-    Account* account;
-
-    g_return_val_if_fail (id, FALSE);
-
-    account = xaccAccountLookup (id, pdata->book);
+    Account* account = xaccAccountLookup (id, book);
     if (!account && gnc_transaction_xml_v2_testing &&
         !guid_equal (id, guid_null ()))
     {
-        account = xaccMallocAccount (pdata->book);
+        account = xaccMallocAccount (book);
         xaccAccountSetGUID (account, id);
         xaccAccountSetCommoditySCU (account,
-                                    xaccSplitGetAmount (pdata->split).denom);
+                                    xaccSplitGetAmount (split).denom);
+    }
+
+    xaccAccountInsertSplit (account, split);
+}
+
+static void
+split_set_lot (Split* split, const GncGUID* id, QofBook* book)
+{
+    GNCLot* lot = gnc_lot_lookup (id, book);
+    if (!lot && gnc_transaction_xml_v2_testing &&
+        !guid_equal (id, guid_null ()))
+    {
+        lot = gnc_lot_new (book);
+        gnc_lot_set_guid (lot, *id);
     }
 
-    xaccAccountInsertSplit (account, pdata->split);
+    gnc_lot_add_split (lot, split);
+}
+
+static gboolean
+spl_account_handler (xmlNodePtr node, gpointer data)
+{
+    struct split_pdata* pdata = static_cast<decltype (pdata)> (data);
+    GncGUID* id = dom_tree_to_guid (node);
+
+    g_return_val_if_fail (id, FALSE);
+
+    split_set_account (pdata->split, id, pdata->book);
 
     g_free (id);
 
@@ -326,19 +420,10 @@ spl_lot_handler (xmlNodePtr node, gpointer data)
 {
     struct split_pdata* pdata = static_cast<decltype (pdata)> (data);
     GncGUID* id = dom_tree_to_guid (node);
-    GNCLot* lot;
 
     g_return_val_if_fail (id, FALSE);
 
-    lot = gnc_lot_lookup (id, pdata->book);
-    if (!lot && gnc_transaction_xml_v2_testing &&
-        !guid_equal (id, guid_null ()))
-    {
-        lot = gnc_lot_new (pdata->book);
-        gnc_lot_set_guid (lot, *id);
-    }
-
-    gnc_lot_add_split (lot, pdata->split);
+    split_set_lot (pdata->split, id, pdata->book);
 
     g_free (id);
 
@@ -646,3 +731,634 @@ gnc_transaction_sixtp_parser_create (void)
 {
     return sixtp_dom_parser_new (gnc_transaction_end_handler, NULL, NULL);
 }
+
+/***********************************************************************/
+/* Streamed and pipelined loading, see gnc-transaction-loader.hpp. The
+ * GncTransactionStream reduces each element the handlers above would get to
+ * a GncStreamField, the workers convert their text and apply_split() and
+ * apply_transaction() then hand them to the engine the same way the handlers
+ * do. */
+
+/* In the order of spl_dom_handlers and trn_dom_handlers. */
+enum class SplField { id, memo, action, reconciled_state, reconcile_date,
+                      value, quantity, account, lot, slots };
+enum class TrnField { id, currency, num, date_posted, date_entered,
+                      description, slots, splits };
+
+static const GncFieldType spl_field_types[] =
+{
+    GncFieldType::guid, GncFieldType::text, GncFieldType::text,
+    GncFieldType::text, GncFieldType::time, GncFieldType::numeric,
+    GncFieldType::numeric, GncFieldType::guid, GncFieldType::guid,
+    GncFieldType::slots,
+};
+
+/* trn:splits isn't a field, GncTransactionStream parses it itself. */
+static const GncFieldType trn_field_types[] =
+{
+    GncFieldType::guid, GncFieldType::commodity, GncFieldType::text,
+    GncFieldType::time, GncFieldType::time, GncFieldType::text,
+    GncFieldType::slots,
+};
+
+using StreamFields = std::vector<GncStreamField>;
+
+struct GncTransactionJob
+{
+    std::string tag;
+    bool done;                  // protected by the loader's mutex
+    bool ok;                    // false if the transaction can't be loaded
+    std::string texts;          // the fields' texts, NUL terminated
+    StreamFields fields;
+    StreamFields split_fields;
+    std::vector<std::size_t> splits; // where each split's fields start
+
+    ~GncTransactionJob () { clear (); }
+    /* Make the job ready for the next transaction, keeping the memory. */
+    void clear ()
+    {
+        for (auto fields_ptr : {&fields, &split_fields})
+            for (auto& field : *fields_ptr)
+                delete field.frame;
+        texts.clear ();
+        fields.clear ();
+        split_fields.clear ();
+        splits.clear ();
+        done = ok = false;
+    }
+};
+
+static int
+find_handler (const struct dom_tree_handler* handlers, const gchar* tag)
+{
+    for (int i = 0; handlers[i].tag; ++i)
+        if (strcmp (handlers[i].tag, tag) == 0)
+            return i;
+    return -1;
+}
+
+static bool
+all_required_seen (const struct dom_tree_handler* handlers, guint seen)
+{
+    bool ok = true;
+    for (int i = 0; handlers[i].tag; ++i)
+    {
+        if (handlers[i].required && !(seen & (1u << i)))
+        {
+            PERR ("Not defined and it should be: %s", handlers[i].tag);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/* Parses the descendants of a <gnc:transaction> into a GncTransactionJob,
+ * checking them the way dom_tree_generic_parse() and trn_splits_handler()
+ * would: unknown elements or missing required ones make the transaction
+ * fail, and a split failing that way ends its transaction's splits. */
+class GncTransactionStream : public SixtpStream
+{
+public:
+    explicit GncTransactionStream (GncTransactionJob* job) :
+        m_job{job}, m_fields{job->texts}
+    {
+        m_job->ok = true;
+    }
+    ~GncTransactionStream () { delete m_job; }
+
+    void start_element (const gchar* tag, const gchar** attrs) override;
+    void characters (const gchar* text, int len) override;
+    void end_element (const gchar* tag) override;
+
+    /* The job, which then belongs to the caller. */
+    GncTransactionJob* finish ();
+
+private:
+    void start_field (StreamFields& fields, int handler, GncFieldType type,
+                      const gchar** attrs);
+    void field_done ();
+    void start_transaction_child (const gchar* tag, const gchar** attrs);
+    void start_split_child (const gchar* tag, const gchar** attrs);
+    void end_split ();
+
+    GncTransactionJob* m_job;
+    GncFieldStream m_fields;
+    int m_depth = 0;            // of the current element below the transaction
+    int m_ignored = 0;          // the depth of the element being ignored
+    guint m_seen = 0;           // the transaction's fields, by handler
+    guint m_split_seen = 0;
+    bool m_in_split = false;
+    bool m_split_ok = true;
+    bool m_splits_done = false;
+};
+
+void
+GncTransactionStream::start_field (StreamFields& fields, int handler,
+                                   GncFieldType type, const gchar** attrs)
+{
+    fields.push_back (GncStreamField{handler, type, true, 0, 0, nullptr,
+                                     gnc_numeric_zero (), 0, {}});
+    m_fields.start (fields.back (), attrs);
+}
+
+void
+GncTransactionStream::field_done ()
+{
+    if (m_fields.ok ())
+        return;
+    PERR ("unexpected element in the text of a transaction field");
+    if (m_in_split)
+        m_split_ok = false;
+    else
+        m_job->ok = false;
+    m_fields.reset_ok ();
+}
+
+void
+GncTransactionStream::start_transaction_child (const gchar* tag,
+                                               const gchar** attrs)
+{
+    auto handler = find_handler (trn_dom_handlers, tag);
+    if (handler < 0)
+    {
+        PERR ("Unhandled tag: %s", tag);
+        m_job->ok = false;
+        m_ignored = m_depth;
+        return;
+    }
+
+    m_seen |= 1u << handler;
+    if (static_cast<TrnField> (handler) == TrnField::splits)
+    {
+        m_job->fields.push_back (GncStreamField{handler, GncFieldType::text,
+                                                true, 0, 0, nullptr,
+                                                gnc_numeric_zero (), 0, {}});
+        m_splits_done = false;
+        return;
+    }
+    start_field (m_job->fields, handler, trn_field_types[handler], attrs);
+}
+
+void
+GncTransactionStream::start_split_child (const gchar* tag, const gchar** attrs)
+{
+    auto handler = find_handler (spl_dom_handlers, tag);
+    if (handler < 0)
+    {
+        PERR ("Unhandled tag: %s", tag);
+        m_split_ok = false;
+        m_ignored = m_depth;
+        return;
+    }
+
+    m_split_seen |= 1u << handler;
+    start_field (m_job->split_fields, handler, spl_field_types[handler], attrs);
+}
+
+void
+GncTransactionStream::end_split ()
+{
+    m_in_split = false;
+    if (m_split_ok && all_required_seen (spl_dom_handlers, m_split_seen))
+        return;
+
+    /* Like a split dom_tree_to_split() fails on, drop it and the ones
+     * after it. */
+    auto start = m_job->splits.back ();
+    m_job->splits.pop_back ();
+    for (auto i = start; i < m_job->split_fields.size (); ++i)
+        delete m_job->split_fields[i].frame;
+    m_job->split_fields.resize (start);
+    m_splits_done = true;
+}
+
+void
+GncTransactionStream::start_element (const gchar* tag, const gchar** attrs)
+{
+    ++m_depth;
+    if (m_ignored)
+        return;
+    if (m_fields.active ())
+    {
+        m_fields.start_element (tag, attrs);
+        return;
+    }
+
+    switch (m_depth)
+    {
+    case 1:
+        start_transaction_child (tag, attrs);
+        break;
+    case 2:
+        /* Only trn:splits has children that aren't fields. */
+        if (m_splits_done || strcmp (tag, "trn:split") != 0)
+        {
+            m_splits_done = true;
+            m_ignored = m_depth;
+            break;
+        }
+        m_job->splits.push_back (m_job->split_fields.size ());
+        m_in_split = true;
+        m_split_ok = true;
+        m_split_seen = 0;
+        break;
+    default:
+        start_split_child (tag, attrs);
+        break;
+    }
+}
+
+void
+GncTransactionStream::characters (const gchar* text, int len)
+{
+    if (!m_ignored && m_fields.active ())
+        m_fields.characters (text, len);
+}
+
+void
+GncTransactionStream::end_element (const gchar* tag)
+{
+    if (m_ignored)
+    {
+        if (m_depth == m_ignored)
+            m_ignored = 0;
+    }
+    else if (m_fields.active ())
+    {
+        m_fields.end_element (tag);
+        if (!m_fields.active ())
+            field_done ();
+    }
+    else if (m_depth == 2)
+    {
+        end_split ();
+    }
+    --m_depth;
+}
+
+GncTransactionJob*
+GncTransactionStream::finish ()
+{
+    if (!all_required_seen (trn_dom_handlers, m_seen))
+        m_job->ok = false;
+
+    auto job = m_job;
+    m_job = nullptr;
+    return job;
+}
+
+/* Runs on the workers, so it mustn't touch the engine. */
+static void
+convert_transaction (GncTransactionJob* job)
+{
+    for (auto fields : {&job->fields, &job->split_fields})
+        for (auto& field : *fields)
+            field.convert (job->texts);
+}
+
+static time64
+stream_field_time (const GncStreamField& field, const char* tag)
+{
+    return dom_tree_valid_time64 (field.time, BAD_CAST tag) ? field.time : 0;
+}
+
+static const char*
+stream_field_text (const GncTransactionJob* job, std::size_t text)
+{
+    return text == std::string::npos ? NULL : &job->texts[text];
+}
+
+static Split*
+apply_split (GncTransactionJob* job, std::size_t begin, std::size_t end,
+             QofBook* book)
+{
+    Split* split = xaccMallocSplit (book);
+
+    for (auto i = begin; i < end; ++i)
+    {
+        auto& field = job->split_fields[i];
+        auto text = stream_field_text (job, field.text);
+
+        switch (static_cast<SplField> (field.handler))
+        {
+        case SplField::id:
+            if (field.valid)
+                xaccSplitSetGUID (split, &field.guid);
+            break;
+        case SplField::memo:
+            xaccSplitSetMemo (split, text);
+            break;
+        case SplField::action:
+            xaccSplitSetAction (split, text);
+            break;
+        case SplField::reconciled_state:
+            xaccSplitSetReconcile (split, text[0]);
+            break;
+        case SplField::reconcile_date:
+            xaccSplitSetDateReconciledSecs (
+                split, stream_field_time (field,
+                                          spl_dom_handlers[field.handler].tag));
+            break;
+        case SplField::value:
+            xaccSplitSetValue (split, field.num);
+            break;
+        case SplField::quantity:
+            xaccSplitSetAmount (split, field.num);
+            break;
+        case SplField::account:
+            if (field.valid)
+                split_set_account (split, &field.guid, book);
+            break;
+        case SplField::lot:
+            if (field.valid)
+                split_set_lot (split, &field.guid, book);
+            break;
+        case SplField::slots:
+            GncSlotsStream::add_to_instance (field.frame, QOF_INSTANCE (split));
+            field.frame = nullptr;
+            break;
+        }
+    }
+    return split;
+}
+
+static Transaction*
+apply_transaction (GncTransactionJob* job, QofBook* book,
+                   GncCommodityRefCache& commodities)
+{
+    Transaction* trn = xaccMallocTransaction (book);
+    bool splits_applied = false;
+
+    xaccTransBeginEdit (trn);
+
+    for (auto& field : job->fields)
+    {
+        auto text = stream_field_text (job, field.text);
+        auto tag = trn_dom_handlers[field.handler].tag;
+
+        switch (static_cast<TrnField> (field.handler))
+        {
+        case TrnField::id:
+            if (field.valid)
+                xaccTransSetGUID (trn, &field.guid);
+            break;
+        case TrnField::currency:
+            xaccTransSetCurrency (trn, field.valid ?
+                                  commodities.lookup (text,
+                                                      stream_field_text (job, field.text2),
+                                                      book) : NULL);
+            break;
+        case TrnField::num:
+            xaccTransSetNum (trn, text);
+            break;
+        case TrnField::date_posted:
+            xaccTransSetDatePostedSecs (trn, stream_field_time (field, tag));
+            break;
+        case TrnField::date_entered:
+            xaccTransSetDateEnteredSecs (trn, stream_field_time (field, tag));
+            break;
+        case TrnField::description:
+            xaccTransSetDescription (trn, text);
+            break;
+        case TrnField::slots:
+            GncSlotsStream::add_to_instance (field.frame, QOF_INSTANCE (trn));
+            field.frame = nullptr;
+            break;
+        case TrnField::splits:
+            /* All the splits are in job->splits, even if there were
+             * several trn:splits. */
+            if (splits_applied)
+                break;
+            for (std::size_t i = 0; i < job->splits.size (); ++i)
+            {
+                auto end = i + 1 < job->splits.size () ? job->splits[i + 1] :
+                           job->split_fields.size ();
+                xaccTransAppendSplit (trn, apply_split (job, job->splits[i], end,
+                                                        book));
+            }
+            splits_applied = true;
+            break;
+        }
+    }
+
+    xaccTransCommitEdit (trn);
+    return trn;
+}
+
+static Transaction*
+load_transaction (GncTransactionJob* job, QofBook* book,
+                  GncCommodityRefCache& commodities)
+{
+    if (!job->ok)
+    {
+        PERR ("failed to load a transaction");
+        return NULL;
+    }
+    return apply_transaction (job, book, commodities);
+}
+
+GncTransactionLoader::GncTransactionLoader (QofBook* book, gxpf_callback cb,
+                                            gpointer parsedata) :
+    m_book{book}, m_cb{cb}, m_parsedata{parsedata}
+{
+    g_mutex_init (&m_mutex);
+    g_cond_init (&m_cond);
+
+    /* The main thread is busy parsing and applying, so it doesn't count. */
+    auto workers = g_get_num_processors () - 1;
+    if (workers > 0)
+        m_pool = g_thread_pool_new (convert, this, workers, TRUE, NULL);
+    /* Enough to keep the workers busy while the main thread catches up,
+     * without holding on to too many transactions. */
+    m_max_pending = 64 * (workers > 0 ? workers : 1);
+}
+
+GncTransactionLoader::~GncTransactionLoader ()
+{
+    if (m_pool)
+        g_thread_pool_free (m_pool, FALSE, TRUE);
+
+    for (auto job : m_jobs)
+        delete job;
+    for (auto job : m_free_jobs)
+        delete job;
+
+    g_cond_clear (&m_cond);
+    g_mutex_clear (&m_mutex);
+}
+
+void
+GncTransactionLoader::convert (gpointer data, gpointer user_data)
+{
+    auto job = static_cast<GncTransactionJob*> (data);
+    auto loader = static_cast<GncTransactionLoader*> (user_data);
+
+    convert_transaction (job);
+
+    g_mutex_lock (&loader->m_mutex);
+    job->done = true;
+    g_cond_broadcast (&loader->m_cond);
+    g_mutex_unlock (&loader->m_mutex);
+}
+
+GncTransactionJob*
+GncTransactionLoader::new_job ()
+{
+    if (m_free_jobs.empty ())
+        return new GncTransactionJob{};
+
+    auto job = m_free_jobs.back ();
+    m_free_jobs.pop_back ();
+    return job;
+}
+
+void
+GncTransactionLoader::push (GncTransactionJob* job)
+{
+    job->done = false;
+    m_jobs.push_back (job);
+    if (m_pool)
+    {
+        g_thread_pool_push (m_pool, job, NULL);
+    }
+    else
+    {
+        convert_transaction (job);
+        job->done = true;
+    }
+
+    auto pending = m_jobs.size ();
+    apply_jobs (pending > m_max_pending ? pending - m_max_pending : 0);
+}
+
+gboolean
+GncTransactionLoader::flush ()
+{
+    apply_jobs (m_jobs.size ());
+
+    auto ok = m_ok;
+    m_ok = TRUE;
+    return ok;
+}
+
+/* Apply the finished jobs at the head of the queue, waiting for the first
+ * min_count of them if they aren't finished yet. */
+void
+GncTransactionLoader::apply_jobs (std::size_t min_count)
+{
+    while (!m_jobs.empty ())
+    {
+        auto job = m_jobs.front ();
+
+        g_mutex_lock (&m_mutex);
+        while (!job->done && min_count)
+            g_cond_wait (&m_cond, &m_mutex);
+        auto done = job->done;
+        g_mutex_unlock (&m_mutex);
+
+        if (!done)
+            break;
+
+        m_jobs.pop_front ();
+        if (min_count)
+            --min_count;
+        apply_job (job);
+    }
+}
+
+void
+GncTransactionLoader::apply_job (GncTransactionJob* job)
+{
+    auto trn = load_transaction (job, m_book, m_commodities);
+
+    if (trn != NULL)
+        m_cb (job->tag.c_str (), m_parsedata, trn);
+    else
+        m_ok = FALSE;
+
+    job->clear ();
+    m_free_jobs.push_back (job);
+}
+
+static gboolean
+gnc_transaction_stream_start_handler (GSList* sibling_data,
+                                      gpointer parent_data,
+                                      gpointer global_data,
+                                      gpointer* data_for_children,
+                                      gpointer* result,
+                                      const gchar* tag, gchar** attrs)
+{
+    gxpf_data* gdata = (gxpf_data*)global_data;
+    sixtp_gdv2* gd = (sixtp_gdv2*)gdata->parsedata;
+    auto job = gd->txn_loader ? gd->txn_loader->new_job () :
+               new GncTransactionJob{};
+
+    *data_for_children = new GncTransactionStream (job);
+    return TRUE;
+}
+
+static gboolean
+gnc_transaction_stream_end_handler (gpointer data_for_children,
+                                    GSList* data_from_children,
+                                    GSList* sibling_data,
+                                    gpointer parent_data,
+                                    gpointer global_data,
+                                    gpointer* result, const gchar* tag)
+{
+    auto stream = static_cast<GncTransactionStream*> (data_for_children);
+    gxpf_data* gdata = (gxpf_data*)global_data;
+    sixtp_gdv2* gd = (sixtp_gdv2*)gdata->parsedata;
+
+    /* Like gnc_transaction_end_handler(). */
+    if (parent_data || !tag)
+    {
+        delete stream;
+        return TRUE;
+    }
+
+    g_return_val_if_fail (stream, FALSE);
+
+    auto job = stream->finish ();
+    delete stream;
+    job->tag = tag;
+
+    if (gd->txn_loader)
+    {
+        gd->txn_loader->push (job);
+        return TRUE;
+    }
+
+    GncCommodityRefCache commodities;
+    convert_transaction (job);
+    auto trn = load_transaction (job, static_cast<QofBook*> (gdata->bookdata),
+                                 commodities);
+    if (trn != NULL)
+        gdata->cb (tag, gdata->parsedata, trn);
+    delete job;
+    return trn != NULL;
+}
+
+static void
+gnc_transaction_stream_fail_handler (gpointer data_for_children,
+                                     GSList* data_from_children,
+                                     GSList* sibling_data,
+                                     gpointer parent_data,
+                                     gpointer global_data,
+                                     gpointer* result, const gchar* tag)
+{
+    delete static_cast<GncTransactionStream*> (data_for_children);
+}
+
+sixtp*
+gnc_transaction_sixtp_pipelined_parser_create (void)
+{
+    sixtp* parser = sixtp_set_any (
+                        sixtp_new (), FALSE,
+                        SIXTP_START_HANDLER_ID, gnc_transaction_stream_start_handler,
+                        SIXTP_END_HANDLER_ID, gnc_transaction_stream_end_handler,
+                        SIXTP_FAIL_HANDLER_ID, gnc_transaction_stream_fail_handler,
+                        SIXTP_NO_MORE_HANDLERS);
+    if (parser)
+        sixtp_set_stream (parser, TRUE);
+    return parser;
+}
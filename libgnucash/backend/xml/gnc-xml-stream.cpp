@@ -0,0 +1,532 @@
+/********************************************************************\
+ * gnc-xml-stream.cpp -- Parse objects straight from SAX events     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+extern "C"
+{
+#include <config.h>
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+}
+
+#include "gnc-xml-helper.h"
+#include "gnc-xml-stream.hpp"
+#include "sixtp-utils.h"
+
+#include <kvp-frame.hpp>
+
+static const std::size_t no_text = std::string::npos;
+
+/* Like xmlGetProp (node, "type"). */
+static const gchar*
+type_attribute (const gchar** attrs)
+{
+    for (; attrs && *attrs; attrs += 2)
+        if (strcmp (attrs[0], "type") == 0)
+            return attrs[1];
+    return NULL;
+}
+
+/***********************************************************************/
+
+GncSlotsStream::GncSlotsStream ()
+{
+    m_levels.push_back (Level{Kind::frame, ValueType::unknown, new KvpFrame,
+                              no_text, nullptr, nullptr, 0, 0, {}});
+}
+
+GncSlotsStream::~GncSlotsStream ()
+{
+    for (auto& level : m_levels)
+    {
+        delete level.frame;
+        delete level.value;
+        g_list_free_full (level.list, [] (gpointer value)
+        {
+            delete static_cast<KvpValue*> (value);
+        });
+    }
+}
+
+KvpFrame*
+GncSlotsStream::release_frame ()
+{
+    auto frame = m_levels.front ().frame;
+    m_levels.front ().frame = nullptr;
+    return frame;
+}
+
+void
+GncSlotsStream::add_to_instance (KvpFrame* frame, QofInstance* inst)
+{
+    if (!frame)
+        return;
+
+    auto slots = qof_instance_get_slots (inst);
+    for (const auto& key : frame->get_keys ())
+        delete slots->set ({key}, frame->set ({key}, nullptr));
+    delete frame;
+}
+
+/* The value types of dom_tree_to_kvp_value(). */
+GncSlotsStream::ValueType
+GncSlotsStream::value_type (const gchar** attrs)
+{
+    static const struct
+    {
+        const char* name;
+        ValueType type;
+    } types[] =
+    {
+        { "integer", ValueType::integer },
+        { "double", ValueType::dbl },
+        { "numeric", ValueType::numeric },
+        { "string", ValueType::string },
+        { "guid", ValueType::guid },
+        { "timespec", ValueType::timespec },
+        { "gdate", ValueType::gdate },
+        { "list", ValueType::list },
+        { "frame", ValueType::frame },
+    };
+    auto type = type_attribute (attrs);
+
+    for (const auto& t : types)
+        if (g_strcmp0 (type, t.name) == 0)
+            return t.type;
+    return ValueType::unknown;
+}
+
+const char*
+GncSlotsStream::text ()
+{
+    checked_char_cast (&m_text[0]);
+    return m_text.c_str ();
+}
+
+void
+GncSlotsStream::start_element (const gchar* tag, const gchar** attrs)
+{
+    const auto& top = m_levels.back ();
+    Level level{Kind::ignored, ValueType::unknown, nullptr, no_text, nullptr,
+                nullptr, 0, 0, {}};
+
+    switch (top.kind)
+    {
+    case Kind::frame:
+        if (strcmp (tag, "slot") == 0)
+            level.kind = Kind::slot;
+        break;
+    case Kind::slot:
+        if (strcmp (tag, "slot:key") == 0)
+            level.kind = Kind::key;
+        else if (strcmp (tag, "slot:value") == 0)
+            level.kind = Kind::value;
+        break;
+    case Kind::value:
+        switch (top.type)
+        {
+        case ValueType::timespec:
+            if (strcmp (tag, "ts:date") == 0)
+                level.kind = Kind::date;
+            break;
+        case ValueType::gdate:
+            if (strcmp (tag, "gdate") == 0)
+                level.kind = Kind::date;
+            break;
+        case ValueType::list:
+            level.kind = Kind::value;
+            break;
+        case ValueType::frame:
+            if (strcmp (tag, "slot") == 0)
+                level.kind = Kind::slot;
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (level.kind == Kind::value)
+    {
+        level.type = value_type (attrs);
+        if (level.type == ValueType::frame)
+            level.frame = new KvpFrame;
+        else if (level.type == ValueType::gdate)
+            g_date_clear (&level.date, 1);
+    }
+    if (level.kind == Kind::key || level.kind == Kind::value ||
+        level.kind == Kind::date)
+        m_text.clear ();
+
+    m_levels.push_back (level);
+}
+
+void
+GncSlotsStream::characters (const gchar* text, int len)
+{
+    const auto& top = m_levels.back ();
+
+    switch (top.kind)
+    {
+    case Kind::key:
+    case Kind::date:
+        m_text.append (text, len);
+        break;
+    case Kind::value:
+        if (top.type <= ValueType::guid)
+            m_text.append (text, len);
+        break;
+    default:
+        break;
+    }
+}
+
+KvpValue*
+GncSlotsStream::finish_value (Level& level)
+{
+    KvpValue* value = nullptr;
+
+    switch (level.type)
+    {
+    case ValueType::integer:
+    {
+        gint64 i;
+        if (string_to_gint64 (text (), &i))
+            value = new KvpValue {i};
+        break;
+    }
+    case ValueType::dbl:
+    {
+        double d;
+        if (string_to_double (text (), &d))
+            value = new KvpValue {d};
+        break;
+    }
+    case ValueType::numeric:
+    {
+        gnc_numeric num;
+        if (!string_to_gnc_numeric (text (), &num))
+            num = gnc_numeric_zero ();
+        value = new KvpValue {num};
+        break;
+    }
+    case ValueType::string:
+        value = new KvpValue {static_cast<const char*> (g_strdup (text ()))};
+        break;
+    case ValueType::guid:
+    {
+        auto guid = guid_new ();
+        string_to_guid (text (), guid);
+        value = new KvpValue {guid};
+        break;
+    }
+    case ValueType::timespec:
+        value = new KvpValue {Time64{level.dates == 1 ? level.time : INT64_MAX}};
+        break;
+    case ValueType::gdate:
+        if (level.dates == 1)
+            value = new KvpValue {level.date};
+        break;
+    case ValueType::list:
+        value = new KvpValue {g_list_reverse (level.list)};
+        level.list = nullptr;
+        break;
+    case ValueType::frame:
+        value = new KvpValue {level.frame};
+        level.frame = nullptr;
+        break;
+    case ValueType::unknown:
+        break;
+    }
+    return value;
+}
+
+void
+GncSlotsStream::add_value (KvpValue* value)
+{
+    auto& top = m_levels.back ();
+
+    if (top.kind == Kind::slot)
+    {
+        delete top.value;
+        top.value = value;
+    }
+    else if (value)
+    {
+        top.list = g_list_prepend (top.list, value);
+    }
+}
+
+void
+GncSlotsStream::end_element (const gchar* tag)
+{
+    g_return_if_fail (m_levels.size () > 1);
+
+    auto level = m_levels.back ();
+    m_levels.pop_back ();
+    auto& parent = m_levels.back ();
+
+    switch (level.kind)
+    {
+    case Kind::slot:
+        if (level.key != no_text && level.value)
+            delete parent.frame->set ({m_keys.c_str () + level.key},
+                                      level.value);
+        else
+            delete level.value;
+        if (level.key != no_text)
+            m_keys.resize (level.key);
+        break;
+    case Kind::key:
+        /* The last key wins, and any keys of slots in the value are gone
+         * again by now. */
+        if (parent.key != no_text)
+            m_keys.resize (parent.key);
+        parent.key = m_keys.size ();
+        m_keys += text ();
+        m_keys += '\0';
+        break;
+    case Kind::value:
+        add_value (finish_value (level));
+        break;
+    case Kind::date:
+        if (++parent.dates > 1)
+            break;
+        if (parent.type == ValueType::timespec)
+        {
+            parent.time = gnc_iso8601_to_time64_gmt (text ());
+        }
+        else
+        {
+            gint year, month, day;
+            if (sscanf (text (), "%d-%d-%d", &year, &month, &day) == 3)
+                g_date_set_dmy (&parent.date, day,
+                                static_cast<GDateMonth> (month), year);
+            if (!g_date_valid (&parent.date))
+                parent.dates = 2;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/***********************************************************************/
+
+void
+GncStreamField::convert (const std::string& texts)
+{
+    switch (type)
+    {
+    case GncFieldType::guid:
+        if (valid)
+            valid = string_to_guid (&texts[text], &guid);
+        break;
+    case GncFieldType::numeric:
+        if (!string_to_gnc_numeric (&texts[text], &num))
+            num = gnc_numeric_zero ();
+        break;
+    case GncFieldType::time:
+        time = valid ? gnc_iso8601_to_time64_gmt (&texts[text]) : INT64_MAX;
+        break;
+    default:
+        break;
+    }
+}
+
+GncFieldStream::~GncFieldStream ()
+{
+    delete m_slots;
+}
+
+void
+GncFieldStream::start_text (std::size_t* where)
+{
+    *where = m_texts.size ();
+    m_text = where;
+    m_text_depth = m_depth;
+}
+
+void
+GncFieldStream::end_text ()
+{
+    m_texts += '\0';
+    checked_char_cast (&m_texts[*m_text]);
+    m_text = nullptr;
+}
+
+void
+GncFieldStream::start (GncStreamField& field, const gchar** attrs)
+{
+    g_return_if_fail (!m_field);
+
+    m_field = &field;
+    m_depth = 0;
+    m_dates = 0;
+    field.valid = true;
+    field.text = field.text2 = no_text;
+    field.frame = nullptr;
+
+    switch (field.type)
+    {
+    case GncFieldType::guid:
+    {
+        /* dom_tree_to_guid() only looks at the first attribute. */
+        auto type = attrs && attrs[0] && strcmp (attrs[0], "type") == 0 ?
+                    attrs[1] : NULL;
+        field.valid = g_strcmp0 (type, "guid") == 0 ||
+                      g_strcmp0 (type, "new") == 0;
+        start_text (&field.text);
+        break;
+    }
+    case GncFieldType::text:
+    case GncFieldType::numeric:
+        start_text (&field.text);
+        break;
+    case GncFieldType::slots:
+        m_slots = new GncSlotsStream;
+        break;
+    default:
+        break;
+    }
+}
+
+void
+GncFieldStream::start_element (const gchar* tag, const gchar** attrs)
+{
+    ++m_depth;
+
+    if (m_slots)
+    {
+        m_slots->start_element (tag, attrs);
+        return;
+    }
+    if (m_text)
+    {
+        m_ok = false;
+        return;
+    }
+    if (m_depth != 1)
+        return;
+
+    switch (m_field->type)
+    {
+    case GncFieldType::time:
+        /* Other children, like the <ts:ns> of old files, are ignored. */
+        if (strcmp (tag, "ts:date") == 0 && ++m_dates == 1)
+            start_text (&m_field->text);
+        break;
+    case GncFieldType::commodity:
+    {
+        std::size_t* where = nullptr;
+        if (strcmp (tag, "cmdty:space") == 0)
+            where = &m_field->text;
+        else if (strcmp (tag, "cmdty:id") == 0)
+            where = &m_field->text2;
+        if (!where)
+            break;
+        if (*where != no_text)
+            m_field->valid = false;
+        else
+            start_text (where);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void
+GncFieldStream::characters (const gchar* text, int len)
+{
+    if (m_slots)
+        m_slots->characters (text, len);
+    else if (m_text && m_depth == m_text_depth)
+        m_texts.append (text, len);
+}
+
+void
+GncFieldStream::end_element (const gchar* tag)
+{
+    if (m_depth > 0)
+    {
+        if (m_slots)
+            m_slots->end_element (tag);
+        else if (m_text && m_depth == m_text_depth)
+            end_text ();
+        --m_depth;
+        return;
+    }
+
+    if (m_text)
+        end_text ();
+    if (m_slots)
+    {
+        m_field->frame = m_slots->release_frame ();
+        delete m_slots;
+        m_slots = nullptr;
+    }
+    if (m_field->type == GncFieldType::time)
+        m_field->valid = m_dates == 1;
+    m_field = nullptr;
+}
+
+/***********************************************************************/
+
+/* The cache is for the few currencies and commodities that turn up over and
+ * over again; it doesn't need to be large. */
+static const std::size_t max_cached_commodities = 16;
+
+gnc_commodity*
+GncCommodityRefCache::lookup (const char* space, const char* id,
+                              QofBook* book)
+{
+    if (!space || !id)
+        return NULL;
+
+    for (const auto& entry : m_entries)
+        if (entry.space == space && entry.id == id)
+            return entry.commodity;
+
+    /* Create the commodity first like dom_tree_to_commodity_ref() does, as
+     * that adds its namespace and maps some of them to others. */
+    auto space_str = g_strstrip (g_strdup (space));
+    auto id_str = g_strstrip (g_strdup (id));
+    auto ref = gnc_commodity_new (book, NULL, space_str, id_str, NULL, 0);
+    auto commodity = gnc_commodity_table_lookup (
+                         gnc_commodity_table_get_table (book),
+                         gnc_commodity_get_namespace (ref),
+                         gnc_commodity_get_mnemonic (ref));
+    gnc_commodity_destroy (ref);
+    g_free (space_str);
+    g_free (id_str);
+
+    if (commodity)
+    {
+        if (m_entries.size () >= max_cached_commodities)
+            m_entries.clear ();
+        m_entries.push_back (Entry{space, id, commodity});
+    }
+    return commodity;
+}
@@ -0,0 +1,174 @@
+/********************************************************************\
+ * gnc-xml-stream.hpp -- Parse objects straight from SAX events     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @file gnc-xml-stream.hpp
+ *
+ * Building blocks for SixtpStreams, which parse the objects a book has most
+ * of (transactions, splits, prices and their slots) without building a DOM
+ * tree for each of them first. They read the same elements the dom_tree_to_*
+ * converters in sixtp-dom-parsers.h read and treat them the same way, except
+ * that elements nested in the text of a field make the object fail to load.
+ */
+
+#ifndef GNC_XML_STREAM_HPP
+#define GNC_XML_STREAM_HPP
+
+extern "C"
+{
+#include <glib.h>
+#include "gnc-commodity.h"
+#include "qof.h"
+}
+
+#include "sixtp.h"
+
+#include <string>
+#include <vector>
+
+/** Builds the KvpFrame a <slots> element describes, like
+ *  dom_tree_to_kvp_frame(). */
+class GncSlotsStream : public SixtpStream
+{
+public:
+    GncSlotsStream ();
+    ~GncSlotsStream ();
+    GncSlotsStream (const GncSlotsStream&) = delete;
+    GncSlotsStream& operator= (const GncSlotsStream&) = delete;
+
+    void start_element (const gchar* tag, const gchar** attrs) override;
+    void characters (const gchar* text, int len) override;
+    void end_element (const gchar* tag) override;
+
+    /** The frame built so far, which the caller then owns. */
+    KvpFrame* release_frame ();
+    /** Move the slots of frame into inst's slots the way
+     *  dom_tree_create_instance_slots() adds them, and delete frame. */
+    static void add_to_instance (KvpFrame* frame, QofInstance* inst);
+
+private:
+    enum class Kind { frame, slot, key, value, date, ignored };
+    enum class ValueType { integer, dbl, numeric, string, guid, timespec,
+                           gdate, list, frame, unknown };
+    struct Level
+    {
+        Kind kind;
+        ValueType type;
+        KvpFrame* frame;        // the frame of a frame or of a frame value
+        std::size_t key;        // where a slot's key starts in m_keys
+        KvpValue* value;        // a slot's value
+        GList* list;            // a list value's values, in reverse
+        int dates;              // how many dates a date value has
+        time64 time;
+        GDate date;
+    };
+
+    static ValueType value_type (const gchar** attrs);
+    KvpValue* finish_value (Level& level);
+    void add_value (KvpValue* value);
+    const char* text ();
+
+    std::vector<Level> m_levels;
+    std::string m_keys;         // the keys of the open slots, NUL separated
+    std::string m_text;
+};
+
+enum class GncFieldType { text, guid, numeric, time, commodity, slots };
+
+/** What a GncFieldStream makes of a field, like a split's value, of an
+ *  object. */
+struct GncStreamField
+{
+    int handler;                // which field it is, up to the user
+    GncFieldType type;
+    /** The element has what its type calls for: a <ts:date> child exactly
+     *  once for a time, <cmdty:space> and <cmdty:id> children at most once
+     *  each for a commodity and a GUID type attribute and valid GUID for a
+     *  GUID. */
+    bool valid;
+    std::size_t text;           // where the text starts, npos if none
+    std::size_t text2;          // where a commodity's <cmdty:id> text starts
+    KvpFrame* frame;            // a slots field's slots
+    gnc_numeric num;
+    time64 time;
+    GncGUID guid;
+
+    /** Turn the text into the field's value. Doesn't touch the engine, so
+     *  it can run on any thread. */
+    void convert (const std::string& texts);
+};
+
+/** Parses one field element after another into GncStreamFields, appending
+ *  their text to a string of NUL terminated texts. */
+class GncFieldStream
+{
+public:
+    explicit GncFieldStream (std::string& texts) : m_texts (texts) {}
+    ~GncFieldStream ();
+    GncFieldStream (const GncFieldStream&) = delete;
+    GncFieldStream& operator= (const GncFieldStream&) = delete;
+
+    /** Start on the field element with the given attributes. The field
+     *  must stay where it is until it's done. */
+    void start (GncStreamField& field, const gchar** attrs);
+    /** Whether a field is being parsed, i.e. its end tag hasn't been seen. */
+    bool active () const { return m_field != nullptr; }
+    /** Elements within the field element. */
+    void start_element (const gchar* tag, const gchar** attrs);
+    void characters (const gchar* text, int len);
+    /** Also takes the field's own end tag, which finishes it. */
+    void end_element (const gchar* tag);
+    /** FALSE once an element turned up where text was expected. */
+    bool ok () const { return m_ok; }
+    void reset_ok () { m_ok = true; }
+
+private:
+    void start_text (std::size_t* where);
+    void end_text ();
+
+    std::string& m_texts;
+    GncStreamField* m_field = nullptr;
+    int m_depth = 0;
+    std::size_t* m_text = nullptr;      // the text being collected
+    int m_text_depth = 0;
+    int m_dates = 0;                    // <ts:date>s in a time field
+    GncSlotsStream* m_slots = nullptr;
+    bool m_ok = true;
+};
+
+/** Looks commodity references up like dom_tree_to_commodity_ref(),
+ *  remembering the commodities it found. */
+class GncCommodityRefCache
+{
+public:
+    /** @return NULL if space or id is NULL or there's no such commodity. */
+    gnc_commodity* lookup (const char* space, const char* id, QofBook* book);
+
+private:
+    struct Entry
+    {
+        std::string space;
+        std::string id;
+        gnc_commodity* commodity;
+    };
+    std::vector<Entry> m_entries;
+};
+
+#endif /* GNC_XML_STREAM_HPP */
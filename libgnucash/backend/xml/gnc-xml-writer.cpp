@@ -0,0 +1,460 @@
+/********************************************************************\
+ * gnc-xml-writer.cpp -- Write XML without building a DOM first     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+extern "C"
+{
+#include <config.h>
+
+#include <glib.h>
+#include <string.h>
+}
+
+#include "gnc-xml-helper.h"
+#include "gnc-xml-writer.hpp"
+
+#include <kvp-frame.hpp>
+#include <gnc-datetime.hpp>
+
+/* The buffer is written out whenever it grows beyond this. */
+static const std::size_t flush_size = 64 * 1024;
+
+/* libxml2 indents by two spaces per level, but not beyond 30 levels. */
+static const unsigned max_indent_level = 30;
+
+GncXmlWriter::GncXmlWriter (FILE* out) : m_out{out}
+{
+    m_buf.reserve (flush_size + flush_size / 4);
+}
+
+GncXmlWriter::~GncXmlWriter ()
+{
+    flush ();
+}
+
+gboolean
+GncXmlWriter::flush ()
+{
+    if (!m_buf.empty ())
+    {
+        if (fwrite (m_buf.data (), 1, m_buf.size (), m_out) != m_buf.size ())
+            m_ok = FALSE;
+        m_buf.clear ();
+    }
+    if (ferror (m_out))
+        m_ok = FALSE;
+    return m_ok;
+}
+
+/* An element's children are put on lines of their own, unless one of them is
+ * text. That's only ever the case for the elements add_text() writes, so
+ * an element getting its first child from start_element() or add_text() is
+ * formatted. */
+void
+GncXmlWriter::close_start_tag ()
+{
+    if (!m_start_tag_open)
+        return;
+    m_buf += ">\n";
+    m_start_tag_open = false;
+}
+
+void
+GncXmlWriter::indent ()
+{
+    auto level = m_level < max_indent_level ? m_level : max_indent_level;
+    m_buf.append (2 * level, ' ');
+}
+
+void
+GncXmlWriter::element_done ()
+{
+    m_buf += '\n';
+    if (m_buf.size () > flush_size)
+        flush ();
+}
+
+void
+GncXmlWriter::start_element (const char* tag)
+{
+    close_start_tag ();
+    indent ();
+    m_buf += '<';
+    m_buf += tag;
+    m_tags += tag;
+    m_tags += '\0';
+    ++m_level;
+    m_start_tag_open = true;
+}
+
+void
+GncXmlWriter::add_attribute (const char* name, const char* value)
+{
+    g_return_if_fail (m_start_tag_open);
+    m_buf += ' ';
+    m_buf += name;
+    m_buf += "=\"";
+    m_buf += value;
+    m_buf += '"';
+}
+
+void
+GncXmlWriter::end_element ()
+{
+    g_return_if_fail (m_level > 0);
+
+    m_tags.pop_back ();
+    auto start = m_tags.rfind ('\0');
+    start = start == std::string::npos ? 0 : start + 1;
+    --m_level;
+
+    if (m_start_tag_open)
+    {
+        m_buf += "/>";
+        m_start_tag_open = false;
+    }
+    else
+    {
+        indent ();
+        m_buf += "</";
+        m_buf.append (m_tags, start, std::string::npos);
+        m_buf += '>';
+    }
+    m_tags.resize (start);
+    element_done ();
+}
+
+/* What checked_char_cast() and libxml2's escaping of text content would make
+ * of text. */
+void
+GncXmlWriter::append_escaped (const char* text)
+{
+    gchar* checked = NULL;
+
+    if (!g_utf8_validate (text, -1, NULL))
+    {
+        checked = g_strdup (text);
+        checked_char_cast (checked);
+        text = checked;
+    }
+
+    for (auto p = text; *p; ++p)
+    {
+        switch (*p)
+        {
+        case '&':
+            m_buf += "&amp;";
+            break;
+        case '<':
+            m_buf += "&lt;";
+            break;
+        case '>':
+            m_buf += "&gt;";
+            break;
+        case '\r':
+            m_buf += "&#13;";
+            break;
+        default:
+            if (*p > 0 && *p < 0x20 && *p != '\t' && *p != '\n')
+                m_buf += '?';
+            else
+                m_buf += *p;
+            break;
+        }
+    }
+
+    g_free (checked);
+}
+
+void
+GncXmlWriter::append_int64 (gint64 val)
+{
+    char digits[24];
+    char* p = digits + sizeof (digits);
+    /* Work on the magnitude as unsigned so that INT64_MIN works too. */
+    guint64 mag = val < 0 ? 0 - static_cast<guint64> (val) : val;
+
+    do
+    {
+        *--p = '0' + mag % 10;
+        mag /= 10;
+    }
+    while (mag);
+    if (val < 0)
+        *--p = '-';
+    m_buf.append (p, digits + sizeof (digits) - p);
+}
+
+void
+GncXmlWriter::add_text (const char* tag, const char* text, const char* type)
+{
+    close_start_tag ();
+    indent ();
+    m_buf += '<';
+    m_buf += tag;
+    if (type)
+    {
+        m_buf += " type=\"";
+        m_buf += type;
+        m_buf += '"';
+    }
+    if (text)
+    {
+        m_buf += '>';
+        append_escaped (text);
+        m_buf += "</";
+        m_buf += tag;
+        m_buf += '>';
+    }
+    else
+    {
+        m_buf += "/>";
+    }
+    element_done ();
+}
+
+void
+GncXmlWriter::add_guid (const char* tag, const GncGUID* guid)
+{
+    static const char hex[] = "0123456789abcdef";
+    char guid_str[GUID_ENCODING_LENGTH + 1];
+
+    if (!guid)
+        return;
+
+    for (int i = 0; i < GUID_DATA_SIZE; ++i)
+    {
+        guid_str[2 * i] = hex[guid->reserved[i] >> 4];
+        guid_str[2 * i + 1] = hex[guid->reserved[i] & 0xf];
+    }
+    guid_str[GUID_ENCODING_LENGTH] = '\0';
+
+    add_text (tag, guid_str, "guid");
+}
+
+void
+GncXmlWriter::add_numeric (const char* tag, gnc_numeric num)
+{
+    close_start_tag ();
+    indent ();
+    m_buf += '<';
+    m_buf += tag;
+    m_buf += '>';
+    append_int64 (num.num);
+    m_buf += '/';
+    append_int64 (num.denom);
+    m_buf += "</";
+    m_buf += tag;
+    m_buf += '>';
+    element_done ();
+}
+
+/* GncDateTime::format_iso8601() for the years with four digits, without going
+ * through boost. */
+static std::string
+time64_to_iso8601 (time64 time)
+{
+    gint64 days = time / 86400;
+    gint64 secs = time % 86400;
+    if (secs < 0)
+    {
+        secs += 86400;
+        --days;
+    }
+
+    /* Civil date from days since the epoch, see
+     * http://howardhinnant.github.io/date_algorithms.html#civil_from_days */
+    days += 719468;
+    gint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    gint64 doe = days - era * 146097;
+    gint64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    gint64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    gint64 mp = (5 * doy + 2) / 153;
+    gint64 day = doy - (153 * mp + 2) / 5 + 1;
+    gint64 month = mp < 10 ? mp + 3 : mp - 9;
+    gint64 year = yoe + era * 400 + (month <= 2);
+
+    if (year < 1400 || year > 9999)
+        return GncDateTime (time).format_iso8601 ();
+
+    char str[] = "YYYY-MM-DD HH:MM:SS";
+    auto put2 = [&str] (int pos, gint64 val)
+    {
+        str[pos] = '0' + val / 10;
+        str[pos + 1] = '0' + val % 10;
+    };
+    put2 (0, year / 100);
+    put2 (2, year % 100);
+    put2 (5, month);
+    put2 (8, day);
+    put2 (11, secs / 3600);
+    put2 (14, secs / 60 % 60);
+    put2 (17, secs % 60);
+    return str;
+}
+
+void
+GncXmlWriter::add_time64 (const char* tag, time64 time, const char* type)
+{
+    if (time == INT64_MAX)
+        return;
+
+    auto date_str = time64_to_iso8601 (time);
+    if (date_str.empty ())
+        return;
+
+    start_element (tag);
+    if (type)
+        add_attribute ("type", type);
+    add_text ("ts:date", date_str.c_str ());
+    end_element ();
+}
+
+void
+GncXmlWriter::add_gdate (const char* tag, const GDate* date, const char* type)
+{
+    char date_str[512];
+
+    g_return_if_fail (date);
+    g_date_strftime (date_str, sizeof (date_str), "%Y-%m-%d", date);
+
+    start_element (tag);
+    if (type)
+        add_attribute ("type", type);
+    add_text ("gdate", date_str);
+    end_element ();
+}
+
+void
+GncXmlWriter::add_commodity_ref (const char* tag, const gnc_commodity* c)
+{
+    g_return_if_fail (c);
+
+    auto name_space = gnc_commodity_get_namespace (c);
+    auto mnemonic = gnc_commodity_get_mnemonic (c);
+    if (!name_space || !mnemonic)
+        return;
+
+    start_element (tag);
+    add_text ("cmdty:space", name_space);
+    add_text ("cmdty:id", mnemonic);
+    end_element ();
+}
+
+void
+GncXmlWriter::add_kvp_value (const char* tag, KvpValue* val)
+{
+    char str[64];
+
+    switch (val->get_type ())
+    {
+    case KvpValue::Type::STRING:
+        add_text (tag, val->get<const char*> (), "string");
+        break;
+    case KvpValue::Type::INT64:
+        g_snprintf (str, sizeof (str), "%" G_GINT64_FORMAT,
+                    val->get<int64_t> ());
+        add_text (tag, str, "integer");
+        break;
+    case KvpValue::Type::DOUBLE:
+    {
+        /* Like double_to_string(). */
+        snprintf (str, sizeof (str), "%24.18g", val->get<double> ());
+        auto start = str;
+        while (g_ascii_isspace (*start))
+            ++start;
+        add_text (tag, start, "double");
+        break;
+    }
+    case KvpValue::Type::NUMERIC:
+    {
+        auto num = val->get<gnc_numeric> ();
+        g_snprintf (str, sizeof (str), "%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
+                    num.num, num.denom);
+        add_text (tag, str, "numeric");
+        break;
+    }
+    case KvpValue::Type::GUID:
+    {
+        auto guid = val->get<GncGUID*> ();
+        if (guid)
+            add_guid (tag, guid);
+        else
+            add_text (tag, NULL, "guid");
+        break;
+    }
+    /* Note: The type attribute must remain 'timespec' to maintain
+     * compatibility.
+     */
+    case KvpValue::Type::TIME64:
+        add_time64 (tag, val->get<Time64> ().t, "timespec");
+        break;
+    case KvpValue::Type::GDATE:
+    {
+        auto d = val->get<GDate> ();
+        add_gdate (tag, &d, "gdate");
+        break;
+    }
+    case KvpValue::Type::GLIST:
+        start_element (tag);
+        add_attribute ("type", "list");
+        for (auto cursor = val->get<GList*> (); cursor; cursor = cursor->next)
+            add_kvp_value ("slot:value", static_cast<KvpValue*> (cursor->data));
+        end_element ();
+        break;
+    case KvpValue::Type::FRAME:
+    {
+        start_element (tag);
+        add_attribute ("type", "frame");
+        auto frame = val->get<KvpFrame*> ();
+        if (frame)
+            add_kvp_frame (frame);
+        end_element ();
+        break;
+    }
+    default:
+        add_text (tag, NULL);
+        break;
+    }
+}
+
+void
+GncXmlWriter::add_kvp_frame (const KvpFrame* frame)
+{
+    frame->for_each_slot_temp ([this] (const char* key, KvpValue* value)
+    {
+        start_element ("slot");
+        add_text ("slot:key", key);
+        add_kvp_value ("slot:value", value);
+        end_element ();
+    });
+}
+
+void
+GncXmlWriter::add_slots (const char* tag, const QofInstance* inst)
+{
+    KvpFrame* frame = qof_instance_get_slots (inst);
+    if (!frame || frame->empty ())
+        return;
+
+    start_element (tag);
+    add_kvp_frame (frame);
+    end_element ();
+}
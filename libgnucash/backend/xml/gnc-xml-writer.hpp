@@ -0,0 +1,100 @@
+/********************************************************************\
+ * gnc-xml-writer.hpp -- Write XML without building a DOM first     *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @file gnc-xml-writer.hpp
+ *
+ * GncXmlWriter streams elements straight into a large output buffer. It
+ * produces exactly what xmlElemDump() produces for the DOM trees the
+ * *_to_dom_tree() generators in sixtp-dom-generators.h build, so the objects
+ * written most often can skip allocating and freeing a node for every field.
+ *
+ * Elements are written depth first: start_element(), optionally
+ * add_attribute(), the children and end_element(). Each element written at
+ * the top level is followed by a newline, like the callers of xmlElemDump()
+ * do.
+ */
+
+#ifndef GNC_XML_WRITER_HPP
+#define GNC_XML_WRITER_HPP
+
+extern "C"
+{
+#include <glib.h>
+#include <stdio.h>
+
+#include "gnc-commodity.h"
+#include "qof.h"
+}
+
+#include <string>
+
+class GncXmlWriter
+{
+public:
+    explicit GncXmlWriter (FILE* out);
+    /** Writes out what's still buffered. */
+    ~GncXmlWriter ();
+    GncXmlWriter (const GncXmlWriter&) = delete;
+    GncXmlWriter& operator= (const GncXmlWriter&) = delete;
+
+    void start_element (const char* tag);
+    /** Must directly follow start_element(). The value is written as is. */
+    void add_attribute (const char* name, const char* value);
+    void end_element ();
+
+    /** Like xmlNewTextChild(): an empty text makes <tag></tag>, a NULL one
+     *  <tag/>. If type isn't NULL it's written as the type attribute. */
+    void add_text (const char* tag, const char* text, const char* type = NULL);
+    /** The elements of guid_to_dom_tree(), gnc_numeric_to_dom_tree(),
+     *  time64_to_dom_tree(), gdate_to_dom_tree() and
+     *  commodity_ref_to_dom_tree(). Nothing is written where those return
+     *  NULL. */
+    void add_guid (const char* tag, const GncGUID* guid);
+    void add_numeric (const char* tag, gnc_numeric num);
+    void add_time64 (const char* tag, time64 time, const char* type = NULL);
+    void add_gdate (const char* tag, const GDate* date, const char* type = NULL);
+    void add_commodity_ref (const char* tag, const gnc_commodity* c);
+    /** Like qof_instance_slots_to_dom_tree(). */
+    void add_slots (const char* tag, const QofInstance* inst);
+
+    /** Write out the buffer.
+     *  @return FALSE if writing failed, now or before. */
+    gboolean flush ();
+    gboolean ok () const { return m_ok; }
+
+private:
+    void close_start_tag ();
+    void indent ();
+    void element_done ();
+    void append_escaped (const char* text);
+    void append_int64 (gint64 val);
+    void add_kvp_value (const char* tag, KvpValue* val);
+    void add_kvp_frame (const KvpFrame* frame);
+
+    FILE* m_out;
+    std::string m_buf;
+    std::string m_tags;         // the open elements' tags, NUL separated
+    unsigned m_level = 0;
+    bool m_start_tag_open = false;
+    gboolean m_ok = TRUE;
+};
+
+#endif /* GNC_XML_WRITER_HPP */
@@ -36,6 +36,8 @@ extern "C"
 #include "gnc-xml-helper.h"
 #include "sixtp.h"
 
+class GncXmlWriter;
+
 xmlNodePtr gnc_account_dom_tree_create (Account* act, gboolean exporting,
                                         gboolean allow_incompat);
 sixtp* gnc_account_sixtp_parser_create (void);
@@ -54,6 +56,10 @@ xmlNodePtr gnc_lot_dom_tree_create (GNCLot*);
 sixtp* gnc_lot_sixtp_parser_create (void);
 
 xmlNodePtr gnc_pricedb_dom_tree_create (GNCPriceDB* db);
+/* Write what gnc_pricedb_dom_tree_create() creates without creating it,
+ * counting the prices in gd. */
+void gnc_pricedb_xml_write (GncXmlWriter& writer, GNCPriceDB* db,
+                            sixtp_gdv2* gd);
 sixtp* gnc_pricedb_sixtp_parser_create (void);
 
 xmlNodePtr gnc_schedXaction_dom_tree_create (SchedXaction* sx);
@@ -63,7 +69,13 @@ xmlNodePtr gnc_budget_dom_tree_create (GncBudget* bgt);
 sixtp* gnc_budget_sixtp_parser_create (void);
 
 xmlNodePtr gnc_transaction_dom_tree_create (Transaction* txn);
+/* Write what gnc_transaction_dom_tree_create() creates without creating it. */
+void gnc_transaction_xml_write (GncXmlWriter& writer, Transaction* txn);
 sixtp* gnc_transaction_sixtp_parser_create (void);
+/* Like gnc_transaction_sixtp_parser_create(), but parses the transactions
+ * straight from the SAX events and hands them to the sixtp_gdv2's txn_loader
+ * if there is one. */
+sixtp* gnc_transaction_sixtp_pipelined_parser_create (void);
 
 sixtp* gnc_template_transaction_sixtp_parser_create (void);
 
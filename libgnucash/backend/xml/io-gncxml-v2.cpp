@@ -74,6 +74,11 @@ extern "C"
 #include "sixtp-dom-parsers.h"
 #include "io-gncxml-v2.h"
 #include "io-gncxml-gen.h"
+#include "gnc-transaction-loader.hpp"
+#include "gnc-xml-writer.hpp"
+
+#include <deque>
+#include <vector>
 
 /* Do not treat -Wstrict-aliasing warnings as errors because of problems of the
  * G_LOCK* macros as declared by glib.  See
@@ -106,6 +111,7 @@ struct file_backend
     const char*     tag;
     sixtp*          parser;
     FILE*           out;
+    GncXmlWriter*   writer;
     QofBook*        book;
 };
 
@@ -376,6 +382,16 @@ counter (const GncXmlDataType_t& data, file_backend* be_data)
     /* XXX: should we do anything with this counter? */
 }
 
+/* Let the book's collection of type make room for the count entities the
+ * file announces, so that it doesn't grow over and over while loading. */
+static void
+reserve_entities (QofBook* book, QofIdTypeConst type, gint64 count)
+{
+    if (book == NULL || count <= 0 || count > G_MAXUINT)
+        return;
+    qof_collection_reserve (qof_book_get_collection (book, type), count);
+}
+
 static gboolean
 gnc_counter_end_handler (gpointer data_for_children,
                          GSList* data_from_children, GSList* sibling_data,
@@ -415,10 +431,14 @@ gnc_counter_end_handler (gpointer data_for_children,
     else if (g_strcmp0 (type, "transaction") == 0)
     {
         sixdata->counter.transactions_total = val;
+        reserve_entities (sixdata->book, GNC_ID_TRANS, val);
+        /* Most transactions have just two splits. */
+        reserve_entities (sixdata->book, GNC_ID_SPLIT, 2 * val);
     }
     else if (g_strcmp0 (type, "account") == 0)
     {
         sixdata->counter.accounts_total = val;
+        reserve_entities (sixdata->book, GNC_ID_ACCOUNT, val);
     }
     else if (g_strcmp0 (type, "book") == 0)
     {
@@ -691,6 +711,26 @@ gnc_sixtp_gdv2_new (
     return gd;
 }
 
+/* Transactions handed to the loader have to be in the book before anything
+ * following them gets parsed, it may refer to them. */
+static gboolean
+flush_transactions_before_child (gpointer data_for_children,
+                                 GSList* data_from_children,
+                                 GSList* sibling_data,
+                                 gpointer parent_data,
+                                 gpointer global_data,
+                                 gpointer* result,
+                                 const gchar* tag,
+                                 const gchar* child_tag)
+{
+    gxpf_data* gdata = (gxpf_data*)global_data;
+    sixtp_gdv2* gd = (sixtp_gdv2*)gdata->parsedata;
+
+    if (!gd->txn_loader || g_strcmp0 (child_tag, TRANSACTION_TAG) == 0)
+        return TRUE;
+    return gd->txn_loader->flush ();
+}
+
 static gboolean
 qof_session_load_from_xml_file_v2_full (
     GncXmlBackend* xml_be, QofBook* book,
@@ -738,7 +778,7 @@ qof_session_load_from_xml_file_v2_full (
             PRICEDB_TAG, gnc_pricedb_sixtp_parser_create (),
             COMMODITY_TAG, gnc_commodity_sixtp_parser_create (),
             ACCOUNT_TAG, gnc_account_sixtp_parser_create (),
-            TRANSACTION_TAG, gnc_transaction_sixtp_parser_create (),
+            TRANSACTION_TAG, gnc_transaction_sixtp_pipelined_parser_create (),
             SCHEDXACTION_TAG, gnc_schedXaction_sixtp_parser_create (),
             TEMPLATE_TRANSACTION_TAG, gnc_template_transaction_sixtp_parser_create (),
             NULL, NULL))
@@ -755,7 +795,7 @@ qof_session_load_from_xml_file_v2_full (
             COMMODITY_TAG, gnc_commodity_sixtp_parser_create (),
             ACCOUNT_TAG, gnc_account_sixtp_parser_create (),
             BUDGET_TAG, gnc_budget_sixtp_parser_create (),
-            TRANSACTION_TAG, gnc_transaction_sixtp_parser_create (),
+            TRANSACTION_TAG, gnc_transaction_sixtp_pipelined_parser_create (),
             SCHEDXACTION_TAG, gnc_schedXaction_sixtp_parser_create (),
             TEMPLATE_TRANSACTION_TAG, gnc_template_transaction_sixtp_parser_create (),
             NULL, NULL))
@@ -770,6 +810,10 @@ qof_session_load_from_xml_file_v2_full (
     if (be_data.ok == FALSE)
         goto bail;
 
+    sixtp_set_before_child (main_parser, flush_transactions_before_child);
+    sixtp_set_before_child (book_parser, flush_transactions_before_child);
+    gd->txn_loader = new GncTransactionLoader (book, generic_callback, gd);
+
     /* stop logging while we load */
     xaccLogDisable ();
     xaccDisableDataScrubbing ();
@@ -813,6 +857,9 @@ qof_session_load_from_xml_file_v2_full (
         }
     }
 
+    /* Load the transactions still queued at the end of the file. */
+    retval &= gd->txn_loader->flush ();
+
     if (!retval)
     {
         sixtp_destroy (top_parser);
@@ -824,6 +871,7 @@ qof_session_load_from_xml_file_v2_full (
 
     /* destroy the parser */
     sixtp_destroy (top_parser);
+    delete gd->txn_loader;
     g_free (gd);
 
     xaccEnableDataScrubbing ();
@@ -860,6 +908,8 @@ qof_session_load_from_xml_file_v2_full (
     return TRUE;
 
 bail:
+    if (gd)
+        delete gd->txn_loader;
     g_free (gd);
     return FALSE;
 }
@@ -1118,71 +1168,19 @@ write_commodities (FILE* out, QofBook* book, sixtp_gdv2* gd)
 static gboolean
 write_pricedb (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
-    xmlNodePtr node;
-    xmlNodePtr parent;
-    xmlOutputBufferPtr outbuf;
-
-    parent = gnc_pricedb_dom_tree_create (gnc_pricedb_get_db (book));
+    GncXmlWriter writer {out};
 
-    if (!parent)
-    {
-        return TRUE;
-    }
-
-    /* Write out the parent pricedb tag then loop to write out each price.
-       We do it this way instead of just calling xmlElemDump so that we can
-       increment the progress bar as we go. */
-
-    if (fprintf (out, "<%s version=\"%s\">\n", parent->name,
-                 xmlGetProp (parent, BAD_CAST "version")) < 0)
-        return FALSE;
-
-    /* We create our own output buffer so we can call xmlNodeDumpOutput to get
-       the indentation correct. */
-    outbuf = xmlOutputBufferCreateFile (out, NULL);
-    if (outbuf == NULL)
-    {
-        xmlFreeNode (parent);
-        return FALSE;
-    }
-
-    for (node = parent->children; node; node = node->next)
-    {
-        /* Write two spaces since xmlNodeDumpOutput doesn't indent the first line */
-        xmlOutputBufferWrite (outbuf, 2, "  ");
-        xmlNodeDumpOutput (outbuf, NULL, node, 1, 1, NULL);
-        /* It also doesn't terminate the last line */
-        xmlOutputBufferWrite (outbuf, 1, "\n");
-        if (ferror (out))
-            break;
-        gd->counter.prices_loaded += 1;
-        sixtp_run_callback (gd, "prices");
-    }
-
-    xmlOutputBufferClose (outbuf);
-
-    if (ferror (out) || fprintf (out, "</%s>\n", parent->name) < 0)
-    {
-        xmlFreeNode (parent);
-        return FALSE;
-    }
-
-    xmlFreeNode (parent);
-    return TRUE;
+    gnc_pricedb_xml_write (writer, gnc_pricedb_get_db (book), gd);
+    return writer.flush ();
 }
 
 static int
 xml_add_trn_data (Transaction* t, gpointer data)
 {
     struct file_backend* be_data = static_cast<decltype (be_data)> (data);
-    xmlNodePtr node;
 
-    node = gnc_transaction_dom_tree_create (t);
-
-    xmlElemDump (be_data->out, NULL, node);
-    xmlFreeNode (node);
-
-    if (ferror (be_data->out) || fprintf (be_data->out, "\n") < 0)
+    gnc_transaction_xml_write (*be_data->writer, t);
+    if (!be_data->writer->ok ())
         return -1;
 
     be_data->gd->counter.transactions_loaded++;
@@ -1194,13 +1192,16 @@ static gboolean
 write_transactions (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     struct file_backend be_data;
+    GncXmlWriter writer {out};
 
     be_data.out = out;
+    be_data.writer = &writer;
     be_data.gd = gd;
     return 0 ==
            xaccAccountTreeForEachTransaction (gnc_book_get_root_account (book),
                                               xml_add_trn_data,
-                                              (gpointer) &be_data);
+                                              (gpointer) &be_data)
+           && writer.flush ();
 }
 
 static gboolean
@@ -1208,8 +1209,10 @@ write_template_transaction_data (FILE* out, QofBook* book, sixtp_gdv2* gd)
 {
     Account* ra;
     struct file_backend be_data;
+    GncXmlWriter writer {out};
 
     be_data.out = out;
+    be_data.writer = &writer;
     be_data.gd = gd;
 
     ra = gnc_book_get_template_root (book);
@@ -1218,6 +1221,7 @@ write_template_transaction_data (FILE* out, QofBook* book, sixtp_gdv2* gd)
         if (fprintf (out, "<%s>\n", TEMPLATE_TRANSACTION_TAG) < 0
             || !write_account_tree (out, ra, gd)
             || xaccAccountTreeForEachTransaction (ra, xml_add_trn_data, (gpointer)&be_data)
+            || !writer.flush ()
             || fprintf (out, "</%s>\n", TEMPLATE_TRANSACTION_TAG) < 0)
 
             return FALSE;
@@ -1401,19 +1405,241 @@ gnc_book_write_accounts_to_xml_filehandle_v2 (QofBackend* qof_be, QofBook* book,
     return success;
 }
 
-#define BUFLEN 4096
+/* Compression cuts the save stream into blocks of GZ_BLOCK_SIZE bytes and
+ * deflates them in parallel, each using the last GZ_DICT_SIZE bytes of the
+ * previous one as dictionary the way pigz does. Decompression reads in
+ * chunks of the same size. */
+#define GZ_BLOCK_SIZE (128 * 1024)
+#define GZ_DICT_SIZE (32 * 1024)
+
+typedef struct
+{
+    std::vector<Bytef> in;
+    std::vector<Bytef> dict;
+    std::vector<Bytef> out;
+    uLong crc;
+    gboolean last;
+    gboolean ok;
+    gboolean done;
+} gz_block_t;
+
+typedef struct
+{
+    GMutex mutex;
+    GCond cond;
+} gz_sync_t;
+
+/* Deflate a block into a raw deflate stream ending on a byte boundary, so
+ * that the compressed blocks can simply be concatenated. Only the last one
+ * is marked final. sync is NULL if no other threads are involved. */
+static void
+gz_deflate_block (gpointer data, gpointer user_data)
+{
+    gz_block_t* block = static_cast<gz_block_t*> (data);
+    gz_sync_t* sync = static_cast<gz_sync_t*> (user_data);
+    z_stream strm;
+    gint flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+    gint ret;
+    gsize have = 0;
+
+    memset (&strm, 0, sizeof (strm));
+    block->ok = deflateInit2 (&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                              -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    if (block->ok)
+    {
+        if (!block->dict.empty ())
+            deflateSetDictionary (&strm, block->dict.data (),
+                                  block->dict.size ());
+
+        strm.next_in = block->in.data ();
+        strm.avail_in = block->in.size ();
+        block->out.resize (deflateBound (&strm, block->in.size ()) + 16);
+        do
+        {
+            if (have == block->out.size ())
+                block->out.resize (2 * have);
+            strm.next_out = block->out.data () + have;
+            strm.avail_out = block->out.size () - have;
+            ret = deflate (&strm, flush);
+            have = block->out.size () - strm.avail_out;
+        }
+        while (ret == Z_OK && strm.avail_out == 0);
+
+        block->ok = block->last ? ret == Z_STREAM_END : ret == Z_OK;
+        block->out.resize (have);
+        deflateEnd (&strm);
+    }
+    block->crc = crc32 (crc32 (0L, Z_NULL, 0), block->in.data (),
+                        block->in.size ());
+
+    if (!sync)
+    {
+        block->done = TRUE;
+        return;
+    }
+    g_mutex_lock (&sync->mutex);
+    block->done = TRUE;
+    g_cond_broadcast (&sync->cond);
+    g_mutex_unlock (&sync->mutex);
+}
+
+/* Fill buffer from fd unless the stream ends first.
+ * Returns the number of bytes read or -1 on error. */
+static gssize
+gz_read_block (gint fd, Bytef* buffer, gsize size)
+{
+    gsize have = 0;
+
+    while (have < size)
+    {
+        gssize bytes = read (fd, buffer + have, size - have);
+        if (bytes == 0)
+            break;
+        if (bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        have += bytes;
+    }
+    return have;
+}
+
+static gboolean
+gz_write_le32 (FILE* out, uLong value)
+{
+    Bytef bytes[4];
+    for (gint i = 0; i < 4; ++i)
+        bytes[i] = (value >> (8 * i)) & 0xff;
+    return fwrite (bytes, 1, 4, out) == 4;
+}
+
+/* Write what comes through fd to filename as a single gzip member, deflating
+ * blocks of it on all processors. */
+static gboolean
+gz_compress_parallel (gint fd, const gchar* filename)
+{
+    static const Bytef gz_header[] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0,
+                                       0, 3 /* OS_CODE for Unix */ };
+    std::deque<gz_block_t*> pending;
+    std::vector<Bytef> dict;
+    gz_sync_t sync;
+    GThreadPool* pool = NULL;
+    guint workers = g_get_num_processors ();
+    uLong crc = crc32 (0L, Z_NULL, 0);
+    uLong total = 0;
+    gboolean eof = FALSE;
+    gboolean success = TRUE;
+    FILE* out = g_fopen (filename, "wb");
+
+    if (out == NULL)
+    {
+        g_warning ("Could not open the compressed file '%s'. The error is '%s' (errno %d)",
+                   filename, g_strerror (errno) ? g_strerror (errno) : "", errno);
+        return FALSE;
+    }
+    if (fwrite (gz_header, 1, sizeof (gz_header), out) != sizeof (gz_header))
+        success = FALSE;
+
+    g_mutex_init (&sync.mutex);
+    g_cond_init (&sync.cond);
+    if (workers > 1)
+        pool = g_thread_pool_new (gz_deflate_block, &sync, workers, TRUE, NULL);
+
+    while (!eof || !pending.empty ())
+    {
+        gz_block_t* block;
+
+        /* Keep every worker busy and one block in reserve. */
+        if (!eof && pending.size () <= 2 * workers)
+        {
+            gssize bytes;
+
+            block = new gz_block_t ();
+            block->in.resize (GZ_BLOCK_SIZE);
+            bytes = gz_read_block (fd, block->in.data (), GZ_BLOCK_SIZE);
+            if (bytes < 0)
+            {
+                g_warning ("Could not read from pipe. The error is '%s' (errno %d)",
+                           g_strerror (errno) ? g_strerror (errno) : "", errno);
+                success = FALSE;
+                bytes = 0;
+            }
+            block->in.resize (bytes);
+            eof = bytes < GZ_BLOCK_SIZE;
+            block->last = eof;
+            block->dict.swap (dict);
+            if (!eof)
+                dict.assign (block->in.end () - GZ_DICT_SIZE, block->in.end ());
+
+            pending.push_back (block);
+            if (pool)
+                g_thread_pool_push (pool, block, NULL);
+            else
+                gz_deflate_block (block, NULL);
+            continue;
+        }
+
+        block = pending.front ();
+        pending.pop_front ();
+        g_mutex_lock (&sync.mutex);
+        while (!block->done)
+            g_cond_wait (&sync.cond, &sync.mutex);
+        g_mutex_unlock (&sync.mutex);
+
+        if (success && block->ok
+            && fwrite (block->out.data (), 1, block->out.size (), out)
+               == block->out.size ())
+        {
+            crc = crc32_combine (crc, block->crc, block->in.size ());
+            total += block->in.size ();
+        }
+        else if (success)
+        {
+            g_warning ("Could not write the compressed file '%s'.", filename);
+            success = FALSE;
+        }
+        delete block;
+    }
+
+    if (pool)
+        g_thread_pool_free (pool, FALSE, TRUE);
+    g_cond_clear (&sync.cond);
+    g_mutex_clear (&sync.mutex);
+
+    /* The trailer holds the size modulo 2^32. */
+    if (success && !(gz_write_le32 (out, crc)
+                     && gz_write_le32 (out, total & 0xffffffffUL)))
+    {
+        g_warning ("Could not write the compressed file '%s'.", filename);
+        success = FALSE;
+    }
+    if (fclose (out) != 0)
+    {
+        g_warning ("Could not close the compressed file '%s'.", filename);
+        success = FALSE;
+    }
+
+    return success;
+}
 
 /* Compress or decompress function that is to be run in a separate thread.
  * Returns 1 on success or 0 otherwise, stuffed into a pointer type. */
 static gpointer
 gz_thread_func (gz_thread_params_t* params)
 {
-    gchar buffer[BUFLEN];
-    gssize bytes;
+    gchar* buffer = NULL;
     gint gzval;
     gzFile file;
     gint success = 1;
 
+    if (params->compress)
+    {
+        success = gz_compress_parallel (params->fd, params->filename);
+        goto cleanup_gz_thread_func;
+    }
+
 #ifdef G_OS_WIN32
     {
         gchar* conv_name = g_win32_locale_filename_from_utf8 (params->filename);
@@ -1447,67 +1673,38 @@ gz_thread_func (gz_thread_params_t* params)
         goto cleanup_gz_thread_func;
     }
 
-    if (params->compress)
+    gzbuffer (file, GZ_BLOCK_SIZE);
+    buffer = static_cast<gchar*> (g_malloc (GZ_BLOCK_SIZE));
+    while (success)
     {
-        while (success)
+        gzval = gzread (file, buffer, GZ_BLOCK_SIZE);
+        if (gzval > 0)
         {
-            bytes = read (params->fd, buffer, BUFLEN);
-            if (bytes > 0)
-            {
-                if (gzwrite (file, buffer, bytes) <= 0)
-                {
-                    gint errnum;
-                    const gchar* error = gzerror (file, &errnum);
-                    g_warning ("Could not write the compressed file '%s'. The error is: '%s' (%d)",
-                               params->filename, error, errnum);
-                    success = 0;
-                }
-            }
-            else if (bytes == 0)
-            {
-                break;
-            }
-            else
-            {
-                g_warning ("Could not read from pipe. The error is '%s' (errno %d)",
-                           g_strerror (errno) ? g_strerror (errno) : "", errno);
-                success = 0;
-            }
-        }
-    }
-    else
-    {
-        while (success)
-        {
-            gzval = gzread (file, buffer, BUFLEN);
-            if (gzval > 0)
-            {
-                if (
+            if (
 #if COMPILER(MSVC)
-                    _write
+                _write
 #else
-                    write
+                write
 #endif
-                    (params->fd, buffer, gzval) < 0)
-                {
-                    g_warning ("Could not write to pipe. The error is '%s' (%d)",
-                               g_strerror (errno) ? g_strerror (errno) : "", errno);
-                    success = 0;
-                }
-            }
-            else if (gzval == 0)
+                (params->fd, buffer, gzval) < 0)
             {
-                break;
-            }
-            else
-            {
-                gint errnum;
-                const gchar* error = gzerror (file, &errnum);
-                g_warning ("Could not read from compressed file '%s'. The error is: '%s' (%d)",
-                           params->filename, error, errnum);
+                g_warning ("Could not write to pipe. The error is '%s' (%d)",
+                           g_strerror (errno) ? g_strerror (errno) : "", errno);
                 success = 0;
             }
         }
+        else if (gzval == 0)
+        {
+            break;
+        }
+        else
+        {
+            gint errnum;
+            const gchar* error = gzerror (file, &errnum);
+            g_warning ("Could not read from compressed file '%s'. The error is: '%s' (%d)",
+                       params->filename, error, errnum);
+            success = 0;
+        }
     }
 
     if ((gzval = gzclose (file)) != Z_OK)
@@ -1519,6 +1716,7 @@ gz_thread_func (gz_thread_params_t* params)
 
 cleanup_gz_thread_func:
     close (params->fd);
+    g_free (buffer);
     g_free (params->filename);
     g_free (params->perms);
     g_free (params);
@@ -1577,6 +1775,10 @@ try_gz_open (const char* filename, const char* perms, gboolean use_gzip,
             file = fdopen (filedes[1], "w");
         else
             file = fdopen (filedes[0], "r");
+        /* Move the data through the pipe in chunks as large as the
+         * compression thread's. */
+        if (file)
+            setvbuf (file, NULL, _IOFBF, GZ_BLOCK_SIZE);
 
         G_LOCK (threads);
         if (!threads)
@@ -144,6 +144,12 @@ sixtp_set_chars_fail (sixtp* parser, sixtp_result_handler handler)
     parser->chars_fail_handler = handler;
 }
 
+void
+sixtp_set_stream (sixtp* parser, gboolean stream)
+{
+    parser->stream = stream;
+}
+
 sixtp*
 sixtp_new (void)
 {
@@ -399,6 +405,15 @@ sixtp_sax_start_handler (void* user_data,
     current_frame = (sixtp_stack_frame*) pdata->stack->data;
     current_parser = current_frame->parser;
 
+    if (current_parser->stream)
+    {
+        auto stream = static_cast<SixtpStream*> (current_frame->data_for_children);
+        pdata->stream_depth++;
+        if (stream)
+            stream->start_element ((gchar*) name, (const gchar**) attrs);
+        return;
+    }
+
     /* Use an extended lookup so we can get *our* copy of the key.
        Since we've strduped it, we know its lifetime... */
     lookup_success =
@@ -477,6 +492,14 @@ sixtp_sax_characters_handler (void* user_data, const xmlChar* text, int len)
     sixtp_stack_frame* frame;
 
     frame = (sixtp_stack_frame*) pdata->stack->data;
+    if (frame->parser->stream)
+    {
+        auto stream = static_cast<SixtpStream*> (frame->data_for_children);
+        if (stream)
+            stream->characters ((gchar*) text, len);
+        return;
+    }
+
     if (frame->parser->characters_handler)
     {
         gpointer result = NULL;
@@ -515,6 +538,16 @@ sixtp_sax_end_handler (void* user_data, const xmlChar* name)
     gchar* end_tag = NULL;
 
     current_frame = (sixtp_stack_frame*) pdata->stack->data;
+
+    if (current_frame->parser->stream && pdata->stream_depth > 0)
+    {
+        auto stream = static_cast<SixtpStream*> (current_frame->data_for_children);
+        pdata->stream_depth--;
+        if (stream)
+            stream->end_element ((gchar*) name);
+        return;
+    }
+
     parent_frame = (sixtp_stack_frame*) pdata->stack->next->data;
 
     /* time to make sure we got the right closing tag.  Is this really
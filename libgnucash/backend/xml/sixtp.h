@@ -35,6 +35,7 @@ extern "C"
 #include "gnc-backend-xml.h"
 
 typedef struct sixtp_gdv2 sixtp_gdv2;
+class GncTransactionLoader;
 typedef void (*countCallbackFn) (sixtp_gdv2* gd, const char* type);
 
 typedef struct
@@ -68,6 +69,7 @@ struct sixtp_gdv2
     countCallbackFn countCallback;
     QofBePercentageFunc gui_display_fn;
     gboolean exporting;
+    GncTransactionLoader* txn_loader;
 };
 typedef struct _sixtp_child_result sixtp_child_result;
 
@@ -126,6 +128,21 @@ typedef void (*sixtp_fail_handler) (gpointer data_for_children,
 typedef void (*sixtp_push_handler) (xmlParserCtxtPtr xml_context,
                                     gpointer user_data);
 
+/* A parser set up with sixtp_set_stream() handles all of its element's
+   descendants itself: its start handler has to put a SixtpStream into
+   *data_for_children, which then gets their start tags, text and end tags
+   instead of having a stack frame and a parser of their own set up for
+   each of them.  The parser's end handler is called as usual at the
+   element's own end tag. */
+class SixtpStream
+{
+public:
+    virtual ~SixtpStream () = default;
+    virtual void start_element (const gchar* tag, const gchar** attrs) = 0;
+    virtual void characters (const gchar* text, int len) = 0;
+    virtual void end_element (const gchar* tag) = 0;
+};
+
 typedef struct sixtp
 {
     /* If you change this, don't forget to modify all the copy/etc. functions */
@@ -149,6 +166,8 @@ typedef struct sixtp
        children. */
 
     GHashTable* child_parsers;
+
+    gboolean stream; /* see SixtpStream */
 } sixtp;
 
 typedef enum
@@ -197,6 +216,8 @@ typedef struct sixtp_sax_data
     gpointer global_data;
     xmlParserCtxtPtr saxParserCtxt;
     sixtp* bad_xml_parser;
+    /* How many of the current stream's descendants are open. */
+    int stream_depth;
 } sixtp_sax_data;
 
 gboolean is_child_result_from_node_named (sixtp_child_result* cr,
@@ -242,6 +263,7 @@ void sixtp_set_cleanup_chars (sixtp* parser, sixtp_result_handler handler);
 void sixtp_set_fail (sixtp* parser, sixtp_fail_handler handler);
 void sixtp_set_result_fail (sixtp* parser, sixtp_result_handler handler);
 void sixtp_set_chars_fail (sixtp* parser, sixtp_result_handler handler);
+void sixtp_set_stream (sixtp* parser, gboolean stream);
 
 sixtp* sixtp_set_any (sixtp* tochange, gboolean cleanup, ...);
 sixtp* sixtp_add_some_sub_parsers (sixtp* tochange, gboolean cleanup, ...);
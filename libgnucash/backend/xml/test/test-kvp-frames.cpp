@@ -5,6 +5,7 @@ extern "C"
 #include <config.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "test-stuff.h"
 #include "test-engine-stuff.h"
@@ -15,6 +16,9 @@ extern "C"
 #include "test-file-stuff.h"
 #include "sixtp-dom-generators.h"
 #include "sixtp-dom-parsers.h"
+#include "gnc-xml-stream.hpp"
+
+#include <vector>
 
 #define GNC_V2_STRING "gnc-v2"
 const gchar* gnc_v2_xml_version_string = GNC_V2_STRING;
@@ -137,6 +141,46 @@ test_kvp_printing (void)
     }
 }
 
+/* Hand node's descendants to stream the way the SAX parser would. */
+static void
+feed_children (SixtpStream& stream, xmlNodePtr node)
+{
+    for (auto child = node->children; child; child = child->next)
+    {
+        if (child->type == XML_TEXT_NODE)
+        {
+            auto text = reinterpret_cast<const gchar*> (child->content);
+            stream.characters (text, strlen (text));
+            continue;
+        }
+        if (child->type != XML_ELEMENT_NODE)
+            continue;
+
+        std::vector<const gchar*> attrs;
+        for (auto attr = child->properties; attr; attr = attr->next)
+        {
+            attrs.push_back (reinterpret_cast<const gchar*> (attr->name));
+            attrs.push_back (reinterpret_cast<const gchar*> (
+                                 attr->children->content));
+        }
+        attrs.push_back (nullptr);
+
+        auto tag = reinterpret_cast<const gchar*> (child->name);
+        stream.start_element (tag, attrs.data ());
+        feed_children (stream, child);
+        stream.end_element (tag);
+    }
+}
+
+static KvpFrame*
+stream_to_kvp_frame (xmlNodePtr node)
+{
+    GncSlotsStream stream;
+
+    feed_children (stream, node);
+    return stream.release_frame ();
+}
+
 static void
 test_kvp_xml_stuff (void)
 {
@@ -175,6 +219,11 @@ test_kvp_xml_stuff (void)
                 printf ("\n   and kvp_frame 2:\n%s\n",
                         test_frame2->to_string ().c_str ());
             }
+
+            auto test_frame3 = stream_to_kvp_frame (test_node);
+            do_test (compare (test_frame2, test_frame3) == 0,
+                     "GncSlotsStream matches dom_tree_to_kvp_frame");
+            delete test_frame3;
             delete test_frame2;
             xmlFreeNode (test_node);
         }
@@ -43,6 +43,7 @@ extern "C"
 #include "sixtp-parsers.h"
 #include "sixtp-dom-parsers.h"
 #include "io-gncxml-v2.h"
+#include "gnc-xml-writer.hpp"
 #include "test-file-stuff.h"
 #include "test-stuff.h"
 
@@ -63,6 +64,114 @@ test_add_pricedb (const char* tag, gpointer globaldata, gpointer data)
     return TRUE;
 }
 
+/* Parse the price DB in filename into parse_book, checking it with cb. */
+static void
+parse_db (const char* filename, QofBook* book, QofBook* parse_book,
+          gxpf_callback cb, const char* what)
+{
+    sixtp* parser;
+    load_counter lc = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    sixtp_gdv2 data = {book, lc, NULL, NULL, FALSE};
+
+    parser = sixtp_new ();
+
+    if (!sixtp_add_some_sub_parsers
+        (parser, TRUE,
+         "gnc:pricedb", gnc_pricedb_sixtp_parser_create (),
+         NULL, NULL))
+    {
+        failure_args ("sixtp_add_some_sub_parsers failed",
+                      __FILE__, __LINE__, "%s %d", what, iter);
+    }
+    else if (!gnc_xml_parse_file (parser, filename, cb, (gpointer)&data,
+                                  parse_book))
+    {
+        failure_args ("gnc_xml_parse_file returned FALSE",
+                      __FILE__, __LINE__, "%s %d", what, iter);
+    }
+}
+
+static gboolean
+price_found_in_book (GNCPrice* p, gpointer data)
+{
+    QofBook* book = static_cast<decltype (book)> (data);
+
+    return gnc_price_equal (p, gnc_price_lookup (gnc_price_get_guid (p),
+                                                 book));
+}
+
+static gboolean
+copy_commodity (gnc_commodity* com, gpointer data)
+{
+    QofBook* book = static_cast<decltype (book)> (data);
+
+    gnc_commodity_table_insert (gnc_commodity_table_get_table (book),
+                                gnc_commodity_new (book,
+                                                   gnc_commodity_get_fullname (com),
+                                                   gnc_commodity_get_namespace (com),
+                                                   gnc_commodity_get_mnemonic (com),
+                                                   gnc_commodity_get_cusip (com),
+                                                   gnc_commodity_get_fraction (com)));
+    return TRUE;
+}
+
+/* The prices are in another book, so compare them one by one. */
+static gboolean
+test_add_written_pricedb (const char* tag, gpointer globaldata, gpointer data)
+{
+    sixtp_gdv2* gdata = static_cast<decltype (gdata)> (globaldata);
+    GNCPriceDB* db1 = gnc_pricedb_get_db (gdata->book);
+    GNCPriceDB* db2 = static_cast<decltype (db2)> (data);
+
+    do_test_args (gnc_pricedb_get_num_prices (db1) ==
+                  gnc_pricedb_get_num_prices (db2) &&
+                  gnc_pricedb_foreach_price (db1, price_found_in_book,
+                                             qof_instance_get_book (db2),
+                                             FALSE),
+                  "gnc_pricedb_xml_write round trip",
+                  __FILE__, __LINE__, "%d", iter);
+
+    return TRUE;
+}
+
+/* Write db the way the book writer does, without a DOM, and read it back
+ * into a new book. */
+static void
+test_db_writer (GNCPriceDB* db)
+{
+    QofBook* book = qof_instance_get_book (QOF_INSTANCE (db));
+    load_counter lc = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    sixtp_gdv2 gd = {book, lc, NULL, NULL, FALSE};
+    gchar* filename = g_strdup ("test_file_XXXXXX");
+    int fd = g_mkstemp (filename);
+    FILE* out = fdopen (fd, "w");
+    QofBook* new_book;
+    gboolean ok;
+
+    {
+        GncXmlWriter writer (out);
+        gnc_pricedb_xml_write (writer, db, &gd);
+        ok = writer.flush ();
+    }
+    fclose (out);
+
+    do_test_args (ok, "gnc_pricedb_xml_write", __FILE__, __LINE__, "%d", iter);
+    do_test_args (gd.counter.prices_loaded ==
+                  (int) gnc_pricedb_get_num_prices (db),
+                  "gnc_pricedb_xml_write counts the prices",
+                  __FILE__, __LINE__, "%d", iter);
+
+    /* The reader only refers to the commodities the book already has. */
+    new_book = qof_book_new ();
+    gnc_commodity_table_foreach_commodity (gnc_commodity_table_get_table (book),
+                                           copy_commodity, new_book);
+    parse_db (filename, book, new_book, test_add_written_pricedb, "writer");
+    qof_book_destroy (new_book);
+
+    g_unlink (filename);
+    g_free (filename);
+}
+
 static void
 test_db (GNCPriceDB* db)
 {
@@ -91,29 +200,8 @@ test_db (GNCPriceDB* db)
 
     close (fd);
 
-    {
-        sixtp *parser;
-	load_counter lc = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-        sixtp_gdv2 data = {book, lc, NULL, NULL, FALSE};
-
-        parser = sixtp_new ();
-
-        if (!sixtp_add_some_sub_parsers
-            (parser, TRUE,
-             "gnc:pricedb", gnc_pricedb_sixtp_parser_create (),
-             NULL, NULL))
-        {
-            failure_args ("sixtp_add_some_sub_parsers failed",
-                          __FILE__, __LINE__, "%d", iter);
-        }
-        else if (!gnc_xml_parse_file (parser, filename1, test_add_pricedb,
-                                      (gpointer)&data,
-                                      qof_session_get_book (session)))
-        {
-            failure_args ("gnc_xml_parse_file returned FALSE",
-                          __FILE__, __LINE__, "%d", iter);
-        }
-    }
+    parse_db (filename1, book, qof_session_get_book (session),
+              test_add_pricedb, "DOM");
 
     g_unlink (filename1);
     g_free (filename1);
@@ -136,7 +224,10 @@ test_generation (void)
             return;
         }
         if (gnc_pricedb_get_num_prices (db))
+        {
             test_db (db);
+            test_db_writer (db);
+        }
 
         gnc_pricedb_destroy (db);
         qof_session_end (session);
@@ -51,8 +51,13 @@ extern "C"
 #include "../sixtp-parsers.h"
 #include "../sixtp-dom-parsers.h"
 #include "../io-gncxml-gen.h"
+#include "../gnc-xml-writer.hpp"
+#include "../gnc-transaction-loader.hpp"
 #include "test-file-stuff.h"
 #include <test-stuff.h>
+
+#include <string>
+
 static QofBook* book;
 
 extern gboolean gnc_transaction_xml_v2_testing;
@@ -345,6 +350,7 @@ struct tran_data_struct
     Transaction* new_trn;
     gnc_commodity* com;
     int value;
+    const char* parser;
 };
 typedef struct tran_data_struct tran_data;
 
@@ -360,7 +366,7 @@ test_add_transaction (const char* tag, gpointer globaldata, gpointer data)
     xaccTransCommitEdit (trans);
 
     if (!do_test_args (xaccTransEqual (gdata->trn, trans, TRUE, TRUE, TRUE, FALSE),
-                       "gnc_transaction_sixtp_parser_create",
+                       gdata->parser,
                        __FILE__, __LINE__,
                        "%d", gdata->value))
         retval = FALSE;
@@ -370,6 +376,87 @@ test_add_transaction (const char* tag, gpointer globaldata, gpointer data)
     return retval;
 }
 
+/* The stream parser's handlers want a sixtp_gdv2 as the parse data. */
+struct stream_tran_data
+{
+    sixtp_gdv2 gd;
+    tran_data* data;
+};
+
+static gboolean
+test_add_streamed_transaction (const char* tag, gpointer globaldata,
+                               gpointer data)
+{
+    auto sdata = static_cast<stream_tran_data*> (globaldata);
+
+    return test_add_transaction (tag, sdata->data, data);
+}
+
+/* Parse filename with the stream parser the book loader uses, handing the
+ * transactions to a GncTransactionLoader if pipelined. */
+static gboolean
+parse_streamed (const char* filename, tran_data* data, bool pipelined)
+{
+    stream_tran_data sdata{};
+    sixtp* parser = sixtp_new ();
+    gboolean ok;
+
+    sdata.gd.book = book;
+    sdata.data = data;
+    if (pipelined)
+        sdata.gd.txn_loader =
+            new GncTransactionLoader (book, test_add_streamed_transaction,
+                                      &sdata);
+
+    ok = sixtp_add_some_sub_parsers (
+             parser, TRUE,
+             "gnc:transaction", gnc_transaction_sixtp_pipelined_parser_create (),
+             NULL, NULL) &&
+         gnc_xml_parse_file (parser, filename, test_add_streamed_transaction,
+                             &sdata, book);
+    if (pipelined)
+    {
+        ok = sdata.gd.txn_loader->flush () && ok;
+        delete sdata.gd.txn_loader;
+    }
+    return ok;
+}
+
+/* The contents of a file written by write_func, which gets the FILE. */
+template <typename F> static std::string
+file_contents (F write_func)
+{
+    std::string contents;
+    char buf[4096];
+    std::size_t len;
+    FILE* file = tmpfile ();
+
+    write_func (file);
+    rewind (file);
+    while ((len = fread (buf, 1, sizeof (buf), file)) > 0)
+        contents.append (buf, len);
+    fclose (file);
+    return contents;
+}
+
+/* GncXmlWriter must write exactly what the DOM generators and xmlElemDump()
+ * do, including the newline io-gncxml-v2 puts after each object. */
+static gboolean
+writer_matches_dom (xmlNodePtr node, Transaction* trn)
+{
+    auto dom_text = file_contents ([node] (FILE * out)
+    {
+        xmlElemDump (out, NULL, node);
+        fputc ('\n', out);
+    });
+    auto writer_text = file_contents ([trn] (FILE * out)
+    {
+        GncXmlWriter writer (out);
+        gnc_transaction_xml_write (writer, trn);
+    });
+    return dom_text == writer_text;
+}
+
 static void
 test_transaction (void)
 {
@@ -441,6 +528,9 @@ test_transaction (void)
             success_args ("transaction_xml", __FILE__, __LINE__, "%d", i);
         }
 
+        do_test_args (writer_matches_dom (test_node, ran_trn),
+                      "transaction_xml_writer", __FILE__, __LINE__, "%d", i);
+
         filename1 = g_strdup_printf ("test_file_XXXXXX");
 
         fd = g_mkstemp (filename1);
@@ -481,6 +571,7 @@ test_transaction (void)
             data.trn = ran_trn;
             data.com = com;
             data.value = i;
+            data.parser = "gnc_transaction_sixtp_parser_create";
             parser = gnc_transaction_sixtp_parser_create ();
 
             if (!gnc_xml_parse_file (parser, filename1, test_add_transaction,
@@ -488,8 +579,36 @@ test_transaction (void)
             {
                 failure_args ("gnc_xml_parse_file returned FALSE",
                               __FILE__, __LINE__, "%d", i);
+                data.new_trn = NULL;
+            }
+
+            /* The stream parser must load what the DOM parser does, nested
+             * slots of the transaction and its splits included. */
+            for (auto pipelined : {false, true})
+            {
+                tran_data stream_data = data;
+
+                stream_data.parser = pipelined ?
+                                     "transaction stream parser, pipelined" :
+                                     "transaction stream parser";
+                stream_data.new_trn = NULL;
+                if (!parse_streamed (filename1, &stream_data, pipelined) ||
+                        !stream_data.new_trn)
+                {
+                    failure_args (stream_data.parser, __FILE__, __LINE__,
+                                  "%d", i);
+                    continue;
+                }
+                if (data.new_trn)
+                    do_test_args (xaccTransEqual (data.new_trn,
+                                                  stream_data.new_trn,
+                                                  TRUE, TRUE, TRUE, FALSE),
+                                  "stream and DOM parsers load the same",
+                                  __FILE__, __LINE__, "%d", i);
+                really_get_rid_of_transaction (stream_data.new_trn);
             }
-            else
+
+            if (data.new_trn)
                 really_get_rid_of_transaction (data.new_trn);
         }
         /* no handling of circular data structures.  We'll do that later */
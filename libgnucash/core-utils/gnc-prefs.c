@@ -34,6 +34,7 @@ static gboolean extras_enabled    = FALSE;
 static gboolean use_compression   = TRUE; // This is also the default in the prefs backend
 static gint file_retention_policy = 1;    // 1 = "days", the default in the prefs backend
 static gint file_retention_days   = 30;   // This is also the default in the prefs backend
+static gint sql_history_days      = 0;    // 0 = load all, the default in the prefs backend
 
 PrefsBackend *prefsbackend = NULL;
 
@@ -113,6 +114,18 @@ gnc_prefs_set_file_retention_days(gint days)
     file_retention_days = days;
 }
 
+gint
+gnc_prefs_get_sql_history_days(void)
+{
+    return sql_history_days;
+}
+
+void
+gnc_prefs_set_sql_history_days(gint days)
+{
+    sql_history_days = days;
+}
+
 guint
 gnc_prefs_get_long_version()
 {
@@ -115,6 +115,9 @@ void gnc_prefs_set_file_retention_policy(gint policy);
 gint gnc_prefs_get_file_retention_days(void);
 void gnc_prefs_set_file_retention_days(gint days);
 
+gint gnc_prefs_get_sql_history_days(void);
+void gnc_prefs_set_sql_history_days(gint days);
+
 guint gnc_prefs_get_long_version( void );
 
 /** @} */
@@ -42,8 +42,13 @@
 #include "qofinstance-p.h"
 #include "gnc-features.h"
 #include "guid.hpp"
+#include "gnc-split-index.hpp"
 
+#include <algorithm>
+#include <map>
 #include <numeric>
+#include <unordered_map>
+#include <vector>
 
 static QofLogModule log_module = GNC_MOD_ACCOUNT;
 
@@ -67,6 +72,8 @@ using FinalProbabilityVec=std::vector<std::pair<std::string, int32_t>>;
 using ProbabilityVec=std::vector<std::pair<std::string, struct AccountProbability>>;
 using FlatKvpEntry=std::pair<std::string, KvpValue*>;
 
+static void drop_imap_bayes_index (AccountPrivate *priv);
+
 enum
 {
     LAST_SIGNAL
@@ -288,6 +295,7 @@ gnc_account_init(Account* acc)
 
     priv->splits = NULL;
     priv->sort_dirty = FALSE;
+    priv->split_index = new GncSplitIndex;
 }
 
 static void
@@ -299,6 +307,11 @@ gnc_account_dispose (GObject *acctp)
 static void
 gnc_account_finalize(GObject* acctp)
 {
+    AccountPrivate *priv = GET_PRIVATE(acctp);
+
+    delete priv->split_index;
+    priv->split_index = nullptr;
+    drop_imap_bayes_index (priv);
     G_OBJECT_CLASS(gnc_account_parent_class)->finalize(acctp);
 }
 
@@ -1340,6 +1353,8 @@ xaccAccountCommitEdit (Account *acc)
     /* If marked for deletion, get rid of subaccounts first,
      * and then the splits ... */
     priv = GET_PRIVATE(acc);
+    /* The import map may have been changed in any way. */
+    drop_imap_bayes_index (priv);
     if (qof_instance_get_destroying(acc))
     {
         GList *lp, *slist;
@@ -1369,6 +1384,7 @@ xaccAccountCommitEdit (Account *acc)
         }
         else
         {
+            priv->split_index->clear();
             g_list_free(priv->splits);
             priv->splits = NULL;
         }
@@ -1708,6 +1724,7 @@ gnc_account_set_sort_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->sort_dirty = TRUE;
+    priv->split_index->invalidate_order();
 }
 
 void
@@ -1722,6 +1739,56 @@ gnc_account_set_balance_dirty (Account *acc)
 
     priv = GET_PRIVATE(acc);
     priv->balance_dirty = TRUE;
+    priv->split_index->invalidate_balances();
+}
+
+void
+gnc_account_mark_split_dirty (Account *acc, Split *split)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(GNC_IS_SPLIT(split));
+
+    if (qof_instance_get_destroying(acc))
+        return;
+
+    /* A split that isn't in the index yet will be put into place when
+     * it's inserted, so there's nothing to remember about it. */
+    priv = GET_PRIVATE(acc);
+    priv->split_index->mark_split_dirty(split);
+    priv->sort_dirty = TRUE;
+    priv->balance_dirty = TRUE;
+}
+
+void
+gnc_account_update_split_balances (const Account *acc, const Split *split)
+{
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(split);
+
+    GET_PRIVATE(acc)->split_index->update_split_balances(split);
+}
+
+void
+gnc_account_foreach_split_posted_between (const Account *acc,
+                                          time64 start, time64 end,
+                                          GFunc cb,
+                                          gpointer user_data)
+{
+    AccountPrivate *priv;
+
+    g_return_if_fail(GNC_IS_ACCOUNT(acc));
+    g_return_if_fail(cb);
+
+    priv = GET_PRIVATE(acc);
+    if (priv->sort_dirty)
+    {
+        /* The index can't be searched until it's sorted again. */
+        g_list_foreach (priv->splits, cb, user_data);
+        return;
+    }
+    priv->split_index->foreach_posted_between(start, end, cb, user_data);
 }
 
 /********************************************************************\
@@ -1731,24 +1798,23 @@ gboolean
 gnc_account_insert_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (node)
+    if (priv->split_index->contains(s))
         return FALSE;
 
     if (qof_instance_get_editlevel(acc) == 0)
     {
-        priv->splits = g_list_insert_sorted(priv->splits, s,
-                                            (GCompareFunc)xaccSplitOrder);
+        priv->split_index->insert_sorted(priv->splits, s);
     }
     else
     {
-        priv->splits = g_list_prepend(priv->splits, s);
+        /* The split's sort keys may still change during the edit, so
+         * leave placing it to xaccAccountSortSplits(). */
+        priv->split_index->insert_unsorted(priv->splits, s);
         priv->sort_dirty = TRUE;
     }
 
@@ -1767,17 +1833,14 @@ gboolean
 gnc_account_remove_split (Account *acc, Split *s)
 {
     AccountPrivate *priv;
-    GList *node;
 
     g_return_val_if_fail(GNC_IS_ACCOUNT(acc), FALSE);
     g_return_val_if_fail(GNC_IS_SPLIT(s), FALSE);
 
     priv = GET_PRIVATE(acc);
-    node = g_list_find(priv->splits, s);
-    if (NULL == node)
+    if (!priv->split_index->remove(priv->splits, s))
         return FALSE;
 
-    priv->splits = g_list_delete_link(priv->splits, node);
     //FIXME: find better event type
     qof_event_gen(&acc->inst, QOF_EVENT_MODIFY, NULL);
     // And send the account-based event, too
@@ -1798,7 +1861,7 @@ xaccAccountSortSplits (Account *acc, gboolean force)
     priv = GET_PRIVATE(acc);
     if (!priv->sort_dirty || (!force && qof_instance_get_editlevel(acc) > 0))
         return;
-    priv->splits = g_list_sort(priv->splits, (GCompareFunc)xaccSplitOrder);
+    priv->split_index->sort(priv->splits);
     priv->sort_dirty = FALSE;
     priv->balance_dirty = TRUE;
 }
@@ -2069,10 +2132,7 @@ void
 xaccAccountRecomputeBalance (Account * acc)
 {
     AccountPrivate *priv;
-    gnc_numeric  balance;
-    gnc_numeric  cleared_balance;
-    gnc_numeric  reconciled_balance;
-    GList *lp;
+    SplitBalances start, end;
 
     if (NULL == acc) return;
 
@@ -2082,40 +2142,20 @@ xaccAccountRecomputeBalance (Account * acc)
     if (qof_instance_get_destroying(acc)) return;
     if (qof_book_shutting_down(qof_instance_get_book(acc))) return;
 
-    balance            = priv->starting_balance;
-    cleared_balance    = priv->starting_cleared_balance;
-    reconciled_balance = priv->starting_reconciled_balance;
+    start.balance    = priv->starting_balance;
+    start.cleared    = priv->starting_cleared_balance;
+    start.reconciled = priv->starting_reconciled_balance;
 
     PINFO ("acct=%s starting baln=%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT,
-           priv->accountName, balance.num, balance.denom);
-    for (lp = priv->splits; lp; lp = lp->next)
-    {
-        Split *split = (Split *) lp->data;
-        gnc_numeric amt = xaccSplitGetAmount (split);
-
-        balance = gnc_numeric_add_fixed(balance, amt);
-
-        if (NREC != split->reconciled)
-        {
-            cleared_balance = gnc_numeric_add_fixed(cleared_balance, amt);
-        }
-
-        if (YREC == split->reconciled ||
-                FREC == split->reconciled)
-        {
-            reconciled_balance =
-                gnc_numeric_add_fixed(reconciled_balance, amt);
-        }
-
-        split->balance = balance;
-        split->cleared_balance = cleared_balance;
-        split->reconciled_balance = reconciled_balance;
-
-    }
-
-    priv->balance = balance;
-    priv->cleared_balance = cleared_balance;
-    priv->reconciled_balance = reconciled_balance;
+           priv->accountName, start.balance.num, start.balance.denom);
+    /* Only the parts of the split index that changed are added up again;
+     * the splits' running balances are filled in when they're asked for,
+     * see gnc_account_update_split_balances(). */
+    priv->split_index->recompute_balances(start, end);
+
+    priv->balance = end.balance;
+    priv->cleared_balance = end.cleared;
+    priv->reconciled_balance = end.reconciled;
     priv->balance_dirty = FALSE;
 }
 
@@ -3287,59 +3327,56 @@ xaccAccountGetProjectedMinimumBalance (const Account *acc)
 /********************************************************************\
 \********************************************************************/
 
-gnc_numeric
-xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
+/* Have the backend load the splits of accounts posted from date on, if it
+ * only loaded the more recent ones, so that their starting balances are
+ * those before date. */
+static void
+load_history_since (const std::vector<Account*>& accounts, time64 date)
 {
-    /* Ideally this could use xaccAccountForEachSplit, but
-     * it doesn't exist yet and I'm uncertain of exactly how
-     * it would work at this time, since it differs from
-     * xaccAccountForEachTransaction by using gpointer return
-     * values rather than gints.
-     */
-    AccountPrivate *priv;
-    GList   *lp;
-    gboolean found = FALSE;
-    gnc_numeric balance;
+    if (accounts.empty ())
+        return;
+    auto book = gnc_account_get_book (accounts.front ());
+    auto be = qof_book_get_backend (book);
+    if (!be)
+        return;
 
-    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
+    GList *guids = NULL;
+    for (auto acc : accounts)
+        guids = g_list_prepend (guids, (gpointer)qof_entity_get_guid (acc));
+    qof_backend_load_history (be, book, guids, date);
+    g_list_free (guids);
+}
 
-    xaccAccountSortSplits (acc, TRUE); /* just in case, normally a noop */
-    xaccAccountRecomputeBalance (acc); /* just in case, normally a noop */
+/* The balance before date; the splits must be sorted, the balances up to
+ * date and the splits posted from date on loaded. */
+static gnc_numeric
+balance_as_of_date (const AccountPrivate *priv, time64 date)
+{
+    Split *split = priv->split_index->last_posted_before (date);
 
-    priv = GET_PRIVATE(acc);
-    balance = priv->balance;
+    /* If there were no splits posted after the given date, the latest
+     * account balance should be good enough.
+     */
+    if (split == priv->split_index->last ())
+        return priv->balance;
 
-    lp = priv->splits;
-    while ( lp && !found )
-    {
-        time64 trans_time = xaccTransRetDatePosted( xaccSplitGetParent( (Split *)lp->data ));
-        if ( trans_time >= date )
-            found = TRUE;
-        else
-            lp = lp->next;
-    }
+    /* Otherwise it's the running balance of the last split before the
+     * date, or what the account started with if the date is before any
+     * entries.
+     */
+    return split ? xaccSplitGetBalance (split) : priv->starting_balance;
+}
 
-    if ( lp )
-    {
-        if ( lp->prev )
-        {
-            /* Since lp is now pointing to a split which was past the reconcile
-             * date, get the running balance of the previous split.
-             */
-            balance = xaccSplitGetBalance( (Split *)lp->prev->data );
-        }
-        else
-        {
-            /* AsOf date must be before any entries, return zero. */
-            balance = gnc_numeric_zero();
-        }
-    }
+gnc_numeric
+xaccAccountGetBalanceAsOfDate (Account *acc, time64 date)
+{
+    g_return_val_if_fail(GNC_IS_ACCOUNT(acc), gnc_numeric_zero());
 
-    /* Otherwise there were no splits posted after the given date,
-     * so the latest account balance should be good enough.
-     */
+    load_history_since ({acc}, date);
+    xaccAccountSortSplits (acc, TRUE); /* just in case, normally a noop */
+    xaccAccountRecomputeBalance (acc); /* just in case, normally a noop */
 
-    return( balance );
+    return balance_as_of_date (GET_PRIVATE(acc), date);
 }
 
 /*
@@ -3361,6 +3398,13 @@ xaccAccountGetPresentBalance (const Account *acc)
 
     priv = GET_PRIVATE(acc);
     today = gnc_time64_get_today_end();
+    if (!priv->sort_dirty)
+    {
+        Split *split = priv->split_index->last_posted_by (today);
+        return split ? xaccSplitGetBalance (split) : priv->starting_balance;
+    }
+
+    /* The index can't be searched until it's sorted again. */
     for (node = g_list_last(priv->splits); node; node = node->prev)
     {
         Split *split = static_cast<Split*>(node->data);
@@ -3369,7 +3413,7 @@ xaccAccountGetPresentBalance (const Account *acc)
             return xaccSplitGetBalance (split);
     }
 
-    return gnc_numeric_zero ();
+    return priv->starting_balance;
 }
 
 
@@ -3681,6 +3725,130 @@ xaccAccountGetBalanceChangeForPeriod (Account *acc, time64 t1, time64 t2,
 }
 
 
+static void
+collect_descendant (Account *acc, gpointer data)
+{
+    static_cast<std::vector<Account*>*>(data)->push_back (acc);
+}
+
+gnc_numeric *
+xaccAccountGetBalancesAsOfDates (GList *accounts, const time64 *dates,
+                                 gsize n_dates,
+                                 gnc_commodity *report_commodity,
+                                 gboolean include_children)
+{
+    using AccountVec = std::vector<Account*>;
+    using BalanceVec = std::vector<gnc_numeric>;
+    using Conversion = std::pair<const gnc_commodity*, const gnc_commodity*>;
+    using ConvertedKey = std::pair<Account*, const gnc_commodity*>;
+
+    auto n_rows = g_list_length (accounts);
+    auto matrix = g_new (gnc_numeric, n_rows * n_dates);
+    std::fill_n (matrix, n_rows * n_dates, gnc_numeric_zero ());
+    if (!n_rows || !n_dates)
+        return matrix;
+    g_return_val_if_fail (dates, matrix);
+
+    /* The accounts adding up to each row and the commodity it's reported
+     * in; without a report commodity that's the row account's own. */
+    std::vector<AccountVec> row_accts (n_rows);
+    std::vector<const gnc_commodity*> row_comms (n_rows);
+    guint row = 0;
+    for (auto node = accounts; node; node = node->next, ++row)
+    {
+        auto acc = static_cast<Account*>(node->data);
+        g_return_val_if_fail (GNC_IS_ACCOUNT (acc), matrix);
+        row_accts[row].push_back (acc);
+        if (include_children)
+            gnc_account_foreach_descendant (acc, collect_descendant,
+                                            &row_accts[row]);
+        row_comms[row] = report_commodity ? report_commodity :
+            GET_PRIVATE(acc)->commodity;
+    }
+
+    /* Each account's own balances are looked up only once even if it's in
+     * several rows, with one binary search of its splits per date. */
+    AccountVec all_accts;
+    for (auto& accts : row_accts)
+        all_accts.insert (all_accts.end (), accts.begin (), accts.end ());
+    load_history_since (all_accts, *std::min_element (dates, dates + n_dates));
+    std::unordered_map<Account*, BalanceVec> own;
+    for (auto& accts : row_accts)
+        for (auto acc : accts)
+        {
+            if (own.count (acc))
+                continue;
+            xaccAccountSortSplits (acc, TRUE);
+            xaccAccountRecomputeBalance (acc);
+            auto priv = GET_PRIVATE(acc);
+            BalanceVec bals (n_dates);
+            for (gsize i = 0; i < n_dates; ++i)
+                bals[i] = balance_as_of_date (priv, dates[i]);
+            own.emplace (acc, std::move (bals));
+        }
+
+    /* Convert the balances of all accounts with the same commodity in one
+     * go, so the prices are looked up once per commodity. */
+    std::map<ConvertedKey, BalanceVec> converted;
+    std::map<Conversion, AccountVec> conversions;
+    for (row = 0; row < n_rows; ++row)
+    {
+        auto report = row_comms[row];
+        if (!report)
+            continue;
+        for (auto acc : row_accts[row])
+        {
+            if (!converted.emplace (ConvertedKey (acc, report), own[acc]).second)
+                continue;
+            auto comm = GET_PRIVATE(acc)->commodity;
+            if (!gnc_commodity_equiv (comm, report))
+                conversions[Conversion (comm, report)].push_back (acc);
+        }
+    }
+    auto book = gnc_account_get_book (static_cast<Account*>(accounts->data));
+    auto pdb = gnc_pricedb_get_db (book);
+    for (auto& conv : conversions)
+    {
+        BalanceVec bals;
+        bals.reserve (conv.second.size () * n_dates);
+        for (auto acc : conv.second)
+            bals.insert (bals.end (), own[acc].begin (), own[acc].end ());
+        gnc_pricedb_convert_balances_latest_price (pdb, bals.data (),
+                                                   bals.size (),
+                                                   conv.first.first,
+                                                   conv.first.second);
+        auto from = bals.begin ();
+        for (auto acc : conv.second)
+        {
+            auto& dest = converted[ConvertedKey (acc, conv.first.second)];
+            std::copy (from, from + n_dates, dest.begin ());
+            from += n_dates;
+        }
+    }
+
+    /* Add up the rows in the same order and with the same rounding as
+     * xaccAccountBalanceAsOfDateHelper. */
+    for (row = 0; row < n_rows; ++row)
+    {
+        auto report = row_comms[row];
+        if (!report)
+            continue;
+        auto cells = matrix + row * n_dates;
+        auto fraction = gnc_commodity_get_fraction (report);
+        auto acc = row_accts[row].begin ();
+        auto& first = converted[ConvertedKey (*acc, report)];
+        std::copy (first.begin (), first.end (), cells);
+        for (++acc; acc != row_accts[row].end (); ++acc)
+        {
+            auto& bals = converted[ConvertedKey (*acc, report)];
+            for (gsize i = 0; i < n_dates; ++i)
+                cells[i] = gnc_numeric_add (cells[i], bals[i], fraction,
+                                            GNC_HOW_RND_ROUND_HALF_UP);
+        }
+    }
+    return matrix;
+}
+
 /********************************************************************\
 \********************************************************************/
 
@@ -5147,21 +5315,6 @@ struct AccountProbability
     double product_difference; /* product of (1-probabilities) */
 };
 
-struct AccountTokenCount
-{
-    std::string account_guid;
-    int64_t token_count; /** occurrences of a given token for this account_guid */
-};
-
-/** total_count and the token_count for a given account let us calculate the
- * probability of a given account with any single token
- */
-struct TokenAccountsInfo
-{
-    std::vector<AccountTokenCount> accounts;
-    int64_t total_count;
-};
-
 /** holds an account guid and its corresponding integer probability
   the integer probability is some factor of 10
  */
@@ -5171,18 +5324,6 @@ struct AccountInfo
     int32_t probability;
 };
 
-static void
-build_token_info(char const * key, KvpValue * value, TokenAccountsInfo & tokenInfo)
-{
-    tokenInfo.total_count += value->get<int64_t>();
-    AccountTokenCount this_account;
-    std::string account_guid {key};
-    /*By convention, the key ends with the account GUID.*/
-    this_account.account_guid = account_guid.substr(account_guid.size() - GUID_ENCODING_LENGTH);
-    this_account.token_count = value->get<int64_t>();
-    tokenInfo.accounts.push_back(this_account);
-}
-
 /** We scale the probability values by probability_factor.
   ie. with probability_factor of 100000, 10% would be
   0.10 * 100000 = 10000 */
@@ -5216,41 +5357,126 @@ highest_probability(FinalProbabilityVec const & probabilities)
     return ret;
 }
 
+/** The import-map-bayes slots of an account, indexed for matching.
+ *
+ * The slots' keys are IMAP_FRAME_BAYES "/<token>/<account guid>". The index
+ * keeps the part after IMAP_FRAME_BAYES "/" in the same order as the slots,
+ * so looking up all keys starting with a token finds the same entries in the
+ * same order as qof_instance_foreach_slot_prefix would, and replaces the
+ * guids by small integers so that the matching doesn't compare strings.
+ */
+struct ImapBayesIndex
+{
+    struct Entry
+    {
+        uint32_t account;
+        int64_t count;
+    };
+
+    std::map<std::string, Entry> entries;
+    std::vector<std::string> guids; /* account number -> guid */
+    std::unordered_map<std::string, uint32_t> numbers; /* guid -> number */
+
+    uint32_t account_number (std::string const & guid)
+    {
+        auto found = numbers.emplace (guid, guids.size ());
+        if (found.second)
+            guids.push_back (guid);
+        return found.first->second;
+    }
+
+    void set (std::string const & key, int64_t count)
+    {
+        /*By convention, the key ends with the account GUID.*/
+        if (key.size () < GUID_ENCODING_LENGTH)
+            return;
+        auto guid = key.substr (key.size () - GUID_ENCODING_LENGTH);
+        entries[key] = Entry {account_number (guid), count};
+    }
+
+    template <typename Func> void
+    for_each_with_prefix (std::string const & prefix, Func func) const
+    {
+        for (auto entry = entries.lower_bound (prefix);
+             entry != entries.end () &&
+                 entry->first.compare (0, prefix.size (), prefix) == 0;
+             ++entry)
+            func (entry->second);
+    }
+};
+
+static void
+drop_imap_bayes_index (AccountPrivate *priv)
+{
+    delete priv->imap_bayes_index;
+    priv->imap_bayes_index = nullptr;
+}
+
+static void
+build_imap_bayes_index (char const * key, KvpValue * value, ImapBayesIndex & index)
+{
+    static const auto prefix_len = strlen (IMAP_FRAME_BAYES "/");
+    index.set (key + prefix_len, value->get<int64_t>());
+}
+
+static ImapBayesIndex &
+get_imap_bayes_index (Account *acc)
+{
+    auto priv = GET_PRIVATE (acc);
+    if (!priv->imap_bayes_index)
+    {
+        priv->imap_bayes_index = new ImapBayesIndex;
+        qof_instance_foreach_slot_prefix (QOF_INSTANCE (acc), IMAP_FRAME_BAYES "/",
+                                          &build_imap_bayes_index, *priv->imap_bayes_index);
+    }
+    return *priv->imap_bayes_index;
+}
+
 static ProbabilityVec
 get_first_pass_probabilities(GncImportMatchMap * imap, GList * tokens)
 {
-    ProbabilityVec ret;
+    auto const & index = get_imap_bayes_index (imap->acc);
+    /* The accounts in the order they're first found, and where each of them
+     * is in that order. */
+    std::vector<std::pair<uint32_t, AccountProbability>> found;
+    std::vector<int32_t> position (index.guids.size (), -1);
+    std::vector<ImapBayesIndex::Entry> matches;
     /* find the probability for each account that contains any of the tokens
      * in the input tokens list. */
     for (auto current_token = tokens; current_token; current_token = current_token->next)
     {
-        TokenAccountsInfo tokenInfo{};
-        auto path = std::string{IMAP_FRAME_BAYES "/"} + static_cast <char const *> (current_token->data);
-        qof_instance_foreach_slot_prefix (QOF_INSTANCE (imap->acc), path, &build_token_info, tokenInfo);
-        for (auto const & current_account_token : tokenInfo.accounts)
+        int64_t total_count = 0;
+        matches.clear ();
+        index.for_each_with_prefix (static_cast <char const *> (current_token->data),
+                                    [&total_count, &matches] (ImapBayesIndex::Entry const & entry) {
+                                        total_count += entry.count;
+                                        matches.push_back (entry);
+                                    });
+        for (auto const & current_account_token : matches)
         {
-            auto item = std::find_if(ret.begin(), ret.end(), [&current_account_token]
-                (std::pair<std::string, AccountProbability> const & a) {
-                    return current_account_token.account_guid == a.first;
-                });
-            if (item != ret.end())
+            auto token_probability = (double)current_account_token.count / (double)total_count;
+            auto & pos = position[current_account_token.account];
+            if (pos >= 0)
             {/* This account is already in the map */
-                item->second.product = ((double)current_account_token.token_count /
-                                      (double)tokenInfo.total_count) * item->second.product;
-                item->second.product_difference = ((double)1 - ((double)current_account_token.token_count /
-                                              (double)tokenInfo.total_count)) * item->second.product_difference;
+                auto & item = found[pos].second;
+                item.product = token_probability * item.product;
+                item.product_difference = ((double)1 - token_probability) * item.product_difference;
             }
             else
             {
                 /* add a new entry */
                 AccountProbability new_probability;
-                new_probability.product = ((double)current_account_token.token_count /
-                                      (double)tokenInfo.total_count);
+                new_probability.product = token_probability;
                 new_probability.product_difference = 1 - (new_probability.product);
-                ret.push_back({current_account_token.account_guid, std::move(new_probability)});
+                pos = found.size ();
+                found.push_back ({current_account_token.account, new_probability});
             }
         } /* for all accounts in tokenInfo */
     }
+    ProbabilityVec ret;
+    ret.reserve (found.size ());
+    for (auto const & account : found)
+        ret.push_back ({index.guids[account.first], account.second});
     return ret;
 }
 
@@ -5438,7 +5664,7 @@ gnc_account_imap_find_account_bayes (GncImportMatchMap *imap, GList *tokens)
     return account;
 }
 
-static void
+static int64_t
 change_imap_entry (GncImportMatchMap *imap, std::string const & path, int64_t token_count)
 {
     GValue value = G_VALUE_INIT;
@@ -5470,6 +5696,7 @@ change_imap_entry (GncImportMatchMap *imap, std::string const & path, int64_t to
     // Add or Update the entry based on guid
     qof_instance_set_path_kvp (QOF_INSTANCE (imap->acc), &value, {path});
     gnc_features_set_used (imap->book, GNC_FEATURE_GUID_FLAT_BAYESIAN);
+    return token_count;
 }
 
 /** Updates the imap for a given account using a list of tokens */
@@ -5493,6 +5720,11 @@ gnc_account_imap_add_account_bayes (GncImportMatchMap *imap,
 
     g_return_if_fail (acc != NULL);
     account_fullname = gnc_account_get_full_name(acc);
+    /* Update the index along with the map rather than have the commit
+     * drop it. */
+    auto priv = GET_PRIVATE (imap->acc);
+    auto index = priv->imap_bayes_index;
+    priv->imap_bayes_index = nullptr;
     xaccAccountBeginEdit (imap->acc);
 
     PINFO("account name: '%s'", account_fullname);
@@ -5512,13 +5744,18 @@ gnc_account_imap_add_account_bayes (GncImportMatchMap *imap,
         /* start off with one token for this account */
         token_count = 1;
         PINFO("adding token '%s'", (char*)current_token->data);
-        auto path = std::string {IMAP_FRAME_BAYES} + '/' + static_cast<char*>(current_token->data) + '/' + guid_string;
+        auto key = std::string {static_cast<char*>(current_token->data)} + '/' + guid_string;
+        auto path = std::string {IMAP_FRAME_BAYES} + '/' + key;
         /* change the imap entry for the account */
-        change_imap_entry (imap, path, token_count);
+        token_count = change_imap_entry (imap, path, token_count);
+        if (index)
+            index->set (key, token_count);
     }
     /* free up the account fullname and guid string */
     qof_instance_set_dirty (QOF_INSTANCE (imap->acc));
     xaccAccountCommitEdit (imap->acc);
+    drop_imap_bayes_index (priv);
+    priv->imap_bayes_index = index;
     g_free (account_fullname);
     g_free (guid_string);
     LEAVE(" ");
@@ -5691,6 +5928,7 @@ gnc_account_delete_all_bayes_maps (Account *acc)
         {
              qof_instance_slot_path_delete (QOF_INSTANCE (acc), {entry.first});
         }
+        drop_imap_bayes_index (GET_PRIVATE (acc));
     }
 }
 
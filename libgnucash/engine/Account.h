@@ -604,6 +604,29 @@ gnc_numeric xaccAccountGetBalanceAsOfDateInCurrency(
 gnc_numeric xaccAccountGetBalanceChangeForPeriod (
     Account *acc, time64 date1, time64 date2, gboolean recurse);
 
+/** Get the balances of a number of accounts as of a number of dates at
+ *  once, e.g. for the columns of a report.
+ *
+ *  The result for an account and a date is the same as that of
+ *  xaccAccountGetBalanceAsOfDateInCurrency(), but every account's splits
+ *  are brought up to date and searched only once per call, and the
+ *  prices needed for the conversions are looked up once per commodity.
+ *
+ *  @param accounts The accounts, one row of the result each.
+ *  @param dates The dates, one column of the result each.
+ *  @param n_dates The number of dates.
+ *  @param report_commodity The commodity to report the balances in. If
+ *  NULL each account's balances are in its own commodity.
+ *  @param include_children Whether to add in the balances of all of the
+ *  accounts' descendants.
+ *  @return A newly allocated array holding the balances of the first
+ *  account for all dates, followed by those of the second account and so
+ *  on; NULL if there are no accounts or dates. Free it with g_free().
+ */
+gnc_numeric *xaccAccountGetBalancesAsOfDates (
+    GList *accounts, const time64 *dates, gsize n_dates,
+    gnc_commodity *report_commodity, gboolean include_children);
+
 /** @} */
 
 /** @name Account Children and Parents.
@@ -117,6 +117,15 @@ typedef struct AccountPrivate
     GList *splits;              /* list of split pointers */
     gboolean sort_dirty;        /* sort order of splits is bad */
 
+    /* The splits again, ordered in blocks for quick lookup. The index
+     * maintains the list above, which is kept as a view on it for the
+     * benefit of xaccAccountGetSplitList. See gnc-split-index.hpp. */
+    struct GncSplitIndex *split_index;
+
+    /* The import-map-bayes slots indexed by token, built when the first
+     * match is looked up and dropped when the account is committed. */
+    struct ImapBayesIndex *imap_bayes_index;
+
     LotList   *lots;		/* list of lot pointers */
     GNCPolicy *policy;		/* Cached pointer to policy method */
 
@@ -139,6 +148,27 @@ void xaccAccountSetGUID (Account *account, const GncGUID *guid);
 /* Register Accounts with the engine */
 gboolean xaccAccountRegister (void);
 
+/* Tell the account that the sort order and amount of one of its
+ * splits may have changed.  This is cheaper than calling
+ * gnc_account_set_sort_dirty() because only the given split needs to
+ * be put back into place by the next xaccAccountSortSplits(). */
+void gnc_account_mark_split_dirty (Account *acc, Split *split);
+
+/* xaccAccountRecomputeBalance() doesn't store the running balances into
+ * the splits right away; this makes sure that split's balances are those
+ * of the last recompute.  Split's balance getters call it. */
+void gnc_account_update_split_balances (const Account *acc,
+                                        const Split *split);
+
+/* Call cb with the splits of acc posted from start to end, inclusive,
+ * found with a binary search of the split index.  Splits without a
+ * transaction are passed too, and if the splits need sorting all of
+ * them are.  The split query index uses it to answer date ranges. */
+void gnc_account_foreach_split_posted_between (const Account *acc,
+                                               time64 start, time64 end,
+                                               GFunc cb,
+                                               gpointer user_data);
+
 /* Structure for accessing static functions for testing */
 typedef struct
 {
@@ -65,9 +65,11 @@ xaccAccountTreeScrubOrphans (Account *acc, QofPercentageFunc percentagefunc)
 {
     if (!acc) return;
 
+    qof_event_begin_batch ();
     xaccAccountScrubOrphans (acc, percentagefunc);
     gnc_account_foreach_descendant(acc,
                                    (AccountCb)xaccAccountScrubOrphans, percentagefunc);
+    qof_event_end_batch ();
 }
 
 static void
@@ -291,9 +293,11 @@ xaccSplitScrub (Split *split)
 void
 xaccAccountTreeScrubImbalance (Account *acc, QofPercentageFunc percentagefunc)
 {
+    qof_event_begin_batch ();
     xaccAccountScrubImbalance (acc, percentagefunc);
     gnc_account_foreach_descendant(acc,
                                    (AccountCb)xaccAccountScrubImbalance, percentagefunc);
+    qof_event_end_batch ();
 }
 
 void
@@ -1252,10 +1256,12 @@ xaccAccountTreeScrubCommodities (Account *acc)
 {
     if (!acc) return;
 
+    qof_event_begin_batch ();
     xaccAccountTreeForEachTransaction (acc, scrub_trans_currency_helper, NULL);
 
     scrub_account_commodity_helper (acc, NULL);
     gnc_account_foreach_descendant (acc, scrub_account_commodity_helper, NULL);
+    qof_event_end_batch ();
 }
 
 /* ================================================================ */
@@ -56,6 +56,7 @@
 #include "gnc-lot.h"
 #include "gnc-event.h"
 #include "qofinstance-p.h"
+#include "qofquery-p.h"
 
 const char *void_former_amt_str = "void-former-amount";
 const char *void_former_val_str = "void-former-value";
@@ -120,6 +121,7 @@ gnc_split_init(Split* split)
     split->balance             = gnc_numeric_zero();
     split->cleared_balance     = gnc_numeric_zero();
     split->reconciled_balance  = gnc_numeric_zero();
+    split->index_block         = NULL;
 
     split->gains = GAINS_STATUS_UNKNOWN;
     split->gains_split = NULL;
@@ -594,9 +596,9 @@ xaccSplitCloneNoKvp (const Split *s)
     split->date_reconciled     = s->date_reconciled;
     split->value               = s->value;
     split->amount              = s->amount;
-    split->balance             = s->balance;
-    split->cleared_balance     = s->cleared_balance;
-    split->reconciled_balance  = s->reconciled_balance;
+    split->balance             = xaccSplitGetBalance (s);
+    split->cleared_balance     = xaccSplitGetClearedBalance (s);
+    split->reconciled_balance  = xaccSplitGetReconciledBalance (s);
 
     split->gains = GAINS_STATUS_UNKNOWN;
     split->gains_split = NULL;
@@ -723,7 +725,7 @@ void mark_split (Split *s)
 {
     if (s->acc)
     {
-        g_object_set(s->acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_mark_split_dirty (s->acc, s);
     }
 
     /* set dirty flag on lot too. */
@@ -860,13 +862,16 @@ xaccSplitEqual(const Split *sa, const Split *sb,
 
     if (check_balances)
     {
-        if (!xaccSplitEqualCheckBal ("", sa->balance, sb->balance))
+        if (!xaccSplitEqualCheckBal ("", xaccSplitGetBalance (sa),
+                                     xaccSplitGetBalance (sb)))
             return FALSE;
-        if (!xaccSplitEqualCheckBal ("cleared ", sa->cleared_balance,
-                                     sb->cleared_balance))
+        if (!xaccSplitEqualCheckBal ("cleared ",
+                                     xaccSplitGetClearedBalance (sa),
+                                     xaccSplitGetClearedBalance (sb)))
             return FALSE;
-        if (!xaccSplitEqualCheckBal ("reconciled ", sa->reconciled_balance,
-                                     sb->reconciled_balance))
+        if (!xaccSplitEqualCheckBal ("reconciled ",
+                                     xaccSplitGetReconciledBalance (sa),
+                                     xaccSplitGetReconciledBalance (sb)))
             return FALSE;
     }
 
@@ -1010,7 +1015,7 @@ xaccSplitCommitEdit(Split *s)
 
     if (acc)
     {
-        g_object_set(acc, "sort-dirty", TRUE, "balance-dirty", TRUE, NULL);
+        gnc_account_mark_split_dirty (acc, s);
         xaccAccountRecomputeBalance(acc);
     }
 }
@@ -1266,22 +1271,35 @@ xaccSplitSetValue (Split *s, gnc_numeric amt)
 /********************************************************************\
 \********************************************************************/
 
+static inline void
+update_balances (const Split *s)
+{
+    if (s->acc)
+        gnc_account_update_split_balances (s->acc, s);
+}
+
 gnc_numeric
 xaccSplitGetBalance (const Split *s)
 {
-    return s ? s->balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    update_balances (s);
+    return s->balance;
 }
 
 gnc_numeric
 xaccSplitGetClearedBalance (const Split *s)
 {
-    return s ? s->cleared_balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    update_balances (s);
+    return s->cleared_balance;
 }
 
 gnc_numeric
 xaccSplitGetReconciledBalance (const Split *s)
 {
-    return s ? s->reconciled_balance : gnc_numeric_zero();
+    if (!s) return gnc_numeric_zero();
+    update_balances (s);
+    return s->reconciled_balance;
 }
 
 void
@@ -2221,6 +2239,176 @@ qofSplitSetAccount(Split *s, QofInstance *ent)
     xaccSplitSetAccount(s, acc);
 }
 
+static gboolean
+param_path_is (const GSList *path, const char *first, const char *second)
+{
+    if (!path || g_strcmp0 (path->data, first))
+        return FALSE;
+    path = path->next;
+    if (!second)
+        return path == NULL;
+    return path && !g_strcmp0 (path->data, second) && !path->next;
+}
+
+static void
+prepend_split (gpointer split, gpointer list)
+{
+    *(GList**)list = g_list_prepend (*(GList**)list, split);
+}
+
+/* The accounts all splits matching and_terms must be in, if any of the
+ * terms says, and the range of dates their transactions must be posted in,
+ * as xaccQueryAddSingleAccountMatch() and xaccQueryAddDateMatchTT() ask. */
+static void
+split_query_bounds (const GList *and_terms, const GList **accounts,
+                    gboolean *have_accounts, time64 *start, time64 *end)
+{
+    const GList *node;
+
+    *accounts = NULL;
+    *have_accounts = FALSE;
+    *start = G_MININT64;
+    *end = G_MAXINT64;
+
+    for (node = and_terms; node; node = node->next)
+    {
+        QofQueryTerm *qt = node->data;
+        GSList *path = qof_query_term_get_param_path (qt);
+        QofQueryPredData *pd = qof_query_term_get_pred_data (qt);
+        QofGuidMatch guid_match;
+        QofDateMatch date_match;
+        const GList *guids;
+        time64 date;
+
+        if (qof_query_term_is_inverted (qt))
+            continue;
+
+        if ((param_path_is (path, SPLIT_ACCOUNT, QOF_PARAM_GUID) ||
+             param_path_is (path, SPLIT_ACCOUNT_GUID, NULL)) &&
+            qof_query_guid_predicate_get_guids (pd, &guid_match, &guids) &&
+            guid_match == QOF_GUID_MATCH_ANY)
+        {
+            /* The splits must match all of the account terms, so any of
+             * them will do; the shortest is the cheapest. */
+            if (!*have_accounts ||
+                g_list_length ((GList*)guids) < g_list_length ((GList*)*accounts))
+                *accounts = guids;
+            *have_accounts = TRUE;
+        }
+        else if (param_path_is (path, SPLIT_TRANS, TRANS_DATE_POSTED) &&
+                 qof_query_date_predicate_get_date (pd, &date) &&
+                 qof_query_date_predicate_get_options (pd, &date_match) &&
+                 date_match == QOF_DATE_MATCH_NORMAL)
+        {
+            switch (pd->how)
+            {
+            case QOF_COMPARE_EQUAL:
+                *start = MAX (*start, date);
+                *end = MIN (*end, date);
+                break;
+            case QOF_COMPARE_GT:
+                if (date < G_MAXINT64)
+                    *start = MAX (*start, date + 1);
+                break;
+            case QOF_COMPARE_GTE:
+                *start = MAX (*start, date);
+                break;
+            case QOF_COMPARE_LT:
+                if (date > G_MININT64)
+                    *end = MIN (*end, date - 1);
+                break;
+            case QOF_COMPARE_LTE:
+                *end = MIN (*end, date);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+/* Have the backend load the older transactions the splits matching
+ * and_terms may be in. */
+static void
+split_query_load (QofBook *book, const GList *and_terms)
+{
+    const GList *accounts;
+    gboolean have_accounts;
+    time64 start, end;
+
+    split_query_bounds (and_terms, &accounts, &have_accounts, &start, &end);
+    if (have_accounts && !accounts)
+        return;
+    qof_backend_load_history (qof_book_get_backend (book), book, accounts,
+                              start);
+}
+
+/* Answer the split queries that ask for the splits of particular
+ * accounts, like xaccQueryAddSingleAccountMatch() makes, from the
+ * accounts' split indexes, narrowed down to the date range asked for by
+ * xaccQueryAddDateMatchTT() if there is one.  The splits of transactions
+ * in an open edit are added, as the indexes only learn where those went
+ * when they're committed. */
+static gboolean
+split_query_index (QofBook *book, const GList *and_terms, GList **objects)
+{
+    const GList *accounts, *node;
+    gboolean have_accounts;
+    time64 start, end;
+    GList *splits = NULL, *open_list;
+
+    split_query_bounds (and_terms, &accounts, &have_accounts, &start, &end);
+    if (!have_accounts)
+        return FALSE;
+
+    for (node = accounts; node; node = node->next)
+    {
+        Account *acc;
+
+        /* A split belongs to one account, so listing each account once
+         * lists each split once. */
+        if (g_list_find_custom ((GList*)accounts, node->data,
+                                (GCompareFunc)guid_compare) != node)
+            continue;
+        acc = xaccAccountLookup (node->data, book);
+        if (acc)
+            gnc_account_foreach_split_posted_between (acc, start, end,
+                                                      prepend_split, &splits);
+    }
+
+    open_list = xaccTransGetOpenList (book);
+    if (open_list)
+    {
+        GHashTable *seen;
+        GList *tnode, *snode;
+
+        seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+        for (snode = splits; snode; snode = snode->next)
+            g_hash_table_add (seen, snode->data);
+        for (tnode = open_list; tnode; tnode = tnode->next)
+            for (snode = xaccTransGetSplitList (tnode->data); snode;
+                 snode = snode->next)
+                if (g_hash_table_add (seen, snode->data))
+                    splits = g_list_prepend (splits, snode->data);
+        g_hash_table_destroy (seen);
+        g_list_free (open_list);
+    }
+
+    *objects = g_list_reverse (splits);
+    return TRUE;
+}
+
+/* The splits of a transaction, for live split queries to check when the
+ * transaction changes.  Those of an account aren't listed when the
+ * account changes: the account's splits get events of their own when
+ * they move, and checking them all for a renamed account would cost as
+ * much as running the query again. */
+static GList *
+split_trans_dependents (QofInstance *trans)
+{
+    return g_list_copy (xaccTransGetSplitList (GNC_TRANSACTION (trans)));
+}
+
 gboolean xaccSplitRegister (void)
 {
     static const QofParam params[] =
@@ -2320,6 +2508,10 @@ gboolean xaccSplitRegister (void)
                         NULL);
     qof_class_register (SPLIT_CORR_ACCT_CODE,
                         (QofSortFunc)xaccSplitCompareOtherAccountCodes, NULL);
+    qof_query_register_index (GNC_ID_SPLIT, split_query_index);
+    qof_query_register_loader (GNC_ID_SPLIT, split_query_load);
+    qof_query_register_dependents (GNC_ID_SPLIT, GNC_ID_TRANS,
+                                   split_trans_dependents);
 
     return qof_object_register (&split_object_def);
 }
@@ -125,6 +125,10 @@ struct split_s
     gnc_numeric  balance;
     gnc_numeric  cleared_balance;
     gnc_numeric  reconciled_balance;
+
+    /* The block of the account's split index holding this split, see
+     * gnc-split-index.hpp. Only the account code touches this. */
+    struct SplitIndexBlock *index_block;
 };
 
 struct _SplitClass
@@ -29,6 +29,9 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <string.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "Account.h"
 #include "Transaction.h"
@@ -38,6 +41,10 @@
 #ifdef _MSC_VER
 # define g_fopen fopen
 #endif
+#ifdef G_OS_WIN32
+# include <io.h>
+# define fsync _commit
+#endif
 
 static QofLogModule log_module = "gnc.translog";
 
@@ -88,6 +95,69 @@ static int gen_logs = 1;
 static FILE * trans_log = NULL; /**< current log file handle */
 static char * trans_log_name = NULL; /**< current log file name */
 static char * log_base_name = NULL;
+static XaccLogFormat log_format = XACC_LOG_FORMAT_TEXT;
+static XaccLogFormat trans_log_format = XACC_LOG_FORMAT_TEXT; /**< of the current log file */
+static XaccLogDurability log_durability = XACC_LOG_DURABILITY_GROUP;
+
+/*  Note: this must match src/import-export/log-replay/gnc-log-replay.c */
+static const char text_header[] =
+    "mod\ttrans_guid\tsplit_guid\ttime_now\t"
+    "date_entered\tdate_posted\t"
+    "acc_guid\tacc_name\tnum\tdescription\t"
+    "notes\tmemo\taction\treconciled\t"
+    "amount\tvalue\tdate_reconciled\n"
+    "-----------------\n";
+
+/* Binary log files start with this, followed by the records. */
+static const char binary_magic[] = "GNCTLOG1";
+#define BINARY_MAGIC_LEN (sizeof (binary_magic) - 1)
+/* Far more than the strings of one split take; a larger size is garbage. */
+#define MAX_BINARY_RECORD_LEN (64 * 1024 * 1024)
+
+/*
+ * xaccTransWriteLog() only copies what it logs into a LogRecord, in the
+ * binary format. Unless the log is written immediately, the records are
+ * pushed onto a lock free stack, which a writer thread empties whenever it
+ * is done writing what it took from it before. That way commits that come
+ * in quick succession are written, and flushed, as one group, and the
+ * formatting of the text log is done off the caller's thread as well.
+ *
+ * A binary record is the little endian 32 bit size of the rest of the
+ * record, followed by
+ *   flag                 1 byte
+ *   time_now             64 bit time64
+ *   date_entered         64 bit time64
+ *   date_posted          64 bit time64
+ *   trans_guid           16 bytes
+ *   num                  string
+ *   description          string
+ *   notes                string
+ *   number of splits     32 bit
+ * and for each split
+ *   split_guid           16 bytes
+ *   has an account       1 byte
+ *   acc_guid             16 bytes
+ *   acc_name             string
+ *   memo                 string
+ *   action               string
+ *   reconciled           1 byte
+ *   amount               64 bit numerator and denominator
+ *   value                64 bit numerator and denominator
+ *   date_reconciled      64 bit time64
+ * where a string is its 32 bit length followed by its bytes.
+ */
+typedef struct LogRecord LogRecord;
+struct LogRecord
+{
+    LogRecord *next;
+    GByteArray *bytes;
+};
+
+static LogRecord *pending = NULL;   /**< submitted records, newest first */
+static GThread *writer_thread = NULL;
+static GMutex writer_mutex;
+static GCond writer_cond;
+static gboolean writer_stop = FALSE;
 
 /********************************************************************\
 \********************************************************************/
@@ -130,6 +200,41 @@ xaccLogSetBaseName (const char *basepath)
     }
 }
 
+void
+xaccLogSetFormat (XaccLogFormat format)
+{
+    if (format == log_format) return;
+
+    log_format = format;
+    /* A file can't change its format, so start a new one. */
+    xaccReopenLog ();
+}
+
+XaccLogFormat
+xaccLogGetFormat (void)
+{
+    return log_format;
+}
+
+static void start_writer (void);
+static void stop_writer (void);
+
+void
+xaccLogSetDurability (XaccLogDurability durability)
+{
+    if (durability == log_durability) return;
+
+    stop_writer ();
+    log_durability = durability;
+    start_writer ();
+}
+
+XaccLogDurability
+xaccLogGetDurability (void)
+{
+    return log_durability;
+}
+
 
 /*
  * See if the provided file name is that of the current log file.
@@ -152,6 +257,385 @@ xaccFileIsCurrentLog (const gchar *name)
     return result;
 }
 
+/********************************************************************\
+ * Encoding and decoding binary records
+\********************************************************************/
+
+static void
+put_u8 (GByteArray *bytes, guint8 val)
+{
+    g_byte_array_append (bytes, &val, 1);
+}
+
+static void
+put_u32 (GByteArray *bytes, guint32 val)
+{
+    val = GUINT32_TO_LE (val);
+    g_byte_array_append (bytes, (const guint8 *) &val, sizeof (val));
+}
+
+static void
+put_i64 (GByteArray *bytes, gint64 val)
+{
+    guint64 uval = GUINT64_TO_LE ((guint64) val);
+    g_byte_array_append (bytes, (const guint8 *) &uval, sizeof (uval));
+}
+
+static void
+put_guid (GByteArray *bytes, const GncGUID *guid)
+{
+    g_byte_array_append (bytes, guid->reserved, GUID_DATA_SIZE);
+}
+
+static void
+put_string (GByteArray *bytes, const char *str)
+{
+    guint32 len = str ? strlen (str) : 0;
+
+    put_u32 (bytes, len);
+    g_byte_array_append (bytes, (const guint8 *) str, len);
+}
+
+static LogRecord *
+encode_transaction (Transaction *trans, char flag)
+{
+    LogRecord *record = g_new0 (LogRecord, 1);
+    GByteArray *bytes = g_byte_array_sized_new (256);
+    guint32 size;
+    GList *node;
+
+    put_u32 (bytes, 0);         /* the size, filled in below */
+    put_u8 (bytes, flag);
+    put_i64 (bytes, gnc_time (NULL));
+    put_i64 (bytes, trans->date_entered);
+    put_i64 (bytes, trans->date_posted);
+    put_guid (bytes, xaccTransGetGUID (trans));
+    put_string (bytes, trans->num);
+    put_string (bytes, trans->description);
+    put_string (bytes, xaccTransGetNotes (trans));
+    put_u32 (bytes, g_list_length (trans->splits));
+
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *split = node->data;
+        Account *acc = xaccSplitGetAccount (split);
+        gnc_numeric amt = xaccSplitGetAmount (split);
+        gnc_numeric val = xaccSplitGetValue (split);
+
+        put_guid (bytes, xaccSplitGetGUID (split));
+        put_u8 (bytes, acc != NULL);
+        put_guid (bytes, acc ? xaccAccountGetGUID (acc) : guid_null ());
+        put_string (bytes, acc ? xaccAccountGetName (acc) : NULL);
+        put_string (bytes, split->memo);
+        put_string (bytes, split->action);
+        put_u8 (bytes, split->reconciled);
+        put_i64 (bytes, gnc_numeric_num (amt));
+        put_i64 (bytes, gnc_numeric_denom (amt));
+        put_i64 (bytes, gnc_numeric_num (val));
+        put_i64 (bytes, gnc_numeric_denom (val));
+        put_i64 (bytes, split->date_reconciled);
+    }
+
+    size = GUINT32_TO_LE (bytes->len - sizeof (size));
+    memcpy (bytes->data, &size, sizeof (size));
+
+    record->bytes = bytes;
+    return record;
+}
+
+static void
+free_record (LogRecord *record)
+{
+    g_byte_array_free (record->bytes, TRUE);
+    g_free (record);
+}
+
+typedef struct
+{
+    const guint8 *pos;
+    const guint8 *end;
+    gboolean ok;
+} LogReader;
+
+static const guint8 *
+get_bytes (LogReader *reader, gsize len)
+{
+    const guint8 *bytes = reader->pos;
+
+    if (!reader->ok || (gsize) (reader->end - reader->pos) < len)
+    {
+        reader->ok = FALSE;
+        return NULL;
+    }
+    reader->pos += len;
+    return bytes;
+}
+
+static guint8
+get_u8 (LogReader *reader)
+{
+    const guint8 *bytes = get_bytes (reader, 1);
+    return bytes ? *bytes : 0;
+}
+
+static guint32
+get_u32 (LogReader *reader)
+{
+    const guint8 *bytes = get_bytes (reader, sizeof (guint32));
+    guint32 val;
+
+    if (!bytes) return 0;
+    memcpy (&val, bytes, sizeof (val));
+    return GUINT32_FROM_LE (val);
+}
+
+static gint64
+get_i64 (LogReader *reader)
+{
+    const guint8 *bytes = get_bytes (reader, sizeof (guint64));
+    guint64 val;
+
+    if (!bytes) return 0;
+    memcpy (&val, bytes, sizeof (val));
+    return (gint64) GUINT64_FROM_LE (val);
+}
+
+static void
+get_guid_string (LogReader *reader, char *buff)
+{
+    const guint8 *bytes = get_bytes (reader, GUID_DATA_SIZE);
+    GncGUID guid;
+
+    buff[0] = '\0';
+    if (!bytes) return;
+    memcpy (guid.reserved, bytes, GUID_DATA_SIZE);
+    guid_to_string_buff (&guid, buff);
+}
+
+/* Append the next string to out, followed by a tab. */
+static void
+append_string (LogReader *reader, GString *out)
+{
+    guint32 len = get_u32 (reader);
+    const guint8 *bytes = get_bytes (reader, len);
+
+    if (bytes)
+        g_string_append_len (out, (const char *) bytes, len);
+    g_string_append_c (out, '\t');
+}
+
+/* Append the text lines for the record in data, without its size, to out.
+ * Returns FALSE if the record is malformed. */
+static gboolean
+record_to_text (const guint8 *data, gsize size, GString *out)
+{
+    LogReader reader = { data, data + size, TRUE };
+    char trans_guid_str[GUID_ENCODING_LENGTH + 1];
+    char dnow[100], dent[100], dpost[100];
+    GString *trans_fields = g_string_sized_new (128);
+    GString *split_fields = g_string_sized_new (128);
+    char flag;
+    guint32 n_splits, i;
+
+    flag = get_u8 (&reader);
+    gnc_time64_to_iso8601_buff (get_i64 (&reader), dnow);
+    gnc_time64_to_iso8601_buff (get_i64 (&reader), dent);
+    gnc_time64_to_iso8601_buff (get_i64 (&reader), dpost);
+    get_guid_string (&reader, trans_guid_str);
+    append_string (&reader, trans_fields);      /* num */
+    append_string (&reader, trans_fields);      /* description */
+    append_string (&reader, trans_fields);      /* notes */
+    n_splits = get_u32 (&reader);
+
+    g_string_append (out, "===== START\n");
+
+    for (i = 0; i < n_splits && reader.ok; i++)
+    {
+        char split_guid_str[GUID_ENCODING_LENGTH + 1];
+        char acc_guid_str[GUID_ENCODING_LENGTH + 1];
+        char drecn[100];
+        gboolean has_account;
+        char reconciled;
+        gint64 amt_num, amt_denom, val_num, val_denom;
+
+        get_guid_string (&reader, split_guid_str);
+        has_account = get_u8 (&reader);
+        get_guid_string (&reader, acc_guid_str);
+        if (!has_account)
+            acc_guid_str[0] = '\0';
+
+        g_string_truncate (split_fields, 0);
+        append_string (&reader, split_fields);  /* acc_name */
+        g_string_append_len (split_fields, trans_fields->str,
+                             trans_fields->len);
+        append_string (&reader, split_fields);  /* memo */
+        append_string (&reader, split_fields);  /* action */
+        reconciled = get_u8 (&reader);
+        amt_num = get_i64 (&reader);
+        amt_denom = get_i64 (&reader);
+        val_num = get_i64 (&reader);
+        val_denom = get_i64 (&reader);
+        gnc_time64_to_iso8601_buff (get_i64 (&reader), drecn);
+
+        /* use tab-separated fields */
+        g_string_append_printf (out, "%c\t%s\t%s\t%s\t%s\t%s\t%s\t",
+                                flag, trans_guid_str, split_guid_str,
+                                dnow, dent, dpost, acc_guid_str);
+        g_string_append_len (out, split_fields->str, split_fields->len);
+        g_string_append_printf (out, "%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT
+                                "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
+                                reconciled, amt_num, amt_denom,
+                                val_num, val_denom, drecn);
+    }
+
+    g_string_append (out, "===== END\n");
+
+    g_string_free (trans_fields, TRUE);
+    g_string_free (split_fields, TRUE);
+    return reader.ok && reader.pos == reader.end;
+}
+
+/********************************************************************\
+ * Writing records
+\********************************************************************/
+
+/* Write the records in list, in order, and free them. Then get them out
+ * to the disk as far as the durability asks for. */
+static void
+write_records (LogRecord *list)
+{
+    GString *text = NULL;
+    LogRecord *next;
+
+    for (; list; list = next)
+    {
+        GByteArray *bytes = list->bytes;
+
+        next = list->next;
+        if (trans_log_format == XACC_LOG_FORMAT_BINARY)
+        {
+            fwrite (bytes->data, 1, bytes->len, trans_log);
+        }
+        else
+        {
+            if (!text)
+                text = g_string_sized_new (1024);
+            g_string_truncate (text, 0);
+            record_to_text (bytes->data + sizeof (guint32),
+                            bytes->len - sizeof (guint32), text);
+            fwrite (text->str, 1, text->len, trans_log);
+        }
+        free_record (list);
+    }
+
+    if (text)
+        g_string_free (text, TRUE);
+
+    /* get data out to the disk */
+    if (fflush (trans_log) != 0)
+    {
+        PERR ("cannot write transaction log: %s", g_strerror (errno));
+        return;
+    }
+    if (log_durability == XACC_LOG_DURABILITY_GROUP_SYNC &&
+        fsync (fileno (trans_log)) != 0)
+        PERR ("cannot sync transaction log: %s", g_strerror (errno));
+}
+
+/* Take all submitted records, oldest first. */
+static LogRecord *
+take_pending (void)
+{
+    LogRecord *head, *list = NULL;
+
+    do
+        head = g_atomic_pointer_get (&pending);
+    while (head && !g_atomic_pointer_compare_and_exchange (&pending, head, NULL));
+
+    while (head)
+    {
+        LogRecord *next = head->next;
+        head->next = list;
+        list = head;
+        head = next;
+    }
+    return list;
+}
+
+static void
+submit_record (LogRecord *record)
+{
+    LogRecord *head;
+
+    do
+    {
+        head = g_atomic_pointer_get (&pending);
+        record->next = head;
+    }
+    while (!g_atomic_pointer_compare_and_exchange (&pending, head, record));
+
+    /* The writer only waits after it found nothing pending, so it only
+     * needs waking for the first record of a group. */
+    if (!head)
+    {
+        g_mutex_lock (&writer_mutex);
+        g_cond_signal (&writer_cond);
+        g_mutex_unlock (&writer_mutex);
+    }
+}
+
+static gpointer
+log_writer_thread (gpointer data)
+{
+    while (TRUE)
+    {
+        LogRecord *list = take_pending ();
+        gboolean stop;
+
+        if (list)
+        {
+            write_records (list);
+            continue;
+        }
+
+        g_mutex_lock (&writer_mutex);
+        while (!writer_stop && !g_atomic_pointer_get (&pending))
+            g_cond_wait (&writer_cond, &writer_mutex);
+        stop = writer_stop && !g_atomic_pointer_get (&pending);
+        g_mutex_unlock (&writer_mutex);
+
+        if (stop)
+            break;
+    }
+    return NULL;
+}
+
+static void
+start_writer (void)
+{
+    if (!trans_log || writer_thread ||
+        log_durability == XACC_LOG_DURABILITY_IMMEDIATE)
+        return;
+
+    writer_stop = FALSE;
+    writer_thread = g_thread_new ("gnc-translog", log_writer_thread, NULL);
+}
+
+/* Stop the writer once it wrote everything submitted. */
+static void
+stop_writer (void)
+{
+    if (!writer_thread) return;
+
+    g_mutex_lock (&writer_mutex);
+    writer_stop = TRUE;
+    g_cond_signal (&writer_cond);
+    g_mutex_unlock (&writer_mutex);
+
+    g_thread_join (writer_thread);
+    writer_thread = NULL;
+}
+
 /********************************************************************\
 \********************************************************************/
 
@@ -175,7 +659,8 @@ xaccOpenLog (void)
 
     filename = g_strconcat (log_base_name, ".", timestamp, ".log", NULL);
 
-    trans_log = g_fopen (filename, "a");
+    trans_log = g_fopen (filename,
+                         log_format == XACC_LOG_FORMAT_BINARY ? "ab" : "a");
     if (!trans_log)
     {
         int norr = errno;
@@ -195,13 +680,20 @@ xaccOpenLog (void)
     g_free (filename);
     g_free (timestamp);
 
-    /*  Note: this must match src/import-export/log-replay/gnc-log-replay.c */
-    fprintf (trans_log, "mod\ttrans_guid\tsplit_guid\ttime_now\t"
-             "date_entered\tdate_posted\t"
-             "acc_guid\tacc_name\tnum\tdescription\t"
-             "notes\tmemo\taction\treconciled\t"
-             "amount\tvalue\tdate_reconciled\n");
-    fprintf (trans_log, "-----------------\n");
+    trans_log_format = log_format;
+    if (trans_log_format == XACC_LOG_FORMAT_BINARY)
+    {
+        /* Appending to a file opened within the same second. */
+        fseek (trans_log, 0, SEEK_END);
+        if (ftell (trans_log) == 0)
+            fwrite (binary_magic, 1, BINARY_MAGIC_LEN, trans_log);
+    }
+    else
+    {
+        fputs (text_header, trans_log);
+    }
+
+    start_writer ();
 }
 
 /********************************************************************\
@@ -211,6 +703,7 @@ void
 xaccCloseLog (void)
 {
     if (!trans_log) return;
+    stop_writer ();
     fflush (trans_log);
     fclose (trans_log);
     trans_log = NULL;
@@ -222,11 +715,7 @@ xaccCloseLog (void)
 void
 xaccTransWriteLog (Transaction *trans, char flag)
 {
-    GList *node;
-    char trans_guid_str[GUID_ENCODING_LENGTH + 1];
-    char split_guid_str[GUID_ENCODING_LENGTH + 1];
-    const char *trans_notes;
-    char dnow[100], dent[100], dpost[100], drecn[100];
+    LogRecord *record;
 
     if (!gen_logs)
     {
@@ -235,69 +724,114 @@ xaccTransWriteLog (Transaction *trans, char flag)
     }
     if (!trans_log) return;
 
-    gnc_time64_to_iso8601_buff (gnc_time(NULL), dnow);
-    gnc_time64_to_iso8601_buff (trans->date_entered, dent);
-    gnc_time64_to_iso8601_buff (trans->date_posted, dpost);
-    guid_to_string_buff (xaccTransGetGUID(trans), trans_guid_str);
-    trans_notes = xaccTransGetNotes(trans);
-    fprintf (trans_log, "===== START\n");
+    record = encode_transaction (trans, flag);
 
-    for (node = trans->splits; node; node = node->next)
+    if (writer_thread)
+        submit_record (record);
+    else
+        write_records (record);
+}
+
+/********************************************************************\
+\********************************************************************/
+
+gboolean
+xaccLogFileIsBinary (const gchar *name)
+{
+    char magic[BINARY_MAGIC_LEN];
+    FILE *file;
+    gboolean result;
+
+    if (!name) return FALSE;
+
+    file = g_fopen (name, "rb");
+    if (!file) return FALSE;
+
+    result = (fread (magic, 1, BINARY_MAGIC_LEN, file) == BINARY_MAGIC_LEN &&
+              memcmp (magic, binary_magic, BINARY_MAGIC_LEN) == 0);
+    fclose (file);
+    return result;
+}
+
+gboolean
+xaccLogConvertToText (const gchar *binary_name, const gchar *text_name)
+{
+    char magic[BINARY_MAGIC_LEN];
+    FILE *in, *out;
+    GByteArray *data;
+    GString *text;
+    gboolean ok = TRUE;
+    gint64 left;
+
+    g_return_val_if_fail (binary_name && text_name, FALSE);
+
+    in = g_fopen (binary_name, "rb");
+    if (!in)
     {
-        time64 time;
-        Split *split = node->data;
-        const char * accname = "";
-        char acc_guid_str[GUID_ENCODING_LENGTH + 1];
-        gnc_numeric amt, val;
+        PERR ("cannot open %s: %s", binary_name, g_strerror (errno));
+        return FALSE;
+    }
+    if (fread (magic, 1, BINARY_MAGIC_LEN, in) != BINARY_MAGIC_LEN ||
+        memcmp (magic, binary_magic, BINARY_MAGIC_LEN) != 0)
+    {
+        PERR ("%s is not a binary transaction log", binary_name);
+        fclose (in);
+        return FALSE;
+    }
+    fseek (in, 0, SEEK_END);
+    left = ftell (in) - BINARY_MAGIC_LEN;
+    fseek (in, BINARY_MAGIC_LEN, SEEK_SET);
+
+    out = g_fopen (text_name, "w");
+    if (!out)
+    {
+        PERR ("cannot open %s: %s", text_name, g_strerror (errno));
+        fclose (in);
+        return FALSE;
+    }
 
-        if (xaccSplitGetAccount(split))
+    fputs (text_header, out);
+
+    data = g_byte_array_new ();
+    text = g_string_sized_new (1024);
+    while (ok)
+    {
+        guint32 size;
+
+        if (fread (&size, 1, sizeof (size), in) != sizeof (size))
+            break;
+        size = GUINT32_FROM_LE (size);
+        left -= sizeof (size);
+        /* A crash may have cut the last record short, or left garbage for
+         * its size; it's left out. */
+        if (size > MAX_BINARY_RECORD_LEN || (gint64) size > left)
         {
-            accname = xaccAccountGetName (xaccSplitGetAccount(split));
-            guid_to_string_buff(xaccAccountGetGUID(xaccSplitGetAccount(split)),
-                                acc_guid_str);
+            PWARN ("%s ends with an incomplete record", binary_name);
+            break;
         }
-        else
+        left -= size;
+        g_byte_array_set_size (data, size);
+        if (fread (data->data, 1, size, in) != size)
         {
-            acc_guid_str[0] = '\0';
+            PWARN ("%s ends with an incomplete record", binary_name);
+            break;
         }
 
-        gnc_time64_to_iso8601_buff (split->date_reconciled, drecn);
-
-        guid_to_string_buff (xaccSplitGetGUID(split), split_guid_str);
-        amt = xaccSplitGetAmount (split);
-        val = xaccSplitGetValue (split);
-
-        /* use tab-separated fields */
-        fprintf (trans_log,
-                 "%c\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t"
-                 "%s\t%s\t%s\t%s\t%c\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "/%" G_GINT64_FORMAT "\t%s\n",
-                 flag,
-                 trans_guid_str, split_guid_str,  /* trans+split make up unique id */
-                 /* Note that the next three strings always exist,
-                 		* so we don't need to test them. */
-                 dnow,
-                 dent,
-                 dpost,
-                 acc_guid_str,
-                 accname ? accname : "",
-                 trans->num ? trans->num : "",
-                 trans->description ? trans->description : "",
-                 trans_notes ? trans_notes : "",
-                 split->memo ? split->memo : "",
-                 split->action ? split->action : "",
-                 split->reconciled,
-                 gnc_numeric_num(amt),
-                 gnc_numeric_denom(amt),
-                 gnc_numeric_num(val),
-                 gnc_numeric_denom(val),
-                 /* The next string always exists. No need to test it. */
-                 drecn);
+        g_string_truncate (text, 0);
+        if (!record_to_text (data->data, size, text))
+        {
+            PERR ("%s has a malformed record", binary_name);
+            ok = FALSE;
+        }
+        fwrite (text->str, 1, text->len, out);
     }
 
-    fprintf (trans_log, "===== END\n");
-
-    /* get data out to the disk */
-    fflush (trans_log);
+    if (fclose (out) != 0 || ferror (in))
+        ok = FALSE;
+    fclose (in);
+    g_byte_array_free (data, TRUE);
+    g_string_free (text, TRUE);
+    return ok;
 }
 
 /************************ END OF ************************************\
@@ -46,7 +46,30 @@
 #include "Account.h"
 #include "Transaction.h"
 
+/** The format of the log files. */
+typedef enum
+{
+    /** Tab separated text, a line per split, as read by the log replay. */
+    XACC_LOG_FORMAT_TEXT,
+    /** Compact binary records, see xaccLogConvertToText(). */
+    XACC_LOG_FORMAT_BINARY,
+} XaccLogFormat;
+
+/** When what xaccTransWriteLog() logs gets to the disk. */
+typedef enum
+{
+    /** Written and flushed before xaccTransWriteLog() returns. */
+    XACC_LOG_DURABILITY_IMMEDIATE,
+    /** Written by a background thread, which flushes the file after each
+     *  group of records it finds waiting. */
+    XACC_LOG_DURABILITY_GROUP,
+    /** Like XACC_LOG_DURABILITY_GROUP, but the file is also synced to the
+     *  disk after each group. */
+    XACC_LOG_DURABILITY_GROUP_SYNC,
+} XaccLogDurability;
+
 void    xaccOpenLog (void);
+/** Closes the log file once everything logged is written to it. */
 void    xaccCloseLog (void);
 void    xaccReopenLog (void);
 
@@ -81,6 +104,32 @@ void    xaccLogSetBaseName (const char *);
 /** Test a filename to see if it is the name of the current logfile */
 gboolean xaccFileIsCurrentLog (const gchar *name);
 
+/** Set the format of the log files. The default is XACC_LOG_FORMAT_TEXT.
+ *    If the journal file is already open, it will close it and open
+ *    a new one in the new format.
+ */
+void    xaccLogSetFormat (XaccLogFormat format);
+XaccLogFormat xaccLogGetFormat (void);
+
+/** Set when logged transactions get to the disk. The default is
+ *    XACC_LOG_DURABILITY_GROUP, whose queued records are written at the
+ *    latest by xaccCloseLog(), which gnc_engine_shutdown() calls.
+ */
+void    xaccLogSetDurability (XaccLogDurability durability);
+XaccLogDurability xaccLogGetDurability (void);
+
+/** Test whether a file is a binary log file. */
+gboolean xaccLogFileIsBinary (const gchar *name);
+
+/** Convert the binary log file binary_name into a text log file of the
+ *    same records at text_name, replacing any file there. A record cut
+ *    short at the end of the binary file is left out.
+ *
+ * @return FALSE if either file can't be opened, binary_name isn't a
+ *    binary log file or has a malformed record, or writing failed.
+ */
+gboolean xaccLogConvertToText (const gchar *binary_name, const gchar *text_name);
+
 #endif /* XACC_TRANS_LOG_H */
 /** @} */
 /** @} */
@@ -234,6 +234,43 @@ void mark_trans (Transaction *trans)
     FOR_EACH_SPLIT(trans, mark_split(s));
 }
 
+/* The transactions in an open edit. Their splits may not be in the split
+ * indexes of the accounts they're in now, see xaccTransGetOpenList(). */
+static GHashTable *open_transactions = NULL;
+
+static void
+set_trans_open (Transaction *trans, gboolean open)
+{
+    if (open)
+    {
+        if (!open_transactions)
+            open_transactions = g_hash_table_new (g_direct_hash,
+                                                  g_direct_equal);
+        g_hash_table_add (open_transactions, trans);
+    }
+    else if (open_transactions)
+    {
+        g_hash_table_remove (open_transactions, trans);
+    }
+}
+
+GList *
+xaccTransGetOpenList (QofBook *book)
+{
+    GList *list = NULL;
+    GHashTableIter iter;
+    gpointer trans;
+
+    if (!open_transactions)
+        return NULL;
+
+    g_hash_table_iter_init (&iter, open_transactions);
+    while (g_hash_table_iter_next (&iter, &trans, NULL))
+        if (qof_instance_get_book (trans) == book)
+            list = g_list_prepend (list, trans);
+    return list;
+}
+
 G_INLINE_FUNC void gen_event_trans (Transaction *trans);
 void gen_event_trans (Transaction *trans)
 {
@@ -796,6 +833,8 @@ xaccFreeTransaction (Transaction *trans)
         return;
     }
 
+    set_trans_open (trans, FALSE);
+
     /* free up the destination splits */
     for (node = trans->splits; node; node = node->next)
         xaccFreeSplit (node->data);
@@ -1435,6 +1474,8 @@ xaccTransBeginEdit (Transaction *trans)
     if (!trans) return;
     if (!qof_begin_edit(&trans->inst)) return;
 
+    set_trans_open (trans, TRUE);
+
     if (qof_book_shutting_down(qof_instance_get_book(trans))) return;
 
     if (!qof_book_is_readonly(qof_instance_get_book(trans)))
@@ -1623,6 +1664,7 @@ static void trans_cleanup_commit(Transaction *trans)
     /* Put back to zero. */
     qof_instance_decrease_editlevel(trans);
     g_assert(qof_instance_get_editlevel(trans) == 0);
+    set_trans_open (trans, FALSE);
 
     gen_event_trans (trans); //TODO: could be conditional
     qof_event_gen (&trans->inst, QOF_EVENT_MODIFY, NULL);
@@ -1800,6 +1842,15 @@ xaccTransRollbackEdit (Transaction *trans)
     g_list_free(orig->splits);
     orig->splits = NULL;
 
+    /* The dates, amounts and reconcile flags were put back behind the
+     * accounts' backs, so have them look at the splits again. */
+    for (node = trans->splits; node; node = node->next)
+    {
+        Split *s = node->data;
+        if (s->acc)
+            gnc_account_mark_split_dirty (s->acc, s);
+    }
+
     /* Now that the engine copy is back to its original version,
      * get the backend to fix it in the database */
     be = qof_book_get_backend(qof_instance_get_book(trans));
@@ -1852,6 +1903,7 @@ xaccTransRollbackEdit (Transaction *trans)
 
     /* Put back to zero. */
     qof_instance_decrease_editlevel(trans);
+    set_trans_open (trans, FALSE);
     /* FIXME: The register code seems to depend on the engine to
        generate an event during rollback, even though the state is just
        reverting to what it was. */
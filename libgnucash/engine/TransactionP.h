@@ -179,6 +179,11 @@ void xaccEnableDataScrubbing(void);
 void xaccDisableDataScrubbing(void);
 
 void xaccTransRemoveSplit (Transaction *trans, const Split *split);
+
+/* The transactions of book in an open edit, in no particular order. The
+ * splits of those may have moved to an account or date that the account's
+ * split index doesn't know about yet. The caller frees the list. */
+GList * xaccTransGetOpenList (QofBook *book);
 void check_open (const Transaction *trans);
 
 /* Structure for accessing static functions for testing */
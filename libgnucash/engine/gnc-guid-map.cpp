@@ -0,0 +1,153 @@
+/********************************************************************\
+ * gnc-guid-map.cpp -- Flat hash map from GUIDs to QofInstances.    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+#include "gnc-guid-map.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+/* The table never gets fuller than 3/4 so that the probe sequences stay
+ * short, and it never gets smaller than min_capacity slots. Capacities are
+ * powers of two. */
+static const std::size_t min_capacity = 16;
+
+static inline bool
+max_load_exceeded(std::size_t count, std::size_t capacity) noexcept
+{
+    return count * 4 > capacity * 3;
+}
+
+static inline bool
+same_guid(const GncGUID& a, const GncGUID& b) noexcept
+{
+    return memcmp(a.reserved, b.reserved, GUID_DATA_SIZE) == 0;
+}
+
+/* Fold the GUID to 64 bits and use the high bits of its product with
+ * 2^64/phi, which spreads even GUIDs differing in a few bits only evenly
+ * over the table. */
+std::size_t
+GncGUIDMap::home(const GncGUID& guid) const noexcept
+{
+    uint64_t low, high;
+    memcpy(&low, guid.reserved, sizeof(low));
+    memcpy(&high, guid.reserved + sizeof(low), sizeof(high));
+    return static_cast<std::size_t>(((low ^ high) * UINT64_C(0x9e3779b97f4a7c15))
+                                    >> m_shift);
+}
+
+/* The slot holding guid, or else the empty slot where it would go. The table
+ * mustn't be empty. */
+std::size_t
+GncGUIDMap::find(const GncGUID& guid) const noexcept
+{
+    auto mask = m_slots.size() - 1;
+    for (auto pos = home(guid);; pos = (pos + 1) & mask)
+    {
+        const auto& slot = m_slots[pos];
+        if (!slot.inst || same_guid(slot.guid, guid))
+            return pos;
+    }
+}
+
+QofInstance*
+GncGUIDMap::lookup(const GncGUID& guid) const noexcept
+{
+    if (m_slots.empty())
+        return nullptr;
+    return m_slots[find(guid)].inst;
+}
+
+void
+GncGUIDMap::insert(const GncGUID& guid, QofInstance* inst)
+{
+    if (m_slots.empty() || max_load_exceeded(m_size + 1, m_slots.size()))
+        reserve(m_size + 1);
+    auto& slot = m_slots[find(guid)];
+    if (!slot.inst)
+    {
+        slot.guid = guid;
+        ++m_size;
+    }
+    slot.inst = inst;
+}
+
+/* Linear probing can't simply empty the slot, that would cut the probe
+ * sequences running through it. Instead move every following entry of the
+ * run whose home lies at or before the hole into it, so no tombstones are
+ * needed. */
+bool
+GncGUIDMap::erase(const GncGUID& guid) noexcept
+{
+    if (m_slots.empty())
+        return false;
+    auto hole = find(guid);
+    if (!m_slots[hole].inst)
+        return false;
+
+    auto mask = m_slots.size() - 1;
+    for (auto pos = (hole + 1) & mask; m_slots[pos].inst; pos = (pos + 1) & mask)
+    {
+        auto slot_home = home(m_slots[pos].guid);
+        bool stays = hole < pos ? (hole < slot_home && slot_home <= pos)
+                                : (hole < slot_home || slot_home <= pos);
+        if (stays)
+            continue;
+        m_slots[hole] = m_slots[pos];
+        hole = pos;
+    }
+    m_slots[hole].inst = nullptr;
+    --m_size;
+    return true;
+}
+
+void
+GncGUIDMap::reserve(std::size_t count)
+{
+    auto capacity = m_slots.empty() ? min_capacity : m_slots.size();
+    while (max_load_exceeded(count, capacity))
+        capacity *= 2;
+    if (capacity != m_slots.size())
+        rehash(capacity);
+}
+
+void
+GncGUIDMap::rehash(std::size_t capacity)
+{
+    std::vector<Slot> old_slots(capacity, Slot{});
+    old_slots.swap(m_slots);
+
+    m_shift = 64;
+    for (auto n = capacity; n > 1; n >>= 1)
+        --m_shift;
+
+    auto mask = capacity - 1;
+    for (const auto& slot : old_slots)
+    {
+        if (!slot.inst)
+            continue;
+        auto pos = home(slot.guid);
+        while (m_slots[pos].inst)
+            pos = (pos + 1) & mask;
+        m_slots[pos] = slot;
+    }
+}
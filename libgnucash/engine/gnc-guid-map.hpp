@@ -0,0 +1,90 @@
+/********************************************************************\
+ * gnc-guid-map.hpp -- Flat hash map from GUIDs to QofInstances.    *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @file gnc-guid-map.hpp
+ *
+ * GncGUIDMap is the table QofCollection uses to find its entities. It's an
+ * open addressing hash table with linear probing that stores the GUID keys
+ * inline next to the instance pointers, so a lookup is a short scan of
+ * contiguous memory instead of GHashTable's walk through its nodes and the
+ * instances holding the keys. GUIDs are random, so their own bits serve as
+ * the hash after a single multiplication spreading them over the table.
+ *
+ * This is an engine-private header.
+ */
+
+#ifndef GNC_GUID_MAP_HPP
+#define GNC_GUID_MAP_HPP
+
+extern "C"
+{
+#include "guid.h"
+#include "qofinstance.h"
+}
+
+#include <cstddef>
+#include <vector>
+
+class GncGUIDMap
+{
+public:
+    GncGUIDMap() = default;
+
+    std::size_t size() const noexcept { return m_size; }
+
+    /** The instance stored for guid, nullptr if there is none. */
+    QofInstance* lookup(const GncGUID& guid) const noexcept;
+    /** Store inst for guid, replacing the instance stored for it before.
+     *  inst mustn't be nullptr. */
+    void insert(const GncGUID& guid, QofInstance* inst);
+    /** Remove the instance stored for guid.
+     *  @return false if there was none. */
+    bool erase(const GncGUID& guid) noexcept;
+    /** Make room for count entries so that inserting them doesn't have to
+     *  grow the table again. */
+    void reserve(std::size_t count);
+
+    /** Call func with every stored instance, in no particular order. func
+     *  mustn't change the map. */
+    template <typename Func> void for_each(Func func) const
+    {
+        for (const auto& slot : m_slots)
+            if (slot.inst)
+                func(slot.inst);
+    }
+
+private:
+    struct Slot
+    {
+        GncGUID guid;
+        QofInstance* inst;      // nullptr marks an empty slot
+    };
+
+    std::size_t home(const GncGUID& guid) const noexcept;
+    std::size_t find(const GncGUID& guid) const noexcept;
+    void rehash(std::size_t capacity);
+
+    std::vector<Slot> m_slots;
+    std::size_t m_size = 0;
+    unsigned m_shift = 64;
+};
+
+#endif //GNC_GUID_MAP_HPP
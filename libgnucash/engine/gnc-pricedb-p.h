@@ -56,6 +56,9 @@ struct gnc_price_db_s
 {
     QofInstance inst;              /* globally unique object identifier */
     GHashTable *commodity_hash;
+    GHashTable *price_series;      /* see "Price series" in gnc-pricedb.c */
+    GHashTable *conversions;       /* see "Conversion cache" in gnc-pricedb.c */
+    GHashTable *generations;
     gboolean bulk_update;		 /* TRUE while reading XML file, etc. */
 };
 
@@ -44,6 +44,9 @@ static gboolean
 pricedb_pricelist_traversal(GNCPriceDB *db,
                             gboolean (*f)(GList *p, gpointer user_data),
                             gpointer user_data);
+static guint conversion_hash (gconstpointer key);
+static gboolean conversion_equal (gconstpointer a, gconstpointer b);
+static void conversion_free (gpointer data);
 
 enum
 {
@@ -732,30 +735,25 @@ price_list_is_duplicate( gpointer data, gpointer user_data )
     pStruct->isDupl = TRUE;
 }
 
+static gboolean
+price_list_has_duplicate (PriceList *prices, GNCPrice *p)
+{
+    PriceListIsDuplStruct dupl = { p, FALSE };
+
+    g_list_foreach (prices, price_list_is_duplicate, &dupl);
+    return dupl.isDupl;
+}
+
 gboolean
 gnc_price_list_insert(PriceList **prices, GNCPrice *p, gboolean check_dupl)
 {
     GList *result_list;
-    PriceListIsDuplStruct* pStruct;
-    gboolean isDupl;
 
     if (!prices || !p) return FALSE;
     gnc_price_ref(p);
 
-    if (check_dupl)
-    {
-        pStruct = g_new0( PriceListIsDuplStruct, 1 );
-        pStruct->pPrice = p;
-        pStruct->isDupl = FALSE;
-        g_list_foreach( *prices, price_list_is_duplicate, pStruct );
-        isDupl = pStruct->isDupl;
-        g_free( pStruct );
-
-        if ( isDupl )
-        {
-            return TRUE;
-        }
-    }
+    if (check_dupl && price_list_has_duplicate (*prices, p))
+        return TRUE;
 
     result_list = g_list_insert_sorted(*prices, p, compare_prices_by_date);
     if (!result_list) return FALSE;
@@ -821,6 +819,161 @@ gnc_price_list_equal(PriceList *prices1, PriceList *prices2)
     return TRUE;
 }
 
+/* ==================================================================== */
+/* Price series
+
+   Besides the price lists, a GNCPriceDB keeps the prices between each
+   pair of commodities, in either direction, in a GPtrArray in
+   compare_prices_by_date() order. That's the order of the merged price
+   lists of both directions, which the lookups for a commodity and a
+   currency have to search, so they can binary search the array without
+   copying or merging anything. The price_series hash maps PricePairs to
+   these arrays. The arrays don't hold references, the price lists do.
+ */
+
+typedef struct
+{
+    const gnc_commodity *first;
+    const gnc_commodity *second;
+} PricePair;
+
+static void
+price_pair_init (PricePair *pair, const gnc_commodity *a,
+                 const gnc_commodity *b)
+{
+    /* Either direction makes the same pair. */
+    if ((guintptr) a < (guintptr) b)
+    {
+        pair->first = a;
+        pair->second = b;
+    }
+    else
+    {
+        pair->first = b;
+        pair->second = a;
+    }
+}
+
+static guint
+price_pair_hash (gconstpointer key)
+{
+    const PricePair *pair = key;
+    return g_direct_hash (pair->first) * 31 + g_direct_hash (pair->second);
+}
+
+static gboolean
+price_pair_equal (gconstpointer a, gconstpointer b)
+{
+    const PricePair *pair_a = a;
+    const PricePair *pair_b = b;
+    return pair_a->first == pair_b->first && pair_a->second == pair_b->second;
+}
+
+static GPtrArray *
+price_series_lookup (GNCPriceDB *db, const gnc_commodity *commodity,
+                     const gnc_commodity *currency)
+{
+    PricePair pair;
+
+    if (!db->price_series) return NULL;
+    price_pair_init (&pair, commodity, currency);
+    return g_hash_table_lookup (db->price_series, &pair);
+}
+
+/* The index p has or would have in series. */
+static guint
+price_series_position (GPtrArray *series, GNCPrice *p, gboolean *found)
+{
+    guint lo = 0, hi = series->len;
+
+    *found = FALSE;
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+        gint cmp = compare_prices_by_date (g_ptr_array_index (series, mid), p);
+
+        if (cmp == 0)
+        {
+            *found = TRUE;
+            return mid;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* The index of the first, i.e. latest, price in series that isn't later
+ * than t, or series->len if they all are. */
+static guint
+price_series_find (GPtrArray *series, time64 t)
+{
+    guint lo = 0, hi = series->len;
+
+    while (lo < hi)
+    {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (gnc_price_get_time64 (g_ptr_array_index (series, mid)) > t)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void
+price_series_insert (GNCPriceDB *db, GNCPrice *p)
+{
+    PricePair pair;
+    GPtrArray *series;
+    gboolean found;
+    guint pos;
+
+    if (!db->price_series) return;
+
+    price_pair_init (&pair, p->commodity, p->currency);
+    series = g_hash_table_lookup (db->price_series, &pair);
+    if (!series)
+    {
+        PricePair *key = g_new (PricePair, 1);
+
+        *key = pair;
+        series = g_ptr_array_new ();
+        g_hash_table_insert (db->price_series, key, series);
+    }
+
+    pos = price_series_position (series, p, &found);
+    if (!found)
+        g_ptr_array_insert (series, pos, p);
+}
+
+static void
+price_series_remove (GNCPriceDB *db, GNCPrice *p)
+{
+    PricePair pair;
+    GPtrArray *series;
+    gboolean found;
+    guint pos;
+
+    if (!db->price_series) return;
+
+    price_pair_init (&pair, p->commodity, p->currency);
+    series = g_hash_table_lookup (db->price_series, &pair);
+    if (!series) return;
+
+    pos = price_series_position (series, p, &found);
+    if (found && g_ptr_array_index (series, pos) == p)
+        g_ptr_array_remove_index (series, pos);
+    else
+        g_ptr_array_remove (series, p);
+
+    if (series->len == 0)
+        g_hash_table_remove (db->price_series, &pair);
+}
+
 /* ==================================================================== */
 /* GNCPriceDB functions
 
@@ -880,6 +1033,13 @@ gnc_pricedb_create(QofBook * book)
 
     result->commodity_hash = g_hash_table_new(NULL, NULL);
     g_return_val_if_fail (result->commodity_hash, NULL);
+    result->price_series = g_hash_table_new_full (price_pair_hash,
+                                                  price_pair_equal, g_free,
+                                                  (GDestroyNotify) g_ptr_array_unref);
+    result->conversions = g_hash_table_new_full (conversion_hash,
+                                                 conversion_equal,
+                                                 conversion_free, NULL);
+    result->generations = g_hash_table_new (NULL, NULL);
     return result;
 }
 
@@ -919,6 +1079,15 @@ void
 gnc_pricedb_destroy(GNCPriceDB *db)
 {
     if (!db) return;
+    if (db->price_series)
+        g_hash_table_destroy (db->price_series);
+    db->price_series = NULL;
+    if (db->conversions)
+        g_hash_table_destroy (db->conversions);
+    db->conversions = NULL;
+    if (db->generations)
+        g_hash_table_destroy (db->generations);
+    db->generations = NULL;
     if (db->commodity_hash)
     {
         g_hash_table_foreach (db->commodity_hash,
@@ -1130,10 +1299,20 @@ add_price(GNCPriceDB *db, GNCPrice *p)
     }
 
     price_list = g_hash_table_lookup(currency_hash, currency);
-    if (!gnc_price_list_insert(&price_list, p, !db->bulk_update))
+    if (!db->bulk_update && price_list_has_duplicate (price_list, p))
     {
-        LEAVE ("gnc_price_list_insert failed");
-        return FALSE;
+        /* Like gnc_price_list_insert() does for a duplicate. */
+        gnc_price_ref (p);
+    }
+    else
+    {
+        if (!gnc_price_list_insert(&price_list, p, FALSE))
+        {
+            LEAVE ("gnc_price_list_insert failed");
+            return FALSE;
+        }
+        price_series_insert (db, p);
+        conversions_invalidate (db, commodity, currency);
     }
 
     if (!price_list)
@@ -1237,6 +1416,8 @@ remove_price(GNCPriceDB *db, GNCPrice *p, gboolean cleanup)
         LEAVE (" cannot remove price list");
         return FALSE;
     }
+    price_series_remove (db, p);
+    conversions_invalidate (db, commodity, currency);
 
     /* if the price list is empty, then remove this currency from the
        commodity hash */
@@ -1787,20 +1968,17 @@ GNCPrice *gnc_pricedb_lookup_latest(GNCPriceDB *db,
                           const gnc_commodity *commodity,
                           const gnc_commodity *currency)
 {
-    GList *price_list;
+    GPtrArray *series;
     GNCPrice *result;
 
     if (!db || !commodity || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, commodity, currency);
 
-    price_list = pricedb_get_prices_internal(db, commodity, currency, TRUE);
-    if (!price_list) return NULL;
-    /* This works magically because prices are inserted in date-sorted
-     * order, and the latest date always comes first. So return the
-     * first in the list.  */
-    result = price_list->data;
+    series = price_series_lookup (db, commodity, currency);
+    if (!series) return NULL;
+    /* The latest price always comes first. */
+    result = g_ptr_array_index (series, 0);
     gnc_price_ref(result);
-    g_list_free (price_list);
     LEAVE(" ");
     return result;
 }
@@ -2240,26 +2418,25 @@ gnc_pricedb_lookup_at_time64(GNCPriceDB *db,
                              const gnc_commodity *currency,
                              time64 t)
 {
-    GList *price_list;
-    GList *item = NULL;
+    GPtrArray *series;
+    guint i;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    item = price_list;
-    while (item)
+    series = price_series_lookup (db, c, currency);
+    if (series)
     {
-        GNCPrice *p = item->data;
-        time64 price_time = gnc_price_get_time64(p);
-        if (price_time == t)
+        i = price_series_find (series, t);
+        if (i < series->len)
         {
-            gnc_price_ref(p);
-            g_list_free (price_list);
-            return p;
+            GNCPrice *p = g_ptr_array_index (series, i);
+            if (gnc_price_get_time64(p) == t)
+            {
+                gnc_price_ref(p);
+                return p;
+            }
         }
-        item = item->next;
     }
-    g_list_free (price_list);
     LEAVE (" ");
     return NULL;
 }
@@ -2271,36 +2448,24 @@ lookup_nearest_in_time(GNCPriceDB *db,
                        time64 t,
                        gboolean sameday)
 {
-    GList *price_list;
+    GPtrArray *series;
     GNCPrice *current_price = NULL;
     GNCPrice *next_price = NULL;
     GNCPrice *result = NULL;
-    GList *item = NULL;
+    guint i;
 
     if (!db || !c || !currency) return NULL;
     if (t == INT64_MAX) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-
-    /* default answer */
-    current_price = item->data;
+    series = price_series_lookup (db, c, currency);
+    if (!series) return NULL;
 
-    /* find the first candidate past the one we want.  Remember that
-       prices are in most-recent-first order. */
-    while (!next_price && item)
-    {
-        GNCPrice *p = item->data;
-        time64 price_time = gnc_price_get_time64(p);
-        if (price_time <= t)
-        {
-            next_price = item->data;
-            break;
-        }
-        current_price = item->data;
-        item = item->next;
-    }
+    /* find the first candidate past the one we want, and the one before
+       it.  Remember that prices are in most-recent-first order. */
+    i = price_series_find (series, t);
+    if (i < series->len)
+        next_price = g_ptr_array_index (series, i);
+    current_price = g_ptr_array_index (series, i > 0 ? i - 1 : 0);
 
     if (current_price)      /* How can this be null??? */
     {
@@ -2372,7 +2537,6 @@ lookup_nearest_in_time(GNCPriceDB *db,
     }
 
     gnc_price_ref(result);
-    g_list_free (price_list);
     LEAVE (" ");
     return result;
 }
@@ -2393,32 +2557,35 @@ gnc_pricedb_lookup_latest_before_t64 (GNCPriceDB *db,
                                       gnc_commodity *currency,
                                       time64 t)
 {
-    GList *price_list;
+    GPtrArray *series;
     GNCPrice *current_price = NULL;
-    /*  GNCPrice *next_price = NULL;
-        GNCPrice *result = NULL;*/
-    GList *item = NULL;
-    time64 price_time;
+    guint i;
 
     if (!db || !c || !currency) return NULL;
     ENTER ("db=%p commodity=%p currency=%p", db, c, currency);
-    price_list = pricedb_get_prices_internal (db, c, currency, TRUE);
-    if (!price_list) return NULL;
-    item = price_list;
-    do
-    {
-        price_time = gnc_price_get_time64 (item->data);
-        if (price_time <= t)
-            current_price = item->data;
-        item = item->next;
-    }
-    while (price_time > t && item);
+    series = price_series_lookup (db, c, currency);
+    if (!series) return NULL;
+    i = price_series_find (series, t);
+    if (i < series->len)
+        current_price = g_ptr_array_index (series, i);
     gnc_price_ref(current_price);
-    g_list_free (price_list);
     LEAVE (" ");
     return current_price;
 }
 
+static gnc_numeric
+convert_balance_direct (gnc_numeric bal, const gnc_commodity *from,
+                        const gnc_commodity *to, GNCPrice *price)
+{
+    if (gnc_price_get_commodity(price) == from)
+        return gnc_numeric_mul (bal, gnc_price_get_value (price),
+                                gnc_commodity_get_fraction (to),
+                                GNC_HOW_RND_ROUND);
+    return gnc_numeric_div (bal, gnc_price_get_value (price),
+                            gnc_commodity_get_fraction (to),
+                            GNC_HOW_RND_ROUND);
+}
+
 static gnc_numeric
 direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
                            const gnc_commodity *from, const gnc_commodity *to,
@@ -2436,14 +2603,7 @@ direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
         price = gnc_pricedb_lookup_latest(db, from, to);
     if (price == NULL)
         return retval;
-    if (gnc_price_get_commodity(price) == from)
-        retval = gnc_numeric_mul (bal, gnc_price_get_value (price),
-                                  gnc_commodity_get_fraction (to),
-                                  GNC_HOW_RND_ROUND);
-    else
-        retval = gnc_numeric_div (bal, gnc_price_get_value (price),
-                                  gnc_commodity_get_fraction (to),
-                                  GNC_HOW_RND_ROUND);
+    retval = convert_balance_direct (bal, from, to, price);
     gnc_price_unref (price);
     return retval;
 
@@ -2527,18 +2687,14 @@ convert_balance(gnc_numeric bal, const gnc_commodity *from,
                            fraction, GNC_HOW_RND_ROUND);
 
 }
-static gnc_numeric
-indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
-                             const gnc_commodity *from, const gnc_commodity *to,
-                             time64 t )
+static PriceTuple
+lookup_common_prices (GNCPriceDB *db, const gnc_commodity *from,
+                      const gnc_commodity *to, time64 t)
 {
     GList *from_prices = NULL, *to_prices = NULL;
-    PriceTuple tuple;
-    gnc_numeric zero = gnc_numeric_zero();
+    PriceTuple tuple = {NULL, NULL};
     if (from == NULL || to == NULL)
-        return zero;
-    if (gnc_numeric_zero_p(bal))
-        return zero;
+        return tuple;
     if (t == INT64_MAX)
     {
         from_prices = gnc_pricedb_lookup_latest_any_currency(db, from);
@@ -2556,10 +2712,146 @@ indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
                                                                     to, t);
     }
     if (from_prices == NULL || to_prices == NULL)
-        return zero;
+    {
+        gnc_price_list_destroy(from_prices);
+        return tuple;
+    }
     tuple = extract_common_prices(from_prices, to_prices, from, to);
     gnc_price_list_destroy(from_prices);
     gnc_price_list_destroy(to_prices);
+    return tuple;
+}
+
+/* Conversion cache
+
+   Finding the common prices for an indirect conversion means scanning all
+   price lists twice, and reports convert many balances between the same
+   commodities at the same time. So the GNCPriceDB remembers what
+   lookup_common_prices() found, including nothing, for each from, to and
+   time in its conversions hash. The entries hold references to their
+   prices.
+
+   The prices lookup_common_prices() picks from only involve from or to,
+   so an entry only goes stale when a price involving one of them is added
+   or removed. Each commodity has a generation, counted up whenever that
+   happens, in the generations hash; an entry is good as long as the
+   generations of its from and to are those it was made with.
+ */
+
+/* The cache is simply emptied when it gets this big. */
+#define MAX_CONVERSIONS 10000
+
+typedef struct
+{
+    const gnc_commodity *from;
+    const gnc_commodity *to;
+    time64 t;
+    guint from_generation;
+    guint to_generation;
+    PriceTuple tuple;
+} Conversion;
+
+static guint
+conversion_hash (gconstpointer key)
+{
+    const Conversion *conv = key;
+    return (g_direct_hash (conv->from) * 31 + g_direct_hash (conv->to)) * 31 +
+           g_int64_hash (&conv->t);
+}
+
+static gboolean
+conversion_equal (gconstpointer a, gconstpointer b)
+{
+    const Conversion *conv_a = a;
+    const Conversion *conv_b = b;
+    return conv_a->from == conv_b->from && conv_a->to == conv_b->to &&
+           conv_a->t == conv_b->t;
+}
+
+static void
+conversion_free (gpointer data)
+{
+    Conversion *conv = data;
+
+    if (conv->tuple.from)
+    {
+        gnc_price_unref (conv->tuple.from);
+        gnc_price_unref (conv->tuple.to);
+    }
+    g_free (conv);
+}
+
+static guint
+commodity_generation (GNCPriceDB *db, const gnc_commodity *c)
+{
+    return GPOINTER_TO_UINT (g_hash_table_lookup (db->generations, c));
+}
+
+/* Make the cached conversions from or to commodity or currency stale. */
+static void
+conversions_invalidate (GNCPriceDB *db, const gnc_commodity *commodity,
+                        const gnc_commodity *currency)
+{
+    if (!db->generations) return;
+
+    g_hash_table_insert (db->generations, (gpointer) commodity,
+                         GUINT_TO_POINTER (commodity_generation (db, commodity) + 1));
+    g_hash_table_insert (db->generations, (gpointer) currency,
+                         GUINT_TO_POINTER (commodity_generation (db, currency) + 1));
+}
+
+/* Like lookup_common_prices(), but the prices belong to the cache, which
+ * keeps them until a price involving from or to is added or removed. */
+static PriceTuple
+lookup_common_prices_cached (GNCPriceDB *db, const gnc_commodity *from,
+                             const gnc_commodity *to, time64 t)
+{
+    Conversion key, *conv;
+    guint from_generation, to_generation;
+
+    if (!db->conversions)
+    {
+        PriceTuple none = {NULL, NULL};
+        return none;
+    }
+
+    key.from = from;
+    key.to = to;
+    key.t = t;
+    from_generation = commodity_generation (db, from);
+    to_generation = commodity_generation (db, to);
+
+    conv = g_hash_table_lookup (db->conversions, &key);
+    if (conv && conv->from_generation == from_generation &&
+        conv->to_generation == to_generation)
+        return conv->tuple;
+
+    if (!conv && g_hash_table_size (db->conversions) >= MAX_CONVERSIONS)
+        g_hash_table_remove_all (db->conversions);
+
+    if (conv)
+        g_hash_table_remove (db->conversions, conv);
+    conv = g_new (Conversion, 1);
+    *conv = key;
+    conv->from_generation = from_generation;
+    conv->to_generation = to_generation;
+    conv->tuple = lookup_common_prices (db, from, to, t);
+    g_hash_table_add (db->conversions, conv);
+    return conv->tuple;
+}
+
+static gnc_numeric
+indirect_balance_conversion (GNCPriceDB *db, gnc_numeric bal,
+                             const gnc_commodity *from, const gnc_commodity *to,
+                             time64 t )
+{
+    PriceTuple tuple;
+    gnc_numeric zero = gnc_numeric_zero();
+    if (from == NULL || to == NULL)
+        return zero;
+    if (gnc_numeric_zero_p(bal))
+        return zero;
+    tuple = lookup_common_prices_cached(db, from, to, t);
     if (tuple.from)
         return convert_balance(bal, from, to, tuple);
     return zero;
@@ -2595,6 +2887,56 @@ gnc_pricedb_convert_balance_latest_price(GNCPriceDB *pdb,
                                        new_currency, INT64_MAX);
 }
 
+void
+gnc_pricedb_convert_balances_latest_price(GNCPriceDB *pdb,
+                                          gnc_numeric *balances,
+                                          gsize n_balances,
+                                          const gnc_commodity *balance_currency,
+                                          const gnc_commodity *new_currency)
+{
+    GNCPrice *price = NULL;
+    PriceTuple tuple = {NULL, NULL};
+    gboolean have_tuple = FALSE;
+    gsize i;
+
+    if (gnc_commodity_equiv (balance_currency, new_currency))
+        return;
+
+    if (balance_currency && new_currency)
+        price = gnc_pricedb_lookup_latest(pdb, balance_currency, new_currency);
+
+    for (i = 0; i < n_balances; i++)
+    {
+        gnc_numeric new_value = gnc_numeric_zero();
+
+        if (gnc_numeric_zero_p (balances[i]))
+            continue;
+
+        /* The same two steps as in
+         * gnc_pricedb_convert_balance_latest_price, with the prices
+         * looked up only the first time they're needed. */
+        if (price)
+            new_value = convert_balance_direct (balances[i], balance_currency,
+                                                new_currency, price);
+        if (gnc_numeric_zero_p (new_value))
+        {
+            if (!have_tuple)
+            {
+                tuple = lookup_common_prices_cached (pdb, balance_currency,
+                                                     new_currency, INT64_MAX);
+                have_tuple = TRUE;
+            }
+            if (tuple.from)
+                new_value = convert_balance (balances[i], balance_currency,
+                                             new_currency, tuple);
+        }
+        balances[i] = new_value;
+    }
+
+    if (price)
+        gnc_price_unref (price);
+}
+
 gnc_numeric
 gnc_pricedb_convert_balance_nearest_price_t64(GNCPriceDB *pdb,
                                               gnc_numeric balance,
@@ -574,6 +574,26 @@ gnc_pricedb_convert_balance_latest_price(GNCPriceDB *pdb,
                                          const gnc_commodity *balance_currency,
                                          const gnc_commodity *new_currency);
 
+/** @brief Convert a number of balances from one currency to another using the
+ * most recent price between the two.
+ *
+ * Gives the same results as calling
+ * gnc_pricedb_convert_balance_latest_price() on each balance, but looks up
+ * the prices only once.
+ * @param pdb The pricedb
+ * @param balances The balances to be converted, replaced by the results
+ * @param n_balances The number of balances
+ * @param balance_currency The commodity in which the balances are currently
+ * expressed
+ * @param new_currency The commodity to which the balances should be converted
+ */
+void
+gnc_pricedb_convert_balances_latest_price(GNCPriceDB *pdb,
+                                          gnc_numeric *balances,
+                                          gsize n_balances,
+                                          const gnc_commodity *balance_currency,
+                                          const gnc_commodity *new_currency);
+
 /** @brief Convert a balance from one currency to another using the price
  * nearest to the given time.
  * @param pdb The pricedb
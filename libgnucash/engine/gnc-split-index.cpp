@@ -0,0 +1,717 @@
+/********************************************************************\
+ * gnc-split-index.cpp -- Ordered, blocked storage of the splits    *
+ *                        belonging to an account.                  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+extern "C"
+{
+#include <config.h>
+#include <glib.h>
+#include "Split.h"
+#include "SplitP.h"
+#include "Transaction.h"
+}
+
+#include "gnc-split-index.hpp"
+#include <algorithm>
+#include <limits>
+
+/* Blocks are filled to block_fill entries when the index is rebuilt and
+ * split in two once they grow past block_max entries. */
+static const std::size_t block_fill = 128;
+static const std::size_t block_max = 256;
+
+/* Splits are only ever compared with xaccSplitOrder, like g_list_sort did. */
+static inline bool
+split_less (const Split* a, const Split* b)
+{
+    return xaccSplitOrder (a, b) < 0;
+}
+
+/* The date the index is ordered by first, see xaccTransOrder(). */
+static inline time64
+posted_date (const Split* split)
+{
+    auto trans = xaccSplitGetParent (split);
+    return trans ? xaccTransRetDatePosted (trans) :
+        std::numeric_limits<time64>::max ();
+}
+
+static inline SplitBalances
+zero_balances ()
+{
+    return {gnc_numeric_zero (), gnc_numeric_zero (), gnc_numeric_zero ()};
+}
+
+static inline bool
+balances_eq (const SplitBalances& a, const SplitBalances& b)
+{
+    return gnc_numeric_eq (a.balance, b.balance) &&
+        gnc_numeric_eq (a.cleared, b.cleared) &&
+        gnc_numeric_eq (a.reconciled, b.reconciled);
+}
+
+/* The same rules xaccAccountRecomputeBalance always used: Anything that
+ * isn't NREC is cleared, and reconciled means YREC or FREC. */
+static inline void
+add_split (SplitBalances& bal, const Split* split)
+{
+    auto amt = split->amount;
+    bal.balance = gnc_numeric_add_fixed (bal.balance, amt);
+    if (NREC != split->reconciled)
+        bal.cleared = gnc_numeric_add_fixed (bal.cleared, amt);
+    if (YREC == split->reconciled || FREC == split->reconciled)
+        bal.reconciled = gnc_numeric_add_fixed (bal.reconciled, amt);
+}
+
+/* A block's amount column holds numerators below column_max, so adding up
+ * a whole block of them, or adding them to a start balance below
+ * column_start_max, can't overflow. */
+static const gint64 column_max = INT64_C(1) << 52;
+static const gint64 column_start_max = INT64_C(1) << 61;
+static_assert (block_max + 1 < 512, "A block's column total could overflow.");
+
+enum : guint8
+{
+    column_cleared = 1,
+    column_reconciled = 2
+};
+
+/* The reconcile flag of split the way add_split() reads it. */
+static inline guint8
+split_flags (const Split* split)
+{
+    guint8 flags = 0;
+    if (NREC != split->reconciled)
+        flags |= column_cleared;
+    if (YREC == split->reconciled || FREC == split->reconciled)
+        flags |= column_reconciled;
+    return flags;
+}
+
+/* The denominator most of the amounts have, or one of them if none has a
+ * majority. Boyer-Moore voting, so it takes a single pass. */
+static gint64
+common_denom (const std::vector<SplitIndexEntry>& entries)
+{
+    gint64 denom = 0;
+    std::size_t votes = 0;
+    for (auto& entry : entries)
+    {
+        auto d = entry.split->amount.denom;
+        if (votes == 0)
+            denom = d;
+        if (d == denom)
+            ++votes;
+        else
+            --votes;
+    }
+    return denom;
+}
+
+static void
+build_columns (SplitIndexBlock* block)
+{
+    auto& entries = block->entries;
+    auto denom = common_denom (entries);
+    block->amounts.resize (entries.size ());
+    block->flags.resize (entries.size ());
+    block->outliers.clear ();
+    block->amount_denom = denom;
+    for (std::size_t i = 0; i < entries.size (); ++i)
+    {
+        auto split = entries[i].split;
+        auto amt = split->amount;
+        if (denom > 0 && amt.denom == denom &&
+            amt.num < column_max && amt.num > -column_max)
+        {
+            block->amounts[i] = amt.num;
+            block->flags[i] = split_flags (split);
+        }
+        else
+        {
+            block->amounts[i] = 0;
+            block->flags[i] = 0;
+            block->outliers.push_back (i);
+        }
+    }
+    block->columns_valid = true;
+}
+
+struct ColumnSums
+{
+    gint64 balance;
+    gint64 cleared;
+    gint64 reconciled;
+    guint8 flags;               // the flags of all entries or'ed together
+};
+
+/* The loop has neither branches nor calls, the flags select the cleared and
+ * reconciled amounts through masks, so that the compiler can vectorize it. */
+static ColumnSums
+sum_column (const gint64* amounts, const guint8* flags, std::size_t n)
+{
+    gint64 balance = 0, cleared = 0, reconciled = 0;
+    guint8 seen = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto amt = amounts[i];
+        auto cleared_mask = -static_cast<gint64> (flags[i] & column_cleared);
+        auto reconciled_mask =
+            -static_cast<gint64> ((flags[i] & column_reconciled) >> 1);
+        balance += amt;
+        cleared += amt & cleared_mask;
+        reconciled += amt & reconciled_mask;
+        seen |= flags[i];
+    }
+    return {balance, cleared, reconciled, seen};
+}
+
+/* The totals of block's amounts, the same as add_split() gives when it adds
+ * them up one by one: A total nothing was added to stays 0/1, any other has
+ * the column's denominator unless there are outliers. */
+static SplitBalances
+block_sums (SplitIndexBlock* block)
+{
+    build_columns (block);
+    auto sums = zero_balances ();
+    auto n = block->entries.size ();
+    if (block->outliers.size () < n)
+    {
+        auto col = sum_column (block->amounts.data (), block->flags.data (), n);
+        auto denom = block->amount_denom;
+        sums.balance = gnc_numeric_create (col.balance, denom);
+        if (col.flags & column_cleared)
+            sums.cleared = gnc_numeric_create (col.cleared, denom);
+        if (col.flags & column_reconciled)
+            sums.reconciled = gnc_numeric_create (col.reconciled, denom);
+    }
+    for (auto i : block->outliers)
+        add_split (sums, block->entries[i].split);
+    return sums;
+}
+
+/* A running balance kept as a numerator over the column's denominator.
+ * gnc_numeric_add_fixed() returns the amount itself when adding to zero, so
+ * until an amount is added the balance is exactly what the block started
+ * with and after that it has the column's denominator. */
+struct ColumnRunning
+{
+    explicit ColumnRunning (gnc_numeric start) :
+        m_start{start}, m_num{start.num} {}
+    void add (gint64 amt) { m_num += amt; m_added = true; }
+    gnc_numeric value (gint64 denom) const
+    {
+        return m_added ? gnc_numeric_create (m_num, denom) : m_start;
+    }
+
+private:
+    gnc_numeric m_start;
+    gint64 m_num;
+    bool m_added = false;
+};
+
+static inline bool
+column_start_fits (gnc_numeric start, gint64 denom)
+{
+    return (start.denom == denom || (start.num == 0 && start.denom > 0)) &&
+        start.num < column_start_max && start.num > -column_start_max;
+}
+
+/* Store the running balances of a block without outliers from its columns.
+ * @return false if the balances before the block don't fit the column. */
+static bool
+store_column_balances (SplitIndexBlock* block)
+{
+    auto denom = block->amount_denom;
+    auto& start = block->start;
+    if (!(column_start_fits (start.balance, denom) &&
+          column_start_fits (start.cleared, denom) &&
+          column_start_fits (start.reconciled, denom)))
+        return false;
+
+    ColumnRunning balance{start.balance}, cleared{start.cleared},
+        reconciled{start.reconciled};
+    for (std::size_t i = 0; i < block->entries.size (); ++i)
+    {
+        auto amt = block->amounts[i];
+        auto flags = block->flags[i];
+        auto split = block->entries[i].split;
+        balance.add (amt);
+        if (flags & column_cleared)
+            cleared.add (amt);
+        if (flags & column_reconciled)
+            reconciled.add (amt);
+        split->balance = balance.value (denom);
+        split->cleared_balance = cleared.value (denom);
+        split->reconciled_balance = reconciled.value (denom);
+    }
+    return true;
+}
+
+/* Link node into list just after prev, or at the head if prev is NULL.
+ * The counterpart of g_list_remove_link(). */
+static GList*
+list_link_after (GList* list, GList* prev, GList* node)
+{
+    if (!prev)
+    {
+        node->prev = nullptr;
+        node->next = list;
+        if (list)
+            list->prev = node;
+        return node;
+    }
+    node->prev = prev;
+    node->next = prev->next;
+    if (prev->next)
+        prev->next->prev = node;
+    prev->next = node;
+    return list;
+}
+
+GncSplitIndex::~GncSplitIndex ()
+{
+    clear ();
+}
+
+bool
+GncSplitIndex::contains (const Split* split) const noexcept
+{
+    return split->index_block && split->index_block->owner == this;
+}
+
+void
+GncSplitIndex::insert_sorted (GList*& list, Split* split)
+{
+    auto node = g_list_alloc ();
+    node->data = split;
+    insert_at (list, upper_bound (split), {split, node});
+    /* Splits waiting for the next sort may be anywhere, so the binary
+     * search may have been misled by them. */
+    if (!m_unsorted.empty ())
+        m_unsorted.insert (split);
+}
+
+void
+GncSplitIndex::insert_unsorted (GList*& list, Split* split)
+{
+    auto node = g_list_alloc ();
+    node->data = split;
+    insert_at (list, end (), {split, node});
+    m_unsorted.insert (split);
+}
+
+bool
+GncSplitIndex::remove (GList*& list, Split* split)
+{
+    Position pos;
+    if (!locate (split, pos))
+        return false;
+    auto entry = erase_at (list, pos);
+    g_list_free_1 (entry.node);
+    m_unsorted.erase (split);
+    return true;
+}
+
+void
+GncSplitIndex::clear () noexcept
+{
+    for (auto& block : m_blocks)
+        for (auto& entry : block->entries)
+            entry.split->index_block = nullptr;
+    m_blocks.clear ();
+    m_unsorted.clear ();
+    m_size = 0;
+    m_resort_all = false;
+}
+
+bool
+GncSplitIndex::mark_split_dirty (Split* split)
+{
+    if (!contains (split))
+        return false;
+    /* The amount may already have changed, so the columns can't provide
+     * the balances touch() stores. */
+    split->index_block->columns_valid = false;
+    touch (split->index_block);
+    m_unsorted.insert (split);
+    return true;
+}
+
+void
+GncSplitIndex::sort (GList*& list)
+{
+    /* Moving a split costs a binary search and a block insert, sorting
+     * everything costs n log n comparisons: Only move the splits that are
+     * known to be out of place when there are few enough of them. */
+    if (m_resort_all || m_unsorted.size () > m_size / 4)
+    {
+        list = g_list_sort (list, (GCompareFunc)xaccSplitOrder);
+        rebuild (list);
+        return;
+    }
+
+    std::vector<SplitIndexEntry> moving;
+    moving.reserve (m_unsorted.size ());
+    for (auto split : m_unsorted)
+    {
+        Position pos;
+        if (locate (split, pos))
+            moving.push_back (erase_at (list, pos));
+    }
+    m_unsorted.clear ();
+
+    /* Everything left in the index is in order, so the binary searches
+     * find the right places. */
+    for (auto& entry : moving)
+        insert_at (list, upper_bound (entry.split), entry);
+}
+
+Split*
+GncSplitIndex::last () const noexcept
+{
+    return m_blocks.empty () ? nullptr : m_blocks.back ()->entries.back ().split;
+}
+
+Split*
+GncSplitIndex::last_posted_before (time64 date) const
+{
+    return last_matching ([date](const Split* s) {
+                              return posted_date (s) < date;
+                          });
+}
+
+Split*
+GncSplitIndex::last_posted_by (time64 date) const
+{
+    return last_matching ([date](const Split* s) {
+                              return posted_date (s) <= date;
+                          });
+}
+
+void
+GncSplitIndex::foreach_posted_between (time64 start, time64 end,
+                                       GFunc cb,
+                                       gpointer data) const
+{
+    auto before_start = [start](const Split* s) {
+                            return posted_date (s) < start;
+                        };
+    auto block = std::partition_point (m_blocks.begin (), m_blocks.end (),
+                                       [&before_start](const BlockPtr& b) {
+                                           return before_start (b->entries.back ().split);
+                                       });
+    for (bool first = true; block != m_blocks.end (); ++block, first = false)
+    {
+        auto& entries = (*block)->entries;
+        auto entry = entries.begin ();
+        if (first)
+            entry = std::partition_point (entries.begin (), entries.end (),
+                                          [&before_start](const SplitIndexEntry& e) {
+                                              return before_start (e.split);
+                                          });
+        for (; entry != entries.end (); ++entry)
+        {
+            if (posted_date (entry->split) > end)
+                break;
+            cb (entry->split, data);
+        }
+        if (entry != entries.end ())
+            break;
+    }
+    if (end == std::numeric_limits<time64>::max ())
+        return;
+
+    /* The splits without a transaction come last; their date is whatever
+     * the getter makes of a NULL transaction, so they can't be ruled out. */
+    for (auto b = m_blocks.rbegin (); b != m_blocks.rend (); ++b)
+    {
+        auto& entries = (*b)->entries;
+        for (auto e = entries.rbegin (); e != entries.rend (); ++e)
+        {
+            if (xaccSplitGetParent (e->split))
+                return;
+            cb (e->split, data);
+        }
+    }
+}
+
+/* pred must hold for a leading part of the index and for nothing after it;
+ * return the last split of that part. */
+template <typename Pred> Split*
+GncSplitIndex::last_matching (Pred pred) const
+{
+    auto block = std::partition_point (m_blocks.begin (), m_blocks.end (),
+                                       [&pred](const BlockPtr& b) {
+                                           return pred (b->entries.back ().split);
+                                       });
+    if (block != m_blocks.end ())
+    {
+        auto& entries = (*block)->entries;
+        auto entry = std::partition_point (entries.begin (), entries.end (),
+                                           [&pred](const SplitIndexEntry& e) {
+                                               return pred (e.split);
+                                           });
+        if (entry != entries.begin ())
+            return (entry - 1)->split;
+    }
+    if (block == m_blocks.begin ())
+        return nullptr;
+    return (*(block - 1))->entries.back ().split;
+}
+
+void
+GncSplitIndex::recompute_balances (const SplitBalances& start,
+                                   SplitBalances& end)
+{
+    auto running = start;
+    for (auto& block : m_blocks)
+    {
+        bool changed = block->sums_dirty;
+        if (block->sums_dirty)
+        {
+            block->sums = block_sums (block.get ());
+            block->sums_dirty = false;
+        }
+        if (changed || !balances_eq (block->start, running))
+        {
+            block->start = running;
+            block->balances_stale = true;
+        }
+        running.balance = gnc_numeric_add_fixed (running.balance,
+                                                 block->sums.balance);
+        running.cleared = gnc_numeric_add_fixed (running.cleared,
+                                                 block->sums.cleared);
+        running.reconciled = gnc_numeric_add_fixed (running.reconciled,
+                                                    block->sums.reconciled);
+    }
+    end = running;
+}
+
+void
+GncSplitIndex::invalidate_balances ()
+{
+    for (auto& block : m_blocks)
+    {
+        block->columns_valid = false;
+        touch (block.get ());
+    }
+}
+
+void
+GncSplitIndex::update_split_balances (const Split* split)
+{
+    if (contains (split) && split->index_block->balances_stale)
+        store_balances (split->index_block);
+}
+
+SplitIndexBlock*
+GncSplitIndex::new_block (std::size_t num)
+{
+    BlockPtr block{new SplitIndexBlock};
+    auto raw = block.get ();
+    raw->owner = this;
+    raw->sums = zero_balances ();
+    raw->start = zero_balances ();
+    raw->sums_dirty = true;
+    raw->amount_denom = 0;
+    raw->columns_valid = false;
+    raw->balances_stale = false;
+    m_blocks.insert (m_blocks.begin () + num, std::move (block));
+    renumber_blocks (num);
+    return raw;
+}
+
+/* Blocks are only added or dropped when one fills up or empties, so
+ * keeping the ordinals saves looking for a block far more often than it
+ * costs. */
+void
+GncSplitIndex::renumber_blocks (std::size_t from) noexcept
+{
+    for (auto num = from; num < m_blocks.size (); ++num)
+        m_blocks[num]->ordinal = num;
+}
+
+std::size_t
+GncSplitIndex::block_number (const SplitIndexBlock* block) const noexcept
+{
+    return block->ordinal;
+}
+
+bool
+GncSplitIndex::locate (const Split* split, Position& pos) const noexcept
+{
+    if (!contains (split))
+        return false;
+    auto block = split->index_block;
+    auto iter = std::find_if (block->entries.begin (), block->entries.end (),
+                              [split](const SplitIndexEntry& e) {
+                                  return e.split == split;
+                              });
+    if (iter == block->entries.end ())
+        return false;
+    pos.block = block_number (block);
+    pos.entry = iter - block->entries.begin ();
+    return true;
+}
+
+GncSplitIndex::Position
+GncSplitIndex::upper_bound (const Split* split) const
+{
+    /* The first block whose last split sorts after split holds the place. */
+    auto block = std::upper_bound (m_blocks.begin (), m_blocks.end (), split,
+                                   [](const Split* s, const BlockPtr& b) {
+                                       return split_less (s, b->entries.back ().split);
+                                   });
+    if (block == m_blocks.end ())
+        return end ();
+    auto& entries = (*block)->entries;
+    auto entry = std::upper_bound (entries.begin (), entries.end (), split,
+                                   [](const Split* s, const SplitIndexEntry& e) {
+                                       return split_less (s, e.split);
+                                   });
+    return {static_cast<std::size_t>(block - m_blocks.begin ()),
+            static_cast<std::size_t>(entry - entries.begin ())};
+}
+
+GncSplitIndex::Position
+GncSplitIndex::end () const noexcept
+{
+    if (m_blocks.empty ())
+        return {0, 0};
+    return {m_blocks.size () - 1, m_blocks.back ()->entries.size ()};
+}
+
+GList*
+GncSplitIndex::node_before (const Position& pos) const noexcept
+{
+    if (pos.entry > 0)
+        return m_blocks[pos.block]->entries[pos.entry - 1].node;
+    if (pos.block > 0)
+        return m_blocks[pos.block - 1]->entries.back ().node;
+    return nullptr;
+}
+
+void
+GncSplitIndex::insert_at (GList*& list, const Position& pos,
+                          SplitIndexEntry entry)
+{
+    if (m_blocks.empty ())
+        new_block (0);
+    auto block = m_blocks[pos.block].get ();
+    touch (block);
+    list = list_link_after (list, node_before (pos), entry.node);
+    block->entries.insert (block->entries.begin () + pos.entry, entry);
+    entry.split->index_block = block;
+    ++m_size;
+    if (block->entries.size () > block_max)
+        split_block (pos.block);
+}
+
+SplitIndexEntry
+GncSplitIndex::erase_at (GList*& list, const Position& pos)
+{
+    auto block = m_blocks[pos.block].get ();
+    touch (block);
+    auto entry = block->entries[pos.entry];
+    block->entries.erase (block->entries.begin () + pos.entry);
+    entry.split->index_block = nullptr;
+    list = g_list_remove_link (list, entry.node);
+    --m_size;
+    if (block->entries.empty ())
+    {
+        m_blocks.erase (m_blocks.begin () + pos.block);
+        renumber_blocks (pos.block);
+    }
+    return entry;
+}
+
+void
+GncSplitIndex::split_block (std::size_t num)
+{
+    auto block = m_blocks[num].get ();
+    touch (block);
+    auto half = block->entries.begin () + block->entries.size () / 2;
+    auto fresh = new_block (num + 1);
+    fresh->entries.assign (half, block->entries.end ());
+    block->entries.erase (half, block->entries.end ());
+    for (auto& entry : fresh->entries)
+        entry.split->index_block = fresh;
+}
+
+void
+GncSplitIndex::rebuild (GList* list)
+{
+    for (auto& block : m_blocks)
+        if (block->balances_stale)
+            store_balances (block.get ());
+    m_blocks.clear ();
+    m_unsorted.clear ();
+    m_size = 0;
+    m_resort_all = false;
+    SplitIndexBlock* block = nullptr;
+    for (auto node = list; node; node = node->next)
+    {
+        auto split = static_cast<Split*>(node->data);
+        if (!block || block->entries.size () >= block_fill)
+        {
+            block = new_block (m_blocks.size ());
+            block->entries.reserve (block_max + 1);
+        }
+        block->entries.push_back ({split, node});
+        split->index_block = block;
+        ++m_size;
+    }
+}
+
+/* Called before block changes in any way that affects the balances. The
+ * splits get the balances of the last recompute before the block forgets
+ * them, just like they kept them until the next recompute when the whole
+ * account was rescanned every time. */
+void
+GncSplitIndex::touch (SplitIndexBlock* block)
+{
+    if (block->balances_stale)
+        store_balances (block);
+    block->sums_dirty = true;
+    block->columns_valid = false;
+}
+
+void
+GncSplitIndex::store_balances (SplitIndexBlock* block)
+{
+    if (block->columns_valid && block->outliers.empty () &&
+        store_column_balances (block))
+    {
+        block->balances_stale = false;
+        return;
+    }
+    auto running = block->start;
+    for (auto& entry : block->entries)
+    {
+        add_split (running, entry.split);
+        entry.split->balance = running.balance;
+        entry.split->cleared_balance = running.cleared;
+        entry.split->reconciled_balance = running.reconciled;
+    }
+    block->balances_stale = false;
+}
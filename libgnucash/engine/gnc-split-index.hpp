@@ -0,0 +1,221 @@
+/********************************************************************\
+ * gnc-split-index.hpp -- Ordered, blocked storage of the splits    *
+ *                        belonging to an account.                  *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+/** @file gnc-split-index.hpp
+ *
+ * The split index keeps an account's splits in xaccSplitOrder() order in a
+ * sequence of small contiguous blocks.  Each split carries a pointer to the
+ * block holding it, so finding, removing and locating a split costs at most
+ * one block scan, and ordered inserts are a binary search over the blocks.
+ *
+ * The account's GList of splits is kept as a compatibility view: every entry
+ * also remembers the GList node holding its split and the index relinks those
+ * nodes itself, so the list always has exactly the same order as the index.
+ *
+ * The index also maintains the running balances of the splits.  Every block
+ * keeps the totals of its splits' amounts and the balances just before its
+ * first split, so recomputing the balances only has to add up the blocks that
+ * changed and carry the block totals forward; the balances stored in the
+ * splits themselves are filled in a block at a time when somebody asks for
+ * them.
+ *
+ * While adding them up, a block also copies the amounts into a column of
+ * int64 numerators over the denominator most of them share, nearly always
+ * the commodity's SCU, and a column of reconcile flags. The totals and the
+ * running balances are computed from those with plain integer additions;
+ * only the amounts that don't fit the column go through gnc_numeric.
+ *
+ * This is an engine-private header; only Account.cpp should use it.
+ */
+
+#ifndef GNC_SPLIT_INDEX_HPP
+#define GNC_SPLIT_INDEX_HPP
+
+extern "C"
+{
+#include <glib.h>
+#include "gnc-engine.h"
+}
+
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+struct GncSplitIndex;
+
+/** The three running balances an account keeps for its splits. */
+struct SplitBalances
+{
+    gnc_numeric balance;
+    gnc_numeric cleared;
+    gnc_numeric reconciled;
+};
+
+/** A split and the node holding it in the account's split GList. */
+struct SplitIndexEntry
+{
+    Split* split;
+    GList* node;
+};
+
+/** A run of consecutive splits of the index.
+ *
+ *  It's a struct because Split needs to use the typename to declare a
+ *  back pointer and Split's API is C.
+ */
+struct SplitIndexBlock
+{
+    GncSplitIndex* owner;
+    /** Where the block is in the owner's blocks. */
+    std::size_t ordinal;
+    std::vector<SplitIndexEntry> entries;
+    /** The totals of the amounts of entries, valid unless sums_dirty. */
+    SplitBalances sums;
+    /** The balances before the first of entries as of the last
+     *  GncSplitIndex::recompute_balances(). */
+    SplitBalances start;
+    bool sums_dirty;
+    /** The numerators of the entries' amounts over amount_denom, 0 for the
+     *  entries listed in outliers. Valid while columns_valid. */
+    std::vector<gint64> amounts;
+    /** Whether each entry counts as cleared and as reconciled, 0 for the
+     *  outliers. */
+    std::vector<guint8> flags;
+    /** The entries whose amount has another denominator or is too big for
+     *  the column, which are added up the slow way. */
+    std::vector<std::size_t> outliers;
+    gint64 amount_denom;
+    /** The columns reflect the entries' amounts as of the last time sums
+     *  were computed. */
+    bool columns_valid;
+    /** The balances stored in the splits don't reflect start yet. */
+    bool balances_stale;
+};
+
+/** The split index of an account.
+ *
+ *  It's a struct because AccountPrivate needs to use the typename to declare
+ *  a pointer to it, and AccountPrivate is also seen by C code.
+ */
+struct GncSplitIndex
+{
+public:
+    GncSplitIndex() = default;
+    GncSplitIndex(const GncSplitIndex&) = delete;
+    GncSplitIndex& operator=(const GncSplitIndex&) = delete;
+    /** Releases the blocks after clearing the splits' pointers to them,
+     *  see clear(). */
+    ~GncSplitIndex();
+
+    std::size_t size() const noexcept { return m_size; }
+    bool empty() const noexcept { return m_size == 0; }
+    bool contains(const Split* split) const noexcept;
+
+    /** Insert split at its place in the order, linking it into list next to
+     *  its neighbor. Costs a binary search over the blocks plus one block
+     *  insert. */
+    void insert_sorted(GList*& list, Split* split);
+    /** Append split without looking for its place and remember it for the
+     *  next sort(). Used while the account is being edited, when the sort
+     *  keys of the splits may still be changing. */
+    void insert_unsorted(GList*& list, Split* split);
+    /** Remove split from the index and from list.
+     *  @return false if split isn't in this index. */
+    bool remove(GList*& list, Split* split);
+    /** Forget all splits, clearing their pointers to the blocks; list is
+     *  freed by the caller. The splits must still be around: When the book
+     *  is shut down, the accounts go before the transactions free them. */
+    void clear() noexcept;
+
+    /** Note that the sort key, amount or reconcile flag of split changed.
+     *  @return false if split isn't in this index. */
+    bool mark_split_dirty(Split* split);
+    /** Note that the order may be wrong anywhere, so the next sort() must
+     *  sort everything. */
+    void invalidate_order() noexcept { m_resort_all = true; }
+
+    /** Restore the order of the index and of list. Only the splits marked
+     *  dirty or inserted unsorted are moved unless invalidate_order() was
+     *  called or a large part of the index needs placing. */
+    void sort(GList*& list);
+
+    /** The last split of the index, nullptr if it's empty. */
+    Split* last() const noexcept;
+    /** The last split posted strictly before date, nullptr if there's none.
+     *  Costs two binary searches, and like them only works while the index
+     *  is sorted. Splits without a transaction count as posted after any
+     *  date, since xaccSplitOrder() puts them last. */
+    Split* last_posted_before(time64 date) const;
+    /** The last split posted on or before date, see last_posted_before(). */
+    Split* last_posted_by(time64 date) const;
+    /** Call cb with each split posted from start to end, inclusive, in
+     *  order. The splits without a transaction are passed as well unless
+     *  end is the largest time64, since a date query can't rule them out.
+     *  Like last_posted_before(), only works while the index is sorted. */
+    void foreach_posted_between(time64 start, time64 end,
+                                GFunc cb, gpointer data) const;
+
+    /** Recompute the running balances of all splits, starting at start, and
+     *  return the closing balances in end. Only the blocks that changed since
+     *  the last call are added up; the others just pass on their totals. The
+     *  splits' own balance fields are brought up to date lazily by
+     *  update_split_balances(). */
+    void recompute_balances(const SplitBalances& start, SplitBalances& end);
+    /** Note that any of the amounts or reconcile flags may have changed. */
+    void invalidate_balances();
+    /** Store the balances of the last recompute_balances() into split and
+     *  the other splits of its block if that hasn't been done yet. */
+    void update_split_balances(const Split* split);
+
+private:
+    using BlockPtr = std::unique_ptr<SplitIndexBlock>;
+    using BlockVec = std::vector<BlockPtr>;
+    struct Position
+    {
+        std::size_t block;
+        std::size_t entry;
+    };
+
+    SplitIndexBlock* new_block(std::size_t num);
+    void renumber_blocks(std::size_t from) noexcept;
+    std::size_t block_number(const SplitIndexBlock* block) const noexcept;
+    bool locate(const Split* split, Position& pos) const noexcept;
+    Position upper_bound(const Split* split) const;
+    Position end() const noexcept;
+    template <typename Pred> Split* last_matching(Pred pred) const;
+    GList* node_before(const Position& pos) const noexcept;
+    void insert_at(GList*& list, const Position& pos, SplitIndexEntry entry);
+    SplitIndexEntry erase_at(GList*& list, const Position& pos);
+    void split_block(std::size_t num);
+    void rebuild(GList* list);
+    void touch(SplitIndexBlock* block);
+    void store_balances(SplitIndexBlock* block);
+
+    BlockVec m_blocks;
+    std::size_t m_size = 0;
+    /** Splits whose place in the order needs checking at the next sort. */
+    std::unordered_set<Split*> m_unsorted;
+    bool m_resort_all = false;
+};
+
+#endif //GNC_SPLIT_INDEX_HPP
@@ -45,14 +45,27 @@ static QofLogModule log_module = "qof.kvp";
 
 static const char delim = '/';
 
+static inline bool
+key_less (const KvpFrameImpl::map_type::value_type& slot, const char* key) noexcept
+{
+    return slot.first != key && std::strcmp (slot.first, key) < 0;
+}
+
+static inline bool
+key_equal (const char* slot_key, const char* key) noexcept
+{
+    return slot_key == key || std::strcmp (slot_key, key) == 0;
+}
+
 KvpFrameImpl::KvpFrameImpl(const KvpFrameImpl & rhs) noexcept
 {
+    m_valuemap.reserve(rhs.m_valuemap.size());
     std::for_each(rhs.m_valuemap.begin(), rhs.m_valuemap.end(),
         [this](const map_type::value_type & a)
         {
             auto key = static_cast<char *>(qof_string_cache_insert(a.first));
             auto val = new KvpValueImpl(*a.second);
-            this->m_valuemap.insert({key,val});
+            this->m_valuemap.emplace_back(key,val);
         }
     );
 }
@@ -68,34 +81,57 @@ KvpFrameImpl::~KvpFrameImpl() noexcept
     m_valuemap.clear();
 }
 
+KvpFrameImpl::map_type::iterator
+KvpFrameImpl::lower_bound (const char* key) noexcept
+{
+    return std::lower_bound (m_valuemap.begin (), m_valuemap.end (), key,
+                             key_less);
+}
+
+KvpFrameImpl::map_type::const_iterator
+KvpFrameImpl::find (const char* key) const noexcept
+{
+    auto spot = std::lower_bound (m_valuemap.begin (), m_valuemap.end (), key,
+                                  key_less);
+    if (spot != m_valuemap.end () && key_equal (spot->first, key))
+        return spot;
+    return m_valuemap.end ();
+}
+
 KvpFrame *
 KvpFrame::get_child_frame_or_nullptr (Path const & path) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    if (m_valuemap.find (key.c_str ()) == m_valuemap.end ())
-        return nullptr;
-    auto child = m_valuemap.at (key.c_str ())->get <KvpFrame *> ();
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    return child->get_child_frame_or_nullptr (send);
+    KvpFrame* frame = this;
+    for (auto const & key : path)
+    {
+        auto spot = frame->find (key.c_str ());
+        if (spot == frame->m_valuemap.end ())
+            return nullptr;
+        frame = spot->second->get <KvpFrame *> ();
+        if (!frame)
+            return nullptr;
+    }
+    return frame;
 }
 
 KvpFrame *
 KvpFrame::get_child_frame_or_create (Path const & path) noexcept
 {
-    if (!path.size ())
-        return this;
-    auto key = path.front ();
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot == m_valuemap.end () || spot->second->get_type () != KvpValue::Type::FRAME)
-        delete set_impl (key.c_str (), new KvpValue {new KvpFrame});
-    Path send;
-    std::copy (path.begin () + 1, path.end (), std::back_inserter (send));
-    auto child_val = m_valuemap.at (key.c_str ());
-    auto child = child_val->get <KvpFrame *> ();
-    return child->get_child_frame_or_create (send);
+    KvpFrame* frame = this;
+    for (auto const & key : path)
+    {
+        auto spot = frame->find (key.c_str ());
+        if (spot == frame->m_valuemap.end () ||
+            spot->second->get_type () != KvpValue::Type::FRAME)
+        {
+            auto child = new KvpFrame;
+            delete frame->set_impl (key, new KvpValue {child});
+            frame = child;
+        }
+        else
+            frame = spot->second->get <KvpFrame *> ();
+    }
+    return frame;
 }
 
 
@@ -103,17 +139,22 @@ KvpValue *
 KvpFrame::set_impl (std::string const & key, KvpValue * value) noexcept
 {
     KvpValue * ret {};
-    auto spot = m_valuemap.find (key.c_str ());
-    if (spot != m_valuemap.end ())
+    auto spot = lower_bound (key.c_str ());
+    if (spot != m_valuemap.end () && key_equal (spot->first, key.c_str ()))
     {
-        qof_string_cache_remove (spot->first);
         ret = spot->second;
+        if (value)
+        {
+            spot->second = value;
+            return ret;
+        }
+        qof_string_cache_remove (spot->first);
         m_valuemap.erase (spot);
     }
-    if (value)
+    else if (value)
     {
         auto cachedkey = static_cast <char const *> (qof_string_cache_insert (key.c_str ()));
-        m_valuemap.emplace (cachedkey, value);
+        m_valuemap.emplace (spot, cachedkey, value);
     }
     return ret;
 }
@@ -150,7 +191,7 @@ KvpFrameImpl::get_slot (Path path) noexcept
     auto target = get_child_frame_or_nullptr (path);
     if (!target)
         return nullptr;
-    auto spot = target->m_valuemap.find (key.c_str ());
+    auto spot = target->find (key.c_str ());
     if (spot != target->m_valuemap.end ())
         return spot->second;
     return nullptr;
@@ -218,7 +259,7 @@ int compare(const KvpFrameImpl & one, const KvpFrameImpl & two) noexcept
 {
     for (const auto & a : one.m_valuemap)
     {
-        auto otherspot = two.m_valuemap.find(a.first);
+        auto otherspot = two.find(a.first);
         if (otherspot == two.m_valuemap.end())
         {
             return 1;
@@ -85,8 +85,8 @@
 #define GNC_KVP_FRAME_TYPE
 
 #include "kvp-value.hpp"
-#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 #include <cstring>
 #include <algorithm>
@@ -108,17 +108,11 @@ using KvpEntry = std::pair <std::vector <std::string>, KvpValue*>;
  */
 struct KvpFrameImpl
 {
-    class cstring_comparer
-    {
-    public:
-	/* Returns true if one is less than two. */
-	bool operator()(const char * one, const char * two) const
-	    {
-		auto ret = std::strcmp(one, two) < 0;
-		return ret;
-	    }
-    };
-    using map_type = std::map<const char *, KvpValue*, cstring_comparer>;
+    /* The slots are kept in a vector sorted by key rather than in a map: most
+     * frames hold only a handful of slots, and a vector of them is much
+     * smaller than as many tree nodes and quicker to search. The keys are
+     * interned in the qof string cache. */
+    using map_type = std::vector<std::pair<const char *, KvpValue*>>;
 
     public:
     KvpFrameImpl() noexcept {};
@@ -229,6 +223,8 @@ struct KvpFrameImpl
     private:
     map_type m_valuemap;
 
+    map_type::iterator lower_bound (const char *) noexcept;
+    map_type::const_iterator find (const char *) const noexcept;
     KvpFrame * get_child_frame_or_nullptr (Path const &) noexcept;
     KvpFrame * get_child_frame_or_create (Path const &) noexcept;
     void flatten_kvp_impl(std::vector <std::string>, std::vector <KvpEntry> &) const noexcept;
@@ -162,6 +162,14 @@ qof_backend_rollback_instance (QofBackend* qof_be, QofInstance* inst)
     ((QofBackend*)qof_be)->rollback(inst);
 }
 
+void
+qof_backend_load_history (QofBackend* qof_be, QofBook* book,
+                          const GList* account_guids, time64 since)
+{
+    if (qof_be == nullptr) return;
+    ((QofBackend*)qof_be)->load_history(book, account_guids, since);
+}
+
 gboolean
 qof_load_backend_library (const char *directory, const char* module_name)
 {
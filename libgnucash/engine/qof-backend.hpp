@@ -227,6 +227,21 @@ public:
  *    better to wait for the query).
  */
     virtual void load (QofBook*, QofBackendLoadType) = 0;
+/**
+ *    Load the transactions posted on or after a time that have splits in the
+ *    accounts with the GUIDs in a list, or in any account if the list is
+ *    NULL. Only backends that load just the recent part of the book's history
+ *    at first need to implement it; queries call it before they run.
+ */
+    virtual void load_history (QofBook*, const GList*, time64) {}
+/**
+ *    Load the objects that a query is about to look for in a book, if the
+ *    backend can tell which ones they are from the query itself. It may load
+ *    more than match, the query weeds those out, but must load all that do.
+ *    Returns false if it can't, in which case the loader registered for the
+ *    type the query looks for narrows the load down as well as it can.
+ */
+    virtual bool load_query (QofBook*, QofQuery*) { return false; }
 /**
  *    Called when the engine is about to make a change to a data structure. It
  *    could provide an advisory lock on data, but no backend does this.
@@ -139,6 +139,11 @@ typedef struct QofBackend QofBackend;
 /* Temporary wrapper so that we don't have to expose qof-backend.hpp to Transaction.c */
     gboolean qof_backend_can_rollback (QofBackend*);
     void qof_backend_rollback_instance (QofBackend*, QofInstance*);
+/** Have the backend load the older transactions of the accounts with the
+ *  GUIDs in account_guids, or all accounts if it's NULL, back to since, if it
+ *  hasn't already. */
+    void qof_backend_load_history (QofBackend*, QofBook*,
+                                   const GList* account_guids, time64 since);
 
 /** \brief Load a QOF-compatible backend shared library.
 
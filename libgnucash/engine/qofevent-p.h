@@ -34,9 +34,18 @@ typedef struct
     gpointer user_data;
 
     gint handler_id;
+
+    /* Set instead of handler for batch handlers, with the entity types
+     * they want or NULL for all of them. */
+    QofEventBatchHandler batch_handler;
+    gchar **types;
 } HandlerInfo;
 
 /* generates an event even when events are suspended! */
 void qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data);
 
+/* How many events were dropped while events were suspended, so far.  Those
+ * watching the events can tell from it that they missed some. */
+guint qof_event_get_dropped_count (void);
+
 #endif
@@ -31,12 +31,22 @@ extern "C"
 #include "qof.h"
 #include "qofevent-p.h"
 
+#include <unordered_map>
+#include <vector>
+
 /* Static Variables ************************************************/
 static guint   suspend_counter   = 0;
 static gint    next_handler_id   = 1;
 static guint   handler_run_level = 0;
 static guint   pending_deletes   = 0;
 static GList   *handlers  =   NULL;
+static guint   batch_handlers    = 0;
+static guint   batch_level       = 0;
+static guint   dropped_events    = 0;
+
+/* The events of the current batch, an item per entity. */
+static std::vector<QofEventBatchItem> batch_items;
+static std::unordered_map<QofInstance*, std::size_t> batch_index;
 
 /* This static indicates the debugging module that this .o belongs to.  */
 static QofLogModule log_module = QOF_MOD_ENGINE;
@@ -102,6 +112,54 @@ qof_event_register_handler (QofEventHandler handler, gpointer user_data)
     return handler_id;
 }
 
+gint
+qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                  const QofIdTypeConst *types,
+                                  gpointer user_data)
+{
+    HandlerInfo *hi;
+    gint handler_id;
+
+    ENTER ("(handler=%p, data=%p)", handler, user_data);
+
+    /* sanity check */
+    if (!handler)
+    {
+        PERR ("no handler specified");
+        return 0;
+    }
+
+    handler_id = find_next_handler_id();
+
+    hi = g_new0 (HandlerInfo, 1);
+
+    hi->batch_handler = handler;
+    hi->user_data = user_data;
+    hi->handler_id = handler_id;
+
+    if (types)
+    {
+        guint n_types = 0;
+        while (types[n_types])
+            n_types++;
+        hi->types = g_new0 (gchar*, n_types + 1);
+        for (guint i = 0; i < n_types; i++)
+            hi->types[i] = g_strdup (types[i]);
+    }
+
+    handlers = g_list_prepend (handlers, hi);
+    batch_handlers++;
+    LEAVE ("(handler=%p, data=%p) handler_id=%d", handler, user_data, handler_id);
+    return handler_id;
+}
+
+static void
+free_handler_info (HandlerInfo *hi)
+{
+    g_strfreev (hi->types);
+    g_free (hi);
+}
+
 void
 qof_event_unregister_handler (gint handler_id)
 {
@@ -123,15 +181,22 @@ qof_event_unregister_handler (gint handler_id)
         if (hi->handler)
             LEAVE ("(handler_id=%d) handler=%p data=%p", handler_id,
                    hi->handler, hi->user_data);
+        else if (hi->batch_handler)
+            LEAVE ("(handler_id=%d) batch handler=%p data=%p", handler_id,
+                   hi->batch_handler, hi->user_data);
+
+        if (hi->batch_handler)
+            batch_handlers--;
 
         /* safety -- clear the handler in case we're running events now */
         hi->handler = NULL;
+        hi->batch_handler = NULL;
 
         if (handler_run_level == 0)
         {
             handlers = g_list_remove_link (handlers, node);
             g_list_free_1 (node);
-            g_free (hi);
+            free_handler_info (hi);
         }
         else
         {
@@ -167,6 +232,135 @@ qof_event_resume (void)
     suspend_counter--;
 }
 
+/* If we're the outermost event runner and we have pending deletes
+ * then go delete the handlers now.
+ */
+static void
+remove_pending_deletes (void)
+{
+    GList *node;
+    GList *next_node = NULL;
+
+    if (handler_run_level != 0 || !pending_deletes)
+        return;
+
+    for (node = handlers; node; node = next_node)
+    {
+        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+        next_node = node->next;
+        if (hi->handler == NULL && hi->batch_handler == NULL)
+        {
+            /* remove this node from the list, then free this node */
+            handlers = g_list_remove_link (handlers, node);
+            g_list_free_1 (node);
+            free_handler_info (hi);
+        }
+    }
+    pending_deletes = 0;
+}
+
+static gboolean
+handler_wants_type (const HandlerInfo *hi, QofIdTypeConst type)
+{
+    if (!hi->types)
+        return TRUE;
+
+    for (gchar **t = hi->types; *t; t++)
+        if (g_strcmp0 (*t, type) == 0)
+            return TRUE;
+    return FALSE;
+}
+
+static void
+deliver_batch (const QofEventBatchItem *items, guint n_items)
+{
+    GList *node;
+    GList *next_node = NULL;
+    std::vector<QofEventBatchItem> wanted;
+
+    handler_run_level++;
+    for (node = handlers; node; node = next_node)
+    {
+        HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
+
+        next_node = node->next;
+        if (!hi->batch_handler)
+            continue;
+
+        if (!hi->types)
+        {
+            PINFO("id=%d hi=%p batch han=%p items=%u", hi->handler_id, hi,
+                  hi->batch_handler, n_items);
+            hi->batch_handler (items, n_items, hi->user_data);
+            continue;
+        }
+
+        wanted.clear ();
+        for (guint i = 0; i < n_items; i++)
+            if (handler_wants_type (hi, items[i].type))
+                wanted.push_back (items[i]);
+        if (wanted.empty ())
+            continue;
+
+        PINFO("id=%d hi=%p batch han=%p items=%u", hi->handler_id, hi,
+              hi->batch_handler, static_cast<guint>(wanted.size ()));
+        hi->batch_handler (wanted.data (), wanted.size (), hi->user_data);
+    }
+    handler_run_level--;
+
+    remove_pending_deletes ();
+}
+
+static void
+add_to_batch (QofInstance *entity, QofEventId event_id)
+{
+    auto result = batch_index.emplace (entity, batch_items.size ());
+    if (result.second)
+        batch_items.push_back (QofEventBatchItem{entity, *guid_null (),
+                                                 entity->e_type,
+                                                 QOF_EVENT_NONE});
+
+    auto& item = batch_items[result.first->second];
+    /* The GUID may change while the entity is being set up. */
+    item.guid = *qof_instance_get_guid (entity);
+    item.event_mask |= event_id;
+
+    /* The entity is about to go, and another one may take its place. */
+    if (event_id & QOF_EVENT_DESTROY)
+    {
+        item.entity = NULL;
+        batch_index.erase (result.first);
+    }
+}
+
+void
+qof_event_begin_batch (void)
+{
+    batch_level++;
+}
+
+void
+qof_event_end_batch (void)
+{
+    if (batch_level == 0)
+    {
+        PERR ("batch level underflow");
+        return;
+    }
+
+    if (--batch_level > 0 || batch_items.empty ())
+        return;
+
+    /* The handlers may generate events of their own, which mustn't end up
+     * in the batch being handed out. */
+    std::vector<QofEventBatchItem> items;
+    items.swap (batch_items);
+    batch_index.clear ();
+
+    if (batch_handlers)
+        deliver_batch (items.data (), items.size ());
+}
+
 static void
 qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
                              gpointer event_data)
@@ -200,27 +394,30 @@ qof_event_generate_internal (QofInstance *entity, QofEventId event_id,
     }
     handler_run_level--;
 
-    /* If we're the outermost event runner and we have pending deletes
-     * then go delete the handlers now.
-     */
-    if (handler_run_level == 0 && pending_deletes)
+    remove_pending_deletes ();
+
+    if (!batch_handlers)
+        return;
+
+    if (batch_level)
     {
-        for (node = handlers; node; node = next_node)
-        {
-            HandlerInfo *hi = static_cast<HandlerInfo*>(node->data);
-            next_node = node->next;
-            if (hi->handler == NULL)
-            {
-                /* remove this node from the list, then free this node */
-                handlers = g_list_remove_link (handlers, node);
-                g_list_free_1 (node);
-                g_free (hi);
-            }
-        }
-        pending_deletes = 0;
+        add_to_batch (entity, event_id);
+    }
+    else
+    {
+        QofEventBatchItem item {event_id & QOF_EVENT_DESTROY ? NULL : entity,
+                                *qof_instance_get_guid (entity),
+                                entity->e_type, event_id};
+        deliver_batch (&item, 1);
     }
 }
 
+guint
+qof_event_get_dropped_count (void)
+{
+    return dropped_events;
+}
+
 void
 qof_event_force (QofInstance *entity, QofEventId event_id, gpointer event_data)
 {
@@ -237,7 +434,10 @@ qof_event_gen (QofInstance *entity, QofEventId event_id, gpointer event_data)
         return;
 
     if (suspend_counter)
+    {
+        dropped_events++;
         return;
+    }
 
     qof_event_generate_internal (entity, event_id, event_data);
 }
@@ -139,6 +139,70 @@ void qof_event_suspend (void);
 /** Resume engine event generation. */
 void qof_event_resume (void);
 
+/** @name Batched events
+
+   Bulk operations like imports, scrubs and scheduled transaction runs
+   generate a great many events, most of them for the same few entities.
+   Handlers registered with qof_event_register_batch_handler() get all of the
+   events generated within a batch scope at once when the outermost scope
+   ends, as one QofEventBatchItem per entity. Outside of a batch scope they
+   get each event as a batch of its own.
+
+   Handlers registered with qof_event_register_handler() aren't affected by
+   batch scopes; they still get every event as it happens.
+ @{
+*/
+
+/** The events an entity got within a batch scope. The event data passed
+ *  to qof_event_gen() isn't kept. */
+typedef struct
+{
+    /** NULL once the entity got a QOF_EVENT_DESTROY, as it's gone by the
+     *  time the batch is handed out. A new entity at the same address
+     *  gets an item of its own. */
+    QofInstance *entity;
+    GncGUID guid;
+    QofIdTypeConst type;
+    /** All of the events the entity got, or'ed together. */
+    QofEventId event_mask;
+} QofEventBatchItem;
+
+/** \brief Handler invoked with a batch of events.
+ *
+ * @param items:        the entities and their events, in the order the
+ *                      entities first got one.
+ * @param n_items:      how many items there are, never 0.
+ * @param handler_data: data supplied when the handler was registered.
+ */
+typedef void (*QofEventBatchHandler) (const QofEventBatchItem *items,
+                                      guint n_items, gpointer handler_data);
+
+/** \brief Register a handler for batches of events.
+ *
+ * @param handler:      handler to register
+ * @param types:        NULL terminated array of the entity types the
+ *                      handler wants events for, NULL for all of them.
+ *                      The array is copied.
+ * @param handler_data: data provided when handler is invoked
+ *
+ * @return id identifying handler, for qof_event_unregister_handler()
+ */
+gint qof_event_register_batch_handler (QofEventBatchHandler handler,
+                                       const QofIdTypeConst *types,
+                                       gpointer handler_data);
+
+/** \brief Start a batch scope.
+ *
+ *    Batch scopes nest. The batch is handed to the batch handlers when the
+ *    qof_event_end_batch() matching the outermost qof_event_begin_batch()
+ *    is called.
+ */
+void qof_event_begin_batch (void);
+
+/** End a batch scope. */
+void qof_event_end_batch (void);
+/** @} */
+
 #ifdef __cplusplus
 }
 #endif
@@ -140,7 +140,7 @@ print error message if its bad  */
 
 @param e_type QofIdType
 @param is_dirty gboolean
-@param hash_of_entities GHashTable
+@param entities GncGUIDMap
 @param data gpointer, place where object class can hang arbitrary data
 
 */
@@ -154,6 +154,11 @@ QofCollection * qof_collection_new (QofIdType type);
 /** return the number of entities in the collection. */
 guint qof_collection_count (const QofCollection *col);
 
+/** Make room for count entities in the collection. Backends can call this
+ * before loading a known number of entities to spare the collection growing
+ * its table over and over again. */
+void qof_collection_reserve (QofCollection *col, guint count);
+
 /** destroy the collection */
 void qof_collection_destroy (QofCollection *col);
 
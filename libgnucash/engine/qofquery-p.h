@@ -71,6 +71,50 @@ QofQueryParamList * qof_query_sort_get_param_path (const QofQuerySort *querysort
 gint qof_query_sort_get_sort_options (const QofQuerySort *querysort);
 gboolean qof_query_sort_get_increasing (const QofQuerySort *querysort);
 
+
+/* Functions to let an object type answer queries from its own indexes */
+
+/* Put the objects of book that could match all of and_terms into
+ * *objects, without looking at every object of the book.  It may list
+ * objects that don't match, the query weeds those out, but must list
+ * every one that does, and none of them twice.  Returns FALSE if none of
+ * the terms narrow the search down, in which case the query looks at all
+ * objects after all.
+ */
+typedef gboolean (*QofQueryIndexFunc) (QofBook *book, const GList *and_terms,
+                                       GList **objects);
+
+/* Use index_fcn for the queries searching for obj_type. */
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               QofQueryIndexFunc index_fcn);
+
+
+/* Functions to let backends that load only part of a book at first load
+ * what a query needs */
+
+/* Have the backend of book load the objects that could match all of
+ * and_terms, all of them if and_terms is NULL, unless it already has. */
+typedef void (*QofQueryLoadFunc) (QofBook *book, const GList *and_terms);
+
+/* Use load_fcn before running the queries searching for obj_type. */
+void qof_query_register_loader (QofIdTypeConst obj_type,
+                                QofQueryLoadFunc load_fcn);
+
+
+/* Functions to tell live queries which objects a change affects */
+
+/* A newly allocated list of the objects whose query parameters may
+ * change when changed, an instance of another type, does, for instance a
+ * transaction's splits.  When changed is destroyed, live queries take
+ * them for gone as well. */
+typedef GList * (*QofQueryDependentsFunc) (QofInstance *changed);
+
+/* Use dependents_fcn to find the obj_type objects live queries have to
+ * check again when an instance of changed_type changes. */
+void qof_query_register_dependents (QofIdTypeConst obj_type,
+                                    QofIdTypeConst changed_type,
+                                    QofQueryDependentsFunc dependents_fcn);
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,11 +36,67 @@ extern "C"
 #include "qof-backend.hpp"
 #include "qofbook-p.h"
 #include "qofclass-p.h"
+#include "qofevent-p.h"
 #include "qofquery-p.h"
 #include "qofquerycore-p.h"
 
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 static QofLogModule log_module = QOF_MOD_QUERY;
 
+/* The QofQueryIndexFuncs by the type of object they find */
+static GHashTable *query_indexes = NULL;
+
+/* The QofQueryLoadFuncs by the type of object they load */
+static GHashTable *query_loaders = NULL;
+
+/* The QofQueryDependentsFuncs */
+struct QofQueryDependents
+{
+    QofIdTypeConst obj_type;
+    QofIdTypeConst changed_type;
+    QofQueryDependentsFunc dependents_fcn;
+};
+static std::vector<QofQueryDependents> query_dependents;
+
+/* The order of a live query's results: that of its sort */
+struct QofQueryLiveLess
+{
+    QofQuery *query;
+    bool operator() (gconstpointer a, gconstpointer b) const;
+};
+using QofQueryLiveResults = std::multiset<gpointer, QofQueryLiveLess>;
+
+/* What a live query keeps to follow the changes to its results.  The
+ * events change these, never the list qof_query_run() handed out, which
+ * is only replaced by the next run. */
+struct QofQueryLive
+{
+    explicit QofQueryLive (QofQuery *q) : results (QofQueryLiveLess {q}) {}
+
+    QofQueryDeltaHandler handler = nullptr;
+    gpointer          user_data = nullptr;
+    gint              handler_id = 0;
+
+    /* The results are up to date: the query was run and hasn't been
+     * changed or missed any events since. */
+    gboolean          synced = FALSE;
+    guint             dropped = 0;    /* qof_event_get_dropped_count() */
+    /* The results have changed since q->results was made from them */
+    gboolean          changed = FALSE;
+
+    /* The results, in order, and where each object is in them along with
+     * its GUID */
+    QofQueryLiveResults results;
+    std::unordered_map<gpointer, std::pair<QofQueryLiveResults::iterator,
+                                           GncGUID>> objects;
+    GHashTable *      by_guid = nullptr;  /* the objects by their GUIDs */
+};
+
 struct _QofQueryTerm
 {
     QofQueryParamList *     param_list;
@@ -54,6 +110,7 @@ struct _QofQueryTerm
      */
     GSList *                param_fcns;
     QofQueryPredicateFunc   pred_fcn;
+    gint                    rank;       /* see term_rank() */
 };
 
 struct _QofQuerySort
@@ -83,6 +140,10 @@ struct _QofQuery
      * logical expression. */
     GList *           terms;
 
+    /* The AND-terms of each OR-term, in the order check_object() tries
+     * them.  Filled in during compilation. */
+    GList *           plan;
+
     /* sorting and chopping is independent of the search filter */
 
     QofQuerySort      primary_sort;
@@ -104,6 +165,9 @@ struct _QofQuery
     gint              changed;
 
     GList *           results;
+
+    /* Set if the results are kept up to date, see qof_query_set_live() */
+    QofQueryLive *    live;
 };
 
 typedef struct _QofQueryCB
@@ -113,6 +177,12 @@ typedef struct _QofQueryCB
     gint              count;
 } QofQueryCB;
 
+static void free_plan (QofQuery *q)
+{
+    g_list_free_full (q->plan, (GDestroyNotify) g_list_free);
+    q->plan = NULL;
+}
+
 /* initial_term will be owned by the new Query */
 static void query_init (QofQuery *q, QofQueryTerm *initial_term)
 {
@@ -131,6 +201,7 @@ static void query_init (QofQuery *q, QofQueryTerm *initial_term)
     if (q->terms)
         qof_query_clear (q);
 
+    free_plan (q);
     g_list_free (q->results);
     g_list_free (q->books);
 
@@ -171,6 +242,8 @@ static void swap_terms (QofQuery *q1, QofQuery *q2)
     q1->books = q2->books;
     q2->books = g;
 
+    free_plan (q1);
+    free_plan (q2);
     q1->changed = 1;
     q2->changed = 1;
 }
@@ -268,6 +341,7 @@ static void free_members (QofQuery *q)
 
     g_list_free(q->terms);
     q->terms = NULL;
+    free_plan (q);
 
     g_list_free(q->books);
     q->books = NULL;
@@ -356,6 +430,13 @@ sort_func (const gconstpointer a, const gconstpointer b, const gpointer q)
     }
 }
 
+static gboolean
+query_is_sorted (const QofQuery *q)
+{
+    return q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
+           (q->primary_sort.use_default && q->defaultSort);
+}
+
 /* ==================================================================== */
 /* This is the main workhorse for performing the query.  For each
  * object, it walks over all of the query terms to see if the
@@ -370,7 +451,7 @@ check_object (const QofQuery *q, gpointer object)
     const QofQueryTerm * qt;
     int       and_terms_ok = 1;
 
-    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+    for (or_ptr = q->plan; or_ptr; or_ptr = or_ptr->next)
     {
         and_terms_ok = 1;
         for (and_ptr = static_cast<GList*>(or_ptr->data); and_ptr;
@@ -508,6 +589,66 @@ compile_sort (QofQuerySort *sort, QofIdType obj)
     LEAVE ("sort=%p id=%s", sort, obj);
 }
 
+/* How soon check_object() should try a term: the terms that are cheap to
+ * check and let few objects through go first, so that most objects fail
+ * after a term or two.  Every parameter looked up on the way costs a call,
+ * and comparing GUIDs and plain values is much cheaper than matching
+ * strings, let alone regular expressions. */
+static gint term_rank (const QofQueryTerm *qt)
+{
+    const QofQueryPredData *pd = qt->pdata;
+    QofType type = pd->type_name;
+    gint rank;
+
+    /* check_object() skips those anyway */
+    if (!qt->param_fcns || !qt->pred_fcn)
+        return 0;
+
+    if (!g_strcmp0 (type, QOF_TYPE_GUID))
+        rank = 0;
+    else if (!g_strcmp0 (type, QOF_TYPE_BOOLEAN) ||
+             !g_strcmp0 (type, QOF_TYPE_CHAR) ||
+             !g_strcmp0 (type, QOF_TYPE_INT32) ||
+             !g_strcmp0 (type, QOF_TYPE_INT64))
+        rank = 10;
+    else if (!g_strcmp0 (type, QOF_TYPE_DATE) ||
+             !g_strcmp0 (type, QOF_TYPE_NUMERIC) ||
+             !g_strcmp0 (type, QOF_TYPE_DOUBLE))
+        rank = 20;
+    else if (!g_strcmp0 (type, QOF_TYPE_STRING))
+        rank = ((const query_string_def *) pd)->is_regex ? 50 : 30;
+    else
+        rank = 40;
+
+    /* An equality lets fewer objects through than a range does */
+    if (pd->how == QOF_COMPARE_EQUAL && !qt->invert)
+        rank -= 5;
+
+    return rank + 2 * g_slist_length (qt->param_fcns);
+}
+
+static gint term_rank_cmp (gconstpointer a, gconstpointer b)
+{
+    return static_cast<const QofQueryTerm*>(a)->rank -
+        static_cast<const QofQueryTerm*>(b)->rank;
+}
+
+/* Order the terms of every AND-term by rank.  g_list_sort() is stable, so
+ * terms of equal rank keep the order they were added in. */
+static void plan_terms (QofQuery *q)
+{
+    GList *or_ptr;
+
+    free_plan (q);
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+    {
+        GList *and_terms = g_list_copy (static_cast<GList*>(or_ptr->data));
+        q->plan = g_list_prepend (q->plan,
+                                  g_list_sort (and_terms, term_rank_cmp));
+    }
+    q->plan = g_list_reverse (q->plan);
+}
+
 static void compile_terms (QofQuery *q)
 {
     GList *or_ptr, *and_ptr, *node;
@@ -539,8 +680,11 @@ static void compile_terms (QofQuery *q)
                 qt->pred_fcn = qof_query_core_get_predicate (resObj->param_type);
             else
                 qt->pred_fcn = NULL;
+
+            qt->rank = term_rank (qt);
         }
     }
+    plan_terms (q);
 
     /* Update the sort functions */
     compile_sort (&(q->primary_sort), q->search_for);
@@ -706,6 +850,7 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
                     q->terms = g_list_remove_link (static_cast<GList*>(q->terms), _or_);
                     g_list_free_1 (_or_);
                     _or_ = q->terms;
+                    q->changed = 1;
                     break;
                 }
                 else
@@ -723,6 +868,52 @@ void qof_query_purge_terms (QofQuery *q, QofQueryParamList *param_list)
     }
 }
 
+/* The last q->max_results of objects in sort order, which is what sorting
+ * all of them and cropping the list would leave, in O(n log k) instead of
+ * O(n log n).  Objects that sort equal keep their order in the list, as
+ * they would with the stable g_list_sort_with_data(). */
+static GList * query_top_results (QofQuery *q, GList *objects)
+{
+    using Ranked = std::pair<gpointer, guint>;
+    auto before = [q](const Ranked& a, const Ranked& b)
+    {
+        int rc = sort_func (a.first, b.first, q);
+        return rc < 0 || (rc == 0 && a.second < b.second);
+    };
+    /* A heap with the first of the objects kept so far on top */
+    auto heap_cmp = [&before](const Ranked& a, const Ranked& b)
+    {
+        return before (b, a);
+    };
+    std::vector<Ranked> kept;
+    std::size_t max = q->max_results;
+    guint pos = 0;
+    GList *node, *result = NULL;
+
+    kept.reserve (max);
+    for (node = objects; node; node = node->next, ++pos)
+    {
+        Ranked obj{node->data, pos};
+        if (kept.size () < max)
+        {
+            kept.push_back (obj);
+            std::push_heap (kept.begin (), kept.end (), heap_cmp);
+        }
+        else if (before (kept.front (), obj))
+        {
+            std::pop_heap (kept.begin (), kept.end (), heap_cmp);
+            kept.back () = obj;
+            std::push_heap (kept.begin (), kept.end (), heap_cmp);
+        }
+    }
+    g_list_free (objects);
+
+    std::sort (kept.begin (), kept.end (), before);
+    for (auto it = kept.rbegin (); it != kept.rend (); ++it)
+        result = g_list_prepend (result, it->first);
+    return result;
+}
+
 static GList * qof_query_run_internal (QofQuery *q,
                                        void(*run_cb)(QofQueryCB*, gpointer),
                                        gpointer cb_arg)
@@ -736,9 +927,8 @@ static GList * qof_query_run_internal (QofQuery *q,
     g_return_val_if_fail (run_cb, NULL);
     ENTER (" q=%p", q);
 
-    /* XXX: Prioritize the query terms? */
-
-    /* prepare the Query for processing */
+    /* prepare the Query for processing; compiling also puts the terms
+     * into the order they're best checked in */
     if (q->changed)
     {
         query_clear_compiles (q);
@@ -772,11 +962,18 @@ static GList * qof_query_run_internal (QofQuery *q,
      */
     matching_objects = g_list_reverse(matching_objects);
 
-    /* Now sort the matching objects based on the search criteria */
-    if (q->primary_sort.comp_fcn || q->primary_sort.obj_cmp ||
-            (q->primary_sort.use_default && q->defaultSort))
+    /* Now sort the matching objects based on the search criteria.  If
+     * only a few of them will be kept, just pick those. */
+    if (query_is_sorted (q))
     {
-        matching_objects = g_list_sort_with_data(matching_objects, sort_func, q);
+        if (q->max_results > 0 && object_count > q->max_results)
+        {
+            matching_objects = query_top_results (q, matching_objects);
+            object_count = q->max_results;
+        }
+        else
+            matching_objects = g_list_sort_with_data(matching_objects,
+                                                     sort_func, q);
     }
 
     /* Crop the list to limit the number of splits. */
@@ -814,6 +1011,74 @@ static GList * qof_query_run_internal (QofQuery *q,
     return matching_objects;
 }
 
+/* Look only at the objects of book the index of the type searched for
+ * finds for the OR-terms of the query.  Returns FALSE if there's no such
+ * index or it can't narrow the search down for some OR-term, since all
+ * objects have to be looked at then anyway. */
+static gboolean query_run_index (QofQueryCB *qcb, QofBook *book)
+{
+    QofQuery *q = qcb->query;
+    QofQueryIndexFunc index_fcn;
+    GList *or_ptr, *node, *objects = NULL;
+    GHashTable *seen = NULL;
+
+    if (!query_indexes || !q->terms)
+        return FALSE;
+    index_fcn = (QofQueryIndexFunc) g_hash_table_lookup (query_indexes,
+                                                         q->search_for);
+    if (!index_fcn)
+        return FALSE;
+
+    for (or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+    {
+        GList *found = NULL;
+
+        if (!index_fcn (book, static_cast<GList*>(or_ptr->data), &found))
+        {
+            g_list_free (objects);
+            g_list_free (found);
+            return FALSE;
+        }
+        objects = g_list_concat (objects, found);
+    }
+
+    /* Different OR-terms may find the same objects */
+    if (q->terms->next)
+        seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+    for (node = objects; node; node = node->next)
+    {
+        if (seen && !g_hash_table_add (seen, node->data))
+            continue;
+        check_item_cb (node->data, qcb);
+    }
+    if (seen)
+        g_hash_table_destroy (seen);
+    g_list_free (objects);
+    return TRUE;
+}
+
+/* Let the backend load what the query may need, if it hasn't already */
+static void query_run_loader (QofQuery *q, QofBook *book)
+{
+    QofBackend *be = qof_book_get_backend (book);
+    QofQueryLoadFunc load_fcn;
+
+    /* Backends that can run the query themselves know best what to load */
+    if (!be || be->load_query (book, q))
+        return;
+    if (!query_loaders)
+        return;
+    load_fcn = (QofQueryLoadFunc) g_hash_table_lookup (query_loaders,
+                                                       q->search_for);
+    if (!load_fcn)
+        return;
+
+    if (!q->terms)
+        load_fcn (book, NULL);
+    for (GList *or_ptr = q->terms; or_ptr; or_ptr = or_ptr->next)
+        load_fcn (book, static_cast<GList*>(or_ptr->data));
+}
+
 static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
 {
     GList *node;
@@ -839,16 +1104,317 @@ static void qof_query_run_cb(QofQueryCB* qcb, gpointer cb_arg)
             }
         }
 #endif
-        /* And then iterate over all the objects */
-        qof_object_foreach (qcb->query->search_for, book,
-                            (QofInstanceForeachCB) check_item_cb, qcb);
+        query_run_loader (qcb->query, book);
+
+        /* And then iterate over all the objects, unless an index can
+         * tell which ones are worth looking at */
+        if (!query_run_index (qcb, book))
+            qof_object_foreach (qcb->query->search_for, book,
+                                (QofInstanceForeachCB) check_item_cb, qcb);
     }
 }
 
+/* ==================================================================== */
+/* Live queries.  Between runs, the results are changed in place as the
+ * events for the objects in them, or that may join them, come in. */
+
+bool
+QofQueryLiveLess::operator() (gconstpointer a, gconstpointer b) const
+{
+    return query_is_sorted (query) &&
+        sort_func (a, b, static_cast<gpointer>(query)) < 0;
+}
+
+/* Drop what the live query knows about its results */
+static void live_forget (QofQueryLive *live)
+{
+    g_hash_table_remove_all (live->by_guid);
+    live->objects.clear ();
+    live->results.clear ();
+    live->synced = FALSE;
+    live->changed = FALSE;
+}
+
+/* Take the results of a run as the ones to keep up to date */
+static void live_sync (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+    GList *node;
+
+    live_forget (live);
+    for (node = q->results; node; node = node->next)
+    {
+        auto it = live->results.insert (live->results.end (), node->data);
+        auto entry = live->objects.emplace (
+            node->data, std::make_pair (it, *qof_instance_get_guid (node->data)));
+        g_hash_table_insert (live->by_guid, &entry.first->second.second,
+                             node->data);
+    }
+    live->synced = TRUE;
+    live->dropped = qof_event_get_dropped_count ();
+}
+
+/* The results can't be kept up to date: drop them until the next run.
+ * The list of the last run is left to whoever is walking it. */
+static void live_reset (QofQuery *q)
+{
+    QofQueryLive *live = q->live;
+    QofQueryDelta delta {QOF_QUERY_DELTA_RESET, NULL, -1, -1};
+
+    live_forget (live);
+    if (live->handler)
+        live->handler (q, &delta, 1, live->user_data);
+}
+
+/* Where it is in the results, if there's a handler to tell */
+static gint live_position (QofQueryLive *live, QofQueryLiveResults::iterator it)
+{
+    if (!live->handler)
+        return -1;
+    return std::distance (live->results.begin (), it);
+}
+
+/* Take object out of the results, returning where it was */
+static gint live_remove (QofQuery *q, gpointer object)
+{
+    QofQueryLive *live = q->live;
+    auto entry = live->objects.find (object);
+    gint pos = live_position (live, entry->second.first);
+
+    live->results.erase (entry->second.first);
+    g_hash_table_remove (live->by_guid, &entry->second.second);
+    live->objects.erase (entry);
+    live->changed = TRUE;
+    return pos;
+}
+
+/* Put object into the results where the sort puts it, after the objects
+ * it sorts equal to, or at the end if there's no sort.  Returns where.
+ * The objects already in must all sort as they did when they went in. */
+static gint live_insert (QofQuery *q, gpointer object)
+{
+    QofQueryLive *live = q->live;
+    auto it = live->results.insert (object);
+    auto entry = live->objects.emplace (
+        object, std::make_pair (it, *qof_instance_get_guid (object)));
+
+    g_hash_table_insert (live->by_guid, &entry.first->second.second, object);
+    live->changed = TRUE;
+    return live_position (live, it);
+}
+
+static QofQueryDependentsFunc
+live_dependents_fcn (const QofQuery *q, QofIdTypeConst changed_type)
+{
+    for (const auto& dep : query_dependents)
+        if (!g_strcmp0 (dep.obj_type, q->search_for) &&
+                !g_strcmp0 (dep.changed_type, changed_type))
+            return dep.dependents_fcn;
+    return NULL;
+}
+
+/* The entity an item is for.  That of a QOF_EVENT_DESTROY is only still
+ * around if the event is handed out as it happens. */
+static QofInstance *
+live_item_entity (const QofQuery *q, const QofEventBatchItem *item)
+{
+    GList *node;
+
+    if (item->entity)
+        return item->entity;
+    if (!(item->event_mask & QOF_EVENT_DESTROY))
+        return NULL;
+
+    for (node = q->books; node; node = node->next)
+    {
+        QofCollection *col =
+            qof_book_get_collection (static_cast<QofBook*>(node->data),
+                                     item->type);
+        QofInstance *inst = qof_collection_lookup_entity (col, &item->guid);
+        if (inst)
+            return inst;
+    }
+    return NULL;
+}
+
+static void live_event_cb (const QofEventBatchItem *items, guint n_items,
+                           gpointer user_data)
+{
+    QofQuery *q = static_cast<QofQuery*>(user_data);
+    QofQueryLive *live = q->live;
+    std::vector<gpointer> changed;
+    std::unordered_set<gpointer> gone;
+    std::vector<QofQueryDelta> deltas;
+    gboolean relevant = FALSE;
+    guint i;
+
+    if (!live->synced)
+        return;
+    if (q->changed || live->dropped != qof_event_get_dropped_count ())
+    {
+        live_reset (q);
+        return;
+    }
+
+    /* An object that's destroyed along with another one, like a split
+     * with its transaction, may not get an event of its own.  If that
+     * other one is gone already, there's no telling which objects went
+     * with it, and none of the items' entities can be trusted. */
+    for (i = 0; i < n_items; i++)
+    {
+        const QofEventBatchItem *item = &items[i];
+
+        if (!g_strcmp0 (item->type, q->search_for))
+            relevant = TRUE;
+        else if (live_dependents_fcn (q, item->type))
+        {
+            relevant = TRUE;
+            if (!live_item_entity (q, item) &&
+                    (item->event_mask & QOF_EVENT_DESTROY))
+            {
+                live_reset (q);
+                return;
+            }
+        }
+    }
+    if (!relevant)
+        return;
+
+    /* The objects cut off by max_results aren't known. */
+    if (q->max_results >= 0)
+    {
+        live_reset (q);
+        return;
+    }
+
+    for (i = 0; i < n_items; i++)
+    {
+        const QofEventBatchItem *item = &items[i];
+        gboolean destroyed = (item->event_mask & QOF_EVENT_DESTROY) != 0;
+        QofQueryDependentsFunc dependents_fcn;
+        GList *dependents, *node;
+
+        if (!g_strcmp0 (item->type, q->search_for))
+        {
+            gpointer object = item->entity;
+            if (destroyed)
+            {
+                object = g_hash_table_lookup (live->by_guid, &item->guid);
+                if (object)
+                    gone.insert (object);
+            }
+            if (object)
+                changed.push_back (object);
+            continue;
+        }
+
+        dependents_fcn = live_dependents_fcn (q, item->type);
+        if (!dependents_fcn)
+            continue;
+        dependents = dependents_fcn (live_item_entity (q, item));
+        for (node = dependents; node; node = node->next)
+        {
+            if (destroyed)
+                gone.insert (node->data);
+            changed.push_back (node->data);
+        }
+        g_list_free (dependents);
+    }
+
+    /* Check each object that changed once, in the order they came in */
+    struct Change { gpointer object; gboolean was_in, is_in; };
+    std::vector<Change> checks;
+    std::unordered_set<gpointer> checked;
+    for (gpointer object : changed)
+    {
+        if (!checked.insert (object).second)
+            continue;
+        checks.push_back ({object, live->objects.count (object) != 0,
+                           !gone.count (object) &&
+                           !qof_instance_get_destroying (object) &&
+                           check_object (q, object)});
+    }
+
+    /* Where a changed object sorts now may not be where it was put, so
+     * all of them come out of a sorted query's results before any of them
+     * go back in: those that stay are taken out and put back, not moved. */
+    for (const auto& c : checks)
+        if (c.was_in && (!c.is_in || query_is_sorted (q)))
+            deltas.push_back ({QOF_QUERY_DELTA_REMOVE, c.object,
+                               live_remove (q, c.object), -1});
+    for (const auto& c : checks)
+    {
+        if (c.is_in && (!c.was_in || query_is_sorted (q)))
+            deltas.push_back ({QOF_QUERY_DELTA_INSERT, c.object, -1,
+                               live_insert (q, c.object)});
+        else if (c.is_in)
+        {
+            gint pos = live_position (live, live->objects.find (c.object)->second.first);
+            deltas.push_back ({QOF_QUERY_DELTA_MOVE, c.object, pos, pos});
+        }
+    }
+
+    if (live->handler && !deltas.empty ())
+        live->handler (q, deltas.data (), deltas.size (), live->user_data);
+}
+
+void qof_query_set_live (QofQuery *q, QofQueryDeltaHandler handler,
+                         gpointer user_data)
+{
+    if (!q) return;
+
+    if (!q->live)
+    {
+        q->live = new QofQueryLive (q);
+        q->live->by_guid = guid_hash_table_new ();
+        q->live->handler_id =
+            qof_event_register_batch_handler (live_event_cb, NULL, q);
+    }
+    q->live->handler = handler;
+    q->live->user_data = user_data;
+}
+
+void qof_query_stop_live (QofQuery *q)
+{
+    if (!q || !q->live) return;
+
+    qof_event_unregister_handler (q->live->handler_id);
+    g_hash_table_destroy (q->live->by_guid);
+    delete q->live;
+    q->live = NULL;
+}
+
+gboolean qof_query_is_live (const QofQuery *q)
+{
+    return q && q->live;
+}
+
 GList * qof_query_run (QofQuery *q)
 {
-    /* Just a wrapper */
-    return qof_query_run_internal(q, qof_query_run_cb, NULL);
+    GList *results;
+
+    /* A live query's results are up to date already.  They replace the
+     * list of the last run only now, so that one stays good to walk
+     * while the events come in. */
+    if (q && q->live && q->live->synced && !q->changed &&
+            q->live->dropped == qof_event_get_dropped_count ())
+    {
+        if (q->live->changed)
+        {
+            g_list_free (q->results);
+            q->results = NULL;
+            for (auto it = q->live->results.rbegin ();
+                    it != q->live->results.rend (); ++it)
+                q->results = g_list_prepend (q->results, *it);
+            q->live->changed = FALSE;
+        }
+        return q->results;
+    }
+
+    results = qof_query_run_internal(q, qof_query_run_cb, NULL);
+    if (q && q->live)
+        live_sync (q);
+    return results;
 }
 
 static void qof_query_run_subq_cb(QofQueryCB* qcb, gpointer cb_arg)
@@ -871,7 +1437,9 @@ qof_query_run_subquery (QofQuery *subq, const QofQuery* primaryq)
     g_return_val_if_fail(!g_strcmp0(subq->search_for, primaryq->search_for),
                          NULL);
 
-    /* Perform the subquery */
+    /* Perform the subquery; its results aren't kept up to date */
+    if (subq->live)
+        live_forget (subq->live);
     return qof_query_run_internal(subq, qof_query_run_subq_cb,
                                   (gpointer)primaryq);
 }
@@ -893,6 +1461,8 @@ void qof_query_clear (QofQuery *query)
 
     g_list_free (query->books);
     query->books = NULL;
+    if (query->live)
+        live_forget (query->live);
     g_list_free (query->results);
     query->results = NULL;
     query->changed = 1;
@@ -992,6 +1562,7 @@ GSList * qof_query_get_term_type (QofQuery *q, QofQueryParamList *term_param)
 void qof_query_destroy (QofQuery *q)
 {
     if (!q) return;
+    qof_query_stop_live (q);
     free_members (q);
     query_clear_compiles (q);
     g_hash_table_destroy (q->be_compiled);
@@ -1012,6 +1583,8 @@ QofQuery * qof_query_copy (QofQuery *q)
 
     copy->be_compiled = ht;
     copy->terms = copy_or_terms (q->terms);
+    copy->plan = NULL;
+    copy->live = NULL;
     copy->books = g_list_copy (q->books);
     copy->results = g_list_copy (q->results);
 
@@ -1349,10 +1922,68 @@ void qof_query_init (void)
 
 void qof_query_shutdown (void)
 {
+    if (query_indexes)
+    {
+        g_hash_table_destroy (query_indexes);
+        query_indexes = NULL;
+    }
+    if (query_loaders)
+    {
+        g_hash_table_destroy (query_loaders);
+        query_loaders = NULL;
+    }
+    query_dependents.clear ();
     qof_class_shutdown ();
     qof_query_core_shutdown ();
 }
 
+void qof_query_register_index (QofIdTypeConst obj_type,
+                               QofQueryIndexFunc index_fcn)
+{
+    g_return_if_fail (obj_type);
+
+    if (!query_indexes)
+        query_indexes = g_hash_table_new (g_str_hash, g_str_equal);
+    if (index_fcn)
+        g_hash_table_insert (query_indexes, (gpointer) obj_type,
+                             (gpointer) index_fcn);
+    else
+        g_hash_table_remove (query_indexes, obj_type);
+}
+
+void qof_query_register_loader (QofIdTypeConst obj_type,
+                                QofQueryLoadFunc load_fcn)
+{
+    g_return_if_fail (obj_type);
+
+    if (!query_loaders)
+        query_loaders = g_hash_table_new (g_str_hash, g_str_equal);
+    if (load_fcn)
+        g_hash_table_insert (query_loaders, (gpointer) obj_type,
+                             (gpointer) load_fcn);
+    else
+        g_hash_table_remove (query_loaders, obj_type);
+}
+
+void qof_query_register_dependents (QofIdTypeConst obj_type,
+                                    QofIdTypeConst changed_type,
+                                    QofQueryDependentsFunc dependents_fcn)
+{
+    g_return_if_fail (obj_type && changed_type);
+
+    auto it = std::find_if (query_dependents.begin (), query_dependents.end (),
+                            [=](const QofQueryDependents& dep)
+                            {
+                                return !g_strcmp0 (dep.obj_type, obj_type) &&
+                                       !g_strcmp0 (dep.changed_type,
+                                                   changed_type);
+                            });
+    if (it != query_dependents.end ())
+        query_dependents.erase (it);
+    if (dependents_fcn)
+        query_dependents.push_back ({obj_type, changed_type, dependents_fcn});
+}
+
 int qof_query_get_max_results (const QofQuery *q)
 {
     if (!q) return 0;
@@ -237,6 +237,76 @@ GList * qof_query_last_run (QofQuery *query);
 GList * qof_query_run_subquery (QofQuery *subquery,
                                 const QofQuery* primary_query);
 
+/** @name Live queries
+
+   A live query keeps the results of its last qof_query_run() up to date
+   as the objects change.  It watches the engine's events and, when an
+   object is committed, only checks the objects that changed against the
+   query, instead of searching all of them again.  qof_query_run() then
+   returns the results it keeps without searching, unless the query itself
+   was changed since.  The list a run returns isn't changed by the events:
+   it stays good to walk, even while committing the objects in it, until
+   the next qof_query_run().  The changes to the results can be passed on
+   to a handler as they are made.
+ @{
+*/
+
+typedef enum
+{
+    /** object was added to the results at new_pos. */
+    QOF_QUERY_DELTA_INSERT,
+    /** object was taken out of the results from old_pos. */
+    QOF_QUERY_DELTA_REMOVE,
+    /** object changed where it is, at old_pos, which is new_pos.  A
+     *  changed object that stays in the results of a sorted query is
+     *  taken out and put back in instead. */
+    QOF_QUERY_DELTA_MOVE,
+    /** The results couldn't be kept up to date, for instance because events
+     *  were suspended, and are empty until the query is run again. */
+    QOF_QUERY_DELTA_RESET,
+} QofQueryDeltaType;
+
+/** A change to the results of a live query.  The positions are indexes in
+ *  the results as they were before the change (old_pos) and after it
+ *  (new_pos), -1 where they don't apply.  They are only worked out for a
+ *  query with a handler, and take a walk over the results. */
+typedef struct
+{
+    QofQueryDeltaType type;
+    gpointer object;
+    gint old_pos;
+    gint new_pos;
+} QofQueryDelta;
+
+/** Handler invoked with the changes one batch of events made to the
+ *  results of a live query.  Each delta applies to the results left by the
+ *  ones before it; the next qof_query_run() returns the results after all
+ *  of them.  All the objects that left or moved in a batch are taken out
+ *  before any are put in.
+ */
+typedef void (*QofQueryDeltaHandler) (QofQuery *query,
+                                      const QofQueryDelta *deltas,
+                                      guint n_deltas, gpointer user_data);
+
+/** Make query live, passing the changes to its results on to handler,
+ *  which may be NULL.  The results are kept from the next qof_query_run()
+ *  on; those of qof_query_run_subquery() aren't kept.
+ *
+ *  Results limited with qof_query_set_max_results() get a
+ *  QOF_QUERY_DELTA_RESET whenever an object of the searched for type
+ *  changes, as the objects cut off aren't known.
+ */
+void qof_query_set_live (QofQuery *query, QofQueryDeltaHandler handler,
+                         gpointer user_data);
+
+/** Stop query being live.  The results of its last run stay as they
+ *  are. */
+void qof_query_stop_live (QofQuery *query);
+
+/** Whether query is live. */
+gboolean qof_query_is_live (const QofQuery *query);
+/** @} */
+
 /** Remove all query terms from query.  query matches nothing
  *  after qof_query_clear().
  */
@@ -444,6 +444,18 @@ qof_query_date_predicate_get_date (const QofQueryPredData *pd, time64 *date)
     return TRUE;
 }
 
+gboolean
+qof_query_date_predicate_get_options (const QofQueryPredData *pd,
+                                      QofDateMatch *options)
+{
+    const query_date_t pdata = (const query_date_t)pd;
+
+    if (pdata->pd.type_name != query_date_type)
+        return FALSE;
+    *options = pdata->options;
+    return TRUE;
+}
+
 static char *
 date_to_string (gpointer object, QofParam *getter)
 {
@@ -767,6 +779,20 @@ qof_query_guid_predicate (QofGuidMatch options, GList *guid_list)
     return ((QofQueryPredData*)pdata);
 }
 
+gboolean
+qof_query_guid_predicate_get_guids (const QofQueryPredData *pd,
+                                    QofGuidMatch *options,
+                                    const GList **guids)
+{
+    const query_guid_t pdata = (const query_guid_t)pd;
+
+    if (pdata->pd.type_name != query_guid_type)
+        return FALSE;
+    *options = pdata->options;
+    *guids = pdata->guids;
+    return TRUE;
+}
+
 /* ================================================================ */
 /* QOF_TYPE_INT32 */
 
@@ -0,0 +1,92 @@
+/********************************************************************\
+ * gtest-gnc-guid-map.cpp -- Unit tests for GncGUIDMap              *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+ \ *********************************************************************/
+
+#include <config.h>
+#include "../gnc-guid-map.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+/* The map never dereferences the instances, so fake ones will do. */
+static QofInstance*
+fake_instance (std::size_t n)
+{
+    return reinterpret_cast<QofInstance*>((n + 1) * 16);
+}
+
+/* GUIDs that only differ in a few bits, the worst case for the hashing. */
+static GncGUID
+make_guid (std::size_t n)
+{
+    GncGUID guid;
+    memset (guid.reserved, 0, GUID_DATA_SIZE);
+    memcpy (guid.reserved + GUID_DATA_SIZE - sizeof(n), &n, sizeof(n));
+    guid.reserved[0] = 1;
+    return guid;
+}
+
+TEST(GncGUIDMap, empty)
+{
+    GncGUIDMap map;
+    auto guid = make_guid (1);
+    EXPECT_EQ (0u, map.size());
+    EXPECT_EQ (nullptr, map.lookup (guid));
+    EXPECT_FALSE (map.erase (guid));
+}
+
+TEST(GncGUIDMap, insert_replace_erase)
+{
+    GncGUIDMap map;
+    auto guid = make_guid (1);
+    map.insert (guid, fake_instance (1));
+    EXPECT_EQ (1u, map.size());
+    EXPECT_EQ (fake_instance (1), map.lookup (guid));
+    map.insert (guid, fake_instance (2));
+    EXPECT_EQ (1u, map.size());
+    EXPECT_EQ (fake_instance (2), map.lookup (guid));
+    EXPECT_TRUE (map.erase (guid));
+    EXPECT_EQ (0u, map.size());
+    EXPECT_EQ (nullptr, map.lookup (guid));
+}
+
+TEST(GncGUIDMap, many)
+{
+    const std::size_t count = 10000;
+    GncGUIDMap map;
+    map.reserve (count / 2);
+    for (std::size_t n = 0; n < count; ++n)
+        map.insert (make_guid (n), fake_instance (n));
+    EXPECT_EQ (count, map.size());
+
+    /* Erasing every third entry must not cut off any of the others. */
+    for (std::size_t n = 0; n < count; n += 3)
+        EXPECT_TRUE (map.erase (make_guid (n)));
+    for (std::size_t n = 0; n < count; ++n)
+    {
+        auto expected = n % 3 ? fake_instance (n) : nullptr;
+        EXPECT_EQ (expected, map.lookup (make_guid (n)));
+    }
+
+    std::size_t seen = 0;
+    map.for_each ([&seen](QofInstance*) { ++seen; });
+    EXPECT_EQ (map.size(), seen);
+}
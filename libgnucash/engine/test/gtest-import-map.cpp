@@ -318,6 +318,21 @@ TEST_F(ImapBayesTest, AddAccountBayes)
     EXPECT_EQ(2, value->get<int64_t>());
 }
 
+TEST_F(ImapBayesTest, FindAfterAddAccountBayes)
+{
+    gnc_account_imap_add_account_bayes(t_imap, t_list1, t_expense_account1);
+    EXPECT_EQ(t_expense_account1, gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    EXPECT_EQ(nullptr, gnc_account_imap_find_account_bayes(t_imap, t_list2));
+    /* The matching has to see the additions made after it first ran. */
+    for (int i = 0; i < 4; ++i)
+        gnc_account_imap_add_account_bayes(t_imap, t_list1, t_expense_account2);
+    gnc_account_imap_add_account_bayes(t_imap, t_list2, t_expense_account2);
+    EXPECT_EQ(t_expense_account2, gnc_account_imap_find_account_bayes(t_imap, t_list1));
+    EXPECT_EQ(t_expense_account2, gnc_account_imap_find_account_bayes(t_imap, t_list2));
+    gnc_account_delete_all_bayes_maps(t_bank_account);
+    EXPECT_EQ(nullptr, gnc_account_imap_find_account_bayes(t_imap, t_list1));
+}
+
 TEST_F(ImapBayesTest, ConvertBayesData)
 {
     auto root = qof_instance_get_slots(QOF_INSTANCE(t_bank_account));
@@ -0,0 +1,210 @@
+/********************************************************************\
+ * gtest-qofevent.cpp -- Unit tests for batched event handlers      *
+ *                                                                  *
+ * This program is free software; you can redistribute it and/or    *
+ * modify it under the terms of the GNU General Public License as   *
+ * published by the Free Software Foundation; either version 2 of   *
+ * the License, or (at your option) any later version.              *
+ *                                                                  *
+ * This program is distributed in the hope that it will be useful,  *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of   *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the    *
+ * GNU General Public License for more details.                     *
+ *                                                                  *
+ * You should have received a copy of the GNU General Public License*
+ * along with this program; if not, contact:                        *
+ *                                                                  *
+ * Free Software Foundation           Voice:  +1-617-542-5942       *
+ * 51 Franklin Street, Fifth Floor    Fax:    +1-617-542-2652       *
+ * Boston, MA  02110-1301,  USA       gnu@gnu.org                   *
+ *                                                                  *
+\********************************************************************/
+
+extern "C"
+{
+#include <config.h>
+#include <qof.h>
+}
+
+#include <gtest/gtest.h>
+#include <vector>
+
+static const char* type_a = "TypeA";
+static const char* type_b = "TypeB";
+
+struct Received
+{
+    std::vector<std::vector<QofEventBatchItem>> batches;
+    int single_events = 0;
+};
+
+static void
+batch_handler (const QofEventBatchItem* items, guint n_items, gpointer data)
+{
+    auto received = static_cast<Received*> (data);
+    received->batches.emplace_back (items, items + n_items);
+}
+
+static void
+single_handler (QofInstance* entity, QofEventId event_type,
+                gpointer handler_data, gpointer event_data)
+{
+    static_cast<Received*> (handler_data)->single_events++;
+}
+
+class QofEventBatchTest : public testing::Test
+{
+protected:
+    void SetUp()
+    {
+        m_book = qof_book_new ();
+        m_a1 = make_instance (type_a);
+        m_a2 = make_instance (type_a);
+        m_b = make_instance (type_b);
+    }
+    void TearDown()
+    {
+        for (auto inst : {m_a1, m_a2, m_b})
+            g_object_unref (inst);
+        qof_book_destroy (m_book);
+    }
+    QofInstance* make_instance (const char* type)
+    {
+        auto inst = static_cast<QofInstance*> (g_object_new (QOF_TYPE_INSTANCE,
+                                                             NULL));
+        qof_instance_init_data (inst, type, m_book);
+        return inst;
+    }
+
+    QofBook* m_book {};
+    QofInstance* m_a1 {};
+    QofInstance* m_a2 {};
+    QofInstance* m_b {};
+};
+
+TEST_F(QofEventBatchTest, unbatched_events_come_one_by_one)
+{
+    Received received;
+    auto id = qof_event_register_batch_handler (batch_handler, NULL, &received);
+
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_unregister_handler (id);
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+
+    ASSERT_EQ (2u, received.batches.size ());
+    for (const auto& batch : received.batches)
+    {
+        ASSERT_EQ (1u, batch.size ());
+        EXPECT_EQ (m_a1, batch[0].entity);
+        EXPECT_TRUE (guid_equal (qof_instance_get_guid (m_a1), &batch[0].guid));
+        EXPECT_STREQ (type_a, batch[0].type);
+        EXPECT_EQ (QOF_EVENT_MODIFY, batch[0].event_mask);
+    }
+}
+
+TEST_F(QofEventBatchTest, batch_is_coalesced_per_entity)
+{
+    Received received;
+    Received single;
+    auto id = qof_event_register_batch_handler (batch_handler, NULL, &received);
+    auto single_id = qof_event_register_handler (single_handler, &single);
+
+    qof_event_begin_batch ();
+    qof_event_gen (m_a1, QOF_EVENT_CREATE, NULL);
+    qof_event_gen (m_b, QOF_EVENT_MODIFY, NULL);
+    qof_event_begin_batch ();
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+    /* Nothing until the outermost scope ends. */
+    EXPECT_TRUE (received.batches.empty ());
+    qof_event_gen (m_a2, QOF_EVENT_ADD, NULL);
+    qof_event_end_batch ();
+
+    /* The other handlers still get every event right away. */
+    EXPECT_EQ (5, single.single_events);
+
+    ASSERT_EQ (1u, received.batches.size ());
+    const auto& batch = received.batches[0];
+    ASSERT_EQ (3u, batch.size ());
+    EXPECT_EQ (m_a1, batch[0].entity);
+    EXPECT_EQ (QOF_EVENT_CREATE | QOF_EVENT_MODIFY, batch[0].event_mask);
+    EXPECT_EQ (m_b, batch[1].entity);
+    EXPECT_EQ (QOF_EVENT_MODIFY, batch[1].event_mask);
+    EXPECT_EQ (m_a2, batch[2].entity);
+    EXPECT_EQ (QOF_EVENT_ADD, batch[2].event_mask);
+
+    qof_event_unregister_handler (single_id);
+    qof_event_unregister_handler (id);
+}
+
+TEST_F(QofEventBatchTest, handlers_only_get_their_types)
+{
+    Received received_a;
+    Received received_b;
+    QofIdTypeConst types_a[] = { type_a, NULL };
+    QofIdTypeConst types_b[] = { type_b, NULL };
+    auto id_a = qof_event_register_batch_handler (batch_handler, types_a,
+                                                  &received_a);
+    auto id_b = qof_event_register_batch_handler (batch_handler, types_b,
+                                                  &received_b);
+
+    qof_event_begin_batch ();
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (m_a2, QOF_EVENT_MODIFY, NULL);
+    qof_event_end_batch ();
+
+    ASSERT_EQ (1u, received_a.batches.size ());
+    ASSERT_EQ (2u, received_a.batches[0].size ());
+    EXPECT_EQ (m_a1, received_a.batches[0][0].entity);
+    EXPECT_EQ (m_a2, received_a.batches[0][1].entity);
+    EXPECT_TRUE (received_b.batches.empty ());
+
+    qof_event_gen (m_b, QOF_EVENT_MODIFY, NULL);
+    EXPECT_EQ (1u, received_a.batches.size ());
+    EXPECT_EQ (1u, received_b.batches.size ());
+
+    qof_event_unregister_handler (id_a);
+    qof_event_unregister_handler (id_b);
+}
+
+TEST_F(QofEventBatchTest, destroyed_entities_are_not_handed_out)
+{
+    Received received;
+    auto id = qof_event_register_batch_handler (batch_handler, NULL, &received);
+    GncGUID guid = *qof_instance_get_guid (m_a1);
+
+    qof_event_begin_batch ();
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_gen (m_a1, QOF_EVENT_DESTROY, NULL);
+    /* Like a new entity at the same address. */
+    qof_event_gen (m_a1, QOF_EVENT_CREATE, NULL);
+    qof_event_end_batch ();
+
+    ASSERT_EQ (1u, received.batches.size ());
+    const auto& batch = received.batches[0];
+    ASSERT_EQ (2u, batch.size ());
+    EXPECT_EQ (nullptr, batch[0].entity);
+    EXPECT_TRUE (guid_equal (&guid, &batch[0].guid));
+    EXPECT_EQ (QOF_EVENT_MODIFY | QOF_EVENT_DESTROY, batch[0].event_mask);
+    EXPECT_EQ (m_a1, batch[1].entity);
+    EXPECT_EQ (QOF_EVENT_CREATE, batch[1].event_mask);
+
+    qof_event_unregister_handler (id);
+}
+
+TEST_F(QofEventBatchTest, suspended_events_are_dropped)
+{
+    Received received;
+    auto id = qof_event_register_batch_handler (batch_handler, NULL, &received);
+
+    qof_event_begin_batch ();
+    qof_event_suspend ();
+    qof_event_gen (m_a1, QOF_EVENT_MODIFY, NULL);
+    qof_event_resume ();
+    qof_event_end_batch ();
+
+    EXPECT_TRUE (received.batches.empty ());
+    qof_event_unregister_handler (id);
+}
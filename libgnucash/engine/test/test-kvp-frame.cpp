@@ -189,6 +189,21 @@ TEST_F (KvpFrameTest, Empty)
     EXPECT_FALSE(f2.empty());
 }
 
+TEST_F (KvpFrameTest, SortedKeys)
+{
+    KvpFrameImpl f1;
+    for (auto key : {"delta", "alpha", "echo", "charlie", "bravo"})
+        f1.set({key}, new KvpValue {INT64_C(1)});
+    auto v1 = new KvpValue {INT64_C(2)};
+    delete f1.set({"charlie"}, v1);
+    delete f1.set({"echo"}, nullptr);
+
+    std::vector<std::string> expected {"alpha", "bravo", "charlie", "delta"};
+    EXPECT_EQ (expected, f1.get_keys ());
+    EXPECT_EQ (v1, f1.get_slot ({"charlie"}));
+    EXPECT_EQ (nullptr, f1.get_slot ({"echo"}));
+}
+
 TEST (KvpFrameTestForEachPrefix, for_each_prefix_1)
 {
     KvpFrame fr;
@@ -26,6 +26,8 @@ extern "C"
 #include <glib.h>
 #include "qof.h"
 #include "cashobjects.h"
+#include "Account.h"
+#include "Query.h"
 #include "Transaction.h"
 #include "TransLog.h"
 #include "gnc-engine.h"
@@ -67,6 +69,183 @@ test_trans_query (Transaction *trans, gpointer data)
     return 0;
 }
 
+static gboolean
+check_splits (GList *found, GList *expected, const char *what)
+{
+    for (; found && expected; found = found->next, expected = expected->next)
+        if (found->data != expected->data)
+            break;
+    if (found || expected)
+    {
+        failure (what);
+        return FALSE;
+    }
+    success (what);
+    return TRUE;
+}
+
+static time64
+split_date (GList *splits, guint n)
+{
+    Split *split = static_cast<Split*>(g_list_nth_data (splits, n));
+    return xaccTransRetDatePosted (xaccSplitGetParent (split));
+}
+
+/* The queries the registers run: the splits of one account posted in a
+ * date range, all of them or just the last few. */
+static void
+test_account_date_query (Account *acc, gpointer data)
+{
+    QofBook *book = QOF_BOOK(data);
+    GList *splits = xaccAccountGetSplitList (acc);
+    GList *expected = NULL, *node;
+    guint n = g_list_length (splits);
+    time64 start, end;
+    QofQuery *q;
+
+    if (n < 4)
+        return;
+
+    start = split_date (splits, n / 4);
+    end = split_date (splits, 3 * n / 4);
+    for (node = splits; node; node = node->next)
+    {
+        Split *split = static_cast<Split*>(node->data);
+        time64 date = xaccTransRetDatePosted (xaccSplitGetParent (split));
+        if (date >= start && date <= end)
+            expected = g_list_prepend (expected, node->data);
+    }
+    expected = g_list_reverse (expected);
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    xaccQueryAddDateMatchTT (q, TRUE, start, TRUE, end, QOF_QUERY_AND);
+    check_splits (qof_query_run (q), expected, "splits in a date range");
+
+    qof_query_set_max_results (q, 3);
+    check_splits (qof_query_run (q),
+                  g_list_nth (expected, g_list_length (expected) - 3),
+                  "last splits in a date range");
+
+    qof_query_destroy (q);
+    g_list_free (expected);
+}
+
+static void
+count_deltas (QofQuery *q, const QofQueryDelta *deltas, guint n_deltas,
+              gpointer user_data)
+{
+    *static_cast<guint*>(user_data) += n_deltas;
+}
+
+/* The results a live query keeps must be those of running it again. */
+static void
+check_live_results (QofQuery *q, const char *what)
+{
+    QofQuery *copy = qof_query_copy (q);
+
+    check_splits (qof_query_run (q), qof_query_run (copy), what);
+    qof_query_destroy (copy);
+}
+
+static void
+test_live_query (Account *acc, gpointer data)
+{
+    QofBook *book = QOF_BOOK(data);
+    GList *splits = xaccAccountGetSplitList (acc);
+    guint n = g_list_length (splits), n_results, n_deltas = 0;
+    Transaction *trans;
+    GList *results;
+    QofQuery *q;
+
+    if (n < 4)
+        return;
+
+    q = qof_query_create_for (GNC_ID_SPLIT);
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    qof_query_set_live (q, count_deltas, &n_deltas);
+    results = qof_query_run (q);
+    n_results = g_list_length (results);
+
+    /* Moving a transaction to the front moves its splits, but not in the
+     * list the last run handed out. */
+    trans = xaccSplitGetParent (static_cast<Split*>(g_list_nth_data (splits, n / 2)));
+    xaccTransBeginEdit (trans);
+    xaccTransSetDatePostedSecs (trans, split_date (splits, 0) - 1);
+    xaccTransCommitEdit (trans);
+    if (n_deltas == 0)
+        failure ("no deltas for a changed transaction");
+    if (qof_query_last_run (q) != results || g_list_length (results) != n_results)
+        failure ("events changed the results of the last run");
+    check_live_results (q, "live query follows a changed transaction");
+
+    /* Deleting one takes its splits out, whether it's batched or not. */
+    trans = xaccSplitGetParent (static_cast<Split*>(qof_query_last_run (q)->data));
+    xaccTransBeginEdit (trans);
+    xaccTransDestroy (trans);
+    xaccTransCommitEdit (trans);
+    check_live_results (q, "live query follows a deleted transaction");
+
+    trans = xaccSplitGetParent (static_cast<Split*>(qof_query_last_run (q)->data));
+    qof_event_begin_batch ();
+    xaccTransBeginEdit (trans);
+    xaccTransDestroy (trans);
+    xaccTransCommitEdit (trans);
+    qof_event_end_batch ();
+    check_live_results (q, "live query follows a batch");
+
+    qof_query_destroy (q);
+}
+
+static gboolean
+query_finds (QofBook *book, Account *acc, Split *split)
+{
+    QofQuery *q = qof_query_create_for (GNC_ID_SPLIT);
+    gboolean found;
+
+    qof_query_set_book (q, book);
+    xaccQueryAddSingleAccountMatch (q, acc, QOF_QUERY_AND);
+    found = g_list_find (qof_query_run (q), split) != NULL;
+    qof_query_destroy (q);
+    return found;
+}
+
+/* A split moved to another account in an open edit is only in the split
+ * index of the account it was in before, but the queries must find it
+ * where it is now. */
+static void
+test_open_edit_query (QofBook *book, Account *root)
+{
+    GList *accounts = gnc_account_get_descendants (root), *node;
+    Account *from = NULL, *to = NULL;
+    Transaction *trans;
+    Split *split;
+
+    for (node = accounts; node && !from; node = node->next)
+        if (xaccAccountGetSplitList (static_cast<Account*>(node->data)))
+            from = static_cast<Account*>(node->data);
+    for (node = accounts; node && !to; node = node->next)
+        if (node->data != from)
+            to = static_cast<Account*>(node->data);
+    g_list_free (accounts);
+    if (!from || !to)
+        return;
+
+    split = static_cast<Split*>(xaccAccountGetSplitList (from)->data);
+    trans = xaccSplitGetParent (split);
+    xaccTransBeginEdit (trans);
+    xaccSplitSetAccount (split, to);
+    do_test (query_finds (book, to, split),
+             "split moved in an open edit is in its new account");
+    do_test (!query_finds (book, from, split),
+             "split moved in an open edit is not in its old account");
+    xaccTransRollbackEdit (trans);
+    do_test (query_finds (book, from, split),
+             "split is back in its account after a rollback");
+}
+
 static void
 run_test (void)
 {
@@ -81,6 +260,9 @@ run_test (void)
     add_random_transactions_to_book (book, 20);
 
     xaccAccountTreeForEachTransaction (root, test_trans_query, book);
+    gnc_account_foreach_descendant (root, test_account_date_query, book);
+    gnc_account_foreach_descendant (root, test_live_query, book);
+    test_open_edit_query (book, root);
 
     qof_session_end (session);
 }
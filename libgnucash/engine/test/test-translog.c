@@ -0,0 +1,294 @@
+/***************************************************************************
+ *            test-translog.c
+ *
+ *  Tests for the transaction log's text and binary formats.
+ ****************************************************************************/
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+#include <config.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include "cashobjects.h"
+#include "Account.h"
+#include "TransLog.h"
+#include "Transaction.h"
+#include "test-engine-stuff.h"
+#include "test-stuff.h"
+
+#define NUM_TRANS 20
+
+static const char *header =
+    "mod\ttrans_guid\tsplit_guid\ttime_now\t"
+    "date_entered\tdate_posted\tacc_guid\tacc_name\tnum\tdescription\t"
+    "notes\tmemo\taction\treconciled\tamount\tvalue\tdate_reconciled\n";
+
+static Account *
+make_account (QofBook *book, gnc_commodity *currency, const char *name)
+{
+    Account *acc = xaccMallocAccount (book);
+
+    xaccAccountBeginEdit (acc);
+    xaccAccountSetName (acc, name);
+    xaccAccountSetCommodity (acc, currency);
+    xaccAccountCommitEdit (acc);
+    return acc;
+}
+
+static Transaction *
+make_transaction (QofBook *book, gnc_commodity *currency,
+                  Account *from, Account *to, gint64 cents)
+{
+    Transaction *trans = xaccMallocTransaction (book);
+    Split *split1 = xaccMallocSplit (book);
+    Split *split2 = xaccMallocSplit (book);
+    gnc_numeric amount = gnc_numeric_create (cents, 100);
+
+    /* Begin logs the empty transaction, commit the finished one. */
+    xaccTransBeginEdit (trans);
+    xaccTransSetCurrency (trans, currency);
+    xaccTransSetDescription (trans, "Groceries");
+    xaccTransSetNum (trans, "42");
+
+    xaccSplitSetParent (split1, trans);
+    xaccSplitSetAccount (split1, from);
+    xaccSplitSetAmount (split1, gnc_numeric_neg (amount));
+    xaccSplitSetValue (split1, gnc_numeric_neg (amount));
+
+    xaccSplitSetParent (split2, trans);
+    xaccSplitSetAccount (split2, to);
+    xaccSplitSetAmount (split2, amount);
+    xaccSplitSetValue (split2, amount);
+    xaccSplitSetMemo (split2, "milk & eggs");
+
+    xaccTransCommitEdit (trans);
+    return trans;
+}
+
+/* The contents of the only file in dir whose name starts with prefix. */
+static gchar *
+read_log (const char *dir, const char *prefix, gchar **path)
+{
+    GDir *gdir = g_dir_open (dir, 0, NULL);
+    const gchar *name;
+    gchar *contents = NULL;
+
+    *path = NULL;
+    while ((name = g_dir_read_name (gdir)))
+    {
+        if (g_str_has_prefix (name, prefix))
+        {
+            *path = g_build_filename (dir, name, NULL);
+            break;
+        }
+    }
+    g_dir_close (gdir);
+
+    if (*path)
+        g_file_get_contents (*path, &contents, NULL, NULL);
+    return contents;
+}
+
+/* Check that text is the log of what make_transaction() did, n times. */
+static void
+check_log_text (const char *text, guint n, Transaction **trans)
+{
+    gchar **lines;
+    guint i, starts = 0, ends = 0, commits = 0;
+
+    do_test (g_str_has_prefix (text, header), "log starts with the header");
+
+    lines = g_strsplit (text, "\n", -1);
+    for (i = 0; lines[i]; i++)
+    {
+        gchar **fields;
+        char guid_str[GUID_ENCODING_LENGTH + 1];
+        Transaction *t;
+
+        if (strcmp (lines[i], "===== START") == 0)
+            starts++;
+        else if (strcmp (lines[i], "===== END") == 0)
+            ends++;
+        if (lines[i][0] != 'C' || lines[i][1] != '\t')
+            continue;
+
+        fields = g_strsplit (lines[i], "\t", -1);
+        do_test (g_strv_length (fields) == 17, "split line has all fields");
+        if (g_strv_length (fields) == 17 && commits / 2 < n)
+        {
+            t = trans[commits / 2];
+            guid_to_string_buff (xaccTransGetGUID (t), guid_str);
+            do_test (strcmp (fields[1], guid_str) == 0, "transaction guid");
+            do_test (strcmp (fields[8], "42") == 0, "num");
+            do_test (strcmp (fields[9], "Groceries") == 0, "description");
+            if (commits % 2)
+            {
+                do_test (strcmp (fields[7], "Food") == 0, "account name");
+                do_test (strcmp (fields[11], "milk & eggs") == 0, "memo");
+                do_test (strcmp (fields[14], "1234/100") == 0, "amount");
+            }
+            else
+            {
+                do_test (strcmp (fields[7], "Checking") == 0, "account name");
+                do_test (strcmp (fields[15], "-1234/100") == 0, "value");
+            }
+        }
+        g_strfreev (fields);
+        commits++;
+    }
+    g_strfreev (lines);
+
+    do_test (starts == 2 * n && ends == 2 * n, "a record per begin and commit");
+    do_test (commits == 2 * n, "a line per committed split");
+}
+
+static void
+log_transactions (QofBook *book, const char *dir, const char *prefix,
+                  XaccLogFormat format, XaccLogDurability durability,
+                  Transaction **trans)
+{
+    gnc_commodity *usd;
+    Account *checking, *food;
+    gchar *base = g_build_filename (dir, prefix, NULL);
+    int i;
+
+    usd = gnc_commodity_table_lookup (gnc_commodity_table_get_table (book),
+                                      GNC_COMMODITY_NS_CURRENCY, "USD");
+    checking = make_account (book, usd, "Checking");
+    food = make_account (book, usd, "Food");
+
+    xaccLogSetFormat (format);
+    xaccLogSetDurability (durability);
+    xaccLogSetBaseName (base);
+    xaccLogEnable ();
+    for (i = 0; i < NUM_TRANS; i++)
+        trans[i] = make_transaction (book, usd, checking, food, 1234);
+    xaccCloseLog ();
+    xaccLogDisable ();
+
+    g_free (base);
+}
+
+static void
+test_text_log (QofBook *book, const char *dir)
+{
+    Transaction *trans[NUM_TRANS];
+    gchar *path, *text;
+
+    log_transactions (book, dir, "text", XACC_LOG_FORMAT_TEXT,
+                      XACC_LOG_DURABILITY_GROUP, trans);
+
+    text = read_log (dir, "text", &path);
+    do_test (text != NULL, "text log written");
+    if (!text) return;
+
+    do_test (!xaccLogFileIsBinary (path), "text log isn't binary");
+    check_log_text (text, NUM_TRANS, trans);
+
+    g_free (text);
+    g_free (path);
+}
+
+static void
+test_binary_log (QofBook *book, const char *dir)
+{
+    Transaction *trans[NUM_TRANS];
+    gchar *path, *contents, *text;
+    gchar *text_path = g_build_filename (dir, "converted.log", NULL);
+    gsize length;
+
+    log_transactions (book, dir, "binary", XACC_LOG_FORMAT_BINARY,
+                      XACC_LOG_DURABILITY_GROUP_SYNC, trans);
+
+    contents = read_log (dir, "binary", &path);
+    do_test (contents != NULL, "binary log written");
+    if (!contents) return;
+
+    do_test (xaccLogFileIsBinary (path), "binary log is binary");
+    do_test (xaccLogConvertToText (path, text_path), "binary log converts");
+    g_file_get_contents (text_path, &text, NULL, NULL);
+    check_log_text (text, NUM_TRANS, trans);
+    g_free (text);
+
+    /* Cut the last record short, like a crash while writing it could. */
+    g_free (contents);
+    g_file_get_contents (path, &contents, &length, NULL);
+    g_file_set_contents (path, contents, length - 10, NULL);
+    do_test (xaccLogConvertToText (path, text_path),
+             "binary log with an incomplete record converts");
+    g_file_get_contents (text_path, &text, NULL, NULL);
+    do_test (strstr (text, "===== END\n") != NULL, "complete records are kept");
+    g_free (text);
+
+    /* Or leave garbage where the size of the next record goes. */
+    {
+        gchar *garbage = g_malloc (length + 4);
+        memcpy (garbage, contents, length);
+        memset (garbage + length, 0xff, 4);
+        g_file_set_contents (path, garbage, length + 4, NULL);
+        g_free (garbage);
+    }
+    do_test (xaccLogConvertToText (path, text_path),
+             "binary log with a garbage record size converts");
+    g_file_get_contents (text_path, &text, NULL, NULL);
+    check_log_text (text, NUM_TRANS, trans);
+    g_free (text);
+
+    do_test (!xaccLogConvertToText (text_path, path),
+             "text log doesn't convert");
+
+    g_free (contents);
+    g_free (path);
+    g_free (text_path);
+}
+
+static void
+remove_dir (const char *dir)
+{
+    GDir *gdir = g_dir_open (dir, 0, NULL);
+    const gchar *name;
+
+    while ((name = g_dir_read_name (gdir)))
+    {
+        gchar *path = g_build_filename (dir, name, NULL);
+        g_unlink (path);
+        g_free (path);
+    }
+    g_dir_close (gdir);
+    g_rmdir (dir);
+}
+
+int
+main (int argc, char **argv)
+{
+    qof_init ();
+    if (cashobjects_register ())
+    {
+        QofBook *book = qof_book_new ();
+        gchar *dir = g_dir_make_tmp ("test-translog-XXXXXX", NULL);
+
+        test_text_log (book, dir);
+        test_binary_log (book, dir);
+
+        remove_dir (dir);
+        g_free (dir);
+        qof_book_destroy (book);
+        print_test_results ();
+    }
+    qof_close ();
+    return get_rv ();
+}
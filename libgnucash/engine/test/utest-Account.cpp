@@ -33,6 +33,8 @@ extern "C"
 #include "../Split.h"
 #include "../Transaction.h"
 #include "../gnc-lot.h"
+#include "../gnc-pricedb.h"
+#include "../gnc-pricedb-p.h"
 
 #if defined(__clang__) && (__clang_major__ == 5 || (__clang_major__ == 3 && __clang_minor__ < 5))
 #define USE_CLANG_FUNC_SIG 1
@@ -1183,8 +1185,74 @@ test_gnc_account_insert_remove_split (Fixture *fixture, gconstpointer pData)
 void
 xaccAccountSortSplits (Account *acc, gboolean force)// C: 4 in 2
 Make static?
-Passthrough, no test.
+Exercised together with the split index, which needs enough splits to
+span several blocks.
 */
+static gboolean
+splits_in_order (GList *splits)
+{
+    for (GList *node = splits; node && node->next; node = node->next)
+        if (xaccSplitOrder (static_cast<Split*>(node->data),
+                            static_cast<Split*>(node->next->data)) > 0)
+            return FALSE;
+    return TRUE;
+}
+
+static void
+test_xaccAccountSortSplits (Fixture *fixture, gconstpointer pData)
+{
+    QofBook *book = gnc_account_get_book (fixture->acct);
+    Account *acct = xaccMallocAccount (book);
+    AccountPrivate *priv = fixture->func->get_private (acct);
+    const int num_splits = 1000;
+    Split *splits[num_splits];
+    time64 base = gnc_dmy2time64 (1, 1, 2000);
+
+    /* The first half goes in one at a time, each to its place. */
+    for (int i = 0; i < num_splits; ++i)
+    {
+        Transaction *txn = xaccMallocTransaction (book);
+        splits[i] = xaccMallocSplit (book);
+        xaccTransBeginEdit (txn);
+        xaccTransSetDatePostedSecs (txn, base + (i * 7919 % num_splits) * 86400);
+        xaccSplitSetParent (splits[i], txn);
+        xaccSplitSetAccount (splits[i], acct);
+        qof_commit_edit (QOF_INSTANCE (txn));
+        if (i == num_splits / 2)
+            xaccAccountBeginEdit (acct);
+        g_assert (gnc_account_insert_split (acct, splits[i]));
+        if (i < num_splits / 2)
+            g_assert (splits_in_order (priv->splits));
+    }
+    /* The second half waits for the end of the edit. */
+    g_assert (priv->sort_dirty);
+    xaccAccountCommitEdit (acct);
+    g_assert (!priv->sort_dirty);
+    g_assert_cmpuint (g_list_length (priv->splits), ==, num_splits);
+    g_assert (splits_in_order (priv->splits));
+
+    /* Move a few of them around; only those need putting back. */
+    for (int i = 0; i < num_splits; i += 97)
+    {
+        Transaction *txn = xaccSplitGetParent (splits[i]);
+        xaccTransBeginEdit (txn);
+        xaccTransSetDatePostedSecs (txn, base - i * 86400);
+        qof_commit_edit (QOF_INSTANCE (txn));
+    }
+    g_assert (priv->sort_dirty);
+    g_assert (xaccAccountGetSplitList (acct) == priv->splits);
+    g_assert (!priv->sort_dirty);
+    g_assert_cmpuint (g_list_length (priv->splits), ==, num_splits);
+    g_assert (splits_in_order (priv->splits));
+
+    for (int i = 0; i < num_splits; i += 3)
+        g_assert (gnc_account_remove_split (acct, splits[i]));
+    for (int i = 0; i < num_splits; i += 3)
+        g_assert (!gnc_account_remove_split (acct, splits[i]));
+    g_assert_cmpuint (g_list_length (priv->splits), ==,
+                      num_splits - (num_splits + 2) / 3);
+    g_assert (splits_in_order (priv->splits));
+}
 /* xaccAccountBringUpToDate
 static void
 xaccAccountBringUpToDate (Account *acc)// 3
@@ -1327,6 +1395,40 @@ test_xaccAccountRecomputeBalance (Fixture *fixture, gconstpointer pData)
     g_assert (gnc_numeric_eq (priv->cleared_balance, clr_bal));
     g_assert (gnc_numeric_eq (priv->reconciled_balance, rec_bal));
     g_assert (!priv->balance_dirty);
+
+    /* Change the first split, which has to be reflected in all of the
+     * running balances after it. */
+    Split *first = static_cast<Split*>(priv->splits->data);
+    gnc_numeric amt = gnc_numeric_create (100, 1);
+    xaccTransBeginEdit (xaccSplitGetParent (first));
+    xaccSplitSetAmount (first, amt);
+    qof_commit_edit (QOF_INSTANCE (xaccSplitGetParent (first)));
+    g_assert (priv->balance_dirty);
+    xaccAccountRecomputeBalance (fixture->acct);
+    bal = gnc_numeric_zero ();
+    for (GList *node = priv->splits; node; node = node->next)
+    {
+        Split *split = static_cast<Split*>(node->data);
+        bal = gnc_numeric_add_fixed (bal, xaccSplitGetAmount (split));
+        g_assert (gnc_numeric_equal (xaccSplitGetBalance (split), bal));
+    }
+    g_assert (gnc_numeric_equal (priv->balance, bal));
+
+    /* An amount too big for the block's amount column gets added up
+     * separately. */
+    amt = gnc_numeric_create (INT64_C(1) << 53, 100);
+    xaccTransBeginEdit (xaccSplitGetParent (first));
+    xaccSplitSetAmount (first, amt);
+    qof_commit_edit (QOF_INSTANCE (xaccSplitGetParent (first)));
+    xaccAccountRecomputeBalance (fixture->acct);
+    bal = gnc_numeric_zero ();
+    for (GList *node = priv->splits; node; node = node->next)
+    {
+        Split *split = static_cast<Split*>(node->data);
+        bal = gnc_numeric_add_fixed (bal, xaccSplitGetAmount (split));
+        g_assert (gnc_numeric_equal (xaccSplitGetBalance (split), bal));
+    }
+    g_assert (gnc_numeric_equal (priv->balance, bal));
 }
 
 /* xaccAccountOrder
@@ -1931,6 +2033,18 @@ test_xaccAccountGetBalanceAsOfDate (Fixture *fixture, gconstpointer pData)
                                          (gnc_time (NULL) - offset));
     dval = gnc_numeric_to_double (val);
     g_assert_cmpfloat (dval, == , dbal);
+    /* Before and after all of the splits */
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct, 0);
+    g_assert (gnc_numeric_zero_p (val));
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct, G_MAXINT64);
+    g_assert (gnc_numeric_eq (val, xaccAccountGetBalance (fixture->acct)));
+    /* Before the splits there is whatever the account started with, like
+     * the splits a backend hasn't loaded. */
+    gnc_account_set_start_balance (fixture->acct, gnc_numeric_create (500, 1));
+    val = xaccAccountGetBalanceAsOfDate (fixture->acct, 0);
+    g_assert (gnc_numeric_eq (val, gnc_numeric_create (500, 1)));
+    gnc_account_set_start_balance (fixture->acct, gnc_numeric_zero ());
+    xaccAccountRecomputeBalance (fixture->acct);
 }
 /* xaccAccountGetPresentBalance
 gnc_numeric
@@ -1983,6 +2097,105 @@ test_xaccAccountGetPresentBalance (Fixture *fixture, gconstpointer pData)
  * xaccAccountGetBalanceAsOfDateInCurrency
  * xaccAccountGetBalanceChangeForPeriod
  */
+/* xaccAccountGetBalancesAsOfDates
+gnc_numeric *
+xaccAccountGetBalancesAsOfDates (GList *accounts, const time64 *dates,
+                                 gsize n_dates,
+                                 gnc_commodity *report_commodity,
+                                 gboolean include_children)
+It has to agree with xaccAccountGetBalanceAsOfDateInCurrency.
+*/
+static void
+add_price (QofBook *book, gnc_commodity *comm, gnc_commodity *curr,
+           time64 date, gnc_numeric value)
+{
+    GNCPrice *price = gnc_price_create (book);
+
+    gnc_price_begin_edit (price);
+    gnc_price_set_commodity (price, comm);
+    gnc_price_set_currency (price, curr);
+    gnc_price_set_time64 (price, date);
+    gnc_price_set_source (price, PRICE_SOURCE_USER_PRICE);
+    gnc_price_set_value (price, value);
+    gnc_price_commit_edit (price);
+    gnc_pricedb_add_price (gnc_pricedb_get_db (book), price);
+    gnc_price_unref (price);
+}
+
+static void
+check_balances_as_of_dates (GList *accounts, const time64 *dates,
+                            gsize n_dates, gnc_commodity *report)
+{
+    for (int recurse = 0; recurse < 2; recurse++)
+    {
+        gnc_numeric *matrix =
+            xaccAccountGetBalancesAsOfDates (accounts, dates, n_dates, report,
+                                             recurse);
+        gnc_numeric *cell = matrix;
+        for (GList *node = accounts; node; node = node->next)
+            for (gsize i = 0; i < n_dates; i++, cell++)
+            {
+                gnc_numeric val = xaccAccountGetBalanceAsOfDateInCurrency (
+                    static_cast<Account*>(node->data), dates[i], report,
+                    recurse);
+                g_assert (gnc_numeric_equal (*cell, val));
+            }
+        g_free (matrix);
+    }
+}
+
+static void
+test_xaccAccountGetBalancesAsOfDates (Fixture *fixture, gconstpointer pData)
+{
+    Account *root = gnc_account_get_root (fixture->acct);
+    GList *accounts = gnc_account_get_descendants (root);
+    const gsize n_dates = 5;
+    time64 now = gnc_time (NULL);
+    time64 dates[n_dates] = {0, now - 24 * 3600 * 3, now, now + 24 * 3600 * 3,
+                             G_MAXINT64};
+    check_balances_as_of_dates (accounts, dates, n_dates, NULL);
+    g_assert (xaccAccountGetBalancesAsOfDates (NULL, dates, n_dates, NULL,
+                                               FALSE) == NULL);
+
+    /* Reported in another commodity the balances are converted with the
+     * latest prices, all of a commodity's at once. baz is listed twice and
+     * meh shares its commodity, so their converted balances get reused. */
+    gnc_pricedb_register ();
+    QofBook *book = gnc_account_get_book (root);
+    gnc_commodity *usd = gnc_commodity_new (book, "US Dollar", "CURRENCY",
+                                            "USD", "0", 100);
+    gnc_commodity *eur = gnc_commodity_new (book, "Euro", "CURRENCY", "EUR",
+                                            "0", 100);
+    gnc_commodity *stock = gnc_commodity_new (book, "Stock", "NASDAQ", "STK",
+                                              "0", 1000);
+    Account *baz = gnc_account_lookup_by_name (root, "baz");
+    /* xaccAccountSetCommodity would scrub the currency-less transactions. */
+    const struct
+    {
+        const char *name;
+        gnc_commodity *comm;
+    } comms[] = {{"foo", usd}, {"baz", stock}, {"bar", eur}, {"meh", stock}};
+    for (auto& c : comms)
+    {
+        Account *acc = gnc_account_lookup_by_name (root, c.name);
+        fixture->func->get_private (acc)->commodity = c.comm;
+    }
+    add_price (book, stock, usd, now - 24 * 3600, gnc_numeric_create (15025, 100));
+    add_price (book, eur, usd, now - 24 * 3600, gnc_numeric_create (11, 10));
+    accounts = g_list_append (accounts, baz);
+    check_balances_as_of_dates (accounts, dates, n_dates, usd);
+
+    gnc_numeric *matrix = xaccAccountGetBalancesAsOfDates (
+        g_list_last (accounts), dates, n_dates, usd, FALSE);
+    gnc_numeric bal = xaccAccountGetBalanceAsOfDate (baz, G_MAXINT64);
+    g_assert (!gnc_numeric_zero_p (bal));
+    g_assert (gnc_numeric_equal (matrix[n_dates - 1],
+                                 gnc_numeric_mul (bal,
+                                                  gnc_numeric_create (15025, 100),
+                                                  100, GNC_HOW_RND_ROUND)));
+    g_free (matrix);
+    g_list_free (accounts);
+}
 /*
  * Yet more getters & setters:
  * xaccAccountGetSplitList
@@ -2558,6 +2771,7 @@ test_suite_account (void)
 // GNC_TEST_ADD (suitename, "xaccAcctChildrenEqual", Fixture, NULL, setup, test_xaccAcctChildrenEqual,  teardown );
 // GNC_TEST_ADD (suitename, "xaccAccountEqual", Fixture, NULL, setup, test_xaccAccountEqual,  teardown );
     GNC_TEST_ADD (suitename, "gnc account insert & remove split", Fixture, NULL, setup, test_gnc_account_insert_remove_split,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountSortSplits", Fixture, NULL, setup, test_xaccAccountSortSplits,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccount Insert and Remove Lot", Fixture, &good_data, setup, test_xaccAccountInsertRemoveLot,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountRecomputeBalance", Fixture, &some_data, setup, test_xaccAccountRecomputeBalance,  teardown );
     GNC_TEST_ADD_FUNC (suitename, "xaccAccountOrder", test_xaccAccountOrder );
@@ -2579,6 +2793,7 @@ test_suite_account (void)
     GNC_TEST_ADD (suitename, "xaccAccountGetProjectedMinimumBalance", Fixture, &some_data, setup, test_xaccAccountGetProjectedMinimumBalance,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetBalanceAsOfDate", Fixture, &some_data, setup, test_xaccAccountGetBalanceAsOfDate,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountGetPresentBalance", Fixture, &some_data, setup, test_xaccAccountGetPresentBalance,  teardown );
+    GNC_TEST_ADD (suitename, "xaccAccountGetBalancesAsOfDates", Fixture, &some_data, setup, test_xaccAccountGetBalancesAsOfDates,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountFindOpenLots", Fixture, &complex_data, setup, test_xaccAccountFindOpenLots,  teardown );
     GNC_TEST_ADD (suitename, "xaccAccountForEachLot", Fixture, &complex_data, setup, test_xaccAccountForEachLot,  teardown );
 
@@ -1129,11 +1129,46 @@ test_gnc_pricedb_lookup_nearest_in_time64 (PriceDBFixture *fixture, gconstpointe
     g_assert_cmpstr(GET_CUR_NAME(price), ==, "AUD");
     g_assert_cmpstr(GET_COM_NAME(price), ==, "USD");
 }
-// Not Used
 /* gnc_pricedb_lookup_latest_before_t64
 GNCPrice *
 gnc_pricedb_lookup_latest_before_t64 (GNCPriceDB *db,// Local: 0:0:0
 */
+static void
+test_gnc_pricedb_lookup_latest_before_t64 (PriceDBFixture *fixture, gconstpointer pData)
+{
+    time64 t = gnc_dmy2time64(1, 1, 2012);
+    GNCPrice *price =
+        gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                             fixture->com->usd,
+                                             fixture->com->aud, t);
+    /* The prices of both directions count. */
+    g_assert_cmpstr(GET_COM_NAME(price), ==, "AUD");
+    g_assert_cmpint(gnc_price_get_time64(price), ==, gnc_dmy2time64(20, 7, 2011));
+
+    t = gnc_dmy2time64(1, 1, 2015);
+    price = gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                 fixture->com->usd,
+                                                 fixture->com->aud, t);
+    g_assert_cmpstr(GET_COM_NAME(price), ==, "USD");
+    g_assert_cmpint(gnc_price_get_time64(price), ==, gnc_dmy2time64(12, 11, 2014));
+
+    t = gnc_dmy2time64(1, 1, 2009);
+    g_assert(gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                  fixture->com->usd,
+                                                  fixture->com->aud,
+                                                  t) == NULL);
+
+    /* Moving a price in time moves it in the lookups too. */
+    gnc_price_set_time64(price, gnc_dmy2time64(1, 1, 2008));
+    price = gnc_pricedb_lookup_latest_before_t64(fixture->pricedb,
+                                                 fixture->com->aud,
+                                                 fixture->com->usd, t);
+    g_assert(price != NULL);
+    g_assert_cmpint(gnc_price_get_time64(price), ==, gnc_dmy2time64(1, 1, 2008));
+    price = gnc_pricedb_lookup_latest(fixture->pricedb, fixture->com->usd,
+                                      fixture->com->aud);
+    g_assert_cmpint(gnc_price_get_time64(price), ==, gnc_dmy2time64(1, 8, 2013));
+}
 /* direct_balance_conversion
 static gnc_numeric
 direct_balance_conversion (GNCPriceDB *db, gnc_numeric bal,// Local: 2:0:0
@@ -1202,6 +1237,38 @@ test_gnc_pricedb_convert_balance_latest_price (PriceDBFixture *fixture, gconstpo
     g_assert_cmpint(result.denom, ==, 100);
 
 
+}
+static void
+test_gnc_pricedb_convert_balance_cached (PriceDBFixture *fixture, gconstpointer pData)
+{
+    QofBook *book = qof_instance_get_book(QOF_INSTANCE(fixture->pricedb));
+    gnc_numeric from = gnc_numeric_create(10000, 100);
+    GNCPrice *price;
+    /* GBP to DKK goes through USD. */
+    gnc_numeric result =
+        gnc_pricedb_convert_balance_latest_price(fixture->pricedb, from,
+                                                 fixture->com->gbp,
+                                                 fixture->com->dkk);
+    g_assert_cmpint(result.num, ==, 94389);
+    g_assert_cmpint(result.denom, ==, 100);
+
+    /* A newer USD price for DKK must replace the remembered one. */
+    price = construct_price(book, fixture->com->usd, fixture->com->dkk,
+                            gnc_dmy2time64(1, 1, 2015), PRICE_SOURCE_FQ,
+                            gnc_numeric_create(7, 1));
+    gnc_pricedb_add_price(fixture->pricedb, price);
+    result = gnc_pricedb_convert_balance_latest_price(fixture->pricedb, from,
+                                                      fixture->com->gbp,
+                                                      fixture->com->dkk);
+    g_assert_cmpint(result.num, ==, 110361);
+    g_assert_cmpint(result.denom, ==, 100);
+
+    gnc_pricedb_remove_price(fixture->pricedb, price);
+    result = gnc_pricedb_convert_balance_latest_price(fixture->pricedb, from,
+                                                      fixture->com->gbp,
+                                                      fixture->com->dkk);
+    g_assert_cmpint(result.num, ==, 94389);
+    g_assert_cmpint(result.denom, ==, 100);
 }
 /* gnc_pricedb_convert_balance_nearest_price_t64
 gnc_numeric
@@ -1498,11 +1565,13 @@ test_suite_gnc_pricedb (void)
     GNC_TEST_ADD (suitename, "gnc pricedb lookup day", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_day_t64, teardown);
 // GNC_TEST_ADD (suitename, "lookup nearest in time", Fixture, NULL, setup, test_lookup_nearest_in_time, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb lookup nearest in time", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_nearest_in_time64, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb lookup latest before", PriceDBFixture, NULL, setup, test_gnc_pricedb_lookup_latest_before_t64, teardown);
 // GNC_TEST_ADD (suitename, "direct balance conversion", Fixture, NULL, setup, test_direct_balance_conversion, teardown);
 // GNC_TEST_ADD (suitename, "extract common prices", Fixture, NULL, setup, test_extract_common_prices, teardown);
 // GNC_TEST_ADD (suitename, "convert balance", Fixture, NULL, setup, test_convert_balance, teardown);
 // GNC_TEST_ADD (suitename, "indirect balance conversion", Fixture, NULL, setup, test_indirect_balance_conversion, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance latest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_latest_price, teardown);
+    GNC_TEST_ADD (suitename, "gnc pricedb convert balance cached", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_cached, teardown);
     GNC_TEST_ADD (suitename, "gnc pricedb convert balance nearest price", PriceDBFixture, NULL, setup, test_gnc_pricedb_convert_balance_nearest_price_t64, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach pricelist", Fixture, NULL, setup, test_pricedb_foreach_pricelist, teardown);
 // GNC_TEST_ADD (suitename, "pricedb foreach currencies hash", Fixture, NULL, setup, test_pricedb_foreach_currencies_hash, teardown);